@@ -2,8 +2,12 @@
 #include <openssl/des.h>
 #include <openssl/err.h>
 #include <cstring>
+#include <charconv>
+#include <emmintrin.h>
+#include "../../ThreadCount.h"
 
 import std;
+#include "AgsiCodec.h"
 namespace fs = std::filesystem;
 
 extern "C" size_t lzss_compress(uint8_t* dst, unsigned int dstlen, uint8_t* src, unsigned int srclen);
@@ -46,59 +50,6 @@ uint8_t rot_byte_r(uint8_t value, int shift) {
     return (value >> shift) | (value << (8 - shift));
 }
 
-class AgsiMersenneTwister {
-private:
-    static constexpr int StateLength = 624;
-    static constexpr int StateM = 397;
-    static constexpr uint32_t MatrixA = 0x9908B0DF;
-    static constexpr uint32_t SignMask = 0x80000000;
-    static constexpr uint32_t LowerMask = 0x7FFFFFFF;
-    static constexpr uint32_t TemperingMaskB = 0x9D2C5680;
-    static constexpr uint32_t TemperingMaskC = 0xEFC60000;
-
-    std::array<uint32_t, StateLength> mt;
-    int mti = StateLength;
-    const std::array<uint32_t, 2> mag01 = { 0, MatrixA };
-
-public:
-    AgsiMersenneTwister(uint32_t seed) {
-        srand(seed);
-    }
-
-    void srand(uint32_t seed) {
-        for (mti = 0; mti < StateLength; ++mti) {
-            uint32_t upper = seed & 0xFFFF0000;
-            seed = 69069 * seed + 1;
-            mt[mti] = upper | ((seed & 0xFFFF0000) >> 16);
-            seed = 69069 * seed + 1;
-        }
-    }
-
-    uint32_t rand() {
-        uint32_t y;
-        if (mti >= StateLength) {
-            int kk;
-            for (kk = 0; kk < StateLength - StateM; kk++) {
-                y = (mt[kk] & SignMask) | (mt[kk + 1] & LowerMask);
-                mt[kk] = mt[kk + StateM] ^ (y >> 1) ^ mag01[y & 1];
-            }
-            for (; kk < StateLength - 1; kk++) {
-                y = (mt[kk] & SignMask) | (mt[kk + 1] & LowerMask);
-                mt[kk] = mt[kk + (StateM - StateLength)] ^ (y >> 1) ^ mag01[y & 1];
-            }
-            y = (mt[StateLength - 1] & SignMask) | (mt[0] & LowerMask);
-            mt[StateLength - 1] = mt[StateM - 1] ^ (y >> 1) ^ mag01[y & 1];
-            mti = 0;
-        }
-        y = mt[mti++];
-        y ^= y >> 11;
-        y ^= (y << 7) & TemperingMaskB;
-        y ^= (y << 15) & TemperingMaskC;
-        y ^= y >> 18;
-        return y;
-    }
-};
-
 // --- 数据结构 ---
 
 // 解包用
@@ -131,71 +82,7 @@ void decrypt_header(std::vector<uint8_t>& header, uint8_t k1, uint8_t k2) {
 }
 
 void decrypt_index(std::vector<uint8_t>& index_data, uint32_t seed) {
-    AgsiMersenneTwister rnd(seed);
-    for (size_t i = 0; i < index_data.size(); ++i) {
-        uint32_t key = rnd.rand();
-        int shift = key & 7;
-        if (shift == 0) shift = 1;
-        uint8_t x = rot_byte_l(index_data[i], shift);
-        index_data[i] = static_cast<uint8_t>(key) ^ x;
-    }
-}
-
-class BitStreamReader {
-private:
-    const std::vector<uint8_t>& m_buffer;
-    size_t m_byte_pos = 0;
-    uint8_t m_bit_pos = 0;
-public:
-    BitStreamReader(const std::vector<uint8_t>& buffer) : m_buffer(buffer) {}
-    int get_bit() {
-        if (m_byte_pos >= m_buffer.size()) return -1;
-        int bit = (m_buffer[m_byte_pos] >> (7 - m_bit_pos)) & 1;
-        if (++m_bit_pos == 8) { m_bit_pos = 0; m_byte_pos++; }
-        return bit;
-    }
-    int get_bits(int count) {
-        int value = 0;
-        for (int i = 0; i < count; ++i) {
-            int bit = get_bit();
-            if (bit == -1) return -1;
-            value = (value << 1) | bit;
-        }
-        return value;
-    }
-};
-
-std::vector<uint8_t> decompress_lzbitstream(const std::vector<uint8_t>& input, uint32_t unpacked_size) {
-    std::vector<uint8_t> output;
-    output.reserve(unpacked_size);
-    std::vector<uint8_t> frame(0x1000, 0);
-    int frame_pos = 1;
-    BitStreamReader reader(input);
-    while (output.size() < unpacked_size) {
-        int bit = reader.get_bit();
-        if (bit == -1) break;
-        if (bit != 0) {
-            int v = reader.get_bits(8);
-            if (v == -1) break;
-            uint8_t byte_v = static_cast<uint8_t>(v);
-            output.push_back(byte_v);
-            frame[frame_pos++ & 0xFFF] = byte_v;
-        }
-        else {
-            int offset = reader.get_bits(12);
-            if (offset == -1) break;
-            int count = reader.get_bits(4);
-            if (count == -1) break;
-            count += 2;
-            for (int i = 0; i < count; ++i) {
-                uint8_t v = frame[offset++ & 0xFFF];
-                output.push_back(v);
-                frame[frame_pos++ & 0xFFF] = v;
-                if (output.size() >= unpacked_size) break;
-            }
-        }
-    }
-    return output;
+    agsi::crypt_index<false>(index_data, seed);
 }
 
 std::vector<uint8_t> decompress_lzss(const std::vector<uint8_t>& input, uint32_t unpacked_size) {
@@ -208,15 +95,7 @@ std::vector<uint8_t> decompress_lzss(const std::vector<uint8_t>& input, uint32_t
 }
 
 void encrypt_index(std::vector<uint8_t>& index_data, uint32_t seed) {
-    AgsiMersenneTwister rnd(seed);
-    for (size_t i = 0; i < index_data.size(); ++i) {
-        uint8_t original_byte = index_data[i];
-        uint32_t key = rnd.rand();
-        int shift = key & 7;
-        if (shift == 0) shift = 1;
-        uint8_t key_byte = static_cast<uint8_t>(key);
-        index_data[i] = rot_byte_r(original_byte ^ key_byte, shift);
-    }
+    agsi::crypt_index<true>(index_data, seed);
 }
 
 void encrypt_header(std::vector<uint8_t>& header, uint8_t k1, uint8_t k2) {
@@ -228,9 +107,65 @@ void encrypt_header(std::vector<uint8_t>& header, uint8_t k1, uint8_t k2) {
     }
 }
 
+// 解出单个条目。条目之间互不依赖，file_data 和 schedule 只读 (DES_ecb_encrypt 的参数不带 const)，可在多个线程中同时调用
+bool extract_entry(const AgsiEntry& entry, const std::vector<uint8_t>& file_data, DES_key_schedule* schedule,
+    const fs::path& out_dir, std::ostream& out, std::ostream& err) {
+    out << " - Extracting " << std::left << std::setw(20) << entry.name << " (Method: " << entry.method << ", Size: " << entry.size << ")" << std::endl;
+    std::vector<uint8_t> entry_data(file_data.begin() + entry.offset, file_data.begin() + entry.offset + entry.size);
+    if (entry.is_encrypted) {
+        if (!schedule) { err << "   Warning: Skipping encrypted file. No DES key provided." << std::endl; return false; }
+        uint32_t enc_size = entry.size;
+        if (enc_size > 1024) enc_size = 1032;
+        enc_size &= ~7;
+        if (enc_size == 0 && entry.size > 0) { err << "   Warning: Encrypted part is too small. Skipping." << std::endl; return false; }
+        std::vector<uint8_t> encrypted_part(entry_data.begin(), entry_data.begin() + enc_size);
+        std::vector<uint8_t> decrypted_part(enc_size);
+        for (size_t i = 0; i < enc_size; i += 8) DES_ecb_encrypt(reinterpret_cast<const_DES_cblock*>(encrypted_part.data() + i), reinterpret_cast<DES_cblock*>(decrypted_part.data() + i), schedule, DES_DECRYPT);
+        uint32_t header_size;
+        if (!entry.is_special) {
+            header_size = read_le<uint32_t>(decrypted_part, decrypted_part.size() - 4);
+            if (header_size > entry.unpacked_size) { err << "   Warning: Invalid encryption scheme or key for " << entry.name << ". Skipping." << std::endl; return false; }
+        }
+        else { header_size = entry.unpacked_size; }
+        if (header_size > decrypted_part.size()) { err << "   Warning: Decrypted header size is larger than decrypted block for " << entry.name << ". Skipping." << std::endl; return false; }
+        if (entry.size > enc_size) {
+            entry_data.assign(decrypted_part.begin(), decrypted_part.begin() + header_size);
+            entry_data.insert(entry_data.end(), file_data.begin() + entry.offset + enc_size, file_data.begin() + entry.offset + entry.size);
+        }
+        else { entry_data.assign(decrypted_part.begin(), decrypted_part.begin() + header_size); }
+    }
+    std::vector<uint8_t> final_data;
+    bool success = true;
+    switch (entry.method) {
+    case 0: case 3: final_data = std::move(entry_data); break;
+    case 1: case 4: err << "   Warning: RLE decompression (Method " << entry.method << ") is not implemented. Skipping." << std::endl; success = false; break;
+    case 2: case 5: try { final_data = agsi::decompress_lzbitstream(entry_data, entry.unpacked_size); }
+          catch (const std::exception& e) { err << "   Error during LZSS decompression: " << e.what() << std::endl; success = false; } break;
+    case 6: case 7: try { final_data = decompress_lzss(entry_data, entry.unpacked_size); }
+          catch (const std::exception& e) { err << "   Error during LZSS decompression: " << e.what() << std::endl; success = false; } break;
+    default: err << "   Warning: Unknown method " << entry.method << ". Skipping." << std::endl; success = false; break;
+    }
+    if (!success) return false;
+    fs::path out_path = out_dir / entry.name;
+    std::ofstream out_file(out_path, std::ios::binary);
+    if (!out_file) { err << "   Error: Cannot create output file " << out_path << std::endl; return false; }
+    out_file.write(reinterpret_cast<const char*>(final_data.data()), final_data.size());
+    return true;
+}
+
 int do_unpack(int argc, char* argv[]) {
-    if (argc < 4 || argc > 5) {
-        std::cerr << "Usage: " << argv[0] << " extract <pak_file> <output_directory> [des_key_hex]" << std::endl;
+    unsigned int num_threads = 0;
+    bool bad_threads = false;
+    if (argc >= 6 && std::string(argv[argc - 2]) == "--threads") {
+        // 非数字、超出范围或为 0 时打印用法
+        const char* value = argv[argc - 1];
+        const char* end = value + strlen(value);
+        auto [ptr, ec] = std::from_chars(value, end, num_threads);
+        bad_threads = ec != std::errc() || ptr != end || num_threads == 0;
+        argc -= 2;
+    }
+    if (bad_threads || argc < 4 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " extract <pak_file> <output_directory> [des_key_hex] [--threads N]" << std::endl;
         return 1;
     }
     fs::path pak_path = argv[2];
@@ -314,52 +249,49 @@ int do_unpack(int argc, char* argv[]) {
         std::cerr << "Error creating output directory: " << e.what() << std::endl; return 1;
     }
     std::cout << "Extracting files to: " << out_dir << std::endl;
-    for (const auto& entry : dir) {
-        std::cout << " - Extracting " << std::left << std::setw(20) << entry.name << " (Method: " << entry.method << ", Size: " << entry.size << ")" << std::endl;
-        std::vector<uint8_t> entry_data(file_data.begin() + entry.offset, file_data.begin() + entry.offset + entry.size);
-        if (entry.is_encrypted) {
-            if (des_key_bytes.empty()) { std::cerr << "   Warning: Skipping encrypted file. No DES key provided." << std::endl; continue; }
-            uint32_t enc_size = entry.size;
-            if (enc_size > 1024) enc_size = 1032;
-            enc_size &= ~7;
-            if (enc_size == 0 && entry.size > 0) { std::cerr << "   Warning: Encrypted part is too small. Skipping." << std::endl; continue; }
-            std::vector<uint8_t> encrypted_part(entry_data.begin(), entry_data.begin() + enc_size);
-            std::vector<uint8_t> decrypted_part(enc_size);
-            DES_cblock key_block;
-            std::memcpy(key_block, des_key_bytes.data(), 8);
-            DES_key_schedule schedule;
-            DES_set_key_unchecked(&key_block, &schedule);
-            for (size_t i = 0; i < enc_size; i += 8) DES_ecb_encrypt(reinterpret_cast<const_DES_cblock*>(encrypted_part.data() + i), reinterpret_cast<DES_cblock*>(decrypted_part.data() + i), &schedule, DES_DECRYPT);
-            uint32_t header_size;
-            if (!entry.is_special) {
-                header_size = read_le<uint32_t>(decrypted_part, decrypted_part.size() - 4);
-                if (header_size > entry.unpacked_size) { std::cerr << "   Warning: Invalid encryption scheme or key for " << entry.name << ". Skipping." << std::endl; continue; }
-            }
-            else { header_size = entry.unpacked_size; }
-            if (header_size > decrypted_part.size()) { std::cerr << "   Warning: Decrypted header size is larger than decrypted block for " << entry.name << ". Skipping." << std::endl; continue; }
-            if (entry.size > enc_size) {
-                entry_data.assign(decrypted_part.begin(), decrypted_part.begin() + header_size);
-                entry_data.insert(entry_data.end(), file_data.begin() + entry.offset + enc_size, file_data.begin() + entry.offset + entry.size);
+    DES_key_schedule* schedule = nullptr;
+    DES_key_schedule des_schedule;
+    if (!des_key_bytes.empty()) {
+        DES_cblock key_block;
+        std::memcpy(key_block, des_key_bytes.data(), 8);
+        DES_set_key_unchecked(&key_block, &des_schedule);
+        schedule = &des_schedule;
+    }
+
+    // 整个封包已在内存中，各条目分给多个线程解密、解压和写出；每个条目的输出攒齐后一次打印
+    if (num_threads == 0) {
+        num_threads = defaultThreadCount();
+    }
+    num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, dir.size()));
+
+    std::atomic<size_t> next_entry{ 0 };
+    std::atomic<uint64_t> bytes_out{ 0 };
+    std::mutex output_mutex;
+    auto start_time = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        for (size_t i = next_entry++; i < dir.size(); i = next_entry++) {
+            std::ostringstream out, err;
+            if (extract_entry(dir[i], file_data, schedule, out_dir, out, err)) {
+                bytes_out += fs::file_size(out_dir / dir[i].name);
             }
-            else { entry_data.assign(decrypted_part.begin(), decrypted_part.begin() + header_size); }
-        }
-        std::vector<uint8_t> final_data;
-        bool success = true;
-        switch (entry.method) {
-        case 0: case 3: final_data = std::move(entry_data); break;
-        case 1: case 4: std::cerr << "   Warning: RLE decompression (Method " << entry.method << ") is not implemented. Skipping." << std::endl; success = false; break;
-        case 2: case 5: try { final_data = decompress_lzbitstream(entry_data, entry.unpacked_size); }
-              catch (const std::exception& e) { std::cerr << "   Error during LZSS decompression: " << e.what() << std::endl; success = false; } break;
-        case 6: case 7: try { final_data = decompress_lzss(entry_data, entry.unpacked_size); }
-              catch (const std::exception& e) { std::cerr << "   Error during LZSS decompression: " << e.what() << std::endl; success = false; } break;
-        default: std::cerr << "   Warning: Unknown method " << entry.method << ". Skipping." << std::endl; success = false; break;
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << out.str();
+            std::cerr << err.str();
         }
-        if (!success) continue;
-        fs::path out_path = out_dir / entry.name;
-        std::ofstream out_file(out_path, std::ios::binary);
-        if (!out_file) { std::cerr << "   Error: Cannot create output file " << out_path << std::endl; continue; }
-        out_file.write(reinterpret_cast<const char*>(final_data.data()), final_data.size());
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(worker);
     }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << std::format("\nExtracted {} entries ({:.2f} MB) in {:.3f}s with {} threads, {:.1f} MB/s.",
+        dir.size(), bytes_out / 1048576.0, seconds, num_threads, seconds > 0 ? bytes_out / 1048576.0 / seconds : 0.0) << std::endl;
     std::cout << "\nExtraction complete." << std::endl;
     return 0;
 }
@@ -453,10 +385,11 @@ int do_pack(int argc, char* argv[]) {
 void print_usage(fs::path prog_name) {
     std::cout << "Made by julixian 2025.08.19" << std::endl;
     std::cout << "Usage: \n"
-        << "For extract: " << prog_name.filename() << " extract <input_pak> <output_dir> [des_key_hex]\n"
+        << "For extract: " << prog_name.filename() << " extract <input_pak> <output_dir> [des_key_hex] [--threads N]\n"
         << "For pack: " << prog_name.filename() << " pack <input_dir> <output_pak> [--encrypt | -e]\n"
         << "des_key_hex: should be a 16-character hex string.\n"
         << "--encrypt | -e: encrypt the index and header of the pak file when packing.\n"
+        << "--threads N: number of extraction threads (default: CPU count).\n"
         << "For example: \n"
         << prog_name.filename() << " extract data04.pak data04_extracted 0xcf364e455852d3b2\n"
         << prog_name.filename() << " pack data04_repack data04_new.pak -e" 
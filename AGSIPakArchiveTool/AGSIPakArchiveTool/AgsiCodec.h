@@ -0,0 +1,205 @@
+﻿#pragma once
+
+// AGSI 封包的索引加密和位流 LZ 解码。
+// 在 import std; 之后包含，依赖 <cstring> 和 <emmintrin.h>。
+
+namespace agsi {
+
+// AGSI 使用的 MT19937 (69069 LCG 初始化)。
+// 每次用 SSE2 扭转整个状态并一次回火全部 624 个字，取数时直接拷贝整块
+class MersenneTwister {
+private:
+    static constexpr int StateLength = 624;
+    static constexpr int StateM = 397;
+    static constexpr uint32_t MatrixA = 0x9908B0DF;
+    static constexpr uint32_t SignMask = 0x80000000;
+    static constexpr uint32_t LowerMask = 0x7FFFFFFF;
+    static constexpr uint32_t TemperingMaskB = 0x9D2C5680;
+    static constexpr uint32_t TemperingMaskC = 0xEFC60000;
+
+    alignas(16) std::array<uint32_t, StateLength> mt;
+    alignas(16) std::array<uint32_t, StateLength> tempered;
+    int mti = StateLength;
+
+    static uint32_t twist_one(uint32_t upper, uint32_t lower, uint32_t far) {
+        uint32_t y = (upper & SignMask) | (lower & LowerMask);
+        return far ^ (y >> 1) ^ ((0u - (y & 1)) & MatrixA);
+    }
+
+    // 4 个相邻位置同时扭转：读取的 mt[kk + 1..kk + 4] 尚未更新，mt[kk + M] 与 kk 相距至少 227，互不重叠
+    static __m128i twist_four(__m128i upper, __m128i lower, __m128i far) {
+        const __m128i sign = _mm_set1_epi32(static_cast<int>(SignMask));
+        const __m128i one = _mm_set1_epi32(1);
+        __m128i y = _mm_or_si128(_mm_and_si128(upper, sign), _mm_andnot_si128(sign, lower));
+        __m128i mag = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(y, one), one), _mm_set1_epi32(static_cast<int>(MatrixA)));
+        return _mm_xor_si128(_mm_xor_si128(far, _mm_srli_epi32(y, 1)), mag);
+    }
+
+    __m128i load(int i) const { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(mt.data() + i)); }
+
+    void twist() {
+        int kk = 0;
+        for (; kk + 4 <= StateLength - StateM; kk += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mt.data() + kk), twist_four(load(kk), load(kk + 1), load(kk + StateM)));
+        }
+        for (; kk < StateLength - StateM; ++kk) {
+            mt[kk] = twist_one(mt[kk], mt[kk + 1], mt[kk + StateM]);
+        }
+        for (; kk + 4 <= StateLength - 1; kk += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mt.data() + kk), twist_four(load(kk), load(kk + 1), load(kk + StateM - StateLength)));
+        }
+        for (; kk < StateLength - 1; ++kk) {
+            mt[kk] = twist_one(mt[kk], mt[kk + 1], mt[kk + StateM - StateLength]);
+        }
+        mt[StateLength - 1] = twist_one(mt[StateLength - 1], mt[0], mt[StateM - 1]);
+
+        const __m128i maskB = _mm_set1_epi32(static_cast<int>(TemperingMaskB));
+        const __m128i maskC = _mm_set1_epi32(static_cast<int>(TemperingMaskC));
+        for (int i = 0; i < StateLength; i += 4) {
+            __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(mt.data() + i));
+            y = _mm_xor_si128(y, _mm_srli_epi32(y, 11));
+            y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 7), maskB));
+            y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 15), maskC));
+            y = _mm_xor_si128(y, _mm_srli_epi32(y, 18));
+            _mm_store_si128(reinterpret_cast<__m128i*>(tempered.data() + i), y);
+        }
+        mti = 0;
+    }
+
+public:
+    explicit MersenneTwister(uint32_t seed) {
+        srand(seed);
+    }
+
+    void srand(uint32_t seed) {
+        for (int i = 0; i < StateLength; ++i) {
+            uint32_t upper = seed & 0xFFFF0000;
+            seed = 69069 * seed + 1;
+            mt[i] = upper | ((seed & 0xFFFF0000) >> 16);
+            seed = 69069 * seed + 1;
+        }
+        mti = StateLength;
+    }
+
+    // 依次取出 count 个随机数，与逐个调用 rand() 的结果相同
+    void generate(uint32_t* out, size_t count) {
+        while (count > 0) {
+            if (mti >= StateLength) twist();
+            size_t n = std::min<size_t>(count, StateLength - mti);
+            std::memcpy(out, tempered.data() + mti, n * sizeof(uint32_t));
+            out += n;
+            count -= n;
+            mti += static_cast<int>(n);
+        }
+    }
+};
+
+// rotate_table<Left>[key & 7][x]：按 key 低 3 位 (0 视为 1) 循环移位，省掉逐字节的变量移位
+template<bool Left>
+inline const std::array<std::array<uint8_t, 256>, 8> rotate_table = [] {
+    std::array<std::array<uint8_t, 256>, 8> table{};
+    for (int k = 0; k < 8; ++k) {
+        int shift = k == 0 ? 1 : k;
+        for (int x = 0; x < 256; ++x) {
+            table[k][x] = static_cast<uint8_t>(Left ? (x << shift) | (x >> (8 - shift)) : (x >> shift) | (x << (8 - shift)));
+        }
+    }
+    return table;
+}();
+
+// 索引逐字节：解密为 key ^ rol(x, shift)，加密为 ror(x ^ key, shift)
+template<bool Encrypt>
+void crypt_index(std::vector<uint8_t>& index_data, uint32_t seed) {
+    const auto& rotate = rotate_table<!Encrypt>;
+    MersenneTwister rnd(seed);
+    std::array<uint32_t, 1024> keys;
+    for (size_t pos = 0; pos < index_data.size(); pos += keys.size()) {
+        size_t n = std::min(keys.size(), index_data.size() - pos);
+        rnd.generate(keys.data(), n);
+        uint8_t* p = index_data.data() + pos;
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t key_byte = static_cast<uint8_t>(keys[i]);
+            if constexpr (Encrypt) {
+                p[i] = rotate[keys[i] & 7][p[i] ^ key_byte];
+            }
+            else {
+                p[i] = rotate[keys[i] & 7][p[i]] ^ key_byte;
+            }
+        }
+    }
+}
+
+// MSB 优先的位读取器。64 位缓存一次补充最多 7 个字节，每个 token 只检查一次剩余位数
+class BitReader {
+private:
+    const uint8_t* m_ptr;
+    const uint8_t* m_end;
+    uint64_t m_bits = 0;   // 左对齐
+    int m_count = 0;
+
+public:
+    BitReader(const uint8_t* data, size_t size) : m_ptr(data), m_end(data + size) {}
+
+    // 补充后至少有 57 位，除非输入已经读完
+    void refill() {
+        if (m_end - m_ptr >= 8) {
+            uint64_t v;
+            std::memcpy(&v, m_ptr, 8);
+            v = std::byteswap(v);
+            m_bits |= v >> m_count;
+            m_ptr += (63 - m_count) >> 3;
+            m_count |= 56;
+        }
+        else {
+            while (m_count <= 56 && m_ptr < m_end) {
+                m_bits |= static_cast<uint64_t>(*m_ptr++) << (56 - m_count);
+                m_count += 8;
+            }
+        }
+    }
+
+    int available() const { return m_count; }
+
+    // 调用前需保证 available() >= count
+    uint32_t take(int count) {
+        uint32_t v = static_cast<uint32_t>(m_bits >> (64 - count));
+        m_bits <<= count;
+        m_count -= count;
+        return v;
+    }
+};
+
+// 位流 LZ：1 位标志，1 = 8 位字面量，0 = 12 位窗口位置 + 4 位长度 (+2)。
+// 窗口 4096 字节，初始为 0，写入位置从 1 开始。输入提前结束时返回已解出的部分
+inline std::vector<uint8_t> decompress_lzbitstream(const std::vector<uint8_t>& input, uint32_t unpacked_size) {
+    std::vector<uint8_t> output(unpacked_size);
+    uint8_t* out = output.data();
+    size_t pos = 0;
+    BitReader reader(input.data(), input.size());
+
+    while (pos < unpacked_size) {
+        reader.refill();
+        if (reader.available() < 1) break;
+        if (reader.take(1) != 0) {
+            if (reader.available() < 8) break;
+            out[pos++] = static_cast<uint8_t>(reader.take(8));
+        }
+        else {
+            if (reader.available() < 16) break;
+            uint32_t offset = reader.take(12);
+            size_t count = reader.take(4) + 2;
+
+            // 窗口位置 offset 对应距离 distance 之前的输出；距离超出已输出部分时读到的是初始的 0
+            size_t distance = ((pos + 1 - offset) & 0xFFF);
+            if (distance == 0) distance = 0x1000;
+            count = std::min<size_t>(count, unpacked_size - pos);
+            for (size_t i = 0; i < count; ++i, ++pos) {
+                out[pos] = pos >= distance ? out[pos - distance] : 0;
+            }
+        }
+    }
+    output.resize(pos);
+    return output;
+}
+
+} // namespace agsi
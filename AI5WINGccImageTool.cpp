@@ -6,70 +6,12 @@
 #include <png.h>
 #include <filesystem>
 #include <string>
+#include <algorithm>
+#include <iomanip>
+#include "ImageEncoders.h"
 
 namespace fs = std::filesystem;
 
-#pragma pack(push, 1)
-struct GccHeader {
-    uint32_t signature;  // 'G24m'
-    int16_t offsetX;
-    int16_t offsetY;
-    uint16_t width;
-    uint16_t height;
-    uint32_t alphaOffset;
-    uint32_t imageOffset;
-    uint32_t reserved;
-    uint16_t alphaWidth;
-    uint16_t alphaHeight;
-    uint32_t alphaInternalOffset;
-};
-#pragma pack(pop)
-
-class LzssCompressor {
-public:
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        for (size_t i = 0; i < input.size(); i += 8) {
-            output.push_back(0xFF);
-            for (size_t j = 0; j < 8 && i + j < input.size(); ++j) {
-                output.push_back(input[i + j]);
-            }
-        }
-        return output;
-    }
-};
-
-class AlphaCompressor {
-public:
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> controlBytes;
-        std::vector<uint8_t> dataBytes;
-
-        // 每8个像素一组，生成一个控制字节
-        for (size_t i = 0; i < input.size(); i += 8) {
-            uint8_t controlByte = 0;
-
-            // 处理这8个像素
-            for (size_t j = 0; j < 8 && (i + j) < input.size(); ++j) {
-                // 设置控制位为0（直接字节）
-                controlByte |= (0 << j);
-                // 添加数据字节
-                dataBytes.push_back(input[i + j]);
-            }
-
-            // 添加控制字节
-            controlBytes.push_back(controlByte);
-        }
-
-        // 合并输出：先是所有控制字节，然后是所有数据字节
-        std::vector<uint8_t> output;
-        output.insert(output.end(), controlBytes.begin(), controlBytes.end());
-        output.insert(output.end(), dataBytes.begin(), dataBytes.end());
-
-        return output;
-    }
-};
-
 // PNG读取结构体
 struct PngData {
     std::vector<uint8_t> rgba;
@@ -106,8 +48,7 @@ PngData readPng(const std::string& filename) {
     result.rgba.resize(result.width * result.height * 4);
     std::vector<png_bytep> row_pointers(result.height);
     for (size_t y = 0; y < result.height; ++y) {
-        // 修改这里：从下到上读取PNG数据
-        row_pointers[result.height - 1 - y] = result.rgba.data() + y * result.width * 4;
+        row_pointers[y] = result.rgba.data() + y * result.width * 4;
     }
     png_read_image(png, row_pointers.data());
 
@@ -116,21 +57,16 @@ PngData readPng(const std::string& filename) {
     return result;
 }
 
-// 读取原始GCC文件头
-GccHeader readGccHeader(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) throw std::runtime_error("Cannot open GCC file");
-
-    GccHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
-    return header;
-}
-
 bool processFiles(const std::string& pngDir, const std::string& origDir, const std::string& outDir) {
 
     try {
         fs::create_directories(outDir);
 
+        size_t totalNewSize = 0;
+        size_t totalRawSize = 0;
+        size_t totalOrigSize = 0;
+        size_t totalNewSizeWithOrig = 0;
+
         for (const auto& entry : fs::directory_iterator(pngDir)) {
             if (entry.path().extension() != ".png") {
                 continue;
@@ -143,73 +79,20 @@ bool processFiles(const std::string& pngDir, const std::string& origDir, const s
             // 读取PNG文件以获取尺寸
             PngData pngData = readPng(entry.path().string());
 
-            // 创建默认的GCC头部
-            GccHeader newHeader = { 0 };
-            newHeader.signature = 0x6D343247; // G24m
-            newHeader.width = pngData.width;
-            newHeader.height = pngData.height;
-            newHeader.imageOffset = 0x20;
-
-            if (fs::exists(origGccPath)) {
-                // 如果存在原始GCC文件，读取它的头部
-                std::ifstream origFile(origGccPath, std::ios::binary);
-                GccHeader origHeader;
-                origFile.read(reinterpret_cast<char*>(&origHeader), sizeof(origHeader));
-                newHeader.imageOffset = origHeader.imageOffset;
-
-                if (origHeader.signature == 0x6d343247 || origHeader.signature == 0x6d343252) {
-                    // 使用原始文件的Alpha尺寸和偏移
-                    newHeader.offsetX = origHeader.offsetX;
-                    newHeader.offsetY = origHeader.offsetY;
-                    newHeader.alphaWidth = origHeader.alphaWidth;
-                    newHeader.alphaHeight = origHeader.alphaHeight;
-                }
-                else if (origHeader.signature == 0x6e343247 || origHeader.signature == 0x6e343252) {
-                    // 24n模式使用PNG尺寸作为Alpha尺寸
-                    newHeader.offsetX = origHeader.offsetX;
-                    newHeader.offsetY = origHeader.offsetY;
-                    newHeader.alphaWidth = pngData.width;
-                    newHeader.alphaHeight = pngData.height;
-                }
-
-            }
-            else {
-                newHeader.offsetX = 0;
-                newHeader.offsetY = 0;
-                newHeader.alphaWidth = pngData.width;
-                newHeader.alphaHeight = pngData.height;
+            // 头部、BGR/Alpha 数据和 LZSS 压缩与 BatchImageConvertTool 共用 ImageEncoders.h
+            GccHeader origHeader;
+            bool hasOrig = readGccHeader(origGccPath, origHeader);
+            std::vector<uint8_t> gccData;
+            try {
+                gccData = encodeGcc(pngData.rgba.data(), pngData.width, pngData.height,
+                    hasOrig ? &origHeader : nullptr, LzssTreeEncoder::threadLocal());
             }
-
-            // 处理图像数据
-            std::vector<uint8_t> bgrData;
-            std::vector<uint8_t> alphaData(newHeader.alphaWidth * newHeader.alphaHeight, 0);
-
-            // 转换RGBA到BGR并提取Alpha
-            bgrData.reserve(pngData.width * pngData.height * 3);
-            for (size_t y = 0; y < pngData.height; ++y) {
-                for (size_t x = 0; x < pngData.width; ++x) {
-                    size_t srcPos = (y * pngData.width + x) * 4;
-                    bgrData.push_back(pngData.rgba[srcPos + 2]); // B
-                    bgrData.push_back(pngData.rgba[srcPos + 1]); // G
-                    bgrData.push_back(pngData.rgba[srcPos + 0]); // R
-
-                    // 放置Alpha数据
-                    size_t alphaPos = ((newHeader.alphaHeight - newHeader.offsetY - pngData.height + y) *
-                        newHeader.alphaWidth + x + newHeader.offsetX);
-                    alphaData[alphaPos] = pngData.rgba[srcPos + 3];
-                }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to encode " << baseName << ": " << e.what() << std::endl;
+                continue;
             }
-
-            // 压缩数据
-            LzssCompressor lzssComp;
-            AlphaCompressor alphaComp;
-            auto compressedBgr = lzssComp.compress(bgrData);
-            auto compressedAlpha = alphaComp.compress(alphaData);
-
-            // 更新头部信息
-            newHeader.alphaOffset = compressedBgr.size();
-            newHeader.alphaInternalOffset = (alphaData.size() + 7) / 8;
-
+            GccHeader newHeader;
+            memcpy(&newHeader, gccData.data(), sizeof(newHeader));
             // 写入文件
             std::ofstream outFile(outGccPath, std::ios::binary);
             if (!outFile) {
@@ -217,13 +100,32 @@ bool processFiles(const std::string& pngDir, const std::string& origDir, const s
                 continue;
             }
 
-            outFile.write(reinterpret_cast<char*>(&newHeader), sizeof(newHeader));
-            outFile.write(reinterpret_cast<char*>(compressedBgr.data()), compressedBgr.size());
-            outFile.write(reinterpret_cast<char*>(compressedAlpha.data()), compressedAlpha.size());
-
-            std::cout << "Successfully processed " << baseName << std::endl;
+            outFile.write(reinterpret_cast<char*>(gccData.data()), gccData.size());
+
+            outFile.close();
+
+            // 与原始游戏文件比较大小
+            size_t newSize = gccData.size();
+            size_t rawSize = sizeof(newHeader) + (size_t)newHeader.width * newHeader.height * 3 +
+                (size_t)newHeader.alphaWidth * newHeader.alphaHeight;
+            std::cout << "Successfully processed " << baseName << ": " << newSize << " bytes (raw " << rawSize;
+            if (hasOrig) {
+                size_t origSize = fs::file_size(origGccPath);
+                std::cout << ", original " << origSize << ", " << std::fixed << std::setprecision(1)
+                    << (origSize ? 100.0 * newSize / origSize : 0.0) << "%";
+                totalOrigSize += origSize;
+                totalNewSizeWithOrig += newSize;
+            }
+            std::cout << ")" << std::endl;
+            totalNewSize += newSize;
+            totalRawSize += rawSize;
         }
 
+        std::cout << "Total: " << totalNewSize << " bytes (raw " << totalRawSize << ")" << std::endl;
+        if (totalOrigSize) {
+            std::cout << "Files with original GCC: " << totalNewSizeWithOrig << " bytes vs original " << totalOrigSize
+                << " bytes (" << std::fixed << std::setprecision(1) << 100.0 * totalNewSizeWithOrig / totalOrigSize << "%)" << std::endl;
+        }
         return true;
     }
     catch (const std::exception& e) {
@@ -1,8 +1,11 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
 #include <cstdint>
+#define NOMINMAX
 #include <Windows.h>
+#include <emmintrin.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
+#include "../../ThreadCount.h"
 
 import std;
 namespace fs = std::filesystem;
@@ -32,193 +35,242 @@ enum class PixelFormat {
     UNKNOWN
 };
 
-void restore_delta(std::vector<uint8_t>& pixels, int stride, int pixel_size) {
-    if (pixels.empty() || stride == 0) return;
-
-    // 还原每一行内部的差值: 当前像素 += 左边像素
-    for (size_t y = 0; y < pixels.size() / stride; ++y) {
-        size_t row_start = y * stride;
-        for (int i = pixel_size; i < stride; ++i) {
-            pixels[row_start + i] += pixels[row_start + i - pixel_size];
-        }
-    }
+struct AkbInfo {
+    AkbHeader header;
+    int32_t inner_width;
+    int32_t inner_height;
+    int32_t bpp;
+};
 
-    // 还原行与行之间的差值: 当前行像素 += 上一行像素
-    for (size_t i = stride; i < pixels.size(); ++i) {
-        pixels[i] += pixels[i - stride];
-    }
+// 交换每个 32 位像素的第 0 和第 2 字节 (BGRA <-> RGBA)
+static inline __m128i swap_red_blue(__m128i v) {
+    const __m128i keep = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    __m128i ag = _mm_and_si128(v, keep);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+    __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+    return _mm_or_si128(ag, _mm_or_si128(b, r));
 }
 
-// C#代码中的RestoreDelta实现是混合的，这里也进行修正以严格匹配
-void restore_delta_csharp_equivalent(std::vector<uint8_t>& pixels, int stride, int pixel_size) {
-    if (pixels.empty()) return;
+// C# 的 RestoreDelta：第一行加左边像素，后续行加上一行。
+// 解压后的行是倒序存放的 (C# 读取时倒着填行)，这里直接在解压缓冲区里从最后一行往前就地还原，
+// 每还原一行就立即转换为 RGB(A) 并合成到最终图像，省去翻转用的第二个缓冲区和额外的整图遍历。
+void decode_akb_rows(uint8_t* pixels, const AkbInfo& info, int pixel_size, int num_components, uint8_t* final_image) {
+    const AkbHeader& header = info.header;
+    const size_t inner_stride = (size_t)info.inner_width * pixel_size;
+    const size_t final_stride = (size_t)header.width * num_components;
 
-    // C# 版本: 还原第一行
-    for (int i = pixel_size; i < stride; ++i) {
-        pixels[i] += pixels[i - pixel_size];
-    }
+    // 裁剪到画布内的列范围
+    const int x_begin = std::max(0, -header.offsetX);
+    const int x_end = std::min(info.inner_width, (int)header.width - header.offsetX);
 
-    // C# 版本: 还原后续行
-    for (size_t i = stride; i < pixels.size(); ++i) {
-        pixels[i] += pixels[i - stride];
-    }
-}
+    for (int y = 0; y < info.inner_height; ++y) {
+        uint8_t* row = pixels + (size_t)(info.inner_height - 1 - y) * inner_stride;
 
+        if (y == 0) {
+            for (size_t i = pixel_size; i < inner_stride; ++i) {
+                row[i] += row[i - pixel_size];
+            }
+        }
+        else {
+            const uint8_t* prev = row + inner_stride;
+            size_t i = 0;
+            for (; i + 16 <= inner_stride; i += 16) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(a, b));
+            }
+            for (; i < inner_stride; ++i) {
+                row[i] += prev[i];
+            }
+        }
 
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::println("Usage: {} <input.akb> <output.png>", argv[0]);
-        return 1;
-    }
+        const int dst_y = header.offsetY + y;
+        if (dst_y < 0 || dst_y >= header.height || x_begin >= x_end) {
+            continue;
+        }
 
-    std::filesystem::path input_path = argv[1];
-    std::filesystem::path output_path = argv[2];
+        const uint8_t* src = row + (size_t)x_begin * pixel_size;
+        uint8_t* dst = final_image + dst_y * final_stride + (size_t)(header.offsetX + x_begin) * num_components;
+        int x = x_begin;
+        if (pixel_size == 4) {
+            for (; x + 4 <= x_end; x += 4, src += 16, dst += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), swap_red_blue(v));
+            }
+        }
+        for (; x < x_end; ++x, src += pixel_size, dst += num_components) {
+            dst[0] = src[2]; // R
+            dst[1] = src[1]; // G
+            dst[2] = src[0]; // B
+            if (num_components == 4) {
+                dst[3] = (pixel_size == 4) ? src[3] : 255;
+            }
+        }
+    }
+}
 
-    try {
-        std::println("Opening AKB file: {}", input_path.string());
-        std::ifstream file(input_path, std::ios::binary | std::ios::ate);
-        if (!file) throw std::runtime_error("Failed to open input file.");
+AkbInfo convert_akb_to_png(const fs::path& input_path, const fs::path& output_path) {
+    std::ifstream file(input_path, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Failed to open input file.");
 
-        std::streamsize file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
+    std::streamsize file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
 
-        if (file_size < sizeof(AkbHeader)) throw std::runtime_error("File is too small to be a valid AKB file.");
+    if (file_size < sizeof(AkbHeader)) throw std::runtime_error("File is too small to be a valid AKB file.");
 
-        AkbHeader header;
-        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    AkbInfo info;
+    AkbHeader& header = info.header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
 
-        const uint32_t AKB_SIGNATURE = 0x20424B41; // 'AKB '
-        const uint32_t AKB_INCREMENTAL_SIGNATURE = 0x2B424B41; // 'AKB+'
+    const uint32_t AKB_SIGNATURE = 0x20424B41; // 'AKB '
+    const uint32_t AKB_INCREMENTAL_SIGNATURE = 0x2B424B41; // 'AKB+'
 
-        if (header.signature != AKB_SIGNATURE) {
-            if (header.signature == AKB_INCREMENTAL_SIGNATURE) {
-                throw std::runtime_error("This is an incremental AKB file, which is not supported by this tool.");
-            }
-            throw std::runtime_error("Invalid AKB file signature.");
+    if (header.signature != AKB_SIGNATURE) {
+        if (header.signature == AKB_INCREMENTAL_SIGNATURE) {
+            throw std::runtime_error("This is an incremental AKB file, which is not supported by this tool.");
         }
+        throw std::runtime_error("Invalid AKB file signature.");
+    }
 
-        const int32_t inner_width = header.right - header.offsetX;
-        const int32_t inner_height = header.bottom - header.offsetY;
-        const int32_t bpp = (header.flags & 0x40000000) ? 24 : 32;
-        const int pixel_size = bpp / 8;
-
-        if (inner_width <= 0 || inner_height <= 0) {
-            throw std::runtime_error("Invalid inner image dimensions.");
-        }
+    info.inner_width = header.right - header.offsetX;
+    info.inner_height = header.bottom - header.offsetY;
+    info.bpp = (header.flags & 0x40000000) ? 24 : 32;
+    const int pixel_size = info.bpp / 8;
 
-        PixelFormat format = PixelFormat::UNKNOWN;
-        int num_components = 0;
+    if (info.inner_width <= 0 || info.inner_height <= 0) {
+        throw std::runtime_error("Invalid inner image dimensions.");
+    }
 
-        if (bpp == 24) {
-            format = PixelFormat::BGR24;
-            num_components = 3;
-        }
-        else if (bpp == 32) {
-            num_components = 4;
-            format = (header.flags & 0x80000000) ? PixelFormat::BGRA32 : PixelFormat::BGR32;
-        }
+    PixelFormat format = PixelFormat::UNKNOWN;
+    int num_components = 0;
 
-        if (format == PixelFormat::UNKNOWN) throw std::runtime_error("Unsupported pixel format.");
+    if (info.bpp == 24) {
+        format = PixelFormat::BGR24;
+        num_components = 3;
+    }
+    else if (info.bpp == 32) {
+        num_components = 4;
+        format = (header.flags & 0x80000000) ? PixelFormat::BGRA32 : PixelFormat::BGR32;
+    }
 
-        std::println("--- AKB Info ---");
-        std::println("  Dimensions: {}x{}", header.width, header.height);
-        std::println("  Inner Rect: {}x{} at ({}, {})", inner_width, inner_height, header.offsetX, header.offsetY);
-        std::println("  BPP: {}", bpp);
-        std::println("----------------");
+    if (format == PixelFormat::UNKNOWN) throw std::runtime_error("Unsupported pixel format.");
 
-        size_t compressed_size = file_size - sizeof(AkbHeader);
-        std::vector<uint8_t> compressed_data(compressed_size);
-        file.read(reinterpret_cast<char*>(compressed_data.data()), compressed_size);
-        file.close();
+    size_t compressed_size = file_size - sizeof(AkbHeader);
+    std::vector<uint8_t> compressed_data(compressed_size);
+    file.read(reinterpret_cast<char*>(compressed_data.data()), compressed_size);
+    file.close();
 
-        std::println("Decompressing data...");
-        size_t decompressed_size_expected = inner_width * inner_height * pixel_size;
-        std::vector<uint8_t> decompressed_pixels(decompressed_size_expected);
+    size_t decompressed_size_expected = (size_t)info.inner_width * info.inner_height * pixel_size;
+    std::vector<uint8_t> decompressed_pixels(decompressed_size_expected);
 
-        size_t actual_decompressed_size = lzss_decompress(
-            decompressed_pixels.data(), decompressed_pixels.size(),
-            compressed_data.data(), compressed_data.size()
-        );
+    size_t actual_decompressed_size = lzss_decompress(
+        decompressed_pixels.data(), (unsigned int)decompressed_pixels.size(),
+        compressed_data.data(), (unsigned int)compressed_data.size()
+    );
 
-        if (actual_decompressed_size == 0) throw std::runtime_error("LZSS decompression failed.");
-        if (actual_decompressed_size != decompressed_size_expected) {
-            std::println("Warning: Decompressed size ({}) does not match expected size ({}).",
-                actual_decompressed_size, decompressed_size_expected);
-        }
+    if (actual_decompressed_size == 0 || actual_decompressed_size == (size_t)-1) throw std::runtime_error("LZSS decompression failed.");
+    if (actual_decompressed_size != decompressed_size_expected) {
+        std::println("Warning: {}: Decompressed size ({}) does not match expected size ({}).",
+            input_path.filename().string(), actual_decompressed_size, decompressed_size_expected);
+    }
 
-        // ====================================================================
-        // ======================== CRITICAL FIX START ========================
-        // ====================================================================
-
-        // C# code reads rows in reverse order, effectively flipping the image vertically during decompression.
-        // Since we decompress in one go, our `decompressed_pixels` buffer has its rows inverted.
-        // We MUST flip the rows vertically BEFORE applying the delta filter.
-
-        std::vector<uint8_t> inner_pixels(decompressed_size_expected);
-        const int inner_stride = inner_width * pixel_size;
-        for (int y = 0; y < inner_height; ++y) {
-            // Source row is from the bottom of the decompressed buffer
-            const uint8_t* src_row = decompressed_pixels.data() + (inner_height - 1 - y) * inner_stride;
-            // Destination row is from the top of the correctly ordered buffer
-            uint8_t* dst_row = inner_pixels.data() + y * inner_stride;
-            std::copy(src_row, src_row + inner_stride, dst_row);
+    // 内部矩形没有覆盖整张画布时才需要先填充背景色
+    std::vector<uint8_t> final_image((size_t)header.width * header.height * num_components);
+    if (header.offsetX > 0 || header.offsetY > 0 || header.right < header.width || header.bottom < header.height) {
+        const uint8_t background[4] = { header.background[2], header.background[1], header.background[0], header.background[3] }; // RGBA
+        for (size_t i = 0; i < final_image.size(); i += num_components) {
+            std::memcpy(final_image.data() + i, background, num_components);
         }
+    }
 
-        // Now `inner_pixels` has the correct top-to-bottom row order, just like in the C# program
-        // after its decompression loop. We can now safely apply the delta filter.
+    decode_akb_rows(decompressed_pixels.data(), info, pixel_size, num_components, final_image.data());
 
-        std::println("Restoring delta filter...");
-        restore_delta_csharp_equivalent(inner_pixels, inner_stride, pixel_size);
+    int success = stbi_write_png(
+        output_path.string().c_str(), header.width, header.height,
+        num_components, final_image.data(), header.width * num_components
+    );
 
-        // ====================================================================
-        // ========================= CRITICAL FIX END =========================
-        // ====================================================================
+    if (!success) throw std::runtime_error("Failed to write PNG file.");
 
+    return info;
+}
 
-        std::println("Compositing final image...");
-        std::vector<uint8_t> final_image(header.width * header.height * num_components);
+// 批量模式：目录下的每个 AKB 相互独立，用多个线程同时转换
+int convert_directory(const fs::path& input_dir, const fs::path& output_dir) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(input_dir)) {
+        if (entry.is_regular_file()) {
+            std::string ext = entry.path().extension().string();
+            std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (ext == ".akb") {
+                files.push_back(entry.path());
+            }
+        }
+    }
 
-        for (int y = 0; y < header.height; ++y) {
-            for (int x = 0; x < header.width; ++x) {
-                size_t dst_idx = (y * header.width + x) * num_components;
-                final_image[dst_idx + 0] = header.background[2]; // R
-                final_image[dst_idx + 1] = header.background[1]; // G
-                final_image[dst_idx + 2] = header.background[0]; // B
-                if (num_components == 4) final_image[dst_idx + 3] = header.background[3]; // A
+    unsigned int num_threads = defaultThreadCount();
+    num_threads = (unsigned int)std::min<size_t>(num_threads, std::max<size_t>(files.size(), 1));
+
+    std::atomic<size_t> next_file{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex output_mutex;
+
+    auto worker = [&]() {
+        for (size_t i = next_file++; i < files.size(); i = next_file++) {
+            fs::path relative = fs::relative(files[i], input_dir);
+            fs::path output_path = output_dir / relative;
+            output_path.replace_extension(".png");
+            try {
+                fs::create_directories(output_path.parent_path());
+                AkbInfo info = convert_akb_to_png(files[i], output_path);
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::println("Converted: {} ({}x{}, {}bpp)", relative.string(), info.header.width, info.header.height, info.bpp);
+            }
+            catch (const std::exception& e) {
+                failed++;
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::println("Error: {}: {}", relative.string(), e.what());
             }
         }
+    };
 
-        for (int y = 0; y < inner_height; ++y) {
-            for (int x = 0; x < inner_width; ++x) {
-                int dst_x = header.offsetX + x;
-                int dst_y = header.offsetY + y;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
 
-                if (dst_x >= 0 && dst_x < header.width && dst_y >= 0 && dst_y < header.height) {
-                    // Since `inner_pixels` is now correctly ordered, we do NOT flip the source y-coordinate here.
-                    size_t src_idx = (y * inner_width + x) * pixel_size;
-                    size_t dst_idx = (dst_y * header.width + dst_x) * num_components;
+    std::println("Converted {}/{} files with {} threads.", files.size() - failed, files.size(), num_threads);
+    return failed == 0 ? 0 : 1;
+}
 
-                    final_image[dst_idx + 0] = inner_pixels[src_idx + 2]; // R
-                    final_image[dst_idx + 1] = inner_pixels[src_idx + 1]; // G
-                    final_image[dst_idx + 2] = inner_pixels[src_idx + 0]; // B
 
-                    if (num_components == 4) {
-                        final_image[dst_idx + 3] = (pixel_size == 4) ? inner_pixels[src_idx + 3] : 255;
-                    }
-                }
-            }
-        }
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::println("Usage: {} <input.akb> <output.png>", argv[0]);
+        std::println("       {} <input_dir> <output_dir>", argv[0]);
+        return 1;
+    }
 
-        std::println("Writing PNG file: {}", output_path.string());
-        int success = stbi_write_png(
-            output_path.string().c_str(), header.width, header.height,
-            num_components, final_image.data(), header.width * num_components
-        );
+    std::filesystem::path input_path = argv[1];
+    std::filesystem::path output_path = argv[2];
 
-        if (!success) throw std::runtime_error("Failed to write PNG file.");
+    if (fs::is_directory(input_path)) {
+        return convert_directory(input_path, output_path);
+    }
 
+    try {
+        std::println("Converting AKB file: {}", input_path.string());
+        AkbInfo info = convert_akb_to_png(input_path, output_path);
+        std::println("--- AKB Info ---");
+        std::println("  Dimensions: {}x{}", info.header.width, info.header.height);
+        std::println("  Inner Rect: {}x{} at ({}, {})", info.inner_width, info.inner_height, info.header.offsetX, info.header.offsetY);
+        std::println("  BPP: {}", info.bpp);
+        std::println("----------------");
         std::println("Conversion successful!");
-
     }
     catch (const std::exception& e) {
         std::println("\nError: {}", e.what());
@@ -5,11 +5,15 @@
 #include <cstring>
 #include <zlib.h>
 #include <thread>
+#define NOMINMAX
 #include <Windows.h>
+#include "ZlibCodec.h"
+#include "ThreadCount.h"
 
 namespace fs = std::filesystem;
 
 uint32_t signature = 0x1a425341; //4153421A
+ZlibLevel compress_level = ZlibLevel::Max; // -e/-e2 的压缩级别
 
 uint32_t compute_crc32(const uint8_t* data, size_t length) {
     return crc32(0, data, length);
@@ -74,28 +78,11 @@ bool decrypt_asb(const fs::path& input_path, const fs::path& output_path, uint32
 
     // zlib解压缩
     std::vector<uint8_t> decompressed_data(unpacked_size);
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = encrypted_data.size() - 4;
-    strm.next_in = encrypted_data.data() + 4;
-    strm.avail_out = unpacked_size;
-    strm.next_out = decompressed_data.data();
-
-    if (inflateInit(&strm) != Z_OK) {
-        std::cerr << "zlib初始化失败: " << input_path << std::endl;
-        return false;
-    }
-
-    if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
-        inflateEnd(&strm);
+    if (!ZlibCodec::threadLocal().inflate(encrypted_data.data() + 4, encrypted_data.size() - 4, decompressed_data.data(), unpacked_size)) {
         std::cerr << "解压缩失败: " << input_path << std::endl;
         return false;
     }
 
-    inflateEnd(&strm);
-
     std::ofstream output(output_path, std::ios::binary);
     if (!output) {
         std::cerr << "无法创建输出文件: " << output_path << std::endl;
@@ -122,12 +109,12 @@ bool encrypt_asb(const fs::path& input_path, const fs::path& output_path, uint32
     std::vector<uint8_t> input_data(unpacked_size);
     input.read(reinterpret_cast<char*>(input_data.data()), unpacked_size);
 
-    uLong compressed_bound = compressBound(unpacked_size);
+    ZlibCodec& codec = ZlibCodec::threadLocal();
+    size_t compressed_bound = codec.deflateBound(unpacked_size, compress_level);
     std::vector<uint8_t> compressed_data(compressed_bound + 4); // 额外4字节用于CRC32
-    uLong compressed_size = compressed_bound;
+    size_t compressed_size = compressed_bound;
 
-    if (compress2(compressed_data.data() + 4, &compressed_size,
-        input_data.data(), unpacked_size, Z_BEST_COMPRESSION) != Z_OK) {
+    if (!codec.deflate(input_data.data(), unpacked_size, compressed_data.data() + 4, compressed_size, compress_level)) {
         std::cerr << "压缩失败: " << input_path << std::endl;
         return false;
     }
@@ -194,26 +181,10 @@ void try_keys_in_range(const std::vector<uint8_t>& encrypted_data, uint32_t unpa
         if (stored_crc == computed_crc) {
             
             std::vector<uint8_t> decompressed_data(unpacked_size);
-            z_stream strm;
-            strm.zalloc = Z_NULL;
-            strm.zfree = Z_NULL;
-            strm.opaque = Z_NULL;
-            strm.avail_in = decrypted_data.size() - 4;
-            strm.next_in = decrypted_data.data() + 4;
-            strm.avail_out = unpacked_size;
-            strm.next_out = decompressed_data.data();
-
-            if (inflateInit(&strm) != Z_OK) {
-                continue;
-            }
-
-            if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
-                inflateEnd(&strm);
+            if (!ZlibCodec::threadLocal().inflate(decrypted_data.data() + 4, decrypted_data.size() - 4, decompressed_data.data(), unpacked_size)) {
                 continue;
             }
 
-            inflateEnd(&strm);
-
             std::ofstream output(output_path, std::ios::binary);
             if (!output) {
                 std::cerr << "无法创建输出文件: " << output_path << std::endl;
@@ -293,12 +264,28 @@ uint32_t parse_key(const std::string& key_str) {
 }
 
 int main(int argc, char* argv[]) {
+    // 先取出 --level 选项，其余参数仍按位置解析
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (std::string(argv[i]) == "--level" && i + 1 < argc) {
+            if (!parseZlibLevel(argv[++i], compress_level)) {
+                std::cerr << "无效的压缩级别: " << argv[i] << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
     if (argc < 4) {
         std::cout << "Made by julixian 2025.03.06" << std::endl;
         std::cout << "Usage: " << argv[0] << " <mode> [<key>] [<signature>] <input_dir> <output_dir>" << std::endl;
         std::cout << "mode: -d/-d2 decrypt, -e/-e2 encrypt, -g guess key and decrpyt" << std::endl;
         std::cout << "key: can be decimal number or hexadecimal number with 0x prefix (only needed in -d or -e mode)" << std::endl;
         std::cout << "signature: a hexadecimal number with 0x prefix, used to define the uint32_t file signature\nIf the original script use \"ASB\\x1a\", fill with 0x1a425341\nIf the original script use \"ASB\\x00\", fill with 0x00425341, etc. (only needed in -e/-e2 mode)" << std::endl;
+        std::cout << "--level fast|balanced|max: zlib compression level in -e/-e2 mode, default max" << std::endl;
         std::cout << "-d/-e/-g is for script files in normal AZsys resource archive, -d2/-e2 is for script files in AZsys encrypted resource archive(GAR shows)" << std::endl;
         std::cout << "Example:" << std::endl;
         std::cout << "  " << argv[0] << " -d 123456789 input_folder output_folder" << std::endl;
@@ -320,8 +307,7 @@ int main(int argc, char* argv[]) {
 
     fs::create_directories(output_dir);
 
-    unsigned int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 4; // 默认使用 4 线程
+    unsigned int num_threads = defaultThreadCount();
 
     if (mode == "-d" || mode == "-e") {
 
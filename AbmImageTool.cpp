@@ -5,22 +5,11 @@
 #include <cstring>
 #include <filesystem>
 #include <png.h>
+#include "ImageEncoders.h"
 
 namespace fs = std::filesystem;
 
 #pragma pack(push, 1)
-struct BMHeader {
-    char magic[2];          // 'BM'
-    uint32_t unpackedSize;  // 0x02
-    uint32_t reserved;      // 0x06
-    uint32_t frameOffset;   // 0x0A
-    uint32_t unknown;       // 0x0E
-    uint32_t width;         // 0x12
-    uint32_t height;        // 0x16
-    uint16_t reserved2;     // 0x1A
-    uint16_t type;          // 0x1C
-};
-
 struct BitmapFileHeader {
     char magic[2];
     uint32_t fileSize;
@@ -107,33 +96,15 @@ bool readPNG(const char* filename, std::vector<uint8_t>& imageData, uint32_t& wi
 
     png_read_update_info(png, info);
 
-    // 分配临时缓冲区
+    // 按原始行序读取 RGBA
+    imageData.resize(height * width * 4);
     std::vector<png_bytep> row_pointers(height);
-    std::vector<uint8_t> tempData(height * width * 4);  // 临时存储区
-
     for (uint32_t y = 0; y < height; y++) {
-        row_pointers[y] = &tempData[y * width * 4];
+        row_pointers[y] = &imageData[y * width * 4];
     }
 
     png_read_image(png, row_pointers.data());
 
-    // 分配最终图像数据空间
-    imageData.resize(height * width * 4);
-
-    // 翻转图像并转换RGBA到BGRA
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t src_pixel = y * width * 4 + x * 4;
-            uint32_t dst_pixel = (height - 1 - y) * width * 4 + x * 4;
-
-            // 转换RGBA到BGRA并翻转
-            imageData[dst_pixel + 0] = tempData[src_pixel + 2];  // B
-            imageData[dst_pixel + 1] = tempData[src_pixel + 1];  // G
-            imageData[dst_pixel + 2] = tempData[src_pixel + 0];  // R
-            imageData[dst_pixel + 3] = tempData[src_pixel + 3];  // A
-        }
-    }
-
     png_destroy_read_struct(&png, &info, NULL);
     fclose(fp);
     return true;
@@ -147,68 +118,15 @@ bool convertToBM(const char* inputFile, const char* outputFile) {
         return false;
     }
 
-    // 创建BM文件
+    // 跳过/不透明/半透明指令的编码与 BatchImageConvertTool 共用 ImageEncoders.h
+    std::vector<uint8_t> bmData = encodeAbm(imageData.data(), width, height);
+
     std::ofstream output(outputFile, std::ios::binary);
     if (!output) {
         std::cerr << "Cannot create output file" << std::endl;
         return false;
     }
-
-    // 写入BM头部
-    BMHeader bmh = { 0 };
-    bmh.magic[0] = 'B';
-    bmh.magic[1] = 'M';
-    bmh.unpackedSize = width * height * 4;  // BGRA
-    bmh.frameOffset = 0x46;  // 固定偏移量
-    bmh.width = width;
-    bmh.height = height;
-    bmh.type = 0x20;  // 32位模式
-
-    output.write(reinterpret_cast<char*>(&bmh), sizeof(bmh));
-
-    // 填充剩余头部空间到frameOffset
-    std::vector<uint8_t> padding(bmh.frameOffset - sizeof(bmh), 0);
-    output.write(reinterpret_cast<char*>(padding.data()), padding.size());
-
-    // 写入图像数据（与之前相同的处理逻辑）
-    for (int y = height - 1; y >= 0; y--) {  // 从底部开始处理
-        for (uint32_t x = 0; x < width; x++) {
-            size_t pixel_pos = y * width * 4 + x * 4;
-            uint8_t alpha = imageData[pixel_pos + 3];
-
-            if (alpha == 0) {
-                // 完全透明的像素：使用跳过指令
-                uint8_t control = 0x00;
-                uint8_t count = 3;
-                output.write(reinterpret_cast<char*>(&control), 1);
-                output.write(reinterpret_cast<char*>(&count), 1);
-            }
-            else if (alpha == 0xFF) {
-                // 完全不透明的像素：使用FF指令
-                uint8_t control = 0xFF;
-                uint8_t count = 3;
-                output.write(reinterpret_cast<char*>(&control), 1);
-                output.write(reinterpret_cast<char*>(&count), 1);
-                output.write(reinterpret_cast<char*>(&imageData[pixel_pos]), 3);
-            }
-            else {
-                // 半透明的像素：使用alpha值作为控制字节
-                uint8_t control = alpha;
-                output.write(reinterpret_cast<char*>(&control), 1);
-
-                // 写入BGR值（一次一个分量）
-                for (int i = 0; i < 3; i++) {
-                    uint8_t value = imageData[pixel_pos + i];
-                    output.write(reinterpret_cast<char*>(&value), 1);
-
-                    // 如果不是最后一个分量，需要重复控制字节
-                    if (i < 2) {
-                        output.write(reinterpret_cast<char*>(&control), 1);
-                    }
-                }
-            }
-        }
-    }
+    output.write(reinterpret_cast<const char*>(bmData.data()), bmData.size());
 
     return true;
 }
@@ -1,6 +1,7 @@
 ﻿#include <Windows.h>
 #include <cstdint>
 #include <CLI/CLI.hpp>
+#include "../../ScriptServer.h"
 
 import std;
 import Tool;
@@ -569,6 +570,75 @@ void writeTextFileUtf8(const fs::path& path, const std::string& text)
     return entry;
 }
 
+void dumpScript(const ParseResult& parsed, const fs::path& outputPath)
+{
+    json root = json::array();
+    for (const auto& entry : parsed.exported) {
+        root.push_back(textEntryToJson(entry));
+    }
+    writeTextFileUtf8(outputPath, root.dump(2));
+}
+
+[[nodiscard]] std::vector<uint8_t> injectScript(
+    const std::vector<uint8_t>& data,
+    const ParseResult& parsed,
+    std::string_view jsonText,
+    const fs::path& jsonPath)
+{
+    auto root = json::parse(jsonText);
+    if (!root.is_array()) {
+        throw std::runtime_error(std::format("JSON root must be an array: {}", wide2Ascii(jsonPath)));
+    }
+
+    std::vector<TextEntry> replacements;
+    replacements.reserve(root.size());
+    for (const auto& item : root) {
+        replacements.push_back(textEntryFromJson(item));
+    }
+
+    if (replacements.size() != parsed.exported.size()) {
+        throw std::runtime_error(std::format(
+            "{}: entry count mismatch, expected {}, got {}",
+            wide2Ascii(jsonPath.filename()),
+            parsed.exported.size(),
+            replacements.size()));
+    }
+
+    std::vector<std::vector<uint8_t>> rebuilt;
+    rebuilt.reserve(parsed.instructions.size());
+    std::vector<size_t> oldStarts;
+    std::vector<size_t> newStarts;
+    std::vector<int64_t> startDeltas;
+    oldStarts.reserve(parsed.instructions.size());
+    newStarts.reserve(parsed.instructions.size());
+    startDeltas.reserve(parsed.instructions.size());
+
+    size_t replacementIndex = 0;
+    size_t newCursor = 0;
+    for (const auto& instruction : parsed.instructions) {
+        oldStarts.push_back(instruction.start);
+        newStarts.push_back(newCursor);
+        startDeltas.push_back((int64_t)newCursor - (int64_t)instruction.start);
+        auto blob = rebuildInstruction(instruction, replacements, replacementIndex);
+        newCursor += blob.size();
+        rebuilt.push_back(std::move(blob));
+    }
+
+    if (replacementIndex != replacements.size()) {
+        throw std::runtime_error(std::format("{}: unused replacement entries remain", wide2Ascii(jsonPath.filename())));
+    }
+
+    patchControlFlow(parsed.instructions, rebuilt, newStarts, oldStarts, startDeltas);
+
+    std::vector<uint8_t> outData;
+    outData.reserve(newCursor + TRAILER_SIZE);
+    for (const auto& blob : rebuilt) {
+        outData.append_range(blob);
+    }
+    outData.insert(outData.end(), data.end() - (intptr_t)TRAILER_SIZE, data.end());
+    return outData;
+}
+
 void dumpScripts(const fs::path& inputDir, const fs::path& outputDir)
 {
     fs::create_directories(outputDir);
@@ -578,13 +648,7 @@ void dumpScripts(const fs::path& inputDir, const fs::path& outputDir)
     for (const auto& wscPath : collectWscFiles(inputDir)) {
         auto data = readBinaryFile(wscPath);
         auto parsed = parseScript(data);
-        json root = json::array();
-        for (const auto& entry : parsed.exported) {
-            root.push_back(textEntryToJson(entry));
-        }
-
-        auto outputPath = outputDir / wscPath.filename().replace_extension(L".json");
-        writeTextFileUtf8(outputPath, root.dump(2));
+        dumpScript(parsed, outputDir / wscPath.filename().replace_extension(L".json"));
         ++exportedFiles;
         exportedEntries += parsed.exported.size();
     }
@@ -608,62 +672,12 @@ void injectScripts(const fs::path& inputBinDir, const fs::path& inputJsonDir, co
 
         auto data = readBinaryFile(wscPath);
         auto parsed = parseScript(data);
-        auto root = json::parse(readTextFileUtf8(jsonPath));
-        if (!root.is_array()) {
-            throw std::runtime_error(std::format("JSON root must be an array: {}", wide2Ascii(jsonPath)));
-        }
-
-        std::vector<TextEntry> replacements;
-        replacements.reserve(root.size());
-        for (const auto& item : root) {
-            replacements.push_back(textEntryFromJson(item));
-        }
-
-        if (replacements.size() != parsed.exported.size()) {
-            throw std::runtime_error(std::format(
-                "{}: entry count mismatch, expected {}, got {}",
-                wide2Ascii(jsonPath.filename()),
-                parsed.exported.size(),
-                replacements.size()));
-        }
-
-        std::vector<std::vector<uint8_t>> rebuilt;
-        rebuilt.reserve(parsed.instructions.size());
-        std::vector<size_t> oldStarts;
-        std::vector<size_t> newStarts;
-        std::vector<int64_t> startDeltas;
-        oldStarts.reserve(parsed.instructions.size());
-        newStarts.reserve(parsed.instructions.size());
-        startDeltas.reserve(parsed.instructions.size());
-
-        size_t replacementIndex = 0;
-        size_t newCursor = 0;
-        for (const auto& instruction : parsed.instructions) {
-            oldStarts.push_back(instruction.start);
-            newStarts.push_back(newCursor);
-            startDeltas.push_back((int64_t)newCursor - (int64_t)instruction.start);
-            auto blob = rebuildInstruction(instruction, replacements, replacementIndex);
-            newCursor += blob.size();
-            rebuilt.push_back(std::move(blob));
-        }
-
-        if (replacementIndex != replacements.size()) {
-            throw std::runtime_error(std::format("{}: unused replacement entries remain", wide2Ascii(jsonPath.filename())));
-        }
-
-        patchControlFlow(parsed.instructions, rebuilt, newStarts, oldStarts, startDeltas);
-
-        std::vector<uint8_t> outData;
-        outData.reserve(newCursor + TRAILER_SIZE);
-        for (const auto& blob : rebuilt) {
-            outData.append_range(blob);
-        }
-        outData.insert(outData.end(), data.end() - (intptr_t)TRAILER_SIZE, data.end());
+        auto outData = injectScript(data, parsed, readTextFileUtf8(jsonPath), jsonPath);
 
         auto outputPath = outputDir / wscPath.filename();
         writeBinaryFile(outputPath, outData);
         ++patchedFiles;
-        patchedEntries += replacements.size();
+        patchedEntries += parsed.exported.size();
     }
 
     std::println("patched_files={}", patchedFiles);
@@ -671,6 +685,41 @@ void injectScripts(const fs::path& inputBinDir, const fs::path& inputJsonDir, co
     std::println("output_dir={}", wide2Ascii(outputDir));
 }
 
+// 常驻服务模式：解析结果按脚本内容哈希缓存，输入未变的请求直接跳过
+int serveScripts()
+{
+    ScriptServer server("AdvHDWscScriptTool");
+    ScriptParseCache<ParseResult> parsedScripts;
+
+    // {"input": xxx.wsc, "output": xxx.json}
+    server.on("dump", [&](ScriptCall& call) {
+        auto input = call.input(call.path("input"));
+        auto outputPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        auto parsed = parsedScripts.get(input->hash, [&]() { return parseScript(input->bytes); });
+        dumpScript(*parsed, outputPath);
+        call.result("entries", (long long)parsed->exported.size());
+    });
+
+    // {"input": xxx.wsc, "text": xxx.json, "output": new.wsc}
+    server.on("inject", [&](ScriptCall& call) {
+        auto input = call.input(call.path("input"));
+        auto jsonPath = call.path("text");
+        auto inputJson = call.input(jsonPath);
+        auto outputPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        auto parsed = parsedScripts.get(input->hash, [&]() { return parseScript(input->bytes); });
+        std::string_view jsonText((const char*)inputJson->bytes.data(), inputJson->bytes.size());
+        writeBinaryFile(outputPath, injectScript(input->bytes, *parsed, jsonText, jsonPath));
+        call.result("entries", (long long)parsed->exported.size());
+    });
+
+    return server.serve();
+}
 
 } // namespace
 
@@ -700,6 +749,8 @@ int main(int argc, char** argv)
     injectCmd->add_option("inputJsonDir", inputJsonDir, "input json directory")->required()->check(CLI::ExistingDirectory);
     injectCmd->add_option("outputDir", outputDir, "output directory")->required();
 
+    auto serveCmd = app.add_subcommand("serve");
+
     CLI11_PARSE(app, argc, argv);
 
     try {
@@ -709,6 +760,9 @@ int main(int argc, char** argv)
         else if (*injectCmd) {
             injectScripts(inputBinDir, inputJsonDir, outputDir);
         }
+        else if (*serveCmd) {
+            return serveScripts();
+        }
     }
     catch (const std::exception& e) {
         std::println(stderr, "Error: {}", e.what());
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include "LzssDecoder.h"
 
 namespace fs = std::filesystem;
 
@@ -13,52 +14,6 @@ struct Entry {
     uint32_t offset;      // 文件偏移量
 };
 
-class LzssDecompressor {
-public:
-    LzssDecompressor(int frameSize = 0x1000, uint8_t frameFill = 0, int frameInitPos = 0xFEE)
-        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos) {
-    }
-
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
-        int framePos = m_frameInitPos;
-        int frameMask = m_frameSize - 1;
-
-        size_t inputPos = 0;
-        while (inputPos < input.size()) {
-            uint8_t ctrl = input[inputPos++];
-            for (int bit = 1; bit != 0x100 && inputPos < input.size(); bit <<= 1) {
-                if (ctrl & bit) {
-                    uint8_t b = input[inputPos++];
-                    frame[framePos++ & frameMask] = b;
-                    output.push_back(b);
-                }
-                else {
-                    if (inputPos + 1 >= input.size()) break;
-                    uint8_t lo = input[inputPos++];
-                    uint8_t hi = input[inputPos++];
-                    int offset = ((hi & 0xf0) << 4) | lo;
-                    int count = 3 + (hi & 0xF);
-
-                    for (int i = 0; i < count; ++i) {
-                        uint8_t v = frame[offset++ & frameMask];
-                        frame[framePos++ & frameMask] = v;
-                        output.push_back(v);
-                    }
-                }
-            }
-        }
-
-        return output;
-    }
-
-private:
-    int m_frameSize;
-    uint8_t m_frameFill;
-    int m_frameInitPos;
-};
-
 std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
     std::vector<uint8_t> output;
     for (size_t i = 0; i < input.size(); i += 8) {
@@ -193,20 +148,20 @@ bool extractDat(const std::string& datPath, const std::string& outputDir, bool s
 
         if (snr) {
             uint32_t decompLen;
+            size_t headerSize;
             if (version == 1) {
                 memcpy(&decompLen, &raw_data[0xc], sizeof(uint32_t));
-                raw_data.erase(raw_data.begin(), raw_data.begin() + 16);
+                headerSize = 16;
             }
             else if (version == 2) {
                 decompLen = *(uint32_t*)&raw_data[4];
-                raw_data.erase(raw_data.begin(), raw_data.begin() + 8);
+                headerSize = 8;
             }
             else {
                 std::cout << "Not a valid version!" << std::endl;
                 return false;
             }
-            LzssDecompressor decompressor;
-            finalData = decompressor.decompress(raw_data);
+            finalData = StandardLzssDecoder::decode(raw_data.data() + headerSize, raw_data.size() - headerSize, decompLen);
             if (finalData.size() != decompLen) {
                 std::cout << "Warning: expect: " << std::hex << decompLen << " actually get: " << std::hex << finalData.size() << std::endl;
             }
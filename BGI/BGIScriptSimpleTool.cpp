@@ -1,11 +1,12 @@
 ﻿#include <Windows.h>
 #include <cstdint>
+#include "../ScriptServer.h"
 
 import std;
 namespace fs = std::filesystem;
 
 template<typename T>
-T read(void* ptr)
+T read(const void* ptr)
 {
     T value;
     memcpy(&value, ptr, sizeof(T));
@@ -94,15 +95,7 @@ struct Sentence {
 };
 
 //DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD
-void dumpText(const fs::path& inputPath, const fs::path& outputPath, bool swapName) {
-    std::ifstream input(inputPath, std::ios::binary);
-    std::ofstream output(outputPath);
-
-    if (!input || !output) {
-        throw std::runtime_error("Error opening files: " + wide2Ascii(inputPath) + " or " + wide2Ascii(outputPath));
-    }
-
-    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(input), {});
+std::vector<Sentence> parseSentences(const std::vector<uint8_t>& buffer) {
     std::string signature((char*)buffer.data(), 0x1b);
     uint32_t headerSize = signature == "BurikoCompiledScriptVer1.00" ? (0x1c + read<uint32_t>(&buffer[0x1c])) : 0;
     std::vector<Sentence> sentences;
@@ -213,6 +206,15 @@ void dumpText(const fs::path& inputPath, const fs::path& outputPath, bool swapNa
         }
     }
 
+    return sentences;
+}
+
+void writeSentences(std::vector<Sentence> sentences, const fs::path& outputPath, bool swapName) {
+    std::ofstream output(outputPath);
+    if (!output) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(outputPath));
+    }
+
     if (swapName && sentences.size() > 1) {
         std::string open932 = wide2Ascii(L"「", 932);
         std::string close932 = wide2Ascii(L"」", 932);
@@ -231,44 +233,59 @@ void dumpText(const fs::path& inputPath, const fs::path& outputPath, bool swapNa
         output << std::format("{:08X}:::::{}\n", se.offsetAddr, se.str);
     }
 
-    input.close();
     output.close();
 
     std::println("Extraction complete. Output saved to {}", wide2Ascii(outputPath));
 }
 
-//IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII
-void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath) {
-    std::ifstream inputBin(inputBinPath, std::ios::binary);
-    std::ifstream inputTxt(inputTxtPath);
-    std::ofstream outputBin(outputBinPath, std::ios::binary);
-
-    if (!inputBin || !inputTxt || !outputBin) {
-        throw std::runtime_error("Error opening files: " + wide2Ascii(inputBinPath) + " or " + wide2Ascii(inputTxtPath) + " or " + wide2Ascii(outputBinPath));
+void dumpText(const fs::path& inputPath, const fs::path& outputPath, bool swapName) {
+    std::ifstream input(inputPath, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Error opening files: " + wide2Ascii(inputPath) + " or " + wide2Ascii(outputPath));
     }
-    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(inputBin), {});
-    std::vector<uint8_t> newBuffer = buffer;
-    std::string signature((char*)buffer.data(), 0x1b);
-    uint32_t headerSize = signature == "BurikoCompiledScriptVer1.00" ? (0x1c + read<uint32_t>(&buffer[0x1c])) : 0;
-    
+
+    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(input), {});
+    input.close();
+    writeSentences(parseSentences(buffer), outputPath, swapName);
+}
+
+//IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII
+// 读取翻译文本，按行拆分 (兼容 CRLF)
+std::vector<Sentence> parseTranslations(std::string_view text) {
     std::vector<Sentence> sentences;
 
-    // 读取翻译文本
-    std::string line;
-    while (std::getline(inputTxt, line)) {
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = text.size();
+        }
+        std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
+
         size_t pos = line.find(":::::");
-        if (pos == std::string::npos) {
+        if (pos == std::string_view::npos) {
             throw std::runtime_error(std::format("Invalid translation format at line {}", sentences.size() + 1));
         }
         Sentence se;
-        std::string offsetAddrStr = line.substr(0, pos);
-        std::string str = line.substr(pos + 5);
+        std::string offsetAddrStr(line.substr(0, pos));
+        std::string str(line.substr(pos + 5));
         se.offsetAddr = (uint32_t)std::stoul(offsetAddrStr, nullptr, 16);
         replaceStrInplace(str, "[r]", "\r");
         replaceStrInplace(str, "[n]", "\n");
         se.str = std::move(str);
         sentences.push_back(std::move(se));
     }
+    return sentences;
+}
+
+std::vector<uint8_t> buildInjected(const std::vector<uint8_t>& buffer, const std::vector<Sentence>& sentences) {
+    std::vector<uint8_t> newBuffer = buffer;
+    std::string signature((char*)buffer.data(), 0x1b);
+    uint32_t headerSize = signature == "BurikoCompiledScriptVer1.00" ? (0x1c + read<uint32_t>(&buffer[0x1c])) : 0;
 
     for (const auto& se : sentences) {
         uint32_t newOffset = (uint32_t)newBuffer.size() - headerSize;
@@ -277,21 +294,75 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
         newStrBytes.push_back(0);
         newBuffer.insert(newBuffer.end(), newStrBytes.begin(), newStrBytes.end());
     }
-    
+    return newBuffer;
+}
+
+void writeInjected(const std::vector<uint8_t>& newBuffer, const fs::path& outputBinPath) {
+    std::ofstream outputBin(outputBinPath, std::ios::binary);
+    if (!outputBin) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(outputBinPath));
+    }
     outputBin.write(reinterpret_cast<const char*>(newBuffer.data()), newBuffer.size());
+    outputBin.close();
 
+    std::println("Injection complete. Output saved to {}", wide2Ascii(outputBinPath));
+}
+
+void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath) {
+    std::ifstream inputBin(inputBinPath, std::ios::binary);
+    std::ifstream inputTxt(inputTxtPath, std::ios::binary);
+
+    if (!inputBin || !inputTxt) {
+        throw std::runtime_error("Error opening files: " + wide2Ascii(inputBinPath) + " or " + wide2Ascii(inputTxtPath) + " or " + wide2Ascii(outputBinPath));
+    }
+    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(inputBin), {});
+    std::string text(std::istreambuf_iterator<char>(inputTxt), {});
     inputBin.close();
     inputTxt.close();
-    outputBin.close();
 
-    std::println("Injection complete. Output saved to {}", wide2Ascii(outputBinPath));
+    writeInjected(buildInjected(buffer, parseTranslations(text)), outputBinPath);
+}
+
+// 常驻服务模式：脚本解析结果按内容哈希缓存，输入未变的请求直接跳过
+int serveScripts() {
+    ScriptServer server("BGIScriptSimpleTool");
+    ScriptParseCache<std::vector<Sentence>> parsed;
+
+    // {"input": 脚本, "output": 文本, "swap_name": false}
+    server.on("dump", [&](ScriptCall& call) {
+        auto input = call.input(call.path("input"));
+        fs::path outputPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        auto sentences = parsed.get(input->hash, [&]() { return parseSentences(input->bytes); });
+        writeSentences(*sentences, outputPath, call.flag("swap_name"));
+        call.result("texts", (long long)sentences->size());
+    });
+
+    // {"input": 原脚本, "text": 译文, "output": 新脚本}
+    server.on("inject", [&](ScriptCall& call) {
+        auto inputBin = call.input(call.path("input"));
+        auto inputTxt = call.input(call.path("text"));
+        fs::path outputBinPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        std::string_view text((const char*)inputTxt->bytes.data(), inputTxt->bytes.size());
+        std::vector<Sentence> sentences = parseTranslations(text);
+        writeInjected(buildInjected(inputBin->bytes, sentences), outputBinPath);
+        call.result("texts", (long long)sentences.size());
+    });
+
+    return server.serve();
 }
 
 void printUsage(const fs::path& programPath) {
     std::print("Made by julixian 2025.11.16\n"
         "Usage: \n"
         "  Dump: {0} dump <input_folder> <output_folder> [--swap-name]\n"
-        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-txt_folder> <output_folder>\n",
+        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-txt_folder> <output_folder>\n"
+        "  Serve: {0} serve    (one JSON request per line on stdin, methods: dump, inject)\n",
         wide2Ascii(programPath.filename()));
 }
 
@@ -351,6 +422,9 @@ int wmain(int argc, wchar_t* argv[])
                 }
             }
         }
+        else if (mode == L"serve") {
+            return serveScripts();
+        }
         else {
             printUsage(argv[0]);
             return 1;
@@ -5,6 +5,8 @@
 #include <filesystem>
 #include <cstdint>
 #include <algorithm>
+#include "LzssDecoder.h"
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -19,58 +21,10 @@ std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
     return output;
 }
 
-class LzssDecompressor {
-public:
-    LzssDecompressor(int frameSize = 0x1000, uint8_t frameFill = 0, int frameInitPos = 0xFEE)
-        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos) {
-    }
-
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
-        int framePos = m_frameInitPos;
-        int frameMask = m_frameSize - 1;
-
-        size_t inputPos = 0;
-        while (inputPos < input.size()) {
-            uint8_t ctrl = input[inputPos++];
-            for (int bit = 1; bit != 0x100 && inputPos < input.size(); bit <<= 1) {
-                if (ctrl & bit) {
-                    uint8_t b = input[inputPos++];
-                    frame[framePos++ & frameMask] = b;
-                    output.push_back(b);
-                }
-                else {
-                    if (inputPos + 1 >= input.size()) break;
-                    uint8_t lo = input[inputPos++];
-                    uint8_t hi = input[inputPos++];
-                    int offset = ((hi & 0xf0) << 4) | lo;
-                    int count = 3 + (hi & 0xF);
-
-                    for (int i = 0; i < count; ++i) {
-                        uint8_t v = frame[offset++ & frameMask];
-                        frame[framePos++ & frameMask] = v;
-                        output.push_back(v);
-                    }
-                }
-            }
-        }
-
-        return output;
-    }
-
-private:
-    int m_frameSize;
-    uint8_t m_frameFill;
-    int m_frameInitPos;
-};
-
 struct FileEntry {
     std::string filename;
     uint32_t offset;
     uint32_t size;
-    std::string fullPath;
-    std::vector<uint8_t> finalData;
 };
 
 uint32_t BigEndianToHost(uint32_t value) {
@@ -184,8 +138,7 @@ bool ExtractFiles(const std::string& dat_path, const std::string& output_dir, co
         auto it = std::find(extensions.begin(), extensions.end(), entry.filename.substr(entry.filename.find_last_of(".")));
         std::vector<uint8_t> finalData;
         if (it != extensions.end()) {
-            LzssDecompressor decompressor;
-            finalData = decompressor.decompress(buffer);
+            finalData = StandardLzssDecoder::decode(buffer);
         }
         else {
             finalData = buffer;
@@ -200,40 +153,18 @@ bool ExtractFiles(const std::string& dat_path, const std::string& output_dir, co
 }
 
 bool CreatePackage(const std::string& input_dir, const std::string& output_path, const std::vector<std::string>& extensions) {
-    std::vector<FileEntry> entries;
-    uint32_t total_files = 0;
-
-
-    for (const auto& entry : fs::recursive_directory_iterator(input_dir)) {
-        if (entry.is_regular_file()) {
-            FileEntry file_entry;
-            file_entry.fullPath = entry.path().string();
-            file_entry.filename = fs::relative(entry.path(), input_dir).string();
-
-            if (file_entry.filename.length() > 255) {
-                std::cerr << "file name is too long: " << file_entry.filename << std::endl;
-                return false;
-            }
-
-            auto file_size = fs::file_size(entry.path());
-            std::ifstream input(entry.path(), std::ios::binary);
-            if (!input) {
-                std::cerr << "Can not read file: " << file_entry.filename << std::endl;
-                return false;
-            }
-            std::vector<uint8_t> buffer(file_size);
-            input.read((char*)buffer.data(), file_size);
-            auto it = std::find(extensions.begin(), extensions.end(), entry.path().extension().string());
-            if (it != extensions.end()) {
-                file_entry.finalData = compress(buffer);
-            }
-            else{
-                file_entry.finalData = buffer;
-            }
-            file_entry.size = static_cast<uint32_t>(file_entry.finalData.size());
-            entries.push_back(file_entry);
-            total_files++;
+    std::vector<PackItem> entries;
+
+    for (const auto& path : scanPackDirectory(input_dir, true)) {
+        PackItem entry;
+        entry.path = path;
+        entry.name = fs::relative(path, input_dir).string();
+
+        if (entry.name.length() > 255) {
+            std::cerr << "file name is too long: " << entry.name << std::endl;
+            return false;
         }
+        entries.push_back(std::move(entry));
     }
 
     if (entries.empty()) {
@@ -241,17 +172,12 @@ bool CreatePackage(const std::string& input_dir, const std::string& output_path,
         return false;
     }
 
-    uint32_t current_offset = 4;  
-
-    for (auto& entry : entries) {
-        current_offset += 1;  
-        current_offset += entry.filename.length();  
-        current_offset += 8; 
-    }
-
-    for (auto& entry : entries) {
-        entry.offset = current_offset;
-        current_offset += entry.size;
+    // 索引只取决于文件名长度，数据区起点可以先算出来
+    uint32_t data_offset = 4;
+    for (const auto& entry : entries) {
+        data_offset += 1;
+        data_offset += entry.name.length();
+        data_offset += 8;
     }
 
     std::ofstream out_file(output_path, std::ios::binary);
@@ -260,28 +186,43 @@ bool CreatePackage(const std::string& input_dir, const std::string& output_path,
         return false;
     }
 
-    uint32_t file_count = static_cast<uint32_t>(entries.size());
-    out_file.write(reinterpret_cast<char*>(&file_count), 4);
-
-    for (const auto& entry : entries) {
-        uint8_t name_length = static_cast<uint8_t>(entry.filename.length());
-        out_file.write(reinterpret_cast<char*>(&name_length), 1);
-
-        std::vector<uint8_t> encrypted_name = EncryptFileName(entry.filename);
-        out_file.write(reinterpret_cast<char*>(encrypted_name.data()), encrypted_name.size());
-
-        uint32_t offset_be = HostToBigEndian(entry.offset);
-        uint32_t size_be = HostToBigEndian(entry.size);
-        out_file.write(reinterpret_cast<char*>(&offset_be), 4);
-        out_file.write(reinterpret_cast<char*>(&size_be), 4);
-    }
-
-    for (const auto& entry : entries) {
-        std::cout << "Packing: " << entry.filename
+    PackHooks<PackItem> hooks;
+    hooks.transform = [&](PackItem& entry) {
+        auto it = std::find(extensions.begin(), extensions.end(), entry.path.extension().string());
+        if (it != extensions.end()) {
+            entry.data = compress(entry.data);
+        }
+    };
+    hooks.written = [](const PackItem& entry) {
+        std::cout << "Packing: " << entry.name
             << " (Offset: " << entry.offset
             << ", Size: " << entry.size << ")" << std::endl;
+    };
+    hooks.emitIndex = [](std::ostream& out, std::vector<PackItem>& entries, uint64_t) {
+        out.seekp(0);
+        uint32_t file_count = static_cast<uint32_t>(entries.size());
+        out.write(reinterpret_cast<char*>(&file_count), 4);
+
+        for (const auto& entry : entries) {
+            uint8_t name_length = static_cast<uint8_t>(entry.name.length());
+            out.write(reinterpret_cast<char*>(&name_length), 1);
+
+            std::vector<uint8_t> encrypted_name = EncryptFileName(entry.name);
+            out.write(reinterpret_cast<char*>(encrypted_name.data()), encrypted_name.size());
+
+            uint32_t offset_be = HostToBigEndian(static_cast<uint32_t>(entry.offset));
+            uint32_t size_be = HostToBigEndian(static_cast<uint32_t>(entry.size));
+            out.write(reinterpret_cast<char*>(&offset_be), 4);
+            out.write(reinterpret_cast<char*>(&size_be), 4);
+        }
+    };
 
-        out_file.write((char*)entry.finalData.data(), entry.size);
+    try {
+        runPackPipeline(out_file, entries, data_offset, hooks);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
     }
 
     out_file.close();
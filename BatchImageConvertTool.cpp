@@ -0,0 +1,338 @@
+﻿#define _CRT_SECURE_NO_WARNINGS
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <charconv>
+#include <png.h>
+#include "ImageEncoders.h"
+#include "ThreadCount.h"
+
+namespace fs = std::filesystem;
+
+// 多格式批量转换：一个进程内用线程池完成 PNG 解码、按目标格式编码和写出，
+// 省去逐个启动 RMTImageTool / AKBImageTool / AbmImageTool / AI5WINGccImageTool 的开销。
+// 各格式的编码器在 ImageEncoders.h 中，与对应单文件工具共用，输出逐字节一致。
+
+enum class ImageFormat {
+    Rmt,
+    Akb,
+    Abm,
+    Gcc,
+    Unknown
+};
+
+ImageFormat parseFormat(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "rmt") return ImageFormat::Rmt;
+    if (name == "akb") return ImageFormat::Akb;
+    if (name == "abm") return ImageFormat::Abm;
+    if (name == "gcc") return ImageFormat::Gcc;
+    return ImageFormat::Unknown;
+}
+
+const char* formatExtension(ImageFormat format) {
+    switch (format) {
+    case ImageFormat::Rmt: return ".rmt";
+    case ImageFormat::Akb: return ".akb";
+    case ImageFormat::Abm: return ".abm";
+    case ImageFormat::Gcc: return ".gcc";
+    default: return "";
+    }
+}
+
+struct ConvertJob {
+    ImageFormat format;
+    fs::path input;
+    fs::path output;
+    fs::path original; // 仅 GCC 使用：原始 GCC 文件，用于沿用偏移和 Alpha 尺寸
+};
+
+//=============================================== 共用 PNG 解码 ===============================================
+
+// 统一解码为自上而下的 8 位 RGBA
+struct RgbaImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+RgbaImage decodePng(const fs::path& path) {
+    FILE* fp = fopen(path.string().c_str(), "rb");
+    if (!fp) {
+        throw std::runtime_error("Cannot open PNG file");
+    }
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!png) {
+        fclose(fp);
+        throw std::runtime_error("png_create_read_struct failed");
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        fclose(fp);
+        throw std::runtime_error("png_create_info_struct failed");
+    }
+
+    RgbaImage image;
+    std::vector<png_bytep> rowPointers;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        fclose(fp);
+        throw std::runtime_error("PNG decode error");
+    }
+
+    png_init_io(png, fp);
+    png_read_info(png, info);
+
+    image.width = png_get_image_width(png, info);
+    image.height = png_get_image_height(png, info);
+    png_byte colorType = png_get_color_type(png, info);
+    png_byte bitDepth = png_get_bit_depth(png, info);
+
+    if (bitDepth == 16)
+        png_set_strip_16(png);
+    if (colorType == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+        png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(png);
+    if (colorType == PNG_COLOR_TYPE_RGB ||
+        colorType == PNG_COLOR_TYPE_GRAY ||
+        colorType == PNG_COLOR_TYPE_PALETTE)
+        png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+    if (colorType == PNG_COLOR_TYPE_GRAY ||
+        colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(png);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    if (png_get_rowbytes(png, info) != (size_t)image.width * 4) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        fclose(fp);
+        throw std::runtime_error("PNG is not 32bpp after conversion");
+    }
+
+    image.pixels.resize((size_t)image.width * image.height * 4);
+    rowPointers.resize(image.height);
+    for (uint32_t y = 0; y < image.height; ++y) {
+        rowPointers[y] = image.pixels.data() + (size_t)y * image.width * 4;
+    }
+    png_read_image(png, rowPointers.data());
+
+    png_destroy_read_struct(&png, &info, nullptr);
+    fclose(fp);
+    return image;
+}
+
+//=============================================== 任务收集与调度 ===============================================
+
+// 清单每行一个任务，字段用制表符分隔：<格式>\t<输入PNG>\t<输出文件>[\t<原始GCC>]，# 开头为注释
+std::vector<ConvertJob> readManifest(const fs::path& manifestPath) {
+    std::ifstream manifest(manifestPath);
+    if (!manifest) {
+        throw std::runtime_error("Cannot open manifest: " + manifestPath.string());
+    }
+
+    std::vector<ConvertJob> jobs;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(manifest, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 3) {
+            throw std::runtime_error("Invalid manifest line " + std::to_string(lineNo) + ": " + line);
+        }
+
+        ConvertJob job;
+        job.format = parseFormat(fields[0]);
+        if (job.format == ImageFormat::Unknown) {
+            throw std::runtime_error("Unknown format on manifest line " + std::to_string(lineNo) + ": " + fields[0]);
+        }
+        job.input = fields[1];
+        job.output = fields[2];
+        if (fields.size() > 3) job.original = fields[3];
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+std::vector<ConvertJob> collectDirectory(ImageFormat format, const fs::path& inputDir, const fs::path& outputDir, const fs::path& originalDir) {
+    std::vector<ConvertJob> jobs;
+    for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext != ".png") continue;
+
+        fs::path relative = fs::relative(entry.path(), inputDir);
+        ConvertJob job;
+        job.format = format;
+        job.input = entry.path();
+        job.output = (outputDir / relative).replace_extension(formatExtension(format));
+        if (!originalDir.empty()) {
+            job.original = (originalDir / relative).replace_extension(".gcc");
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+void writeFile(const fs::path& path, const std::vector<uint8_t>& data) {
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path());
+    }
+    std::ofstream output(path, std::ios::binary);
+    if (!output) {
+        throw std::runtime_error("Cannot create output file");
+    }
+    output.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!output) {
+        throw std::runtime_error("Failed to write output file");
+    }
+}
+
+int runJobs(const std::vector<ConvertJob>& jobs, unsigned int numThreads) {
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(jobs.size(), 1));
+
+    std::atomic<size_t> nextJob{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::atomic<uint64_t> totalPixels{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::mutex outputMutex;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // 每个线程独立完成 解码 -> 编码 -> 写出，LZSS 编码器在线程内复用
+    auto worker = [&]() {
+        LzssTreeEncoder& lzss = LzssTreeEncoder::threadLocal();
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            const ConvertJob& job = jobs[i];
+            try {
+                RgbaImage image = decodePng(job.input);
+                std::vector<uint8_t> encoded;
+                switch (job.format) {
+                case ImageFormat::Rmt: encoded = encodeRmt(image.pixels.data(), image.width, image.height, lzss); break;
+                case ImageFormat::Akb: encoded = encodeAkb(image.pixels.data(), image.width, image.height, lzss); break;
+                case ImageFormat::Abm: encoded = encodeAbm(image.pixels.data(), image.width, image.height); break;
+                case ImageFormat::Gcc: {
+                    GccHeader original;
+                    bool hasOriginal = !job.original.empty() && readGccHeader(job.original, original);
+                    encoded = encodeGcc(image.pixels.data(), image.width, image.height, hasOriginal ? &original : nullptr, lzss);
+                    break;
+                }
+                default: throw std::runtime_error("Unknown format");
+                }
+                writeFile(job.output, encoded);
+
+                totalPixels += (uint64_t)image.width * image.height;
+                totalBytes += encoded.size();
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << "Converted: " << job.input.string() << " -> " << job.output.string()
+                    << " (" << image.width << "x" << image.height << ", " << encoded.size() << " bytes)" << std::endl;
+            }
+            catch (const std::exception& e) {
+                failed++;
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Error processing " << job.input.string() << ": " << e.what() << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t converted = jobs.size() - failed;
+    std::cout << "\nConverted " << converted << "/" << jobs.size() << " images with " << numThreads << " threads in "
+        << seconds << " s" << std::endl;
+    if (seconds > 0) {
+        std::cout << "  " << converted / seconds << " images/s, " << totalPixels / seconds / 1e6 << " Mpixel/s, "
+            << totalBytes / seconds / (1024.0 * 1024.0) << " MB/s written" << std::endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << "\n"
+        << "  " << programName << " [--threads <N>] -f <rmt|akb|abm|gcc> <png_dir> <output_dir> [original_gcc_dir]" << "\n"
+        << "  " << programName << " [--threads <N>] -m <manifest.txt>" << "\n"
+        << "Manifest lines are tab-separated: <format> <input.png> <output_file> [original.gcc]" << "\n"
+        << "--threads defaults to the number of CPU cores" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int numThreads = defaultThreadCount();
+
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            // 非数字、超出范围或为 0 时打印用法
+            const char* value = argv[++i];
+            const char* end = value + strlen(value);
+            auto [ptr, ec] = std::from_chars(value, end, numThreads);
+            if (ec != std::errc() || ptr != end || numThreads == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+
+    try {
+        std::vector<ConvertJob> jobs;
+        if (args.size() == 2 && args[0] == "-m") {
+            jobs = readManifest(args[1]);
+        }
+        else if ((args.size() == 4 || args.size() == 5) && args[0] == "-f") {
+            ImageFormat format = parseFormat(args[1]);
+            if (format == ImageFormat::Unknown) {
+                std::cerr << "Unknown format: " << args[1] << std::endl;
+                return 1;
+            }
+            jobs = collectDirectory(format, args[2], args[3], args.size() == 5 ? fs::path(args[4]) : fs::path());
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if (jobs.empty()) {
+            std::cout << "No images to convert." << std::endl;
+            return 0;
+        }
+        return runJobs(jobs, numThreads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -6,10 +6,13 @@
 #include <string>
 #include <filesystem>
 #include <algorithm>
+#include <charconv>
+#define NOMINMAX
 #include <Windows.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "LzssTreeEncoder.h"
 
 typedef enum {
 	LZSS_OK,
@@ -41,7 +44,6 @@ std::string AsciiToAscii(const std::string& ascii, UINT src, UINT dst) {
 }
 
 size_t lzss_decompress(uint8_t* dst, unsigned int dstlen, uint8_t* src, unsigned int srclen);
-size_t lzss_compress(uint8_t* dst, unsigned int dstlen, uint8_t* src, unsigned int srclen);
 
 struct FileEntry {
     char filename[32];
@@ -125,7 +127,7 @@ bool extractPackage(const std::string& packagePath, const std::string& outputDir
     return true;
 }
 
-bool createPackage(const std::string& inputDir, const std::string& packagePath) {
+bool createPackage(const std::string& inputDir, const std::string& packagePath, bool lazy, unsigned threadCount) {
     
     if (!std::filesystem::exists(inputDir) || !std::filesystem::is_directory(inputDir)) {
         std::cerr << "Error: Input directory does not exist: " << inputDir << std::endl;
@@ -162,7 +164,8 @@ bool createPackage(const std::string& inputDir, const std::string& packagePath)
     uint32_t currentOffset = 8 + fileCount * sizeof(FileEntry);
 
     std::vector<FileEntry> entries(fileCount);
-    std::vector<std::vector<uint8_t>> compressedData(fileCount);
+    std::vector<std::vector<uint8_t>> fileData(fileCount);
+    std::vector<bool> loaded(fileCount, false);
 
     for (size_t i = 0; i < files.size(); ++i) {
         FileEntry& entry = entries[i];
@@ -185,25 +188,39 @@ bool createPackage(const std::string& inputDir, const std::string& packagePath)
         std::streamsize fileSize = inputFile.tellg();
         inputFile.seekg(0, std::ios::beg);
 
-        std::vector<uint8_t> fileData(fileSize);
-        inputFile.read(reinterpret_cast<char*>(fileData.data()), fileSize);
+        fileData[i].resize(fileSize);
+        inputFile.read(reinterpret_cast<char*>(fileData[i].data()), fileSize);
         inputFile.close();
+        loaded[i] = true;
+    }
 
-        entry.decompressedSize = static_cast<uint32_t>(fileSize);
+    // 文件之间互不相关，读完后一起并行压缩，每个线程复用自己的编码器
+    std::vector<LzssTreeEncoder::BatchItem> batch(fileCount);
+    for (size_t i = 0; i < files.size(); ++i) {
+        batch[i].data = fileData[i].data();
+        batch[i].size = fileData[i].size();
+    }
+    LzssTreeEncoder::compressBatch(batch, lazy, threadCount);
 
-        std::vector<uint8_t> compressed((fileSize + 7) / 8 * 9);
+    std::vector<std::vector<uint8_t>> compressedData(fileCount);
 
-        size_t compressedSize = lzss_compress(
-            compressed.data(), compressed.size(),
-            fileData.data(), fileData.size()
-        );
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!loaded[i]) {
+            continue;
+        }
+        FileEntry& entry = entries[i];
+        size_t fileSize = fileData[i].size();
+        entry.decompressedSize = static_cast<uint32_t>(fileSize);
 
-        if (compressedSize >= fileSize) {
-            compressedSize = fileSize;
-            compressed = std::move(fileData);
+        std::vector<uint8_t>& compressed = batch[i].output;
+        if (compressed.empty() || compressed.size() >= fileSize) {
+            compressed = std::move(fileData[i]);
+        }
+        else {
+            std::vector<uint8_t>().swap(fileData[i]);
         }
 
-        compressed.resize(compressedSize);
+        size_t compressedSize = compressed.size();
         compressedData[i] = std::move(compressed);
         entry.compressedSize = static_cast<uint32_t>(compressedSize);
 
@@ -232,18 +249,46 @@ void printUsage(const char* programName) {
     std::cout << "Made by julixian 2025.05.18" << std::endl;
     std::cout << "Usage:" << std::endl;
     std::cout << "For extract: " << programName << " -e <package_file> <output_directory>" << std::endl;
-    std::cout << "For pack:  " << programName << " -p <input_directory> <package_file>" << std::endl;
+    std::cout << "For pack:  " << programName << " [--lazy] [--threads N] -p <input_directory> <package_file>" << std::endl;
+    std::cout << "  --lazy       Lazy matching, slightly smaller output" << std::endl;
+    std::cout << "  --threads N  Number of compression threads (default: CPU count)" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
+    bool lazy = false;
+    unsigned threadCount = 0;
+    int argi = 1;
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1] == '-') {
+        std::string opt = argv[argi];
+        if (opt == "--lazy") {
+            lazy = true;
+            argi++;
+        }
+        else if (opt == "--threads" && argi + 1 < argc) {
+            // 非数字、超出范围或为 0 时打印用法
+            const char* value = argv[argi + 1];
+            const char* end = value + strlen(value);
+            auto [ptr, ec] = std::from_chars(value, end, threadCount);
+            if (ec != std::errc() || ptr != end || threadCount == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            argi += 2;
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - argi != 3) {
         printUsage(argv[0]);
         return 1;
     }
 
-    std::string mode = argv[1];
-    std::string path1 = argv[2];
-    std::string path2 = argv[3];
+    std::string mode = argv[argi];
+    std::string path1 = argv[argi + 1];
+    std::string path2 = argv[argi + 2];
 
     if (mode == "-e") {
         std::cout << "Extracting package: " << path1 << std::endl;
@@ -262,7 +307,7 @@ int main(int argc, char* argv[]) {
         std::cout << "Creating package from directory: " << path1 << std::endl;
         std::cout << "Output package: " << path2 << std::endl;
 
-        if (createPackage(path1, path2)) {
+        if (createPackage(path1, path2, lazy, threadCount)) {
             std::cout << "Package created successfully!" << std::endl;
             return 0;
         }
@@ -383,253 +428,3 @@ size_t lzss_decompress(uint8_t* dst, unsigned int dstlen, uint8_t* src, unsigned
 		return -1;
 	}
 }
-
-struct encode_state {
-	/* left & right children & parent. These constitute binary search trees. */
-	int lchild[N + 1], rchild[N + 257], parent[N + 1];
-
-	/* ring buffer of size N, with extra F-1 bytes to aid string comparison */
-	uint8_t text_buf[N + F - 1];
-
-	/* match_length of longest match.
-	 * These are set by the insert_node() procedure.
-	 */
-	int match_position, match_length;
-};
-
-/* initialize state, mostly the trees
- *
- * For i = 0 to N - 1, rchild[i] and lchild[i] will be the right and left
- * children of node i.  These nodes need not be initialized.  Also, parent[i]
- * is the parent of node i.  These are initialized to NIL (= N), which stands
- * for 'not used.'  For i = 0 to 255, rchild[N + i + 1] is the root of the
- * tree for strings that begin with character i.  These are initialized to NIL.
- * Note there are 256 trees. */
-static void init_state(struct encode_state* sp) {
-	int  i;
-
-	memset(sp, 0, sizeof(*sp));
-
-	for (i = 0; i < N - F; i++)
-		sp->text_buf[i] = Padding;
-	for (i = N + 1; i <= N + 256; i++)
-		sp->rchild[i] = NIL;
-	for (i = 0; i < N; i++)
-		sp->parent[i] = NIL;
-}
-
-/* Inserts string of length F, text_buf[r..r+F-1], into one of the trees
- * (text_buf[r]'th tree) and returns the longest-match position and length
- * via the global variables match_position and match_length.
- * If match_length = F, then removes the old node in favor of the new one,
- * because the old one will be deleted sooner. Note r plays double role,
- * as tree node and position in buffer.
- */
-static void insert_node(struct encode_state* sp, int r) {
-	int  i, p, cmp;
-	uint8_t* key;
-
-	cmp = 1;
-	key = &sp->text_buf[r];
-	p = N + 1 + key[0];
-	sp->rchild[r] = sp->lchild[r] = NIL;
-	sp->match_length = 0;
-	for (; ; ) {
-		if (cmp >= 0) {
-			if (sp->rchild[p] != NIL)
-				p = sp->rchild[p];
-			else {
-				sp->rchild[p] = r;
-				sp->parent[r] = p;
-				return;
-			}
-		}
-		else {
-			if (sp->lchild[p] != NIL)
-				p = sp->lchild[p];
-			else {
-				sp->lchild[p] = r;
-				sp->parent[r] = p;
-				return;
-			}
-		}
-		for (i = 1; i < F; i++) {
-			if ((cmp = key[i] - sp->text_buf[p + i]) != 0)
-				break;
-		}
-		if (i > sp->match_length) {
-			sp->match_position = p;
-			if ((sp->match_length = i) >= F)
-				break;
-		}
-	}
-	sp->parent[r] = sp->parent[p];
-	sp->lchild[r] = sp->lchild[p];
-	sp->rchild[r] = sp->rchild[p];
-	sp->parent[sp->lchild[p]] = r;
-	sp->parent[sp->rchild[p]] = r;
-	if (sp->rchild[sp->parent[p]] == p)
-		sp->rchild[sp->parent[p]] = r;
-	else
-		sp->lchild[sp->parent[p]] = r;
-	sp->parent[p] = NIL;  /* remove p */
-}
-
-/* deletes node p from tree */
-static void delete_node(struct encode_state* sp, int p) {
-	int  q;
-
-	if (sp->parent[p] == NIL)
-		return;  /* not in tree */
-	if (sp->rchild[p] == NIL)
-		q = sp->lchild[p];
-	else if (sp->lchild[p] == NIL)
-		q = sp->rchild[p];
-	else {
-		q = sp->lchild[p];
-		if (sp->rchild[q] != NIL) {
-			do {
-				q = sp->rchild[q];
-			} while (sp->rchild[q] != NIL);
-			sp->rchild[sp->parent[q]] = sp->lchild[q];
-			sp->parent[sp->lchild[q]] = sp->parent[q];
-			sp->lchild[q] = sp->lchild[p];
-			sp->parent[sp->lchild[p]] = q;
-		}
-		sp->rchild[q] = sp->rchild[p];
-		sp->parent[sp->rchild[p]] = q;
-	}
-	sp->parent[q] = sp->parent[p];
-	if (sp->rchild[sp->parent[p]] == p)
-		sp->rchild[sp->parent[p]] = q;
-	else
-		sp->lchild[sp->parent[p]] = q;
-	sp->parent[p] = NIL;
-}
-
-size_t lzss_compress(uint8_t* dst, unsigned int dstlen, uint8_t* src, unsigned int srclen) {
-	if (dst && src && dstlen && srclen) {
-		/* Encoding state, mostly tree but some current match stuff */
-		struct encode_state* sp;
-
-		int  i, c, len, r, s, last_match_length, code_buf_ptr;
-		uint8_t code_buf[17], mask;
-		uint8_t* srcend = src + srclen;
-		uint8_t* dstend = dst + dstlen;
-		uint8_t* dststart = dst;
-
-		/* initialize trees */
-		sp = (struct encode_state*)malloc(sizeof(*sp));
-		init_state(sp);
-
-		/* code_buf[1..16] saves eight units of code, and code_buf[0] works
-		 * as eight flags, "1" representing that the unit is an unencoded
-		 * letter (1 byte), "" a position-and-length pair (2 bytes).
-		 * Thus, eight units require at most 16 bytes of code.
-		 */
-		code_buf[0] = 0;
-		code_buf_ptr = mask = 1;
-
-		/* Clear the buffer with any character that will appear often. */
-		s = 0;  r = N - F;
-
-		/* Read F bytes into the last F bytes of the buffer */
-		for (len = 0; len < F && src < srcend; len++)
-			sp->text_buf[r + len] = *src++;
-		if (!len) {
-			free(sp);
-			lzss_errno = LZSS_NODATA;
-			return -1;
-		}
-		/*
-		 * Insert the F strings, each of which begins with one or more
-		 * 'space' characters.  Note the order in which these strings are
-		 * inserted.  This way, degenerate trees will be less likely to occur.
-		 */
-		for (i = 1; i <= F; i++)
-			insert_node(sp, r - i);
-
-		/* Finally, insert the whole string just read.
-		 * The global variables match_length and match_position are set.
-		 */
-		insert_node(sp, r);
-		do {
-			/* match_length may be spuriously long near the end of text. */
-			if (sp->match_length > len)
-				sp->match_length = len;
-			if (sp->match_length <= THRESHOLD) {
-				sp->match_length = 1;  /* Not long enough match.  Send one byte. */
-				code_buf[0] |= mask;  /* 'send one byte' flag */
-				code_buf[code_buf_ptr++] = sp->text_buf[r];  /* Send uncoded. */
-			}
-			else {
-				/* Send position and length pair. Note match_length > THRESHOLD. */
-				code_buf[code_buf_ptr++] = (uint8_t)sp->match_position;
-				code_buf[code_buf_ptr++] = (uint8_t)
-					(((sp->match_position >> 4) & 0xF0)
-						| (sp->match_length - (THRESHOLD + 1)));
-			}
-			if ((mask <<= 1) == 0) {  /* Shift mask left one bit. */
-				/* Send at most 8 units of code together */
-				for (i = 0; i < code_buf_ptr; i++)
-					if (dst < dstend)
-						*dst++ = code_buf[i];
-					else {
-						free(sp);
-						lzss_errno = LZSS_NOMEM;
-						return -1;
-					}
-				code_buf[0] = 0;
-				code_buf_ptr = mask = 1;
-			}
-			last_match_length = sp->match_length;
-			for (i = 0; i < last_match_length && src < srcend; i++) {
-				delete_node(sp, s);    /* Delete old strings and */
-				c = *src++;
-				sp->text_buf[s] = c;    /* read new bytes */
-
-				/* If the position is near the end of buffer, extend the buffer
-				 * to make string comparison easier.
-				 */
-				if (s < F - 1)
-					sp->text_buf[s + N] = c;
-
-				/* Since this is a ring buffer, increment the position modulo N. */
-				s = (s + 1) & (N - 1);
-				r = (r + 1) & (N - 1);
-
-				/* Register the string in text_buf[r..r+F-1] */
-				insert_node(sp, r);
-			}
-			while (i++ < last_match_length) {
-				delete_node(sp, s);
-
-				/* After the end of text, no need to read, */
-				s = (s + 1) & (N - 1);
-				r = (r + 1) & (N - 1);
-				/* but buffer may not be empty. */
-				if (--len)
-					insert_node(sp, r);
-			}
-		} while (len > 0);   /* until length of string to be processed is zero */
-
-		if (code_buf_ptr > 1) {    /* Send remaining code. */
-			for (i = 0; i < code_buf_ptr; i++)
-				if (dst < dstend)
-					*dst++ = code_buf[i];
-				else {
-					free(sp);
-					lzss_errno = LZSS_NOMEM;
-					return -1;
-				}
-		}
-
-		free(sp);
-		lzss_errno = LZSS_OK;
-		return (size_t)dst - (size_t)dststart;
-	}
-	else {
-		lzss_errno = LZSS_INVARG;
-		return -1;
-	}
-}
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <filesystem>
 #include <algorithm>
 #include <iomanip>
+#include "LzssDecoder.h"
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -19,52 +21,6 @@ std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
     return output;
 }
 
-class LzssDecompressor {
-public:
-    LzssDecompressor(int frameSize = 0x1000, uint8_t frameFill = 0, int frameInitPos = 0xFEE)
-        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos) {
-    }
-
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
-        int framePos = m_frameInitPos;
-        int frameMask = m_frameSize - 1;
-
-        size_t inputPos = 0;
-        while (inputPos < input.size()) {
-            uint8_t ctrl = input[inputPos++];
-            for (int bit = 1; bit != 0x100 && inputPos < input.size(); bit <<= 1) {
-                if (ctrl & bit) {
-                    uint8_t b = input[inputPos++];
-                    frame[framePos++ & frameMask] = b;
-                    output.push_back(b);
-                }
-                else {
-                    if (inputPos + 1 >= input.size()) break;
-                    uint8_t lo = input[inputPos++];
-                    uint8_t hi = input[inputPos++];
-                    int offset = ((hi & 0xf0) << 4) | lo;
-                    int count = 3 + (hi & 0xF);
-
-                    for (int i = 0; i < count; ++i) {
-                        uint8_t v = frame[offset++ & frameMask];
-                        frame[framePos++ & frameMask] = v;
-                        output.push_back(v);
-                    }
-                }
-            }
-        }
-
-        return output;
-    }
-
-private:
-    int m_frameSize;
-    uint8_t m_frameFill;
-    int m_frameInitPos;
-};
-
 struct BndEntry {
     uint32_t offset;
     uint32_t decomprlen;
@@ -135,9 +91,7 @@ bool extractBndFiles(const std::string& bndFilePath, const std::string& outputDi
         std::vector<uint8_t> buffer(entry.size);
         bndFile.read((char*)buffer.data(), entry.size);
 
-        LzssDecompressor lzssdecompressor;
-
-        std::vector<uint8_t> decompressedData = lzssdecompressor.decompress(buffer);
+        std::vector<uint8_t> decompressedData = StandardLzssDecoder::decode(buffer, entry.decomprlen);
         if (decompressedData.size() != entry.decomprlen) {
             std::cout << "Warning: unexpected data: " << i <<
                 " expect:" << entry.decomprlen << "bytes" <<
@@ -169,12 +123,7 @@ bool packBndFiles(const std::string& inputDir, const std::string& bndFilePath) {
     }
 
     // 收集目录中的所有文件
-    std::vector<fs::path> files;
-    for (const auto& entry : fs::directory_iterator(inputDir)) {
-        if (entry.is_regular_file()) {
-            files.push_back(entry.path());
-        }
-    }
+    std::vector<fs::path> files = scanPackDirectory(inputDir, false);
 
     // 按文件名排序 (00000, 00001, ...)
     std::sort(files.begin(), files.end());
@@ -186,65 +135,51 @@ bool packBndFiles(const std::string& inputDir, const std::string& bndFilePath) {
         return false;
     }
 
-    // 写入文件数目
+    // 索引固定12字节一项，数据紧接在头部之后
     uint32_t fileCount = static_cast<uint32_t>(files.size());
-    bndFile.write(reinterpret_cast<const char*>(&fileCount), sizeof(fileCount));
-
-    // 计算头部大小 (4字节文件数 + 每个文件12字节的索引)
     uint32_t headerSize = 4 + fileCount * sizeof(BndEntry);
 
-    // 构建索引表和文件数据
-    std::vector<BndEntry> entries(fileCount);
-    std::vector<std::vector<uint8_t>> compressedData(fileCount);
-
-    uint32_t currentOffset = headerSize;
-
-    // 第一遍：读取文件，压缩数据，计算偏移
+    struct BndPackItem : PackItem {
+        uint32_t decomprlen = 0;
+    };
+    std::vector<BndPackItem> items(fileCount);
     for (uint32_t i = 0; i < fileCount; ++i) {
-        // 读取原始文件
-        std::ifstream inputFile(files[i], std::ios::binary);
-        if (!inputFile) {
-            std::cerr << "无法打开输入文件: " << files[i] << std::endl;
-            return false;
+        items[i].path = files[i];
+        items[i].name = files[i].filename().string();
+    }
+
+    PackHooks<BndPackItem> hooks;
+    // 工作线程中压缩文件数据
+    hooks.transform = [](BndPackItem& item) {
+        item.decomprlen = static_cast<uint32_t>(item.data.size());
+        item.data = compress(item.data);
+    };
+    hooks.written = [](const BndPackItem& item) {
+        std::cout << "已打包文件 " << item.name
+            << " (原始大小: " << item.decomprlen
+            << " 字节, 偏移: " << item.offset
+            << ", 压缩大小: " << item.size << " 字节)" << std::endl;
+    };
+    // 写入文件数目和索引表
+    hooks.emitIndex = [](std::ostream& out, std::vector<BndPackItem>& items, uint64_t) {
+        out.seekp(0);
+        uint32_t fileCount = static_cast<uint32_t>(items.size());
+        out.write(reinterpret_cast<const char*>(&fileCount), sizeof(fileCount));
+        for (const auto& item : items) {
+            BndEntry entry;
+            entry.offset = static_cast<uint32_t>(item.offset);
+            entry.decomprlen = item.decomprlen;
+            entry.size = static_cast<uint32_t>(item.size);
+            out.write(reinterpret_cast<const char*>(&entry), sizeof(BndEntry));
         }
+    };
 
-        // 获取文件大小
-        inputFile.seekg(0, std::ios::end);
-        size_t fileSize = inputFile.tellg();
-        inputFile.seekg(0, std::ios::beg);
-
-        // 读取文件内容
-        std::vector<uint8_t> fileData(fileSize);
-        inputFile.read(reinterpret_cast<char*>(fileData.data()), fileSize);
-
-        // 压缩文件数据
-        compressedData[i] = compress(fileData);
-
-        // 设置索引信息
-        entries[i].offset = currentOffset;
-        entries[i].decomprlen = static_cast<uint32_t>(fileData.size());
-        entries[i].size = static_cast<uint32_t>(compressedData[i].size());
-
-        // 更新下一个文件的偏移
-        currentOffset += entries[i].size;
-
-        std::cout << "准备打包文件 " << files[i].filename().string()
-            << " (原始大小: " << fileData.size()
-            << " 字节, 压缩后: " << compressedData[i].size() << " 字节)" << std::endl;
+    try {
+        runPackPipeline(bndFile, items, headerSize, hooks);
     }
-
-    // 写入索引表
-    for (uint32_t i = 0; i < fileCount; ++i) {
-        bndFile.write(reinterpret_cast<const char*>(&entries[i]), sizeof(BndEntry));
-    }
-
-    // 写入文件数据
-    for (uint32_t i = 0; i < fileCount; ++i) {
-        bndFile.write(reinterpret_cast<const char*>(compressedData[i].data()), compressedData[i].size());
-
-        std::cout << "已打包文件 " << files[i].filename().string()
-            << " (偏移: " << entries[i].offset
-            << ", 压缩大小: " << entries[i].size << " 字节)" << std::endl;
+    catch (const std::exception& e) {
+        std::cerr << "打包失败: " << e.what() << std::endl;
+        return false;
     }
 
     std::cout << "所有文件打包完成! 共 " << fileCount << " 个文件" << std::endl;
@@ -7,6 +7,7 @@
 #include <filesystem>
 #include <algorithm>
 #include <random>
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -52,67 +53,82 @@ void encryptData(std::vector<uint8_t>& data, uint32_t key) {
 }
 
 void createCpz(const std::string& inputDir, const std::string& cpzPath) {
-    std::vector<FileEntry> entries;
-    uint32_t totalSize = 0;
-
-    // 收集文件信息
-    for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
-        if (entry.is_regular_file()) {
-            FileEntry fileEntry;
-            fileEntry.name = fs::relative(entry.path(), inputDir).string();
-            fileEntry.size = fs::file_size(entry.path());
-            fileEntry.offset = totalSize;
-            fileEntry.key = std::random_device()(); // 生成随机密钥
-            entries.push_back(fileEntry);
-            totalSize += fileEntry.size;
-        }
+    struct CpzPackItem : PackItem {
+        uint32_t key = 0;
+    };
+    std::vector<CpzPackItem> entries;
+
+    // 收集文件信息，密钥按遍历顺序生成
+    for (const auto& path : scanPackDirectory(inputDir, true)) {
+        CpzPackItem fileEntry;
+        fileEntry.path = path;
+        fileEntry.name = fs::relative(path, inputDir).string();
+        fileEntry.key = std::random_device()(); // 生成随机密钥
+        entries.push_back(std::move(fileEntry));
     }
 
-    // 创建索引
-    std::vector<uint8_t> index;
-    uint32_t indexOffset = 0;
-    for (auto& entry : entries) {
-        uint32_t entrySize = 0x18 + entry.name.length() + 1; // +1 for null terminator
-        index.resize(index.size() + entrySize);
-
-        *reinterpret_cast<uint32_t*>(&index[indexOffset]) = entrySize;
-        *reinterpret_cast<uint32_t*>(&index[indexOffset + 4]) = entry.size;
-        *reinterpret_cast<uint32_t*>(&index[indexOffset + 8]) = entry.offset;
-        *reinterpret_cast<uint32_t*>(&index[indexOffset + 0x14]) = entry.key ^ 0x796C3AFDu;
-        std::strcpy(reinterpret_cast<char*>(&index[indexOffset + 0x18]), entry.name.c_str());
-
-        indexOffset += entrySize;
+    // 索引大小只取决于文件名，数据区紧接在头部和索引之后
+    uint32_t indexSize = 0;
+    for (const auto& entry : entries) {
+        indexSize += 0x18 + entry.name.length() + 1; // +1 for null terminator
     }
+    uint32_t dataStart = 0x14 + indexSize;
 
-    // 加密索引
     uint32_t indexKey = std::random_device()();
-    encryptData(index, indexKey);
 
     // 写入CPZ文件
     std::ofstream cpzFile(cpzPath, std::ios::binary);
 
-    // 写入头部
-    uint32_t fileCount = entries.size() ^ 0xE47C59F3;
-    uint32_t indexSize = index.size() ^ 0x3F71DE2Au;
-    uint32_t encryptedIndexKey = indexKey ^ 0x40DE832Cu;
+    PackHooks<CpzPackItem> hooks;
+    // 工作线程中加密文件数据
+    hooks.transform = [](CpzPackItem& entry) {
+        encryptData(entry.data, entry.key);
+    };
+    hooks.written = [](const CpzPackItem& entry) {
+        std::cout << "已打包: " << entry.name << std::endl;
+    };
+    hooks.emitIndex = [&](std::ostream& out, std::vector<CpzPackItem>& entries, uint64_t) {
+        // 创建索引，偏移相对于数据区起点
+        std::vector<uint8_t> index;
+        uint32_t indexOffset = 0;
+        for (auto& entry : entries) {
+            uint32_t entrySize = 0x18 + entry.name.length() + 1; // +1 for null terminator
+            index.resize(index.size() + entrySize);
+
+            *reinterpret_cast<uint32_t*>(&index[indexOffset]) = entrySize;
+            *reinterpret_cast<uint32_t*>(&index[indexOffset + 4]) = static_cast<uint32_t>(entry.size);
+            *reinterpret_cast<uint32_t*>(&index[indexOffset + 8]) = static_cast<uint32_t>(entry.offset - dataStart);
+            *reinterpret_cast<uint32_t*>(&index[indexOffset + 0x14]) = entry.key ^ 0x796C3AFDu;
+            std::strcpy(reinterpret_cast<char*>(&index[indexOffset + 0x18]), entry.name.c_str());
+
+            indexOffset += entrySize;
+        }
 
-    cpzFile.write(reinterpret_cast<const char*>(&SIGNATURE), 4);
-    cpzFile.write(reinterpret_cast<const char*>(&fileCount), 4);
-    cpzFile.write(reinterpret_cast<const char*>(&indexSize), 4);
-    cpzFile.write("\0\0\0\0", 4); // 未使用的4字节
-    cpzFile.write(reinterpret_cast<const char*>(&encryptedIndexKey), 4);
+        // 加密索引
+        encryptData(index, indexKey);
 
-    // 写入索引
-    cpzFile.write(reinterpret_cast<const char*>(index.data()), index.size());
+        // 写入头部
+        uint32_t fileCount = entries.size() ^ 0xE47C59F3;
+        uint32_t encryptedIndexSize = index.size() ^ 0x3F71DE2Au;
+        uint32_t encryptedIndexKey = indexKey ^ 0x40DE832Cu;
 
-    // 写入文件数据
-    for (const auto& entry : entries) {
-        std::ifstream inputFile(fs::path(inputDir) / entry.name, std::ios::binary);
-        std::vector<uint8_t> fileData(entry.size);
-        inputFile.read(reinterpret_cast<char*>(fileData.data()), entry.size);
-        encryptData(fileData, entry.key);
-        cpzFile.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
-        std::cout << "已打包: " << entry.name << std::endl;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&SIGNATURE), 4);
+        out.write(reinterpret_cast<const char*>(&fileCount), 4);
+        out.write(reinterpret_cast<const char*>(&encryptedIndexSize), 4);
+        out.write("\0\0\0\0", 4); // 未使用的4字节
+        out.write(reinterpret_cast<const char*>(&encryptedIndexKey), 4);
+
+        // 写入索引
+        out.write(reinterpret_cast<const char*>(index.data()), index.size());
+    };
+
+    try {
+        runPackPipeline(cpzFile, entries, dataStart, hooks);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "打包失败: " << e.what() << std::endl;
+        return;
     }
 
     cpzFile.close();
@@ -5,7 +5,15 @@
 #include <string>
 #include <zlib.h>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#define NOMINMAX
 #include <Windows.h>
+#include "ThreadCount.h"
 
 namespace fs = std::filesystem;
 
@@ -35,241 +43,140 @@ std::wstring AsciiToWide(const std::string& ascii, UINT CodePage) {
 
 
 //===================================================解加密方法=====================================================
+// 各版本的加密层：
+//   version 1/4: 逐字节减去密钥流(0x84 起, 每字节加 0x99 * (((i & 0xF) + 2) / 3)), 再按 DWORD 异或 RotL 密钥流
+//   version 2:   逐字节减去密钥流(0x71 起, 每字节加 0x47 * (((i & 0xF) + 4) / 5)), 再按 DWORD 异或 RotL 密钥流
+//                (Decrypt_2 原为 https://github.com/One-sixth/TsukikagerouTranslateProject/blob/main/tools_src/%E6%9C%88%E9%98%B3%E7%82%8E%E6%B1%89%E5%8C%96%E8%AE%A1%E5%88%92%20C%2B%2B/format_lib/SnrFile.cpp 的汇编直译)
+//   version 3:   每个 DWORD 减去由解压后长度导出的常量
+// 字节密钥流每 16 字节的增量固定, 4096 字节后完全循环, 所以预先计算成表, 再和异或层合并成一次 SSE2 遍历。
+// 加密为解密的逆序: 先异或, 再加字节密钥流。
+
 uint32_t RotL(uint32_t value, int shift) {
     return (value << shift) | (value >> (32 - shift));
 }
 
-void Decrypt_1_1(std::vector<uint8_t>& data) {
-    uint8_t key = 0x84;
-    for (size_t i = 0; i < data.size(); ++i) {
-        data[i] -= key;
-        int count = ((i & 0xF) + 2) / 3;
-        while (count-- > 0) {
-            key += 0x99;
+class CadathCipher {
+public:
+    explicit CadathCipher(int version) : m_version(version) {
+        if (version == 1 || version == 4) {
+            uint8_t key = 0x84;
+            for (size_t i = 0; i < TablePeriod; ++i) {
+                m_byteKeys[i] = key;
+                key += (uint8_t)(0x99 * (((i & 0xF) + 2) / 3));
+            }
+            m_xorSeed = version == 1 ? 0x3977141B : 0x39750324;
+        }
+        else if (version == 2) {
+            uint8_t key = 0x71;
+            for (size_t i = 0; i < TablePeriod; ++i) {
+                m_byteKeys[i] = key;
+                key += (uint8_t)(0x47 * (((i & 0xF) + 4) / 5));
+            }
+            m_xorSeed = 0x3977141B;
         }
     }
-}
-
-void Decrypt_1_2(std::vector<uint8_t>& data) {
-    if (data.size() < 4) return;
 
-    const uint32_t seed = 0x3977141B;
-    uint32_t key = seed;
-
-    size_t len = data.size() & ~3;
-    uint32_t* data32 = reinterpret_cast<uint32_t*>(data.data());
-
-    for (size_t i = 0; i < len; i += 4) {
-        key = RotL(key, 3);
-        *data32 ^= key;
-        data32++;
-        key += seed;
+    bool valid() const {
+        return m_version >= 1 && m_version <= 4;
     }
-}
 
-void Encrypt_1_1(std::vector<uint8_t>& data) {
-    Decrypt_1_2(data);
-}
-
-void Encrypt_1_2(std::vector<uint8_t>& data) {
-    uint8_t key = 0x84;
-    for (size_t i = 0; i < data.size(); ++i) {
-        data[i] += key;
-        int count = ((i & 0xF) + 2) / 3;
-        while (count-- > 0) {
-            key += 0x99;
+    // decompLen 只有 version 3 使用
+    void decrypt(uint8_t* data, size_t size, uint32_t decompLen) const {
+        if (m_version == 3) {
+            subWords(data, size, version3Key(decompLen));
+        }
+        else {
+            process<false>(data, size);
         }
     }
-}
-
-std::vector<uint8_t> Decrypt_2(std::vector<uint8_t> data) //https://github.com/One-sixth/TsukikagerouTranslateProject/blob/main/tools_src/%E6%9C%88%E9%98%B3%E7%82%8E%E6%B1%89%E5%8C%96%E8%AE%A1%E5%88%92%20C%2B%2B/format_lib/SnrFile.cpp
-{
-    uint8_t* ecx = data.data();
-    unsigned int edi = data.size();
-    unsigned int esi = 0;
-    unsigned int edx = 0;
-    unsigned int eax = 0;
-    unsigned int ebx = 0;
-    unsigned long long tmp64 = 0;
-
-    *(char*)&ebx = 0x71;
-
-loop1:
-    *(char*)&eax = *(char*)ecx;
-    *(char*)&eax = *(char*)&eax - *(char*)&ebx;
-    *(char*)ecx = *(char*)&eax;
-    eax = esi;
-    eax = eax & 0xF;
-    if (eax > 0)
-    {
-        edx = eax + 0x4;
-        eax = 0xCCCCCCCD;
-        tmp64 = (unsigned long long)eax * (unsigned long long)edx;
-        eax = tmp64;
-        edx = tmp64 >> 32;
-        eax = edx;
-        *(char*)&edx = 0x47;
-        eax = eax >> 0x2;
-        *(short*)&eax = (short)*(char*)&eax * (short)*(char*)&edx;
-        *(char*)&ebx += *(char*)&eax;
-    }
-    ecx += 1;
-    esi += 1;
-    if (esi < edi)
-        goto loop1;
 
-    return data;
-}
-
-std::vector<uint8_t> Encrypt_2(std::vector<uint8_t> data)
-{
-    uint8_t* ecx = data.data();
-    unsigned int edi = data.size();
-    unsigned int esi = 0;
-    unsigned int edx = 0;
-    unsigned int eax = 0;
-    unsigned int ebx = 0;
-    unsigned long long tmp64 = 0;
-
-    *(char*)&ebx = 0x71;
-
-loop1:
-    *(char*)&eax = *(char*)ecx;
-    *(char*)&eax = *(char*)&eax + *(char*)&ebx;
-    *(char*)ecx = *(char*)&eax;
-    eax = esi;
-    eax = eax & 0xF;
-    if (eax > 0)
-    {
-        edx = eax + 0x4;
-        eax = 0xCCCCCCCD;
-        tmp64 = (unsigned long long)eax * (unsigned long long)edx;
-        eax = tmp64;
-        edx = tmp64 >> 32;
-        eax = edx;
-        *(char*)&edx = 0x47;
-        eax = eax >> 0x2;
-        *(short*)&eax = (short)*(char*)&eax * (short)*(char*)&edx;
-        *(char*)&ebx += *(char*)&eax;
+    void encrypt(uint8_t* data, size_t size, uint32_t decompLen) const {
+        if (m_version == 3) {
+            subWords(data, size, 0 - version3Key(decompLen));
+        }
+        else {
+            process<true>(data, size);
+        }
     }
-    ecx += 1;
-    esi += 1;
-    if (esi < edi)
-        goto loop1;
 
-    return data;
-}
+private:
+    static constexpr size_t TablePeriod = 0x1000;
+    static constexpr size_t TableMask = TablePeriod - 1;
 
-void Decrypt_3(DWORD* a1, int a2, int a3) //待解密内容指针, 长度, 解密后长度
-{
-    int v3; // eax
-    DWORD* v4; // ecx
-
-    v3 = a2 / 4;
-    v4 = a1;
-    if (a2 / 4 > 0)
-    {
-        do
-        {
-            *v4++ -= ((a3 | (a3 << 12)) << 11) ^ a3;
-            --v3;
-        } while (v3);
-    }
-}
+    int m_version;
+    uint32_t m_xorSeed = 0;
+    alignas(16) uint8_t m_byteKeys[TablePeriod] = {};
 
-void Encrypt_3(DWORD* a1, int a2, int a3)
-{
-    int v3; // eax
-    DWORD* v4; // ecx
-
-    v3 = a2 / 4;
-    v4 = a1;
-    if (a2 / 4 > 0)
-    {
-        do
-        {
-            *v4++ += ((a3 | (a3 << 12)) << 11) ^ a3;
-            --v3;
-        } while (v3);
+    static uint32_t version3Key(uint32_t decompLen) {
+        return ((decompLen | (decompLen << 12)) << 11) ^ decompLen;
     }
-}
 
-void Decrypt_4_1(BYTE* a1, int a2)
-{
-    int v3; // esi
-    char i; // bl
-    unsigned int v5; // edx
-
-    v3 = 0;
-    for (i = -124; v3 < a2; ++v3)
-    {
-        *a1 -= i;
-        if ((v3 & 0xF) != 0)
-        {
-            v5 = ((v3 & 0xFu) + 2) / 3;
-            do
-            {
-                i -= 103;
-                --v5;
-            } while (v5);
+    static void subWords(uint8_t* data, size_t size, uint32_t key) {
+        size_t len = size & ~(size_t)3;
+        size_t i = 0;
+        const __m128i vkey = _mm_set1_epi32((int)key);
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            _mm_storeu_si128((__m128i*)(data + i), _mm_sub_epi32(v, vkey));
+        }
+        for (; i < len; i += 4) {
+            uint32_t v;
+            memcpy(&v, data + i, 4);
+            v -= key;
+            memcpy(data + i, &v, 4);
         }
-        ++a1;
-    }
-}
-
-void Decrypt_4_2(DWORD* a1, int a2)
-{
-    DWORD* result; // eax
-    int v3; // ecx
-    bool v4; // cc
-    int v5; // edx
-    int v6; // et0
-    int v7; // [esp+Ch] [ebp+Ch]
-
-    result = a1;
-    v3 = a2 >> 2;
-    v4 = a2 >> 2 <= 0;
-    v7 = 963969828;
-    if (!v4)
-    {
-        v5 = v3;
-        do
-        {
-            v6 = RotL(v7, 3);
-            *result++ ^= v6;
-            --v5;
-            v7 = v6 + 963969828;
-        } while (v5);
     }
-}
 
-void Encrypt_4_1(DWORD* a1, int a2)
-{
-    Decrypt_4_2(a1, a2);
-}
+    // 字节层与异或层合并为一次遍历; 异或密钥流是串行递推, 每 16 字节现算 4 个
+    template<bool Encrypt>
+    void process(uint8_t* data, size_t size) const {
+        const size_t wordLen = size & ~(size_t)3;
+        uint32_t key = m_xorSeed;
+        auto nextKey = [&]() {
+            key = RotL(key, 3);
+            uint32_t result = key;
+            key += m_xorSeed;
+            return result;
+        };
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            const __m128i byteKeys = _mm_load_si128((const __m128i*)(m_byteKeys + (i & TableMask)));
+            uint32_t k0 = nextKey();
+            uint32_t k1 = nextKey();
+            uint32_t k2 = nextKey();
+            uint32_t k3 = nextKey();
+            const __m128i xorKeys = _mm_set_epi32((int)k3, (int)k2, (int)k1, (int)k0);
+            if constexpr (Encrypt) {
+                v = _mm_add_epi8(_mm_xor_si128(v, xorKeys), byteKeys);
+            }
+            else {
+                v = _mm_xor_si128(_mm_sub_epi8(v, byteKeys), xorKeys);
+            }
+            _mm_storeu_si128((__m128i*)(data + i), v);
+        }
 
-void Encrypt_4_2(BYTE* a1, int a2)
-{
-    int v3; // esi
-    char i; // bl
-    unsigned int v5; // edx
-
-    v3 = 0;
-    for (i = -124; v3 < a2; ++v3)
-    {
-        *a1 += i;
-        if ((v3 & 0xF) != 0)
-        {
-            v5 = ((v3 & 0xFu) + 2) / 3;
-            do
-            {
-                i -= 103;
-                --v5;
-            } while (v5);
+        // 不足 16 字节的尾部
+        const size_t tail = i;
+        if constexpr (!Encrypt) {
+            for (size_t j = tail; j < size; ++j) {
+                data[j] -= m_byteKeys[j & TableMask];
+            }
+        }
+        for (size_t j = tail; j < wordLen; j += 4) {
+            uint32_t v;
+            memcpy(&v, data + j, 4);
+            v ^= nextKey();
+            memcpy(data + j, &v, 4);
+        }
+        if constexpr (Encrypt) {
+            for (size_t j = tail; j < size; ++j) {
+                data[j] += m_byteKeys[j & TableMask];
+            }
         }
-        ++a1;
     }
-}
+};
 
 //=========================================================解加密方法结束=================================================
 
@@ -300,15 +207,12 @@ std::vector<uint8_t> CompressData(const std::vector<uint8_t>& input) {
     return output;
 }
 
-void SNR_EncryptFile(const std::string& input_file, const std::string& output_file, int version) {
+void SNR_EncryptFile(const std::string& input_file, const std::string& output_file, const CadathCipher& cipher) {
     // 读取输入文件
     std::ifstream input(input_file, std::ios::binary);
     if (!input) {
         throw std::runtime_error("Failed to open input file");
     }
-    else {
-        std::cout << "Encrypting: " << input_file << std::endl;
-    }
 
     // 读取文件内容
     std::vector<uint8_t> input_data(
@@ -322,140 +226,134 @@ void SNR_EncryptFile(const std::string& input_file, const std::string& output_fi
 
     uint32_t checksum = 0;
 
-    // 创建最终数据（校验和 + 压缩数据）
-    std::vector<uint8_t> final_data(4 + compressed_data.size());
-    *(uint32_t*)final_data.data() = checksum;
-    std::copy(compressed_data.begin(), compressed_data.end(), final_data.begin() + 4);
+    // 创建最终数据（文件头 + 校验和 + 压缩数据），在原地加密
+    std::vector<uint8_t> final_data(16 + compressed_data.size());
+    uint32_t compressed_size = (uint32_t)(final_data.size() - 12);
+    uint32_t original_size = (uint32_t)input_data.size();
+    memcpy(final_data.data(), "SNR\x1A", 4);
+    memcpy(final_data.data() + 4, &compressed_size, 4);
+    memcpy(final_data.data() + 8, &original_size, 4);
+    memcpy(final_data.data() + 12, &checksum, 4);
+    std::copy(compressed_data.begin(), compressed_data.end(), final_data.begin() + 16);
 
     // 加密数据
-    if (version == 1) {
-        Encrypt_1_1(final_data);
-        Encrypt_1_2(final_data);
-    }
-    else if (version == 2) {
-        Encrypt_1_1(final_data);
-        final_data = Encrypt_2(final_data);
-    }
-    else if (version == 3) {
-        Encrypt_3((DWORD*)final_data.data(), final_data.size(), input_data.size());
-    }
-    else if (version == 4) {
-        Encrypt_4_1((DWORD*)final_data.data(), final_data.size());
-        Encrypt_4_2(final_data.data(), final_data.size());
-    }
-    else {
-        std::cout << "Not a valid version!" << std::endl;
-        return;
-    }
+    cipher.encrypt(final_data.data() + 12, final_data.size() - 12, original_size);
 
     std::ofstream output(output_file, std::ios::binary);
     if (!output) {
         throw std::runtime_error("Failed to create output file");
     }
-
-    output.write("SNR\x1A", 4);
-
-    uint32_t compressed_size = final_data.size();
-    output.write(reinterpret_cast<char*>(&compressed_size), 4);
-
-    uint32_t original_size = input_data.size();
-    output.write(reinterpret_cast<char*>(&original_size), 4);
-
     output.write(reinterpret_cast<char*>(final_data.data()), final_data.size());
-
     output.close();
 }
 
-void SNR_DecryptFile(const std::string& input_file, const std::string& output_file, int version) {
+void SNR_DecryptFile(const std::string& input_file, const std::string& output_file, const CadathCipher& cipher) {
     std::ifstream input(input_file, std::ios::binary);
     if (!input) {
-        std::cerr << "Failed to open input file" << std::endl;
-        return;
-    }
-    else {
-        std::cout << "Decrypting: " << input_file << std::endl;
+        throw std::runtime_error("Failed to open input file");
     }
 
+    std::vector<uint8_t> file_data(
+        (std::istreambuf_iterator<char>(input)),
+        std::istreambuf_iterator<char>()
+    );
+    input.close();
+
     // 读取文件头
-    char header[4];
-    input.read(header, 4);
-    if (std::string(header, 4) != "SNR\x1A") {
-        std::cerr << "Invalid SNR file" << std::endl;
-        return;
+    if (file_data.size() < 16 || memcmp(file_data.data(), "SNR\x1A", 4) != 0) {
+        throw std::runtime_error("Invalid SNR file");
     }
 
-    uint32_t complen;
     uint32_t decomplen;
-    input.read((char*)&complen, 4);
-    input.read((char*)&decomplen, 4);
-
-    // 读取文件内容
-    input.seekg(0, std::ios::end);
-    size_t fileSize = input.tellg();
-    input.seekg(12, std::ios::beg);
-
-    std::vector<uint8_t> data(fileSize - 12);
-    input.read(reinterpret_cast<char*>(data.data()), fileSize - 12);
-    input.close();
+    memcpy(&decomplen, file_data.data() + 8, 4);
 
     // 执行解密
-    if (version == 1) {
-        Decrypt_1_1(data);
-        Decrypt_1_2(data);
-    }
-    else if (version == 2) {
-        data = Decrypt_2(data);
-        Decrypt_1_2(data);
-    }
-    else if (version == 3) {
-        Decrypt_3((DWORD*)data.data(), data.size(), decomplen);
-    }
-    else if (version == 4) {
-        Decrypt_4_1(data.data(), data.size());
-        Decrypt_4_2((DWORD*)data.data(), data.size());
-    }
-    else {
-        std::cout << "Not a valid version!" << std::endl;
-        return;
-    }
+    uint8_t* data = file_data.data() + 12;
+    size_t data_size = file_data.size() - 12;
+    cipher.decrypt(data, data_size, decomplen);
 
-    uint32_t stored_alder32 = *(uint32_t*)data.data();
+    uint32_t stored_alder32;
+    memcpy(&stored_alder32, data, 4);
 
     std::vector<uint8_t> decompressed_data(decomplen);
     z_stream strm;
     strm.zalloc = Z_NULL;
     strm.zfree = Z_NULL;
     strm.opaque = Z_NULL;
-    strm.avail_in = data.size() - 4;
-    strm.next_in = data.data() + 4;
+    strm.avail_in = (uInt)(data_size - 4);
+    strm.next_in = data + 4;
     strm.avail_out = decomplen;
     strm.next_out = decompressed_data.data();
 
     if (inflateInit(&strm) != Z_OK) {
-        std::cerr << "zlib初始化失败: " << input_file << std::endl;
-        return;
+        throw std::runtime_error("zlib初始化失败");
     }
 
     if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
         inflateEnd(&strm);
-        std::cerr << "解压缩失败: " << input_file << std::endl;
-        return;
+        throw std::runtime_error("解压缩失败");
     }
 
     inflateEnd(&strm);
 
-    //decompressed_data = data;
-
     // 写入输出文件
     std::ofstream output(output_file, std::ios::binary);
     if (!output) {
-        std::cerr << "Failed to create output file" << std::endl;
-        return;
+        throw std::runtime_error("Failed to create output file");
     }
 
     output.write(reinterpret_cast<char*>(decompressed_data.data()), decompressed_data.size());
     output.close();
+}
+
+// 目录模式：每个 .snr 互不相关，用多个线程并行处理
+bool SNR_ProcessDirectory(const std::string& input_path, const std::string& output_path, const CadathCipher& cipher, bool isEncrypt, unsigned int numThreads) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(input_path)) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path());
+        }
+    }
+
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(files.size(), 1));
+
+    std::atomic<size_t> nextFile{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex outputMutex;
+
+    auto worker = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            std::string input_file = files[i].string();
+            std::string output_file = output_path + "\\" + fs::relative(files[i], input_path).string();
+            try {
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cout << (isEncrypt ? "Encrypting: " : "Decrypting: ") << input_file << std::endl;
+                }
+                if (isEncrypt) {
+                    SNR_EncryptFile(input_file, output_file, cipher);
+                }
+                else {
+                    SNR_DecryptFile(input_file, output_file, cipher);
+                }
+            }
+            catch (const std::exception& e) {
+                failed++;
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << e.what() << ": " << input_file << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
 
+    return failed == 0;
 }
 
 bool pack_daf(fs::path input_dir, fs::path output_kar) {
@@ -517,10 +415,11 @@ int main(int argc, char* argv[]) {
     if (argc < 4) {
         std::cout << "Made by julixian 2025.03.14" << std::endl;
         std::cout << "Usage: " << "\n"
-            << "For decrypt: " << argv[0] << " -d <version> <input_dir> <output_dir>" << "\n"
-            << "For encrypt: " << argv[0] << " -e <version> <input_dir> <output_dir>" << "\n"
+            << "For decrypt: " << argv[0] << " -d <version> [--threads <N>] <input_dir> <output_dir>" << "\n"
+            << "For encrypt: " << argv[0] << " -e <version> [--threads <N>] <input_dir> <output_dir>" << "\n"
             << "For pack daf archive: " << argv[0] << "-p <input_dir> <output_file>" << "\n"
-            << "version: 1(ＤＡパンツ！！/月陽炎 ～つきかげろう～), 2(月陽炎～千秋恋歌～), 3(てのひらを、たいように), 4(SinsAbell)" << std::endl;
+            << "version: 1(ＤＡパンツ！！/月陽炎 ～つきかげろう～), 2(月陽炎～千秋恋歌～), 3(てのひらを、たいように), 4(SinsAbell)" << "\n"
+            << "--threads: number of worker threads (default: number of CPU cores)" << std::endl;
         return 1;
     }
 
@@ -528,29 +427,37 @@ int main(int argc, char* argv[]) {
     std::string input_path = argv[argc - 2];
     std::string output_path = argv[argc - 1];
     int version = 1;
+    unsigned int num_threads = defaultThreadCount();
 
     if (mode != "-p") {
+        try {
+            version = std::stoi(std::string(argv[2]));
+            for (int i = 3; i + 1 < argc - 2; ++i) {
+                if (std::string(argv[i]) == "--threads") {
+                    num_threads = std::max(1, std::stoi(argv[++i]));
+                }
+            }
+        }
+        catch (const std::logic_error&) {
+            // std::stoi 对非数字抛 invalid_argument，超出 int 范围抛 out_of_range
+            std::cout << "version and --threads must be numbers" << std::endl;
+            return 1;
+        }
         fs::create_directory(output_path);
-        version = std::stoi(std::string(argv[2]));
     }
 
-    if (mode == "-e") {
-        for (const auto& entry : fs::recursive_directory_iterator(input_path)) {
-            if (entry.is_regular_file()) {
-                std::string output_file = output_path + "\\" + fs::relative(entry.path(), input_path).string();
-                SNR_EncryptFile(entry.path().string(), output_file, version);
-            }
+    if (mode == "-e" || mode == "-d") {
+        CadathCipher cipher(version);
+        if (!cipher.valid()) {
+            std::cout << "Not a valid version!" << std::endl;
+            return 1;
         }
-        std::cout << "Encryption completed successfully" << std::endl;
-    }
-    else if (mode == "-d") {
-        for (const auto& entry : fs::recursive_directory_iterator(input_path)) {
-            if (entry.is_regular_file()) {
-                std::string output_file = output_path + "\\" + fs::relative(entry.path(), input_path).string();
-                SNR_DecryptFile(entry.path().string(), output_file, version);
-            }
+        bool isEncrypt = mode == "-e";
+        if (!SNR_ProcessDirectory(input_path, output_path, cipher, isEncrypt, num_threads)) {
+            std::cout << (isEncrypt ? "Encryption" : "Decryption") << " finished with errors" << std::endl;
+            return 1;
         }
-        std::cout << "Decryption completed successfully" << std::endl;
+        std::cout << (isEncrypt ? "Encryption" : "Decryption") << " completed successfully" << std::endl;
     }
     else if (mode == "-p") {
         pack_daf(input_path, output_path);
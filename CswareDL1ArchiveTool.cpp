@@ -3,8 +3,12 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <algorithm>
+#include <memory>
+#include "MappedFile.h"
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -92,11 +96,15 @@ bool extractDL1(const std::string& filename, const std::string& outputDir) {
 }
 
 bool updateDL1(const std::string& dl1Filename, const std::string& updateDir, const std::string& outputFilename) {
-    std::ifstream inputFile(dl1Filename, std::ios::binary);
-    if (!inputFile) {
+    std::unique_ptr<MappedFile> inputFile;
+    try {
+        inputFile = std::make_unique<MappedFile>(dl1Filename);
+    }
+    catch (const std::exception&) {
         std::cerr << "Failed to open input file: " << dl1Filename << std::endl;
         return false;
     }
+    ByteSpan archive = inputFile->span();
 
     std::ofstream outputFile(outputFilename, std::ios::binary);
     if (!outputFile) {
@@ -104,80 +112,75 @@ bool updateDL1(const std::string& dl1Filename, const std::string& updateDir, con
         return false;
     }
 
-    // Copy header (16 bytes)
-    char header[16];
-    inputFile.read(header, 16);
-    outputFile.write(header, 16);
-
-    // Read file count
-    inputFile.seekg(8);
-    uint16_t count;
-    inputFile.read(reinterpret_cast<char*>(&count), sizeof(count));
-
-    // Read index offset
-    inputFile.seekg(0xA);
-    uint32_t index_offset;
-    inputFile.read(reinterpret_cast<char*>(&index_offset), sizeof(index_offset));
-
-    // Read file entries
-    std::vector<Entry> entries;
-    inputFile.seekg(index_offset);
-    for (int i = 0; i < count; ++i) {
-        Entry entry;
-        char name[13] = { 0 };
-        inputFile.read(name, 12);
-        entry.name = std::string(name);
-        inputFile.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
-        entries.push_back(entry);
-    }
-
-    // Update files and write new content
-    uint32_t currentOffset = 0x10;  // Start of data section
-    for (auto& entry : entries) {
-        fs::path updatePath = fs::path(updateDir) / entry.name;
-
-        if (fs::exists(updatePath)) {
-            // Use updated file
-            std::ifstream updateFile(updatePath, std::ios::binary);
-            if (!updateFile) {
-                std::cerr << "Failed to open update file: " << updatePath << std::endl;
-                return false;
-            }
-
-            updateFile.seekg(0, std::ios::end);
-            entry.size = static_cast<uint32_t>(updateFile.tellg());
-            updateFile.seekg(0, std::ios::beg);
-
-            std::vector<char> buffer(entry.size);
-            updateFile.read(buffer.data(), entry.size);
-            outputFile.write(buffer.data(), entry.size);
-
+    struct Dl1PackItem : PackItem {
+        char rawName[12];           // 原样写回的名称字段
+        uint32_t originalOffset = 0;
+        uint32_t originalSize = 0;
+        bool updated = false;
+    };
+
+    PackHooks<Dl1PackItem> hooks;
+    // 没有替换文件的条目直接从映射的原封包复制
+    hooks.transform = [&](Dl1PackItem& entry) {
+        if (!entry.updated) {
+            ByteSpan data = archive.sub(entry.originalOffset, entry.originalSize);
+            entry.data.assign(data.data(), data.data() + data.size());
+        }
+    };
+    hooks.written = [](const Dl1PackItem& entry) {
+        if (entry.updated) {
             std::cout << "Updated: " << entry.name << std::endl;
         }
         else {
-            // Use original file content
-            inputFile.seekg(entry.offset);
-            std::vector<char> buffer(entry.size);
-            inputFile.read(buffer.data(), entry.size);
-            outputFile.write(buffer.data(), entry.size);
-
             std::cout << "Kept original: " << entry.name << std::endl;
         }
+    };
+    // 索引写在数据之后，再把头部 (16 字节) 写回并更新其中的索引偏移
+    hooks.emitIndex = [&](std::ostream& out, std::vector<Dl1PackItem>& entries, uint64_t dataEnd) {
+        for (const auto& entry : entries) {
+            uint32_t size = static_cast<uint32_t>(entry.size);
+            out.write(entry.rawName, 12);
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        }
 
-        entry.offset = currentOffset;
-        currentOffset += entry.size;
-    }
+        char header[16];
+        archive.copy(0, header, 16);
+        uint32_t index_offset = static_cast<uint32_t>(dataEnd);
+        memcpy(header + 0xA, &index_offset, sizeof(index_offset));
+        out.seekp(0);
+        out.write(header, 16);
+    };
+
+    try {
+        // Read file entries
+        uint16_t count = archive.u16le(8);
+        uint32_t index_offset = archive.u32le(0xA);
+        std::vector<Dl1PackItem> entries(count);
+        uint32_t dataOffset = 0x10;
+        for (int i = 0; i < count; ++i) {
+            Dl1PackItem& entry = entries[i];
+            uint64_t pos = index_offset + (uint64_t)i * 16;
+            archive.copy(pos, entry.rawName, 12);
+            entry.name = archive.str(pos, 12);
+            entry.originalSize = archive.u32le(pos + 12);
+            entry.originalOffset = dataOffset;
+            dataOffset += entry.originalSize;
+
+            fs::path updatePath = fs::path(updateDir) / entry.name;
+            if (fs::exists(updatePath)) {
+                // Use updated file
+                entry.path = updatePath;
+                entry.updated = true;
+            }
+        }
 
-    // Write updated index
-    index_offset = currentOffset;
-    for (const auto& entry : entries) {
-        outputFile.write(entry.name.c_str(), 12);
-        outputFile.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+        // Update files and write new content
+        runPackPipeline(outputFile, entries, 0x10, hooks);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
     }
-
-    // Update index offset in header
-    outputFile.seekp(0xA);
-    outputFile.write(reinterpret_cast<const char*>(&index_offset), sizeof(index_offset));
 
     std::cout << "DL1 file updated successfully." << std::endl;
     return true;
@@ -6,6 +6,9 @@
 #include <map>
 #include <cstdint>
 #include <algorithm>
+#include <array>
+#include <emmintrin.h>
+#include "RandKeystream.h"
 
 namespace fs = std::filesystem;
 
@@ -20,29 +23,52 @@ struct Entry {
 const std::string ADVSYS_KEY = "ADVSYS";
 const std::string INDEX_KEY = "1qaz2wsx3edc4rfv5tgb6yhn7ujm8ik,9ol.0p;/-@:^[]";
 
-// 随机数生成器
-class CRuntimeRandomGenerator {
-private:
-    uint32_t m_seed;
-
-public:
-    void SRand(int seed) {
-        m_seed = static_cast<uint32_t>(seed);
+// 索引的密钥流由 idx 末尾的种子决定，生成一次后整块异或
+void XorIndex(std::vector<uint8_t>& data, int32_t seed) {
+    static const RandKeystream generator(INDEX_KEY);
+    std::vector<uint8_t> keystream(data.size());
+    generator.generate(seed, keystream.data(), keystream.size());
+
+    size_t i = 0;
+    for (; i + 16 <= data.size(); i += 16) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.data() + i));
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keystream.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data.data() + i), _mm_xor_si128(d, k));
     }
-
-    int Rand() {
-        m_seed = m_seed * 214013u + 2531011u;
-        return (static_cast<int>(m_seed >> 16) & 0x7FFF);
+    for (; i < data.size(); ++i) {
+        data[i] ^= keystream[i];
     }
-};
+}
 
 // AdvSys加密/解密
+// 密钥长 6 字节，重复到 48 字节 (16 与 6 的最小公倍数) 后每次异或 3 个 16 字节块
 void AdvSysEncrypt(std::vector<uint8_t>& data) {
     const size_t text_offset = 136000;
+    if (data.size() <= text_offset) return;
     const size_t text_length = data.size() - text_offset;
 
-    for (size_t i = 0; i < text_length; ++i) {
-        data[text_offset + i] ^= ADVSYS_KEY[i % ADVSYS_KEY.length()];
+    static const std::array<uint8_t, 48> pattern = [] {
+        std::array<uint8_t, 48> p{};
+        for (size_t i = 0; i < p.size(); ++i) {
+            p[i] = static_cast<uint8_t>(ADVSYS_KEY[i % ADVSYS_KEY.length()]);
+        }
+        return p;
+    }();
+
+    uint8_t* text = data.data() + text_offset;
+    const __m128i k0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data()));
+    const __m128i k1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data() + 16));
+    const __m128i k2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data() + 32));
+
+    size_t i = 0;
+    for (; i + 48 <= text_length; i += 48) {
+        __m128i* block = reinterpret_cast<__m128i*>(text + i);
+        _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), k0));
+        _mm_storeu_si128(block + 1, _mm_xor_si128(_mm_loadu_si128(block + 1), k1));
+        _mm_storeu_si128(block + 2, _mm_xor_si128(_mm_loadu_si128(block + 2), k2));
+    }
+    for (; i < text_length; ++i) {
+        text[i] ^= pattern[i % pattern.size()];
     }
 }
 
@@ -67,15 +93,8 @@ std::vector<uint8_t> DecryptIndex(const std::string& idx_path) {
     int32_t seed;
     idx_file.read(reinterpret_cast<char*>(&seed), sizeof(seed));
 
-    std::vector<uint8_t> output(idx_size);
-    CRuntimeRandomGenerator rng;
-    rng.SRand(seed);
-
-    for (size_t i = 0; i < idx_size; ++i) {
-        output[i] = input[i] ^ INDEX_KEY[rng.Rand() % INDEX_KEY.length()];
-    }
-
-    return output;
+    XorIndex(input, seed);
+    return input;
 }
 
 std::vector<Entry> ParseIndex(const std::vector<uint8_t>& index_data) {
@@ -218,15 +237,7 @@ private:
     }
 
     void DecryptIndex() {
-        std::vector<uint8_t> decrypted(m_index_data.size());
-        CRuntimeRandomGenerator rng;
-        rng.SRand(m_seed);
-
-        for (size_t i = 0; i < m_index_data.size(); ++i) {
-            decrypted[i] = m_index_data[i] ^ INDEX_KEY[rng.Rand() % INDEX_KEY.length()];
-        }
-
-        m_index_data = std::move(decrypted);
+        XorIndex(m_index_data, m_seed);
     }
 
     bool ParseEntries() {
@@ -339,15 +350,7 @@ private:
     }
 
     void EncryptIndex() {
-        std::vector<uint8_t> encrypted(m_index_data.size());
-        CRuntimeRandomGenerator rng;
-        rng.SRand(m_seed);
-
-        for (size_t i = 0; i < m_index_data.size(); ++i) {
-            encrypted[i] = m_index_data[i] ^ INDEX_KEY[rng.Rand() % INDEX_KEY.length()];
-        }
-
-        m_index_data = std::move(encrypted);
+        XorIndex(m_index_data, m_seed);
     }
 
     std::vector<uint8_t> ReadFile(const std::string& path) {
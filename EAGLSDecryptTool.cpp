@@ -4,33 +4,56 @@
 #include <string>
 #include <filesystem>
 #include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <emmintrin.h>
+#include "RandKeystream.h"
+#include "ThreadCount.h"
 
 namespace fs = std::filesystem;
 
 // EAGLS系统密钥
 const std::string EAGLS_KEY = "EAGLS_SYSTEM";
 
-// 随机数生成器类
-class CRuntimeRandomGenerator {
-private:
-    uint32_t m_seed;
-
+// 种子来自文件末字节 (int8)，最多 256 种，密钥流按种子缓存，多个文件和线程共用
+class KeystreamCache {
 public:
-    void SRand(int seed) {
-        m_seed = static_cast<uint32_t>(seed);
+    explicit KeystreamCache(const std::string& key) : m_generator(key) {}
+
+    std::shared_ptr<const std::vector<uint8_t>> get(int8_t seed, size_t count) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& slot = m_streams[static_cast<uint8_t>(seed)];
+        if (!slot || slot->size() < count) {
+            // 按 64 KB 取整，避免文件稍大一点就重新生成
+            auto stream = std::make_shared<std::vector<uint8_t>>((count + 0xFFFF) & ~size_t(0xFFFF));
+            m_generator.generate(seed, stream->data(), stream->size());
+            slot = std::move(stream);
+        }
+        return slot;
     }
 
-    int Rand() {
-        m_seed = m_seed * 214013u + 2531011u;
-        return (static_cast<int>(m_seed >> 16) & 0x7FFF);
-    }
+private:
+    RandKeystream m_generator;
+    std::mutex m_mutex;
+    std::shared_ptr<const std::vector<uint8_t>> m_streams[256];
 };
 
+KeystreamCache g_keystreams(EAGLS_KEY);
+
+// 工作线程共用的控制台输出锁
+std::mutex g_outputMutex;
+
 // 解密单个文件
 bool DecryptFile(const fs::path& inputPath, const fs::path& outputPath) {
     // 读取输入文件
     std::ifstream inFile(inputPath, std::ios::binary);
     if (!inFile) {
+        std::lock_guard<std::mutex> lock(g_outputMutex);
         std::cerr << "无法打开输入文件: " << inputPath << std::endl;
         return false;
     }
@@ -47,27 +70,41 @@ bool DecryptFile(const fs::path& inputPath, const fs::path& outputPath) {
 
     // 检查文件大小是否足够
     if (fileSize < 3603) { // 3600 + 2 + 1 (最小需要的大小)
+        std::lock_guard<std::mutex> lock(g_outputMutex);
         std::cerr << "文件太小: " << inputPath << std::endl;
         return false;
     }
 
-    // 解密过程
-    const int text_offset = 3600;
-    const int text_length = fileSize - text_offset - 2;
-
-    CRuntimeRandomGenerator rng;
-    rng.SRand(static_cast<int8_t>(data[fileSize - 1]));
-
-    for (int i = 0; i < text_length; i += 2) {
-        data[text_offset + i] ^= EAGLS_KEY[rng.Rand() % EAGLS_KEY.length()];
+    // 解密过程：只有偶数位置参与异或，密钥字节与 0 交错后整块异或
+    const size_t text_offset = 3600;
+    const size_t text_length = fileSize - text_offset - 2;
+    const size_t key_count = (text_length + 1) / 2;
+
+    auto keystream = g_keystreams.get(static_cast<int8_t>(data[fileSize - 1]), key_count);
+    const uint8_t* key = keystream->data();
+    uint8_t* text = data.data() + text_offset;
+
+    const __m128i zero = _mm_setzero_si128();
+    size_t j = 0;
+    for (; 2 * j + 32 <= text_length; j += 16) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + j));
+        __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 2 * j));
+        __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 2 * j + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text + 2 * j), _mm_xor_si128(d0, _mm_unpacklo_epi8(k, zero)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text + 2 * j + 16), _mm_xor_si128(d1, _mm_unpackhi_epi8(k, zero)));
+    }
+    for (; j < key_count; ++j) {
+        text[2 * j] ^= key[j];
     }
 
     // 创建输出目录（如果不存在）
-    fs::create_directories(outputPath.parent_path());
+    std::error_code ec;
+    fs::create_directories(outputPath.parent_path(), ec);
 
     // 写入输出文件
     std::ofstream outFile(outputPath, std::ios::binary);
     if (!outFile) {
+        std::lock_guard<std::mutex> lock(g_outputMutex);
         std::cerr << "无法创建输出文件: " << outputPath << std::endl;
         return false;
     }
@@ -75,19 +112,30 @@ bool DecryptFile(const fs::path& inputPath, const fs::path& outputPath) {
     outFile.write(reinterpret_cast<char*>(data.data()), fileSize);
     outFile.close();
 
-    std::cout << "成功解密: " << inputPath.filename() << std::endl;
     return true;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
+    unsigned int numThreads = 0;
+    int argi = 1;
+    bool badThreads = false;
+    if (argc >= 3 && std::string(argv[1]) == "--threads") {
+        // 非数字、超出范围或为 0 时打印用法
+        const char* end = argv[2] + strlen(argv[2]);
+        auto [ptr, ec] = std::from_chars(argv[2], end, numThreads);
+        badThreads = ec != std::errc() || ptr != end || numThreads == 0;
+        argi = 3;
+    }
+
+    if (badThreads || argc - argi != 2) {
         std::cout << "Made by julixian 2025.02.14" << std::endl;
-        std::cout << "用法: " << argv[0] << " <输入目录> <输出目录>" << std::endl;
+        std::cout << "用法: " << argv[0] << " [--threads N] <输入目录> <输出目录>" << std::endl;
+        std::cout << "  --threads N  并行处理的线程数 (默认为 CPU 核心数)" << std::endl;
         return 1;
     }
 
-    fs::path inputDir = argv[1];
-    fs::path outputDir = argv[2];
+    fs::path inputDir = argv[argi];
+    fs::path outputDir = argv[argi + 1];
 
     if (!fs::exists(inputDir)) {
         std::cerr << "输入目录不存在!" << std::endl;
@@ -97,28 +145,49 @@ int main(int argc, char* argv[]) {
     // 创建输出目录（如果不存在）
     fs::create_directories(outputDir);
 
-    // 计数器
-    int successCount = 0;
-    int failCount = 0;
-
-    // 遍历输入目录
+    // 遍历输入目录，只处理.dat文件
+    std::vector<fs::path> files;
     for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
         if (!entry.is_regular_file()) continue;
-
-        // 只处理.dat文件
         if (entry.path().extension() != ".dat") continue;
+        files.push_back(entry.path());
+    }
 
-        // 构建输出文件路径
-        fs::path relativePath = fs::relative(entry.path(), inputDir);
-        fs::path outputPath = outputDir / relativePath;
+    // 计数器
+    std::atomic<int> successCount{ 0 };
+    std::atomic<int> failCount{ 0 };
 
-        // 解密文件
-        if (DecryptFile(entry.path(), outputPath)) {
-            successCount++;
-        }
-        else {
-            failCount++;
+    if (numThreads == 0) {
+        numThreads = defaultThreadCount();
+    }
+    numThreads = static_cast<unsigned int>(std::min<size_t>(numThreads, std::max<size_t>(files.size(), 1)));
+
+    std::atomic<size_t> nextFile{ 0 };
+
+    auto worker = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            // 构建输出文件路径
+            fs::path relativePath = fs::relative(files[i], inputDir);
+            fs::path outputPath = outputDir / relativePath;
+
+            // 解密文件
+            if (DecryptFile(files[i], outputPath)) {
+                successCount++;
+                std::lock_guard<std::mutex> lock(g_outputMutex);
+                std::cout << "成功解密: " << files[i].filename() << std::endl;
+            }
+            else {
+                failCount++;
+            }
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
     }
 
     // 输出统计信息
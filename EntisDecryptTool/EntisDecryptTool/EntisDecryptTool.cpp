@@ -3,6 +3,12 @@
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#define NOMINMAX
 #include <windows.h>
 
 // Main header for the ERISA library.
@@ -42,32 +48,137 @@ struct ExtractedFile {
     std::vector<BYTE> data;
 };
 
-// Forward declaration of the recursive function.
-void readArchiveToMemory(
+// A fixed-budget hand-off queue between the single reader thread and the writer threads.
+// The reader reserves a file's size before reading it, and writers release it after the
+// file has been flushed to disk, so the decrypted data held in memory never exceeds the
+// budget (a single file larger than the budget is still let through on its own).
+class BoundedFileQueue {
+public:
+    explicit BoundedFileQueue(size_t budgetBytes) : budget(budgetBytes) {}
+
+    void reserve(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        roomAvailable.wait(lock, [&] { return inFlight == 0 || inFlight + bytes <= budget; });
+        inFlight += bytes;
+    }
+
+    void release(size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight -= bytes;
+        }
+        roomAvailable.notify_one();
+    }
+
+    void push(ExtractedFile&& file)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            files.push_back(std::move(file));
+        }
+        fileAvailable.notify_one();
+    }
+
+    // Returns false once the queue is closed and drained.
+    bool pop(ExtractedFile& file)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        fileAvailable.wait(lock, [&] { return !files.empty() || closed; });
+        if (files.empty())
+        {
+            return false;
+        }
+        file = std::move(files.front());
+        files.pop_front();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        fileAvailable.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable roomAvailable;
+    std::condition_variable fileAvailable;
+    std::deque<ExtractedFile> files;
+    size_t budget;
+    size_t inFlight = 0;
+    bool closed = false;
+};
+
+// Forward declarations.
+size_t readArchiveToQueue(
     ERISAArchive* archive,
     const std::filesystem::path& current_path_in_archive,
     const char* password,
-    std::vector<ExtractedFile>& extracted_files
+    BoundedFileQueue& queue
 );
+void writeFilesFromQueue(const std::filesystem::path& outputFolderPath, BoundedFileQueue& queue, std::mutex& consoleMutex);
 
 int main(int argc, char* argv[])
 {
     SetConsoleOutputCP(65001); // Set console output code page to UTF-8.
-    if (argc < 3 || argc > 4)
+
+    std::vector<std::string> positional;
+    size_t memoryBudgetMB = 512;
+    unsigned int writerThreads = 4;
+    bool badArgument = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg == "--memory" && i + 1 < argc)
+            {
+                memoryBudgetMB = std::stoull(argv[++i]);
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                writerThreads = std::max(1, std::stoi(argv[++i]));
+            }
+            else
+            {
+                positional.push_back(arg);
+            }
+        }
+        catch (const std::invalid_argument&)
+        {
+            std::cerr << "Error: " << arg << " expects a number, got: " << argv[i] << std::endl;
+            badArgument = true;
+        }
+        catch (const std::out_of_range&)
+        {
+            std::cerr << "Error: " << arg << " is out of range: " << argv[i] << std::endl;
+            badArgument = true;
+        }
+    }
+
+    if (badArgument || positional.size() < 2 || positional.size() > 3)
     {
         std::cout << "Made by julixian 2025.07.07" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <input.noa> <output_folder> [password]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <input.noa> <output_folder> [password] [--memory <MB>] [--threads <N>]" << std::endl;
+        std::cerr << "  --memory   Maximum size of decrypted data held in memory at once (default 512 MB)" << std::endl;
+        std::cerr << "  --threads  Number of writer threads (default 4)" << std::endl;
         std::cerr << "Example: " << argv[0] << " data.noa output" << std::endl;
         std::cerr << "Example: " << argv[0] << " script.noa output MARSELUD" << std::endl;
         std::cerr << "Example: " << argv[0] << " script.noa output convini_cat" << std::endl;
+        std::cerr << "Example: " << argv[0] << " voice.noa output --memory 256 --threads 2" << std::endl;
         return 1;
     }
     
-    std::filesystem::path inputNoaPath(argv[1]);
-    std::filesystem::path outputFolderPath(argv[2]);
+    std::filesystem::path inputNoaPath(positional[0]);
+    std::filesystem::path outputFolderPath(positional[1]);
 
     // Check if a password was provided.
-    const char* password = (argc == 4) ? argv[3] : nullptr;
+    const char* password = (positional.size() == 3) ? positional[2].c_str() : nullptr;
 
     std::cout << "ERISA NOA Archive Extractor" << std::endl;
     std::cout << "--------------------------------------------" << std::endl;
@@ -79,6 +190,7 @@ int main(int argc, char* argv[])
     else {
         std::cout << "No Password Provided" << std::endl;
     }
+    std::cout << "Memory Budget: " << memoryBudgetMB << " MB, Writer Threads: " << writerThreads << std::endl;
     std::cout << std::endl;
 
     // --- Open the archive ---
@@ -100,17 +212,26 @@ int main(int argc, char* argv[])
     }
 
     // ====================================================================
-    // Phase 1: Read all files from the archive into memory.
-    // This decouples library interaction from disk I/O to prevent bugs.(I know it seems stupid, but...you know what I want to say.)
+    // All library interaction stays on this thread; it only reads files and hands
+    // them to the writer threads, which never touch the library.
+    // This decouples library interaction from disk I/O to prevent bugs.
     // ====================================================================
-    std::vector<ExtractedFile> filesInMemory;
-    std::cout << "Phase 1: Scanning archive and reading files into memory..." << std::endl;
+    BoundedFileQueue queue(memoryBudgetMB * 1024 * 1024);
+    std::mutex consoleMutex;
+    std::vector<std::thread> writers;
+    for (unsigned int i = 0; i < writerThreads; ++i)
+    {
+        writers.emplace_back(writeFilesFromQueue, std::cref(outputFolderPath), std::ref(queue), std::ref(consoleMutex));
+    }
+
+    size_t fileCount = 0;
     try
     {
-        readArchiveToMemory(noaArchive, L"", password, filesInMemory);
+        fileCount = readArchiveToQueue(noaArchive, L"", password, queue);
     }
     catch (const std::exception& e)
     {
+        std::lock_guard<std::mutex> lock(consoleMutex);
         std::cerr << "\nCritical error while reading the archive: " << e.what() << std::endl;
     }
 
@@ -118,20 +239,31 @@ int main(int argc, char* argv[])
     noaArchive->Close();
     delete noaArchive;
     delete rawFile;
-    std::cout << "Scan complete. " << filesInMemory.size() << " files read into memory." << std::endl << std::endl;
 
-    // ====================================================================
-    // Phase 2: Write the files from memory to the disk.
-    // ====================================================================
-    std::cout << "Phase 2: Writing files from memory to disk..." << std::endl;
-    for (const auto& file : filesInMemory)
+    queue.close();
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    std::cout << "\nExtraction complete. " << fileCount << " files read." << std::endl;
+    return 0;
+}
+
+void writeFilesFromQueue(const std::filesystem::path& outputFolderPath, BoundedFileQueue& queue, std::mutex& consoleMutex)
+{
+    ExtractedFile file;
+    while (queue.pop(file))
     {
         // Construct the final disk path.
         std::filesystem::path finalDiskPath = outputFolderPath / file.diskPath;
 
         // Convert the Unicode path to the console's encoding for correct display.
         std::string consolePath = wide2Ascii(finalDiskPath.wstring(), 65001);
-        std::cout << "Writing: " << consolePath << " (" << file.data.size() << " bytes)" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(consoleMutex);
+            std::cout << "Writing: " << consolePath << " (" << file.data.size() << " bytes)" << std::endl;
+        }
 
         try
         {
@@ -147,32 +279,37 @@ int main(int argc, char* argv[])
             }
             else
             {
-                std::cerr << "  -> Error: Could not create output file." << std::endl;
+                std::lock_guard<std::mutex> lock(consoleMutex);
+                std::cerr << "  -> Error: Could not create output file: " << consolePath << std::endl;
             }
         }
         catch (const std::filesystem::filesystem_error& e)
         {
+            std::lock_guard<std::mutex> lock(consoleMutex);
             std::cerr << "  -> Filesystem error: " << e.what() << std::endl;
         }
-    }
 
-    std::cout << "\nExtraction complete." << std::endl;
-    return 0;
+        size_t size = file.data.size();
+        std::vector<BYTE>().swap(file.data);
+        queue.release(size);
+    }
 }
 
 /**
- * @brief Recursively reads all files from a directory within the archive into a memory vector.
+ * @brief Recursively reads all files from a directory within the archive and hands them to the writer queue.
  * @param archive The active ERISAArchive object.
  * @param currentPathInArchive The relative path of the current directory being processed.
  * @param password The password to use for encrypted files.
- * @param extractedFiles The vector to store the results in.
+ * @param queue The queue the writer threads consume from.
+ * @return The number of files read.
  */
-void readArchiveToMemory(
+size_t readArchiveToQueue(
     ERISAArchive* archive,
     const std::filesystem::path& currentPathInArchive,
     const char* password,
-    std::vector<ExtractedFile>& extractedFiles)
+    BoundedFileQueue& queue)
 {
+    size_t fileCount = 0;
     ERISAArchive::EDirectory dir;
     archive->GetFileEntries(dir);
 
@@ -189,7 +326,7 @@ void readArchiveToMemory(
         if (fileInfo.dwAttribute & ERISAArchive::attrDirectory)
         {
             archive->DescendDirectory(fileInfo.ptrFileName);
-            readArchiveToMemory(archive, newPath, password, extractedFiles);
+            fileCount += readArchiveToQueue(archive, newPath, password, queue);
             archive->AscendDirectory();
         }
         else
@@ -206,14 +343,18 @@ void readArchiveToMemory(
             ExtractedFile memFile;
             memFile.diskPath = newPath;
 
+            // Wait for the writers to free enough of the budget before allocating.
+            queue.reserve(static_cast<size_t>(size));
             if (size > 0)
             {
                 memFile.data.resize(static_cast<size_t>(size));
                 archive->Read(memFile.data.data(), (unsigned long)size);
             }
 
-            extractedFiles.push_back(std::move(memFile));
+            queue.push(std::move(memFile));
             archive->AscendFile();
+            fileCount++;
         }
     }
+    return fileCount;
 }
@@ -5,6 +5,7 @@
 #include <memory>
 #include <cstring>
 #include <filesystem>
+#include "MappedFile.h"
 
 namespace fs = std::filesystem;
 
@@ -20,15 +21,15 @@ struct Entry {
 // BitStream class for reading compressed data
 class BitStream {
 private:
-    std::ifstream& m_input;
+    SpanReader& m_input;
     uint32_t m_bits;
     int m_bit_count;
 
 public:
-    BitStream(std::ifstream& input) : m_input(input), m_bits(0), m_bit_count(0) {}
+    BitStream(SpanReader& input) : m_input(input), m_bits(0), m_bit_count(0) {}
 
     void fetchBits() {
-        m_input.read(reinterpret_cast<char*>(&m_bits), 4);
+        m_bits = m_input.u32le();
         m_bit_count = 32;
     }
 
@@ -51,13 +52,14 @@ public:
 };
 
 // FA2 decompression class
+// Reads straight from the mapped archive; running past the end throws std::out_of_range
 class Fa2Decompressor {
 private:
-    std::ifstream& m_input;
+    SpanReader& m_input;
     std::vector<uint8_t> m_output;
 
 public:
-    Fa2Decompressor(std::ifstream& input, uint32_t unpacked_size)
+    Fa2Decompressor(SpanReader& input, uint32_t unpacked_size)
         : m_input(input), m_output(unpacked_size) {}
 
     std::vector<uint8_t> unpack() {
@@ -66,8 +68,7 @@ public:
 
         while (dst < m_output.size()) {
             if (bits.getNextBit() != 0) {
-                uint8_t byte;
-                m_input.read(reinterpret_cast<char*>(&byte), 1);
+                uint8_t byte = m_input.u8();
                 m_output[dst++] = byte;
                 continue;
             }
@@ -75,8 +76,7 @@ public:
             int offset;
             if (bits.getNextBit() != 0) {
                 if (bits.getNextBit() != 0) {
-                    uint8_t byte;
-                    m_input.read(reinterpret_cast<char*>(&byte), 1);
+                    uint8_t byte = m_input.u8();
                     offset = byte << 3;
                     offset |= bits.getBits(3);
                     offset += 0x100;
@@ -84,8 +84,7 @@ public:
                         break;
                 }
                 else {
-                    uint8_t byte;
-                    m_input.read(reinterpret_cast<char*>(&byte), 1);
+                    uint8_t byte = m_input.u8();
                     offset = byte;
                 }
                 m_output[dst] = m_output[dst - offset - 1];
@@ -94,37 +93,32 @@ public:
             }
             else {
                 if (bits.getNextBit() != 0) {
-                    uint8_t byte;
-                    m_input.read(reinterpret_cast<char*>(&byte), 1);
+                    uint8_t byte = m_input.u8();
                     offset = byte << 1;
                     offset |= bits.getNextBit();
                 }
                 else {
                     offset = 0x100;
                     if (bits.getNextBit() != 0) {
-                        uint8_t byte;
-                        m_input.read(reinterpret_cast<char*>(&byte), 1);
+                        uint8_t byte = m_input.u8();
                         offset |= byte;
                         offset <<= 1;
                         offset |= bits.getNextBit();
                     }
                     else if (bits.getNextBit() != 0) {
-                        uint8_t byte;
-                        m_input.read(reinterpret_cast<char*>(&byte), 1);
+                        uint8_t byte = m_input.u8();
                         offset |= byte;
                         offset <<= 2;
                         offset |= bits.getBits(2);
                     }
                     else if (bits.getNextBit() != 0) {
-                        uint8_t byte;
-                        m_input.read(reinterpret_cast<char*>(&byte), 1);
+                        uint8_t byte = m_input.u8();
                         offset |= byte;
                         offset <<= 3;
                         offset |= bits.getBits(3);
                     }
                     else {
-                        uint8_t byte;
-                        m_input.read(reinterpret_cast<char*>(&byte), 1);
+                        uint8_t byte = m_input.u8();
                         offset |= byte;
                         offset <<= 4;
                         offset |= bits.getBits(4);
@@ -148,8 +142,7 @@ public:
                     count = 11 + bits.getBits(4);
                 }
                 else {
-                    uint8_t byte;
-                    m_input.read(reinterpret_cast<char*>(&byte), 1);
+                    uint8_t byte = m_input.u8();
                     count = 27 + byte;
                 }
 
@@ -167,54 +160,46 @@ public:
 // FA2 file extractor class
 class Fa2Extractor {
 private:
-    std::ifstream m_file;
+    std::unique_ptr<MappedFile> m_file;
+    ByteSpan m_view;
     std::vector<Entry> m_entries;
 
-    std::vector<uint8_t> decompress(uint32_t unpacked_size) {
-        Fa2Decompressor decompressor(m_file, unpacked_size);
+    std::vector<uint8_t> decompress(uint32_t offset, uint32_t unpacked_size) {
+        SpanReader input(m_view, offset);
+        Fa2Decompressor decompressor(input, unpacked_size);
         return decompressor.unpack();
     }
 
     bool readIndex(uint32_t index_offset, bool is_packed, int count) {
-        m_file.seekg(index_offset);
-
-        std::vector<uint8_t> index;
+        std::vector<uint8_t> unpacked_index;
+        ByteSpan index;
         if (is_packed) {
             // 直接用count * 0x20作为解压大小
-            index = decompress(count * 0x20);
+            unpacked_index = decompress(index_offset, count * 0x20);
+            index = ByteSpan(unpacked_index.data(), unpacked_index.size());
         }
         else {
             // 读取到文件末尾
-            m_file.seekg(0, std::ios::end);
-            size_t file_size = m_file.tellg();
-            size_t index_size = file_size - index_offset;
-            m_file.seekg(index_offset);
-
-            index.resize(index_size);
-            m_file.read(reinterpret_cast<char*>(index.data()), index_size);
+            index = m_view.sub(index_offset);
         }
 
         // 解析索引
-        size_t pos = 0;
+        SpanReader reader(index);
         uint32_t data_offset = 0x10;
 
         for (int i = 0; i < count; ++i) {
             Entry entry;
 
             // 读取文件名 (15字节)
-            char name[16] = { 0 };
-            std::memcpy(name, &index[pos], 15);
-            entry.name = name;
-            pos += 15;
+            entry.name = reader.str(15);
 
             // 读取压缩标志
-            entry.is_packed = (index[pos] & 2) != 0;
-            pos += 9;
+            entry.is_packed = (reader.u8() & 2) != 0;
+            reader.skip(8);
 
             // 读取大小信息
-            entry.unpacked_size = *reinterpret_cast<uint32_t*>(&index[pos]);
-            entry.size = *reinterpret_cast<uint32_t*>(&index[pos + 4]);
-            pos += 8;
+            entry.unpacked_size = reader.u32le();
+            entry.size = reader.u32le();
 
             entry.offset = data_offset;
             data_offset += (entry.size + 0xF) & ~0xF;
@@ -227,49 +212,55 @@ private:
 
 public:
     bool open(const std::string& filename) {
-        m_file.open(filename, std::ios::binary);
-        if (!m_file.is_open())
-            return false;
+        try {
+            m_file = std::make_unique<MappedFile>(filename);
+            m_view = m_file->span();
 
-        // 读取文件头
-        uint32_t signature;
-        m_file.read(reinterpret_cast<char*>(&signature), 4);
-        if (signature != 0x00324146) // "FA2\0"
-            return false;
+            // 读取文件头
+            uint32_t signature = m_view.u32le(0);
+            if (signature != 0x00324146) // "FA2\0"
+                return false;
 
-        uint8_t flags;
-        m_file.read(reinterpret_cast<char*>(&flags), 1);
-        bool is_packed = (flags & 1) != 0;
+            uint8_t flags = m_view.u8(4);
+            bool is_packed = (flags & 1) != 0;
 
-        m_file.seekg(8);
-        uint32_t index_offset;
-        m_file.read(reinterpret_cast<char*>(&index_offset), 4);
+            uint32_t index_offset = m_view.u32le(8);
 
-        int count;
-        m_file.read(reinterpret_cast<char*>(&count), 4);
-        if (count <= 0 || count > 10000) // 简单的合法性检查
-            return false;
+            int count = static_cast<int>(m_view.u32le(12));
+            if (count <= 0 || count > 10000) // 简单的合法性检查
+                return false;
 
-        return readIndex(index_offset, is_packed, count);
+            return readIndex(index_offset, is_packed, count);
+        }
+        catch (const std::exception&) {
+            // 文件打不开或头部/索引被截断
+            return false;
+        }
     }
 
     bool extractFile(const Entry& entry, const std::string& output_path) {
-        m_file.seekg(entry.offset);
-
-        std::vector<uint8_t> data;
+        std::vector<uint8_t> unpacked;
+        const uint8_t* data;
         if (entry.is_packed) {
-            data = decompress(entry.unpacked_size);
+            try {
+                unpacked = decompress(entry.offset, entry.unpacked_size);
+            }
+            catch (const std::out_of_range&) {
+                return false;
+            }
+            data = unpacked.data();
         }
         else {
-            data.resize(entry.size);
-            m_file.read(reinterpret_cast<char*>(data.data()), entry.size);
+            if (!m_view.contains(entry.offset, entry.size))
+                return false;
+            data = m_view.at(entry.offset, entry.size);
         }
 
         std::ofstream outFile(output_path + "/" + entry.name, std::ios::binary);
         if (!outFile.is_open())
             return false;
 
-        outFile.write(reinterpret_cast<char*>(data.data()),
+        outFile.write(reinterpret_cast<const char*>(data),
             entry.is_packed ? entry.unpacked_size : entry.size);
         return true;
     }
@@ -277,11 +268,6 @@ public:
     const std::vector<Entry>& getEntries() const {
         return m_entries;
     }
-
-    ~Fa2Extractor() {
-        if (m_file.is_open())
-            m_file.close();
-    }
 };
 
 // FA2 packer class
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <memory>
 #include <zlib.h>
+#include "ZlibCodec.h"
 #include <windows.h>
 #include <map>
 
@@ -187,19 +188,9 @@ std::vector<uint8_t> extractFile(std::ifstream& file, const FltEntry& entry) {
     // 解压
     if (entry.compression == 1) {
         std::vector<uint8_t> unpackedData(entry.unpackedSize);
-        z_stream strm = {};
-        inflateInit(&strm);
-
-        strm.next_in = data.data();
-        strm.avail_in = data.size();
-        strm.next_out = unpackedData.data();
-        strm.avail_out = unpackedData.size();
-
-        if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
+        if (!ZlibCodec::threadLocal().inflate(data.data(), data.size(), unpackedData.data(), unpackedData.size())) {
             throw std::runtime_error("Decompression failed");
         }
-
-        inflateEnd(&strm);
         return unpackedData;
     }
 
@@ -263,28 +254,19 @@ std::pair<PackHeader, std::vector<FltEntry>> readOriginalPac(const std::string&
     return { header, entries };
 }
 
-std::vector<uint8_t> compressData(const std::vector<uint8_t>& input) {
-    z_stream strm = {};
-    deflateInit(&strm, Z_BEST_COMPRESSION);
-
-    std::vector<uint8_t> output(deflateBound(&strm, input.size()));
-
-    strm.next_in = (Bytef*)input.data();
-    strm.avail_in = input.size();
-    strm.next_out = output.data();
-    strm.avail_out = output.size();
-
-    deflate(&strm, Z_FINISH);
-    deflateEnd(&strm);
-
-    output.resize(strm.total_out);
+std::vector<uint8_t> compressData(const std::vector<uint8_t>& input, ZlibLevel level) {
+    std::vector<uint8_t> output;
+    if (!ZlibCodec::threadLocal().deflate(input.data(), input.size(), output, level)) {
+        throw std::runtime_error("Compression failed");
+    }
     return output;
 }
 
 void createNewPac(const std::string& originalPacPath,
     const std::string& decryptedIndexPath,
     const std::string& inputDir,
-    const std::string& outputPacPath) {
+    const std::string& outputPacPath,
+    ZlibLevel level) {
     std::cout << "Starting to create new PAC file...\n\n";
 
     // 读取原始PAC文件的头和索引
@@ -335,7 +317,7 @@ void createNewPac(const std::string& originalPacPath,
         );
 
         // 压缩数据
-        std::vector<uint8_t> compressedData = compressData(fileData);
+        std::vector<uint8_t> compressedData = compressData(fileData, level);
 
         // 更新条目信息
         entry.compression = 1;
@@ -428,7 +410,7 @@ int main(int argc, char* argv[]) {
         std::cout << "Made by julixian 2025.01.26" << std::endl;
         std::cout << "Usage:\n"
             << "Extract: " << argv[0] << " -e <input.pac> <output_dir>\n"
-            << "Pack:    " << argv[0] << " -p <original.pac> <index_decrypted.bin> <input_dir> <output.pac>\n";
+            << "Pack:    " << argv[0] << " -p <original.pac> <index_decrypted.bin> <input_dir> <output.pac> [--level fast|balanced|max]\n";
         return 1;
     }
 
@@ -442,11 +424,13 @@ int main(int argc, char* argv[]) {
             extractPac(argv[2], argv[3]);
         }
         else if (mode == "-p") {
-            if (argc != 6) {
-                std::cout << "Pack usage: " << argv[0] << " -p <original.pac> <index_decrypted.bin> <input_dir> <output.pac>\n";
+            ZlibLevel level = ZlibLevel::Max;
+            if ((argc != 6 && argc != 8) ||
+                (argc == 8 && (std::string(argv[6]) != "--level" || !parseZlibLevel(argv[7], level)))) {
+                std::cout << "Pack usage: " << argv[0] << " -p <original.pac> <index_decrypted.bin> <input_dir> <output.pac> [--level fast|balanced|max]\n";
                 return 1;
             }
-            createNewPac(argv[2], argv[3], argv[4], argv[5]);
+            createNewPac(argv[2], argv[3], argv[4], argv[5], level);
         }
         else {
             std::cout << "Invalid mode. Use -e for extract or -p for pack.\n";
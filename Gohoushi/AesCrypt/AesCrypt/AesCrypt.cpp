@@ -3,12 +3,21 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+#include <algorithm>
 #include <cryptopp/cryptlib.h>
 #include <cryptopp/aes.h>
 #include <cryptopp/sha.h>
 #include <cryptopp/hex.h>
 #include <cryptopp/filters.h>
 #include <cryptopp/pwdbased.h>
+#include "../../../ThreadCount.h"
+
+namespace fs = std::filesystem;
 
 // 用于将十六进制字符串转换为字节数组
 std::vector<CryptoPP::byte> HexToBytes(const std::string& hex) {
@@ -49,6 +58,32 @@ std::vector<CryptoPP::byte> DeriveKeyFromPassword(const std::string& password, c
     return derivedKey;
 }
 
+// 按 (密码, 盐值) 缓存派生出的密钥，同一组参数只做一次 PBKDF1
+class KeyCache {
+public:
+    explicit KeyCache(const std::string& password) : password(password) {}
+
+    std::vector<CryptoPP::byte> Get(const std::string& bundleKey) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = keys.find(bundleKey);
+        if (it != keys.end()) {
+            return it->second;
+        }
+        std::vector<CryptoPP::byte> salt(bundleKey.begin(), bundleKey.end());
+        std::vector<CryptoPP::byte> key = DeriveKeyFromPassword(password, salt, CryptoPP::AES::DEFAULT_KEYLENGTH);
+        keys.emplace(bundleKey, key);
+        return key;
+    }
+
+private:
+    std::string password;
+    std::map<std::string, std::vector<CryptoPP::byte>> keys;
+    std::mutex mutex;
+};
+
+// 每次批量生成的计数器块数 (64 KB 密钥流)
+const size_t BATCH_BLOCKS = 4096;
+
 // 实现类似于游戏中的 cipher 方法的加密/解密逻辑
 // 注意：由于使用 XOR，加密和解密操作是相同的
 void ProcessBuffer(CryptoPP::byte* buffer, size_t bufferSize, const CryptoPP::byte* key, bool isEncrypt) {
@@ -57,34 +92,127 @@ void ProcessBuffer(CryptoPP::byte* buffer, size_t bufferSize, const CryptoPP::by
     // 创建 AES 加密对象
     CryptoPP::AES::Encryption aesEncryption(key, CryptoPP::AES::DEFAULT_KEYLENGTH);
 
-    // 为每个块创建一个临时缓冲区
-    std::vector<CryptoPP::byte> counterBlock(blockSize, 0);
-    std::vector<CryptoPP::byte> encryptedCounter(blockSize);
+    // 计数器块：低 8 字节为小端序的 blockIndex，高 8 字节恒为 0
+    std::vector<CryptoPP::byte> counterBlocks(BATCH_BLOCKS * blockSize, 0);
 
-    // 按块处理整个缓冲区
     uint64_t blockIndex = 1; // 从1开始，与游戏逻辑一致
+    const size_t fullBlocks = bufferSize / blockSize;
+
+    // 整块部分：一次提交一批计数器，AdvancedProcessBlocks 会走流水线化的 AES-NI 路径，
+    // 并把密钥流直接与 buffer 按 16 字节异或后写回
+    for (size_t done = 0; done < fullBlocks; ) {
+        size_t count = std::min(BATCH_BLOCKS, fullBlocks - done);
+        for (size_t k = 0; k < count; k++) {
+            uint64_t counter = blockIndex + k;
+            for (int j = 0; j < 8; j++) {
+                counterBlocks[k * blockSize + j] = (counter >> (j * 8)) & 0xFF;
+            }
+        }
+
+        CryptoPP::byte* data = buffer + done * blockSize;
+        aesEncryption.AdvancedProcessBlocks(counterBlocks.data(), data, data, count * blockSize,
+            CryptoPP::BlockTransformation::BT_AllowParallel);
+
+        done += count;
+        blockIndex += count;
+    }
 
-    for (size_t position = 0; position < bufferSize; ) {
-        // 将 blockIndex 转换为字节数组（小端序）
+    // 末尾不足一块的部分
+    size_t position = fullBlocks * blockSize;
+    if (position < bufferSize) {
+        CryptoPP::byte counterBlock[CryptoPP::AES::BLOCKSIZE] = { 0 };
+        CryptoPP::byte encryptedCounter[CryptoPP::AES::BLOCKSIZE];
         for (int j = 0; j < 8; j++) {
             counterBlock[j] = (blockIndex >> (j * 8)) & 0xFF;
         }
+        aesEncryption.ProcessBlock(counterBlock, encryptedCounter);
+        for (size_t i = 0; position + i < bufferSize; i++) {
+            buffer[position + i] ^= encryptedCounter[i];
+        }
+    }
+}
 
-        // 加密计数器块
-        aesEncryption.ProcessBlock(counterBlock.data(), encryptedCounter.data());
+// 读取、处理并写出单个文件
+void ProcessFile(const fs::path& inputFile, const fs::path& outputFile, const CryptoPP::byte* key, bool isEncrypt, bool verbose) {
+    // 打开输入文件
+    std::ifstream inFile(inputFile, std::ios::binary);
+    if (!inFile) {
+        throw std::runtime_error("Cannot open input file " + inputFile.string());
+    }
 
-        // 计算这个块可以处理的字节数
-        size_t bytesToProcess = std::min(blockSize, bufferSize - position);
+    // 读取整个文件到内存
+    size_t fileSize = (size_t)fs::file_size(inputFile);
+    std::vector<CryptoPP::byte> buffer(fileSize);
+    inFile.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    inFile.close();
 
-        // 使用 XOR 处理这个块的数据
-        for (size_t i = 0; i < bytesToProcess; i++) {
-            buffer[position + i] ^= encryptedCounter[i];
+    if (verbose) {
+        std::cout << "File size: " << fileSize << " bytes" << std::endl;
+        std::cout << (isEncrypt ? "Encrypting..." : "Decrypting...") << std::endl;
+    }
+
+    // 处理缓冲区 (加密或解密)
+    ProcessBuffer(buffer.data(), fileSize, key, isEncrypt);
+
+    // 写入输出文件
+    std::ofstream outFile(outputFile, std::ios::binary);
+    if (!outFile) {
+        throw std::runtime_error("Cannot open output file " + outputFile.string());
+    }
+    outFile.write(reinterpret_cast<char*>(buffer.data()), fileSize);
+    outFile.close();
+}
+
+// 目录模式：用线程池并行处理目录下的所有文件。
+// 密码模式下如未指定 bundle key，则与 #dec.bat/#enc.bat 一样以文件名作为盐值
+int ProcessDirectory(const fs::path& inputDir, const fs::path& outputDir, bool isEncrypt,
+    const std::vector<CryptoPP::byte>& directKey, KeyCache* keyCache, const std::string& bundleKey) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path());
+        }
+    }
+
+    unsigned int numThreads = defaultThreadCount();
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(files.size(), 1));
+
+    std::atomic<size_t> nextFile{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex outputMutex;
+
+    auto worker = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            const fs::path& inputFile = files[i];
+            fs::path relPath = fs::relative(inputFile, inputDir);
+            fs::path outputFile = outputDir / relPath;
+            try {
+                fs::create_directories(outputFile.parent_path());
+                std::vector<CryptoPP::byte> key = keyCache
+                    ? keyCache->Get(bundleKey.empty() ? inputFile.filename().string() : bundleKey)
+                    : directKey;
+                ProcessFile(inputFile, outputFile, key.data(), isEncrypt, false);
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << (isEncrypt ? "Encrypted: " : "Decrypted: ") << relPath.string() << std::endl;
+            }
+            catch (const std::exception& e) {
+                failed++;
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Error processing " << relPath.string() << ": " << e.what() << std::endl;
+            }
         }
+    };
 
-        // 移动到下一个块
-        position += bytesToProcess;
-        blockIndex++;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
     }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::cout << "Processed " << files.size() - failed << "/" << files.size() << " files with " << numThreads << " threads." << std::endl;
+    return failed == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
@@ -94,11 +222,14 @@ int main(int argc, char* argv[]) {
         std::cout << "  Decrypt with password:    " << argv[0] << " decrypt <input_file> <output_file> -p <password> <bundle_key>" << std::endl;
         std::cout << "  Encrypt with direct key:  " << argv[0] << " encrypt <input_file> <output_file> -k <key_hex>" << std::endl;
         std::cout << "  Encrypt with password:    " << argv[0] << " encrypt <input_file> <output_file> -p <password> <bundle_key>" << std::endl;
+        std::cout << "  Whole directory:          " << argv[0] << " <decrypt|encrypt> <input_dir> <output_dir> <-k <key_hex> | -p <password> [bundle_key]>" << std::endl;
+        std::cout << "                            (without bundle_key, each file's name is used as its bundle key)" << std::endl;
         std::cout << "Examples:" << std::endl;
         std::cout << "  " << argv[0] << " decrypt encrypted.bundle decrypted.bundle -k 1A2B3C4D5E6F7A8B9C0D1E2F3A4B5C6D" << std::endl;
         std::cout << "  " << argv[0] << " decrypt encrypted.bundle decrypted.bundle -p 0123456789012345 bg_control" << std::endl;
         std::cout << "  " << argv[0] << " encrypt decrypted.bundle encrypted.bundle -k 1A2B3C4D5E6F7A8B9C0D1E2F3A4B5C6D" << std::endl;
         std::cout << "  " << argv[0] << " encrypt decrypted.bundle encrypted.bundle -p 0123456789012345 bg_control" << std::endl;
+        std::cout << "  " << argv[0] << " decrypt bundles bundles_dec -p 0123456789012345" << std::endl;
         return 1;
     }
 
@@ -119,6 +250,7 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    bool isDirectory = fs::is_directory(inputFile);
     std::vector<CryptoPP::byte> key;
 
     try {
@@ -129,6 +261,16 @@ int main(int argc, char* argv[]) {
 
             std::cout << "Using provided key: " << keyHex << std::endl;
         }
+        else if (mode == "-p" && isDirectory && argc >= 6) {
+            // 目录 + 密码派生模式，密钥在各工作线程中按需派生并缓存
+            std::string password = argv[5];
+            std::string bundleKey = argc >= 7 ? argv[6] : "";
+            KeyCache keyCache(password);
+
+            std::cout << "Password: " << password << std::endl;
+            std::cout << "Bundle Key (salt): " << (bundleKey.empty() ? "<file name>" : bundleKey) << std::endl;
+            return ProcessDirectory(inputFile, outputFile, isEncrypt, key, &keyCache, bundleKey);
+        }
         else if (mode == "-p" && argc >= 7) {
             // 密码派生模式
             std::string password = argv[5];
@@ -156,37 +298,11 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        // 打开输入文件
-        std::ifstream inFile(inputFile, std::ios::binary);
-        if (!inFile) {
-            std::cerr << "Error: Cannot open input file " << inputFile << std::endl;
-            return 1;
+        if (isDirectory) {
+            return ProcessDirectory(inputFile, outputFile, isEncrypt, key, nullptr, "");
         }
 
-        // 获取文件大小
-        inFile.seekg(0, std::ios::end);
-        size_t fileSize = inFile.tellg();
-        inFile.seekg(0, std::ios::beg);
-
-        // 读取整个文件到内存
-        std::vector<CryptoPP::byte> buffer(fileSize);
-        inFile.read(reinterpret_cast<char*>(buffer.data()), fileSize);
-        inFile.close();
-
-        std::cout << "File size: " << fileSize << " bytes" << std::endl;
-        std::cout << (isEncrypt ? "Encrypting..." : "Decrypting...") << std::endl;
-
-        // 处理缓冲区 (加密或解密)
-        ProcessBuffer(buffer.data(), fileSize, key.data(), isEncrypt);
-
-        // 写入输出文件
-        std::ofstream outFile(outputFile, std::ios::binary);
-        if (!outFile) {
-            std::cerr << "Error: Cannot open output file " << outputFile << std::endl;
-            return 1;
-        }
-        outFile.write(reinterpret_cast<char*>(buffer.data()), fileSize);
-        outFile.close();
+        ProcessFile(inputFile, outputFile, key.data(), isEncrypt, true);
 
         std::cout << (isEncrypt ? "Encryption" : "Decryption") << " completed successfully. Output written to " << outputFile << std::endl;
 
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <map>
 #include <cstring> // 用于 memcpy
+#include "PackPipeline.h"
 
 // 为了跨平台兼容性，定义文件系统库的别名
 namespace fs = std::filesystem;
@@ -257,48 +258,55 @@ void modify_append_archive(const fs::path& original_hxp, const fs::path& replace
     std::cout << "共解析到 " << section_count << " 个区段，" << all_patch_infos.size() << " 个文件条目。" << std::endl;
 
     // --- 4. 遍历所有文件条目，检查并追加替换文件 ---
-    std::vector<char> copy_buffer(1024 * 1024); // 1MB 缓冲区
-
+    // 替换文件的读取在线程池中进行，追加和修补索引按条目顺序在当前线程完成
+    struct HxpPackItem : PackItem {
+        uint32_t section_offset;    // 该条目所属的索引块的偏移
+        size_t entry_pos_in_buffer; // 该条目在对应索引缓冲区中的起始位置
+    };
+    std::vector<HxpPackItem> replacements;
     for (const auto& info : all_patch_infos) {
         fs::path replacement_path = replacements_dir / info.name;
 
         if (fs::exists(replacement_path) && fs::is_regular_file(replacement_path)) {
-            std::cout << "  发现替换文件: " << info.name << std::endl;
-
-            // 定位到当前封包文件的末尾，准备追加数据
-            new_file.seekp(0, std::ios::end);
-            uint64_t new_data_offset = new_file.tellp(); // 这就是新数据的偏移
-
-            // 获取替换文件的大小
-            uint32_t replacement_size = fs::file_size(replacement_path);
-
-            // 写入8字节的文件头 (不压缩)
-            write_u32_le(new_file, 0); // packed_size = 0
-            write_u32_le(new_file, replacement_size); // unpacked_size
-
-            // 写入替换文件的内容
-            std::ifstream replacement_file(replacement_path, std::ios::binary);
-            while (replacement_file) {
-                replacement_file.read(copy_buffer.data(), copy_buffer.size());
-                new_file.write(copy_buffer.data(), replacement_file.gcount());
-            }
-
-            // **核心步骤**: 修改对应索引块的内存副本，更新偏移量
-            std::cout << "    -> 追加到封包末尾，新偏移: " << std::hex << new_data_offset << std::endl;
-            auto& block_to_patch = index_blocks.at(info.section_offset);
-            write_u32_be_to_buffer(block_to_patch, info.entry_pos_in_buffer + 1, static_cast<uint32_t>(new_data_offset));
+            HxpPackItem item;
+            item.path = replacement_path;
+            item.name = info.name;
+            item.section_offset = info.section_offset;
+            item.entry_pos_in_buffer = info.entry_pos_in_buffer;
+            replacements.push_back(std::move(item));
         }
     }
 
-    std::cout << "所有文件检查完毕，正在将更新后的索引块写回封包..." << std::endl;
-    for (const auto& pair : index_blocks) {
-        uint32_t section_offset = pair.first;
-        const auto& modified_block = pair.second;
+    PackHooks<HxpPackItem> hooks;
+    // 在文件内容前加上8字节的文件头 (不压缩)
+    hooks.transform = [](HxpPackItem& item) {
+        uint32_t header[2] = { 0, static_cast<uint32_t>(item.data.size()) }; // packed_size = 0, unpacked_size
+        item.data.insert(item.data.begin(), reinterpret_cast<const uint8_t*>(header), reinterpret_cast<const uint8_t*>(header + 2));
+    };
+    hooks.written = [&](const HxpPackItem& item) {
+        std::cout << "  发现替换文件: " << item.name << std::endl;
 
-        new_file.seekp(section_offset);
-        new_file.write(modified_block.data(), modified_block.size());
-        std::cout << "  已更新偏移 " << std::hex << section_offset << " 处的索引块。" << std::endl;
-    }
+        // **核心步骤**: 修改对应索引块的内存副本，更新偏移量
+        std::cout << "    -> 追加到封包末尾，新偏移: " << std::hex << item.offset << std::endl;
+        auto& block_to_patch = index_blocks.at(item.section_offset);
+        write_u32_be_to_buffer(block_to_patch, item.entry_pos_in_buffer + 1, static_cast<uint32_t>(item.offset));
+    };
+    hooks.emitIndex = [&](std::ostream& out, std::vector<HxpPackItem>&, uint64_t) {
+        std::cout << "所有文件检查完毕，正在将更新后的索引块写回封包..." << std::endl;
+        for (const auto& pair : index_blocks) {
+            uint32_t section_offset = pair.first;
+            const auto& modified_block = pair.second;
+
+            out.seekp(section_offset);
+            out.write(modified_block.data(), modified_block.size());
+            std::cout << "  已更新偏移 " << std::hex << section_offset << " 处的索引块。" << std::endl;
+        }
+    };
+
+    // 新数据追加在当前封包文件的末尾
+    new_file.seekp(0, std::ios::end);
+    uint64_t append_offset = new_file.tellp();
+    runPackPipeline(new_file, replacements, append_offset, hooks);
 
     new_file.close();
     std::cout << "\n'追加并修补索引' 模式修改完成！" << std::endl;
@@ -0,0 +1,356 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <emmintrin.h>
+#include "LzssTreeEncoder.h"
+#include "LzssDecoder.h"
+
+// RMTImageTool / AKBImageTool / AbmImageTool / AI5WINGccImageTool 与 BatchImageConvertTool 共用的编码器。
+// 输入统一为自上而下的 8 位 RGBA，返回完整的文件内容 (文件头 + 数据)。
+// LZSS 统一使用 LzssTreeEncoder，与各工具原来的 lzss_compress 输出逐字节一致。
+
+#pragma pack(push, 1)
+struct RmtHeader {
+    uint32_t signature; // 0x20544D52 ('RMT ')
+    int32_t  offsetX;
+    int32_t  offsetY;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct AkbHeader {
+    uint32_t signature;
+    uint16_t width;
+    uint16_t height;
+    uint32_t flags;
+    uint8_t  background[4]; // BGRA
+    int32_t  offsetX;
+    int32_t  offsetY;
+    int32_t  right;
+    int32_t  bottom;
+};
+
+struct BMHeader {
+    char magic[2];          // 'BM'
+    uint32_t unpackedSize;  // 0x02
+    uint32_t reserved;      // 0x06
+    uint32_t frameOffset;   // 0x0A
+    uint32_t unknown;       // 0x0E
+    uint32_t width;         // 0x12
+    uint32_t height;        // 0x16
+    uint16_t reserved2;     // 0x1A
+    uint16_t type;          // 0x1C
+};
+
+struct GccHeader {
+    uint32_t signature;  // 'G24m'
+    int16_t offsetX;
+    int16_t offsetY;
+    uint16_t width;
+    uint16_t height;
+    uint32_t alphaOffset;
+    uint32_t imageOffset;
+    uint32_t reserved;
+    uint16_t alphaWidth;
+    uint16_t alphaHeight;
+    uint32_t alphaInternalOffset;
+};
+#pragma pack(pop)
+
+// 交换每个 32 位像素的第 0 和第 2 字节 (RGBA -> BGRA)
+inline __m128i swapRedBlue(__m128i v) {
+    const __m128i keep = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    __m128i ag = _mm_and_si128(v, keep);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+    __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+    return _mm_or_si128(ag, _mm_or_si128(b, r));
+}
+
+// dst = BGRA(cur - ref)；ref 为空时表示这是差分的第一行，每个像素减去左边像素。
+// 逐字节相减与通道交换可以互换顺序，所以直接对 RGBA 源数据相减后再交换 R/B
+inline void deltaRowToBgra(const uint8_t* cur, const uint8_t* ref, uint8_t* dst, size_t stride) {
+    size_t i = 0;
+    if (!ref) {
+        if (stride == 0) return;
+        dst[0] = cur[2];
+        dst[1] = cur[1];
+        dst[2] = cur[0];
+        dst[3] = cur[3];
+        ref = cur - 4;
+        i = 4;
+    }
+    for (; i + 16 <= stride; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ref + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), swapRedBlue(_mm_sub_epi8(a, b)));
+    }
+    for (; i < stride; i += 4) {
+        dst[i + 0] = cur[i + 2] - ref[i + 2];
+        dst[i + 1] = cur[i + 1] - ref[i + 1];
+        dst[i + 2] = cur[i + 0] - ref[i + 0];
+        dst[i + 3] = cur[i + 3] - ref[i + 3];
+    }
+}
+
+template<typename Header>
+std::vector<uint8_t> withHeader(const Header& header, const std::vector<uint8_t>& body) {
+    std::vector<uint8_t> file(sizeof(Header) + body.size());
+    memcpy(file.data(), &header, sizeof(Header));
+    if (!body.empty()) {
+        memcpy(file.data() + sizeof(Header), body.data(), body.size());
+    }
+    return file;
+}
+
+// RMT：先垂直翻转，再转 BGRA 做差分 (第一行减左边像素，其余行减上一行)，最后 LZSS 压缩
+inline std::vector<uint8_t> encodeRmt(const uint8_t* rgba, uint32_t width, uint32_t height, LzssTreeEncoder& lzss, bool lazy = false) {
+    const size_t stride = (size_t)width * 4;
+    std::vector<uint8_t> delta(stride * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* cur = rgba + (size_t)(height - 1 - y) * stride;
+        const uint8_t* ref = y == 0 ? nullptr : cur + stride;
+        deltaRowToBgra(cur, ref, delta.data() + y * stride, stride);
+    }
+
+    std::vector<uint8_t> compressed;
+    lzss.compress(delta.data(), delta.size(), compressed, lazy);
+    RmtHeader header = { 0x20544D52, 0, 0, width, height };
+    return withHeader(header, compressed);
+}
+
+// AKB：先在原始行序上做差分，再把结果行倒序存放，最后 LZSS 压缩
+inline std::vector<uint8_t> encodeAkb(const uint8_t* rgba, uint32_t width, uint32_t height, LzssTreeEncoder& lzss) {
+    if (width > 0xFFFF || height > 0xFFFF) {
+        throw std::runtime_error("Image is too large for AKB");
+    }
+    const size_t stride = (size_t)width * 4;
+    std::vector<uint8_t> delta(stride * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* cur = rgba + (size_t)y * stride;
+        const uint8_t* ref = y == 0 ? nullptr : cur - stride;
+        deltaRowToBgra(cur, ref, delta.data() + (size_t)(height - 1 - y) * stride, stride);
+    }
+
+    std::vector<uint8_t> compressed;
+    lzss.compress(delta.data(), delta.size(), compressed);
+
+    AkbHeader header = {};
+    header.signature = 0x20424B41; // 'AKB '
+    header.width = (uint16_t)width;
+    header.height = (uint16_t)height;
+    header.flags = 0x80000000; // bit 30 为 0 表示 32bpp，bit 31 为 1 表示带 Alpha
+    header.right = (int32_t)width;
+    header.bottom = (int32_t)height;
+    return withHeader(header, compressed);
+}
+
+// ABM：逐像素按 Alpha 写出跳过/不透明/半透明指令
+inline std::vector<uint8_t> encodeAbm(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    BMHeader header = {};
+    header.magic[0] = 'B';
+    header.magic[1] = 'M';
+    header.unpackedSize = width * height * 4; // BGRA
+    header.frameOffset = 0x46; // 固定偏移量
+    header.width = width;
+    header.height = height;
+    header.type = 0x20; // 32位模式
+
+    std::vector<uint8_t> file(header.frameOffset, 0);
+    memcpy(file.data(), &header, sizeof(header));
+    file.reserve(header.frameOffset + (size_t)width * height * 6);
+
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        const uint8_t* p = rgba + i * 4;
+        uint8_t alpha = p[3];
+        if (alpha == 0) {
+            // 完全透明的像素：使用跳过指令
+            file.insert(file.end(), { 0x00, 3 });
+        }
+        else if (alpha == 0xFF) {
+            // 完全不透明的像素：使用FF指令
+            file.insert(file.end(), { 0xFF, 3, p[2], p[1], p[0] });
+        }
+        else {
+            // 半透明的像素：每个分量前都写一次 Alpha
+            file.insert(file.end(), { alpha, p[2], alpha, p[1], alpha, p[0] });
+        }
+    }
+    return file;
+}
+
+// 读取原始 GCC 的文件头，文件不存在时返回 false
+inline bool readGccHeader(const std::filesystem::path& path, GccHeader& header) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return true;
+}
+
+// G24m Alpha 流：先是全部控制字节 (alphaInternalOffset 个)，再是全部数据字节。
+// 控制位低位在前，0 表示数据区中的一个直接字节，1 表示窗口引用：数据区中的两字节，
+// 与颜色数据相同为 12 位窗口位置 + 4 位长度 (3~18)，窗口 0x1000，起始 0xFEE，填充 0。
+// 全 0 控制字节加原始 Alpha 也是合法的流 (原先一直输出的排列)
+inline std::vector<uint8_t> decodeGccAlpha(const uint8_t* stream, size_t streamSize, size_t controlSize, size_t outSize) {
+    std::vector<uint8_t> output;
+    output.reserve(outSize);
+    uint8_t window[0x1000] = {};
+    size_t windowPos = 0xFEE;
+    size_t dataPos = controlSize;
+    auto put = [&](uint8_t value) {
+        output.push_back(value);
+        window[windowPos] = value;
+        windowPos = (windowPos + 1) & 0xFFF;
+    };
+    for (size_t controlPos = 0; controlPos < controlSize && controlPos < streamSize && output.size() < outSize; ++controlPos) {
+        uint8_t flags = stream[controlPos];
+        for (int bit = 0; bit < 8 && output.size() < outSize; ++bit) {
+            if (!(flags & (1 << bit))) {
+                if (dataPos >= streamSize) return output;
+                put(stream[dataPos++]);
+            }
+            else {
+                if (dataPos + 1 >= streamSize) return output;
+                uint8_t lo = stream[dataPos++];
+                uint8_t hi = stream[dataPos++];
+                size_t offset = ((hi & 0xF0) << 4) | lo;
+                size_t count = 3 + (hi & 0xF);
+                for (size_t k = 0; k < count && output.size() < outSize; ++k) {
+                    put(window[(offset + k) & 0xFFF]);
+                }
+            }
+        }
+    }
+    return output;
+}
+
+// 标准 LZSS 压缩后拆成 G24m Alpha 的排列：控制位取反 (标准流中 1 为字面量)，控制字节和数据字节分开存放
+inline std::vector<uint8_t> encodeGccAlpha(const std::vector<uint8_t>& alpha, size_t& controlSize, LzssTreeEncoder& lzss) {
+    std::vector<uint8_t> packed;
+    lzss.compress(alpha.data(), alpha.size(), packed);
+
+    std::vector<uint8_t> control;
+    std::vector<uint8_t> data;
+    control.reserve(packed.size() / 8 + 1);
+    data.reserve(packed.size());
+    size_t pos = 0;
+    while (pos < packed.size()) {
+        uint8_t flags = packed[pos++];
+        uint8_t references = 0;
+        for (int bit = 0; bit < 8 && pos < packed.size(); ++bit) {
+            if (flags & (1 << bit)) {
+                data.push_back(packed[pos++]);
+            }
+            else {
+                references |= (uint8_t)(1 << bit);
+                data.insert(data.end(), packed.begin() + pos, packed.begin() + pos + 2);
+                pos += 2;
+            }
+        }
+        control.push_back(references);
+    }
+
+    controlSize = control.size();
+    control.insert(control.end(), data.begin(), data.end());
+    return control;
+}
+
+// GCC G24m：行序自下而上，BGR 走标准 LZSS (0x1000 窗口，0xFEE 起始，填充 0)，Alpha 见 encodeGccAlpha。
+// 颜色和 Alpha 互不依赖，Alpha 在另一个线程中同时压缩，两者都解码一遍确认能还原。
+// original 为原始 GCC 的文件头 (可为空)，沿用其中的偏移和 Alpha 尺寸
+inline std::vector<uint8_t> encodeGcc(const uint8_t* rgba, uint32_t width, uint32_t height, const GccHeader* original, LzssTreeEncoder& lzss) {
+    GccHeader header = {};
+    header.signature = 0x6D343247; // G24m
+    header.width = (uint16_t)width;
+    header.height = (uint16_t)height;
+    header.imageOffset = 0x20;
+    header.alphaWidth = (uint16_t)width;
+    header.alphaHeight = (uint16_t)height;
+
+    if (original) {
+        header.imageOffset = original->imageOffset;
+        if (original->signature == 0x6d343247 || original->signature == 0x6d343252) {
+            // 使用原始文件的Alpha尺寸和偏移
+            header.offsetX = original->offsetX;
+            header.offsetY = original->offsetY;
+            header.alphaWidth = original->alphaWidth;
+            header.alphaHeight = original->alphaHeight;
+        }
+        else if (original->signature == 0x6e343247 || original->signature == 0x6e343252) {
+            // 24n模式使用PNG尺寸作为Alpha尺寸
+            header.offsetX = original->offsetX;
+            header.offsetY = original->offsetY;
+        }
+    }
+
+    std::vector<uint8_t> bgrData((size_t)width * height * 3);
+    std::vector<uint8_t> alphaData((size_t)header.alphaWidth * header.alphaHeight, 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t* bgr = bgrData.data() + (size_t)y * width * 3;
+        int64_t alphaY = (int64_t)header.alphaHeight - header.offsetY - height + y;
+        for (uint32_t x = 0; x < width; ++x) {
+            bgr[x * 3 + 0] = row[x * 4 + 2];
+            bgr[x * 3 + 1] = row[x * 4 + 1];
+            bgr[x * 3 + 2] = row[x * 4 + 0];
+
+            int64_t alphaPos = alphaY * header.alphaWidth + x + header.offsetX;
+            if (alphaPos < 0 || alphaPos >= (int64_t)alphaData.size()) {
+                throw std::runtime_error("Image does not fit the alpha plane of the original GCC");
+            }
+            alphaData[(size_t)alphaPos] = row[x * 4 + 3];
+        }
+    }
+
+    std::vector<uint8_t> compressedAlpha;
+    size_t alphaControlSize = 0;
+    std::exception_ptr alphaError;
+    std::thread alphaThread([&]() {
+        try {
+            compressedAlpha = encodeGccAlpha(alphaData, alphaControlSize, LzssTreeEncoder::threadLocal());
+            if (decodeGccAlpha(compressedAlpha.data(), compressedAlpha.size(), alphaControlSize, alphaData.size()) != alphaData) {
+                throw std::runtime_error("Alpha round-trip check failed");
+            }
+        }
+        catch (...) {
+            alphaError = std::current_exception();
+        }
+    });
+
+    std::vector<uint8_t> compressedBgr;
+    std::exception_ptr bgrError;
+    try {
+        lzss.compress(bgrData.data(), bgrData.size(), compressedBgr);
+        // 颜色数据用通用解码器解一遍，确认能还原
+        if (LzssDecoder<0x1000, 0, 0xFEE>::decode(compressedBgr, bgrData.size()) != bgrData) {
+            throw std::runtime_error("LZSS round-trip check failed");
+        }
+    }
+    catch (...) {
+        bgrError = std::current_exception();
+    }
+    alphaThread.join();
+    if (bgrError) {
+        std::rethrow_exception(bgrError);
+    }
+    if (alphaError) {
+        std::rethrow_exception(alphaError);
+    }
+
+    header.alphaOffset = (uint32_t)compressedBgr.size();
+    header.alphaInternalOffset = (uint32_t)alphaControlSize;
+
+    std::vector<uint8_t> file = withHeader(header, compressedBgr);
+    file.insert(file.end(), compressedAlpha.begin(), compressedAlpha.end());
+    return file;
+}
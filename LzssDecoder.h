@@ -0,0 +1,123 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 控制字节中标志位的读取顺序
+enum class LzssBitOrder {
+    LsbFirst, // bit = 1, 2, 4 ... 0x80
+    MsbFirst, // bit = 0x80, 0x40 ... 1
+};
+
+// 通用 LZSS 解码器（控制位为 1 表示字面量，引用为 12 位窗口偏移 + 4 位长度 (3~18)）。
+// 窗口大小、填充字节、初始写入位置和控制位顺序均为编译期参数。
+// 解码时不维护独立的环形窗口，而是直接把已输出的数据当作窗口：
+// 窗口偏移换算为相对当前输出位置的回溯距离，超出已输出范围的部分即初始填充字节。
+template<uint32_t FrameSize, uint8_t FrameFill, uint32_t FrameInitPos, LzssBitOrder BitOrder = LzssBitOrder::LsbFirst>
+class LzssDecoder {
+    static_assert((FrameSize & (FrameSize - 1)) == 0, "FrameSize must be a power of two");
+    static constexpr uint32_t FrameMask = FrameSize - 1;
+    static constexpr size_t MaxGroupOutput = 8 * 18;
+
+public:
+    // 解码到调用方预先分配好的缓冲区，写满 dstSize 或输入耗尽时停止，返回实际写入的字节数
+    static size_t decode(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+        return decodeImpl<false>(src, srcSize, dst, dstSize, nullptr);
+    }
+
+    // unpackedSize 已知时一次分配到位；为 0 时按需扩容，解完整个输入
+    static std::vector<uint8_t> decode(const uint8_t* src, size_t srcSize, size_t unpackedSize = 0) {
+        std::vector<uint8_t> output;
+        if (unpackedSize != 0) {
+            output.resize(unpackedSize);
+            output.resize(decodeImpl<false>(src, srcSize, output.data(), output.size(), nullptr));
+        }
+        else {
+            output.resize(srcSize * 2 + MaxGroupOutput);
+            output.resize(decodeImpl<true>(src, srcSize, output.data(), output.size(), &output));
+        }
+        return output;
+    }
+
+    static std::vector<uint8_t> decode(const std::vector<uint8_t>& input, size_t unpackedSize = 0) {
+        return decode(input.data(), input.size(), unpackedSize);
+    }
+
+private:
+    static constexpr uint32_t flagBit(int i) {
+        return BitOrder == LzssBitOrder::LsbFirst ? (1u << i) : (0x80u >> i);
+    }
+
+    template<bool Growable>
+    static size_t decodeImpl(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize, std::vector<uint8_t>* growable) {
+        size_t inPos = 0;
+        size_t outPos = 0;
+
+        while (inPos < srcSize) {
+            if constexpr (Growable) {
+                if (dstSize - outPos < MaxGroupOutput) {
+                    growable->resize(dstSize * 2);
+                    dst = growable->data();
+                    dstSize = growable->size();
+                }
+            }
+            else {
+                if (outPos >= dstSize) break;
+            }
+
+            uint8_t ctrl = src[inPos++];
+
+            // 整组都是字面量时直接整块拷贝
+            if (ctrl == 0xFF && srcSize - inPos >= 8 && dstSize - outPos >= 8) {
+                memcpy(dst + outPos, src + inPos, 8);
+                inPos += 8;
+                outPos += 8;
+                continue;
+            }
+
+            for (int i = 0; i < 8 && inPos < srcSize; ++i) {
+                if (ctrl & flagBit(i)) {
+                    if (!Growable && outPos >= dstSize) return outPos;
+                    dst[outPos++] = src[inPos++];
+                }
+                else {
+                    if (inPos + 1 >= srcSize) return outPos;
+                    uint8_t lo = src[inPos++];
+                    uint8_t hi = src[inPos++];
+                    uint32_t offset = ((hi & 0xF0) << 4) | lo;
+                    size_t count = 3 + (hi & 0xF);
+                    if (!Growable && count > dstSize - outPos) {
+                        count = dstSize - outPos;
+                    }
+
+                    // 窗口位置 offset 上的字节是 distance 个字节之前写入的 (1 ~ FrameSize)
+                    size_t distance = ((FrameInitPos + outPos - offset - 1) & FrameMask) + 1;
+                    uint8_t* out = dst + outPos;
+                    if (distance <= outPos) {
+                        const uint8_t* from = out - distance;
+                        if (distance >= count) {
+                            memcpy(out, from, count);
+                        }
+                        else {
+                            for (size_t k = 0; k < count; ++k) {
+                                out[k] = from[k];
+                            }
+                        }
+                    }
+                    else {
+                        for (size_t k = 0; k < count; ++k) {
+                            size_t pos = outPos + k;
+                            out[k] = pos >= distance ? dst[pos - distance] : FrameFill;
+                        }
+                    }
+                    outPos += count;
+                }
+            }
+        }
+        return outPos;
+    }
+};
+
+// 0x1000 窗口、0 填充、从 0xFEE 开始写入，低位优先：Ankh/BananaDatPk/Bnd/Otemoto/RPM/Yaneurao 共用的格式
+using StandardLzssDecoder = LzssDecoder<0x1000, 0x00, 0xFEE>;
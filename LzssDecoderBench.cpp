@@ -0,0 +1,157 @@
+﻿// LzssDecoder.h 的解码吞吐基准：与原先各工具中复制粘贴的 LzssDecompressor 对比
+// 用法: LzssDecoderBench [input_file] [iterations]
+// 不指定输入文件时使用内置的合成数据
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include "LzssDecoder.h"
+
+// 原实现，保留作对照
+class LegacyLzssDecompressor {
+public:
+    LegacyLzssDecompressor(int frameSize, uint8_t frameFill, int frameInitPos, bool msbFirst)
+        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos), m_msbFirst(msbFirst) {
+    }
+
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
+        std::vector<uint8_t> output;
+        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
+        int framePos = m_frameInitPos;
+        int frameMask = m_frameSize - 1;
+
+        size_t inputPos = 0;
+        while (inputPos < input.size()) {
+            uint8_t ctrl = input[inputPos++];
+            for (int i = 0; i < 8 && inputPos < input.size(); ++i) {
+                int bit = m_msbFirst ? (0x80 >> i) : (1 << i);
+                if (ctrl & bit) {
+                    uint8_t b = input[inputPos++];
+                    frame[framePos++ & frameMask] = b;
+                    output.push_back(b);
+                }
+                else {
+                    if (inputPos + 1 >= input.size()) break;
+                    uint8_t lo = input[inputPos++];
+                    uint8_t hi = input[inputPos++];
+                    int offset = ((hi & 0xf0) << 4) | lo;
+                    int count = 3 + (hi & 0xF);
+
+                    for (int k = 0; k < count; ++k) {
+                        uint8_t v = frame[offset++ & frameMask];
+                        frame[framePos++ & frameMask] = v;
+                        output.push_back(v);
+                    }
+                }
+            }
+        }
+
+        return output;
+    }
+
+private:
+    int m_frameSize;
+    uint8_t m_frameFill;
+    int m_frameInitPos;
+    bool m_msbFirst;
+};
+
+// 简单的贪心编码器，只用于生成测试流
+std::vector<uint8_t> encodeForBench(const std::vector<uint8_t>& input, uint32_t frameInitPos, bool msbFirst) {
+    std::vector<uint8_t> output;
+    std::vector<int64_t> lastSeen(1 << 16, -1);
+    size_t pos = 0;
+    while (pos < input.size()) {
+        size_t ctrlPos = output.size();
+        output.push_back(0);
+        for (int i = 0; i < 8 && pos < input.size(); ++i) {
+            uint8_t bit = msbFirst ? (0x80 >> i) : (1 << i);
+            size_t bestLength = 0;
+            int64_t candidate = -1;
+            if (pos + 2 < input.size()) {
+                uint32_t h = (input[pos] << 8 | input[pos + 1]) ^ (input[pos + 2] << 4);
+                h &= 0xFFFF;
+                candidate = lastSeen[h];
+                lastSeen[h] = (int64_t)pos;
+            }
+            if (candidate >= 0 && pos - candidate < 0x1000) {
+                while (bestLength < 18 && pos + bestLength < input.size() && input[candidate + bestLength] == input[pos + bestLength]) {
+                    bestLength++;
+                }
+            }
+            if (bestLength >= 3) {
+                uint32_t offset = (frameInitPos + (uint32_t)candidate) & 0xFFF;
+                output.push_back(offset & 0xFF);
+                output.push_back(((offset >> 4) & 0xF0) | (uint8_t)(bestLength - 3));
+                pos += bestLength;
+            }
+            else {
+                output[ctrlPos] |= bit;
+                output.push_back(input[pos++]);
+            }
+        }
+    }
+    return output;
+}
+
+template<typename Func>
+double measure(int iterations, size_t bytes, Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return bytes * (double)iterations / elapsed.count() / (1024.0 * 1024.0);
+}
+
+template<typename Decoder>
+void runVariant(const std::string& name, const std::vector<uint8_t>& raw, uint8_t fill, uint32_t initPos, bool msbFirst, int iterations) {
+    std::vector<uint8_t> packed = encodeForBench(raw, initPos, msbFirst);
+    LegacyLzssDecompressor legacy(0x1000, fill, initPos, msbFirst);
+
+    if (legacy.decompress(packed) != raw || Decoder::decode(packed) != raw || Decoder::decode(packed, raw.size()) != raw) {
+        std::cout << name << ": output mismatch!" << std::endl;
+        return;
+    }
+
+    std::vector<uint8_t> dst(raw.size());
+    double legacySpeed = measure(iterations, raw.size(), [&]() { legacy.decompress(packed); });
+    double growSpeed = measure(iterations, raw.size(), [&]() { Decoder::decode(packed); });
+    double sizedSpeed = measure(iterations, raw.size(), [&]() { Decoder::decode(packed.data(), packed.size(), dst.data(), dst.size()); });
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+        << " legacy " << std::setw(8) << legacySpeed << " MB/s"
+        << " | unknown size " << std::setw(8) << growSpeed << " MB/s"
+        << " | known size " << std::setw(8) << sizedSpeed << " MB/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<uint8_t> raw;
+    if (argc >= 2) {
+        std::ifstream ifs(argv[1], std::ios::binary);
+        if (!ifs) {
+            std::cerr << "Can not open file: " << argv[1] << std::endl;
+            return 1;
+        }
+        raw.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    else {
+        // 类似脚本/图像的可压缩数据
+        std::mt19937 rng(12345);
+        raw.resize(16 * 1024 * 1024);
+        for (size_t i = 0; i < raw.size(); ++i) {
+            raw[i] = (rng() % 5 == 0) ? (uint8_t)rng() : (uint8_t)("scenario text line, "[i % 20]);
+        }
+    }
+    int iterations = argc >= 3 ? std::stoi(argv[2]) : 5;
+
+    std::cout << "Input: " << raw.size() << " bytes, " << iterations << " iterations" << std::endl;
+    runVariant<StandardLzssDecoder>("0x1000/0x00/0xFEE LSB", raw, 0x00, 0xFEE, false, iterations);
+    runVariant<LzssDecoder<0x1000, 0x20, 0xFEE>>("0x1000/0x20/0xFEE LSB", raw, 0x20, 0xFEE, false, iterations);
+    runVariant<LzssDecoder<0x1000, 0x00, 0x000>>("0x1000/0x00/0x000 LSB", raw, 0x00, 0x000, false, iterations);
+    runVariant<LzssDecoder<0x1000, 0x00, 0xFEE, LzssBitOrder::MsbFirst>>("0x1000/0x00/0xFEE MSB", raw, 0x00, 0xFEE, true, iterations);
+    return 0;
+}
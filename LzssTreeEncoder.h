@@ -0,0 +1,294 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "ThreadCount.h"
+
+// Okumura LZSS.C 二叉树编码器 (N=4096, F=18, THRESHOLD=2, 窗口初始位置 0xFEE，填充 0x00)。
+// 原为各工具中的 lzss_compress/encode_state，每次调用都要 malloc 并 memset 约 100 KB 的状态。
+// 现在状态放在对象里可重复使用：reset 只重置树根、parent 和窗口的填充区，
+// 非惰性模式下输出与原 lzss_compress 逐字节一致。同一个对象不能被多个线程同时使用。
+//
+// 4/6/1989 Haruhiko Okumura, Use, distribute, and modify this program freely.
+// https://github.com/satan53x/SExtractor/tree/main/libs/lzss (Copyright 2015 Pupyshev Nikita)
+class LzssTreeEncoder {
+    static constexpr int N = 4096;
+    static constexpr int F = 18;
+    static constexpr int THRESHOLD = 2;
+    static constexpr int NIL = N;
+
+public:
+    LzssTreeEncoder() = default;
+    LzssTreeEncoder(const LzssTreeEncoder&) = delete;
+    LzssTreeEncoder& operator=(const LzssTreeEncoder&) = delete;
+
+    // 当前线程的编码器，第一次使用时创建，之后一直复用
+    static LzssTreeEncoder& threadLocal() {
+        thread_local LzssTreeEncoder encoder;
+        return encoder;
+    }
+
+    // 压缩到 output (会被清空)，控制位为 1 表示字面量。
+    // lazy 为 true 时启用惰性匹配：下一个位置的匹配更长时当前位置先输出字面量，输出更小但稍慢
+    void compress(const uint8_t* src, size_t srclen, std::vector<uint8_t>& output, bool lazy = false) {
+        output.clear();
+        if (srclen == 0) {
+            return;
+        }
+        output.reserve(srclen + srclen / 8 + 1);
+        reset();
+
+        const uint8_t* srcend = src + srclen;
+        size_t controlPos = 0;
+        uint8_t mask = 0;
+        auto emitLiteral = [&](uint8_t c) {
+            if (mask == 0) {
+                controlPos = output.size();
+                output.push_back(0);
+                mask = 1;
+            }
+            output[controlPos] |= mask;
+            output.push_back(c);
+            mask <<= 1;
+        };
+        auto emitMatch = [&](int position, int length) {
+            if (mask == 0) {
+                controlPos = output.size();
+                output.push_back(0);
+                mask = 1;
+            }
+            output.push_back((uint8_t)position);
+            output.push_back((uint8_t)(((position >> 4) & 0xF0) | (length - (THRESHOLD + 1))));
+            mask <<= 1;
+        };
+
+        int s = 0;
+        int r = N - F;
+        int len;
+        for (len = 0; len < F && src < srcend; len++) {
+            m_textBuf[r + len] = *src++;
+        }
+        for (int i = 1; i <= F; i++) {
+            insertNode(r - i);
+        }
+        insertNode(r);
+
+        // 前进一个字节：删除最旧的串，读入新字节，并把 r 处的串插入树中 (同时得到 r 处的匹配)
+        auto advance = [&]() {
+            deleteNode(s);
+            if (src < srcend) {
+                uint8_t c = *src++;
+                m_textBuf[s] = c;
+                if (s < F - 1) {
+                    m_textBuf[s + N] = c;
+                }
+                s = (s + 1) & (N - 1);
+                r = (r + 1) & (N - 1);
+                insertNode(r);
+            }
+            else {
+                s = (s + 1) & (N - 1);
+                r = (r + 1) & (N - 1);
+                if (--len) {
+                    insertNode(r);
+                }
+            }
+        };
+
+        do {
+            if (m_matchLength > len) {
+                m_matchLength = len;
+            }
+            if (m_matchLength <= THRESHOLD) {
+                emitLiteral(m_textBuf[r]);
+                advance();
+                continue;
+            }
+
+            int matchPosition = m_matchPosition;
+            int matchLength = m_matchLength;
+            int skip = matchLength;
+            if (lazy && matchLength < F) {
+                uint8_t current = m_textBuf[r];
+                advance();
+                if (std::min(m_matchLength, len) > matchLength) {
+                    // 下一个位置的匹配更长，交给下一轮处理
+                    emitLiteral(current);
+                    continue;
+                }
+                skip--;
+            }
+            emitMatch(matchPosition, matchLength);
+            while (skip-- > 0) {
+                advance();
+            }
+        } while (len > 0);
+    }
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& input, bool lazy = false) {
+        std::vector<uint8_t> output;
+        compress(input.data(), input.size(), output, lazy);
+        return output;
+    }
+
+    // 用 threadCount 个线程对 [0, count) 中的每个下标调用 job(index, encoder)，
+    // encoder 为所在线程的编码器。job 抛出的异常会在全部线程结束后重新抛出第一个
+    template<typename Job>
+    static void parallelFor(size_t count, unsigned threadCount, Job&& job) {
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        threadCount = (unsigned)std::min<size_t>(threadCount, count);
+
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::exception_ptr> errors(threadCount);
+        auto worker = [&](unsigned id) {
+            LzssTreeEncoder& encoder = threadLocal();
+            try {
+                for (size_t i; (i = next.fetch_add(1)) < count; ) {
+                    job(i, encoder);
+                }
+            }
+            catch (...) {
+                errors[id] = std::current_exception();
+                next = count;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < threadCount; ++t) {
+            threads.emplace_back(worker, t);
+        }
+        if (threadCount > 0) {
+            worker(0);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        for (auto& e : errors) {
+            if (e) std::rethrow_exception(e);
+        }
+    }
+
+    struct BatchItem {
+        const uint8_t* data;
+        size_t size;
+        std::vector<uint8_t> output;
+    };
+
+    // 并行压缩一批互不相关的数据，结果写入各项的 output
+    static void compressBatch(std::vector<BatchItem>& items, bool lazy = false, unsigned threadCount = 0) {
+        parallelFor(items.size(), threadCount, [&](size_t i, LzssTreeEncoder& encoder) {
+            encoder.compress(items[i].data, items[i].size, items[i].output, lazy);
+        });
+    }
+
+private:
+    // 原 init_state 的必要部分：节点的 lchild/rchild 在插入时赋值，不需要清零
+    void reset() {
+        std::memset(m_textBuf, 0, sizeof(m_textBuf));
+        std::fill_n(m_rchild + N + 1, 256, NIL);
+        std::fill_n(m_parent, N, NIL);
+        m_lchild[NIL] = m_rchild[NIL] = m_parent[NIL] = 0;
+        m_matchPosition = 0;
+        m_matchLength = 0;
+    }
+
+    // 把 text_buf[r..r+F-1] 插入树中，并得到最长匹配 m_matchPosition/m_matchLength。
+    // 匹配长度达到 F 时用新节点替换旧节点，因为旧节点会更早被删除
+    void insertNode(int r) {
+        int cmp = 1;
+        const uint8_t* key = &m_textBuf[r];
+        int p = N + 1 + key[0];
+        m_rchild[r] = m_lchild[r] = NIL;
+        m_matchLength = 0;
+        for (;;) {
+            if (cmp >= 0) {
+                if (m_rchild[p] != NIL) {
+                    p = m_rchild[p];
+                }
+                else {
+                    m_rchild[p] = r;
+                    m_parent[r] = p;
+                    return;
+                }
+            }
+            else {
+                if (m_lchild[p] != NIL) {
+                    p = m_lchild[p];
+                }
+                else {
+                    m_lchild[p] = r;
+                    m_parent[r] = p;
+                    return;
+                }
+            }
+            int i;
+            for (i = 1; i < F; i++) {
+                if ((cmp = key[i] - m_textBuf[p + i]) != 0) break;
+            }
+            if (i > m_matchLength) {
+                m_matchPosition = p;
+                if ((m_matchLength = i) >= F) break;
+            }
+        }
+        m_parent[r] = m_parent[p];
+        m_lchild[r] = m_lchild[p];
+        m_rchild[r] = m_rchild[p];
+        m_parent[m_lchild[p]] = r;
+        m_parent[m_rchild[p]] = r;
+        if (m_rchild[m_parent[p]] == p) {
+            m_rchild[m_parent[p]] = r;
+        }
+        else {
+            m_lchild[m_parent[p]] = r;
+        }
+        m_parent[p] = NIL;
+    }
+
+    void deleteNode(int p) {
+        int q;
+        if (m_parent[p] == NIL) return;
+        if (m_rchild[p] == NIL) {
+            q = m_lchild[p];
+        }
+        else if (m_lchild[p] == NIL) {
+            q = m_rchild[p];
+        }
+        else {
+            q = m_lchild[p];
+            if (m_rchild[q] != NIL) {
+                do {
+                    q = m_rchild[q];
+                } while (m_rchild[q] != NIL);
+                m_rchild[m_parent[q]] = m_lchild[q];
+                m_parent[m_lchild[q]] = m_parent[q];
+                m_lchild[q] = m_lchild[p];
+                m_parent[m_lchild[p]] = q;
+            }
+            m_rchild[q] = m_rchild[p];
+            m_parent[m_rchild[p]] = q;
+        }
+        m_parent[q] = m_parent[p];
+        if (m_rchild[m_parent[p]] == p) {
+            m_rchild[m_parent[p]] = q;
+        }
+        else {
+            m_lchild[m_parent[p]] = q;
+        }
+        m_parent[p] = NIL;
+    }
+
+    // rchild[N + 1 + c] 为以字节 c 开头的串的树根
+    int m_lchild[N + 1];
+    int m_rchild[N + 257];
+    int m_parent[N + 1];
+    uint8_t m_textBuf[N + F - 1];
+    int m_matchPosition = 0;
+    int m_matchLength = 0;
+};
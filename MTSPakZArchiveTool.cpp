@@ -5,7 +5,11 @@
 #include <cstring>
 #include <filesystem>
 #include <algorithm>
+#include <charconv>
+#include <thread>
 #include <zlib.h>
+#include "ZlibCodec.h"
+#include "ThreadCount.h"
 
 #pragma pack(push, 1)
 struct pak_header_t {
@@ -24,18 +28,12 @@ struct pak_entry_t {
 };
 #pragma pack(pop)
 
-uint32_t find_data_start(std::ifstream& file, uint32_t start_pos) {
-    file.seekg(start_pos);
-    std::vector<char> buffer(32);
+// 在内存中的 PAK 镜像里从 start_pos 开始按 32 字节查找第一个非零块，即数据区起点
+uint32_t find_data_start(const uint8_t* data, size_t size, uint32_t start_pos) {
     uint32_t current_pos = start_pos;
 
-    while (true) {
-        file.read(buffer.data(), 32);
-        if (file.gcount() != 32) {
-            break;
-        }
-
-        if (std::any_of(buffer.begin(), buffer.end(), [](char c) { return c != 0; })) {
+    while (current_pos + 32 <= size) {
+        if (std::any_of(data + current_pos, data + current_pos + 32, [](uint8_t c) { return c != 0; })) {
             return current_pos;
         }
 
@@ -45,26 +43,31 @@ uint32_t find_data_start(std::ifstream& file, uint32_t start_pos) {
     return start_pos; // If no non-zero data found, return the original start position
 }
 
-bool extract_pak(const std::string& pak_path, const std::string& output_dir, bool check_magic = true) {
-    std::ifstream file(pak_path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file: " << pak_path << std::endl;
+// 解析内存中的 PAK 镜像并解出全部文件。.pak 读入内存后调用；.z 解压后直接调用，不再经过临时文件
+bool extract_pak_image(const uint8_t* data, size_t size, const std::string& list_stem, const std::string& output_dir, bool check_magic) {
+    if (size < sizeof(pak_header_t)) {
+        std::cerr << "Invalid PAK file format" << std::endl;
         return false;
     }
 
     pak_header_t header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::memcpy(&header, data, sizeof(header));
 
     if (check_magic && strncmp(header.magic, "DATA$TOP", 8) != 0) {
         std::cerr << "Invalid PAK file format" << std::endl;
         return false;
     }
 
+    if (header.index_entries == 0 || (size - sizeof(pak_header_t)) / sizeof(pak_entry_t) < header.index_entries - 1) {
+        std::cerr << "Invalid PAK index" << std::endl;
+        return false;
+    }
+
     std::vector<pak_entry_t> entries(header.index_entries - 1);
-    file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(pak_entry_t));
+    std::memcpy(entries.data(), data + sizeof(pak_header_t), entries.size() * sizeof(pak_entry_t));
 
     uint32_t expected_data_start = sizeof(pak_header_t) + entries.size() * sizeof(pak_entry_t);
-    uint32_t actual_data_start = find_data_start(file, expected_data_start);
+    uint32_t actual_data_start = find_data_start(data, size, expected_data_start);
 
     for (auto& entry : entries) {
         entry.offset1 += actual_data_start;
@@ -72,7 +75,7 @@ bool extract_pak(const std::string& pak_path, const std::string& output_dir, boo
 
     std::filesystem::create_directories(output_dir);
 
-    std::string filename_list_path = std::filesystem::path(pak_path).stem().string() + "_filelist.txt";
+    std::string filename_list_path = list_stem + "_filelist.txt";
     std::ofstream filename_list(filename_list_path);
     if (!filename_list) {
         std::cerr << "Failed to create filename list file" << std::endl;
@@ -101,17 +104,14 @@ bool extract_pak(const std::string& pak_path, const std::string& output_dir, boo
             continue;
         }
 
-        file.seekg(entry.offset1, std::ios::beg);
-        std::vector<char> buffer(entry.length);
-        file.read(buffer.data(), entry.length);
-
-        if (file.gcount() != entry.length) {
-            std::cerr << "Warning: Read " << file.gcount() << " bytes, expected " << entry.length << " bytes for file: " << entry.name << std::endl;
+        size_t available = entry.offset1 < size ? std::min<size_t>(entry.length, size - entry.offset1) : 0;
+        if (available != entry.length) {
+            std::cerr << "Warning: Read " << available << " bytes, expected " << entry.length << " bytes for file: " << entry.name << std::endl;
         }
 
-        output.write(buffer.data(), file.gcount());
+        output.write(reinterpret_cast<const char*>(data + entry.offset1), available);
 
-        std::cout << "Extracted: " << entry.name << " (" << file.gcount() << " bytes)" << std::endl;
+        std::cout << "Extracted: " << entry.name << " (" << available << " bytes)" << std::endl;
     }
 
     filename_list.close();
@@ -120,7 +120,32 @@ bool extract_pak(const std::string& pak_path, const std::string& output_dir, boo
     return true;
 }
 
-bool create_pak(const std::string& list_file, const std::string& input_dir, const std::string& output_pak, bool zero_magic = false) {
+bool read_whole_file(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        std::cerr << "Failed to read file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool extract_pak(const std::string& pak_path, const std::string& output_dir, bool check_magic = true) {
+    std::vector<uint8_t> data;
+    if (!read_whole_file(pak_path, data)) {
+        return false;
+    }
+    return extract_pak_image(data.data(), data.size(), std::filesystem::path(pak_path).stem().string(), output_dir, check_magic);
+}
+
+// 按文件列表在内存中组装 PAK 镜像：头、索引、填充到数据起点，再依次放入各文件内容
+bool build_pak_image(const std::string& list_file, const std::string& input_dir, std::vector<uint8_t>& image, bool zero_magic) {
     std::ifstream file_list(list_file);
     if (!file_list) {
         std::cerr << "Failed to open list file: " << list_file << std::endl;
@@ -149,7 +174,10 @@ bool create_pak(const std::string& list_file, const std::string& input_dir, cons
     std::vector<pak_entry_t> entries(filenames.size());
 
     uint32_t expected_data_start = sizeof(pak_header_t) + entries.size() * sizeof(pak_entry_t);
-    uint32_t padding_size = data_start_offset - expected_data_start;
+    if (data_start_offset < expected_data_start) {
+        std::cerr << "Data start offset " << data_start_offset << " overlaps the index (needs at least " << expected_data_start << ")" << std::endl;
+        return false;
+    }
 
     uint32_t current_offset = 0;
     uint32_t total_size = data_start_offset;
@@ -172,146 +200,80 @@ bool create_pak(const std::string& list_file, const std::string& input_dir, cons
         total_size += entries[i].length;
     }
 
-    std::ofstream pak_file(output_pak, std::ios::binary);
-    if (!pak_file) {
-        std::cerr << "Failed to create output .pak file: " << output_pak << std::endl;
-        return false;
-    }
-
-    pak_file.write(reinterpret_cast<char*>(&header), sizeof(header));
-    pak_file.write(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(pak_entry_t));
-
-    // Write padding
-    std::vector<char> padding(padding_size, 0);
-    pak_file.write(padding.data(), padding_size);
+    // 填充区和缺失的文件保持为 0
+    image.assign(total_size, 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), entries.data(), entries.size() * sizeof(pak_entry_t));
 
     for (const auto& entry : entries) {
         std::string full_path = input_dir + "/" + entry.name;
         std::ifstream input_file(full_path, std::ios::binary);
         if (input_file) {
-            pak_file << input_file.rdbuf();
-            size_t file_padding = entry.length - input_file.tellg();
-            std::vector<char> zeros(file_padding, 0);
-            pak_file.write(zeros.data(), file_padding);
-        }
-        else {
-            std::vector<char> zeros(entry.length, 0);
-            pak_file.write(zeros.data(), entry.length);
+            input_file.read(reinterpret_cast<char*>(image.data() + data_start_offset + entry.offset1), entry.length);
         }
     }
 
-    std::cout << "PAK file created successfully: " << output_pak << std::endl;
     return true;
 }
 
-bool extract_z(const std::string& z_path, const std::string& output_dir) {
-    std::ifstream file(z_path, std::ios::binary | std::ios::ate);
-    if (!file) {
-        std::cerr << "Failed to open file: " << z_path << std::endl;
-        return false;
-    }
-
-    std::streamsize compressed_size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<char> compressed_data(compressed_size);
-    if (!file.read(compressed_data.data(), compressed_size)) {
-        std::cerr << "Failed to read compressed data" << std::endl;
+bool create_pak(const std::string& list_file, const std::string& input_dir, const std::string& output_pak, bool zero_magic = false) {
+    std::vector<uint8_t> image;
+    if (!build_pak_image(list_file, input_dir, image, zero_magic)) {
         return false;
     }
 
-    uLongf uncompressed_size = compressed_size * 2; // Initial guess
-    std::vector<char> uncompressed_data;
-
-    while (true) {
-        uncompressed_data.resize(uncompressed_size);
-        int result = uncompress(reinterpret_cast<Bytef*>(uncompressed_data.data()), &uncompressed_size,
-            reinterpret_cast<const Bytef*>(compressed_data.data()), compressed_size);
-
-        if (result == Z_OK) {
-            break;
-        }
-        else if (result == Z_BUF_ERROR) {
-            uncompressed_size *= 2;
-        }
-        else {
-            std::cerr << "Decompression failed" << std::endl;
-            return false;
-        }
-    }
-
-    uncompressed_data.resize(uncompressed_size);
-
-    std::string pak_path = std::filesystem::path(z_path).stem().string() + ".pak";
-    std::ofstream pak_file(pak_path, std::ios::binary);
+    std::ofstream pak_file(output_pak, std::ios::binary);
     if (!pak_file) {
-        std::cerr << "Failed to create PAK file: " << pak_path << std::endl;
-        return false;
-    }
-
-    pak_file.write(uncompressed_data.data(), uncompressed_size);
-    pak_file.close(); // Explicitly close the file to ensure all data is written
-
-    // Use a new ifstream to read the PAK file
-    std::ifstream pak_input(pak_path, std::ios::binary);
-    if (!pak_input) {
-        std::cerr << "Failed to open created PAK file for reading" << std::endl;
+        std::cerr << "Failed to create output .pak file: " << output_pak << std::endl;
         return false;
     }
 
-    bool result = extract_pak(pak_path, output_dir, false);
-
-    pak_input.close();
-    std::filesystem::remove(pak_path); // Remove the temporary PAK file
+    pak_file.write(reinterpret_cast<const char*>(image.data()), image.size());
 
-    return result;
+    std::cout << "PAK file created successfully: " << output_pak << std::endl;
+    return true;
 }
 
-bool create_z(const std::string& list_file, const std::string& input_dir, const std::string& output_z) {
-    std::string temp_pak = std::filesystem::temp_directory_path().string() + "/temp.pak";
-    if (!create_pak(list_file, input_dir, temp_pak, true)) {  // Create PAK with zero magic
+bool extract_z(const std::string& z_path, const std::string& output_dir) {
+    std::vector<uint8_t> compressed_data;
+    if (!read_whole_file(z_path, compressed_data)) {
         return false;
     }
 
-    std::ifstream pak_file(temp_pak, std::ios::binary | std::ios::ate);
-    if (!pak_file) {
-        std::cerr << "Failed to open temporary PAK file" << std::endl;
+    // 原始大小未知，先按 4 倍猜测，不够时在同一个流上扩容继续解压，不再从头重试
+    std::vector<uint8_t> uncompressed_data;
+    if (!ZlibCodec::threadLocal().inflateUnknown(compressed_data.data(), compressed_data.size(), uncompressed_data, compressed_data.size() * 4)) {
+        std::cerr << "Decompression failed" << std::endl;
         return false;
     }
+    compressed_data = {};
 
-    std::streamsize uncompressed_size = pak_file.tellg();
-    pak_file.seekg(0, std::ios::beg);
+    // 解压后的 PAK 直接在内存中解析，不再写临时 .pak 再读回
+    return extract_pak_image(uncompressed_data.data(), uncompressed_data.size(),
+        std::filesystem::path(z_path).stem().string(), output_dir, false);
+}
 
-    std::vector<char> uncompressed_data(uncompressed_size);
-    if (!pak_file.read(uncompressed_data.data(), uncompressed_size)) {
-        std::cerr << "Failed to read uncompressed data" << std::endl;
+bool create_z(const std::string& list_file, const std::string& input_dir, const std::string& output_z, ZlibLevel level, unsigned int num_threads) {
+    std::vector<uint8_t> uncompressed_data;
+    if (!build_pak_image(list_file, input_dir, uncompressed_data, true)) {  // Create PAK with zero magic
         return false;
     }
 
-    pak_file.close();
-    std::filesystem::remove(temp_pak);
-
-    uLongf compressed_size = compressBound(uncompressed_size);
-    std::vector<char> compressed_data(compressed_size);
-
-    int result = compress2(reinterpret_cast<Bytef*>(compressed_data.data()), &compressed_size,
-        reinterpret_cast<const Bytef*>(uncompressed_data.data()), uncompressed_size,
-        Z_BEST_COMPRESSION);
-
-    if (result != Z_OK) {
+    // 分块并行压缩，仍输出单个 zlib 流；--threads 1 时与原先的 compress2 结果一致
+    std::vector<uint8_t> compressed_data;
+    if (!zlibDeflateParallel(uncompressed_data.data(), uncompressed_data.size(), compressed_data, level, num_threads)) {
         std::cerr << "Compression failed" << std::endl;
         return false;
     }
 
-    compressed_data.resize(compressed_size);
-
     std::ofstream z_file(output_z, std::ios::binary);
     if (!z_file) {
         std::cerr << "Failed to create Z file: " << output_z << std::endl;
         return false;
     }
 
-    z_file.write(compressed_data.data(), compressed_size);
+    z_file.write(reinterpret_cast<const char*>(compressed_data.data()), compressed_data.size());
+
     std::cout << "Compressed Z file created: " << output_z << std::endl;
 
     return true;
@@ -323,7 +285,7 @@ void print_usage(const char* program_name) {
     std::cerr << "  Extract PAK: " << program_name << " extract_pak <pak_file> <output_directory>" << std::endl;
     std::cerr << "  Create PAK:  " << program_name << " create_pak <list_file> <input_directory> <output_pak>" << std::endl;
     std::cerr << "  Extract Z:   " << program_name << " extract_z <z_file> <output_directory>" << std::endl;
-    std::cerr << "  Create Z:    " << program_name << " create_z <list_file> <input_directory> <output_z>" << std::endl;
+    std::cerr << "  Create Z:    " << program_name << " create_z <list_file> <input_directory> <output_z> [--level fast|balanced|max] [--threads N]" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -350,11 +312,34 @@ int main(int argc, char* argv[]) {
         std::string output_dir = argv[3];
         return extract_z(z_path, output_dir) ? 0 : 1;
     }
-    else if (command == "create_z" && argc == 5) {
+    else if (command == "create_z" && argc >= 5) {
         std::string list_file = argv[2];
         std::string input_dir = argv[3];
         std::string output_z = argv[4];
-        return create_z(list_file, input_dir, output_z) ? 0 : 1;
+        ZlibLevel level = ZlibLevel::Max;
+        unsigned int num_threads = defaultThreadCount();
+        for (int i = 5; i < argc; i += 2) {
+            std::string option = argv[i];
+            bool valid = i + 1 < argc;
+            if (valid && option == "--level") {
+                valid = parseZlibLevel(argv[i + 1], level);
+            }
+            else if (valid && option == "--threads") {
+                // 非数字、超出范围或为 0 时都打印用法
+                const char* value = argv[i + 1];
+                const char* end = value + strlen(value);
+                auto [ptr, ec] = std::from_chars(value, end, num_threads);
+                valid = ec == std::errc() && ptr == end && num_threads > 0;
+            }
+            else {
+                valid = false;
+            }
+            if (!valid) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        return create_z(list_file, input_dir, output_z, level, num_threads) ? 0 : 1;
     }
     else {
         print_usage(argv[0]);
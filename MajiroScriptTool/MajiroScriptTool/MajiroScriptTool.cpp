@@ -1,6 +1,7 @@
 ﻿#define NOMINMAX
 #include <Windows.h>
 #include <cstdint>
+#include "../../ScriptServer.h"
 
 import std;
 import nlohmann.json;
@@ -295,17 +296,13 @@ void verifySentence(json& jarray, Sentence& sentence, uint32_t opCodeAddr) {
 }
 
 //DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD
-void dumpText(const fs::path& inputPath, const fs::path& outputPath) {
-    std::ifstream inFile(inputPath, std::ios::binary);
+void dumpText(std::vector<uint8_t> buffer, const fs::path& outputPath) {
     std::ofstream ofs(outputPath);
-
-    if (!inFile || !ofs) {
-        throw std::runtime_error("Error opening files: " + wide2Ascii(inputPath) + " or " + wide2Ascii(outputPath));
+    if (!ofs) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(outputPath));
     }
 
-    size_t fileSize = (size_t)fs::file_size(inputPath);
-    std::vector<uint8_t> buffer(fileSize);
-    inFile.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    size_t fileSize = buffer.size();
 
     char signature[16] = { 0 };
     memcpy(signature, buffer.data(), 16);
@@ -552,11 +549,24 @@ void dumpText(const fs::path& inputPath, const fs::path& outputPath) {
         }
     }
 
-    inFile.close();
     ofs << jarray.dump(2);
     ofs.close();
 }
 
+void dumpText(const fs::path& inputPath, const fs::path& outputPath) {
+    std::ifstream inFile(inputPath, std::ios::binary);
+    if (!inFile) {
+        throw std::runtime_error("Error opening files: " + wide2Ascii(inputPath) + " or " + wide2Ascii(outputPath));
+    }
+
+    size_t fileSize = (size_t)fs::file_size(inputPath);
+    std::vector<uint8_t> buffer(fileSize);
+    inFile.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    inFile.close();
+
+    dumpText(std::move(buffer), outputPath);
+}
+
 struct Jump {
     uint32_t jumpOffsetAddr = 0;
     uint32_t startAddr = 0;
@@ -705,18 +715,13 @@ std::vector<uint8_t> processNormalText(const std::string& name, const std::strin
 }
 
 //IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII
-void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath) {
-    std::ifstream inputBin(inputBinPath, std::ios::binary);
-    std::ifstream inputTxt(inputTxtPath);
+void injectText(std::vector<uint8_t> buffer, std::string_view jsonText, const fs::path& outputBinPath) {
     std::ofstream outputBin(outputBinPath, std::ios::binary);
-
-    if (!inputBin || !inputTxt || !outputBin) {
-        throw std::runtime_error("Error opening files: " + wide2Ascii(inputBinPath) + " or " + wide2Ascii(inputTxtPath) + " or " + wide2Ascii(outputBinPath));
+    if (!outputBin) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(outputBinPath));
     }
 
-    size_t fileSize = (size_t)fs::file_size(inputBinPath);
-    std::vector<uint8_t> buffer(fileSize);
-    inputBin.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    size_t fileSize = buffer.size();
 
     char signature[16] = { 0 };
     memcpy(signature, buffer.data(), 16);
@@ -869,7 +874,7 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
         }
     }
 
-    json jarray = json::parse(inputTxt);
+    json jarray = json::parse(jsonText);
     std::vector<uint8_t> newBuffer;
 
     uint32_t currentPos = 0;
@@ -952,10 +957,55 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
     }
 
     outputBin.write(reinterpret_cast<const char*>(newBuffer.data()), newBuffer.size());
+    outputBin.close();
+}
+
+void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath) {
+    std::ifstream inputBin(inputBinPath, std::ios::binary);
+    std::ifstream inputTxt(inputTxtPath);
+
+    if (!inputBin || !inputTxt) {
+        throw std::runtime_error("Error opening files: " + wide2Ascii(inputBinPath) + " or " + wide2Ascii(inputTxtPath) + " or " + wide2Ascii(outputBinPath));
+    }
+
+    size_t fileSize = (size_t)fs::file_size(inputBinPath);
+    std::vector<uint8_t> buffer(fileSize);
+    inputBin.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    std::string jsonText(std::istreambuf_iterator<char>(inputTxt), {});
 
     inputBin.close();
     inputTxt.close();
-    outputBin.close();
+
+    injectText(std::move(buffer), jsonText, outputBinPath);
+}
+
+// 常驻服务模式：脚本与译文按内容哈希缓存，输入未变的请求直接跳过
+int serveScripts() {
+    ScriptServer server("MajiroScriptTool");
+
+    // {"input": 脚本, "output": json}
+    server.on("dump", [&](ScriptCall& call) {
+        auto input = call.input(call.path("input"));
+        fs::path outputPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        dumpText(input->bytes, outputPath);
+    });
+
+    // {"input": 原脚本, "text": 译文json, "output": 新脚本}
+    server.on("inject", [&](ScriptCall& call) {
+        auto inputBin = call.input(call.path("input"));
+        auto inputTxt = call.input(call.path("text"));
+        fs::path outputBinPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        std::string_view jsonText((const char*)inputTxt->bytes.data(), inputTxt->bytes.size());
+        injectText(inputBin->bytes, jsonText, outputBinPath);
+    });
+
+    return server.serve();
 }
 
 
@@ -963,7 +1013,8 @@ void printUsage(const fs::path& programPath) {
     std::print("Made by julixian 2025.12.03\n"
         "Usage: \n"
         "  Dump: {0} dump <input_folder> <output_folder> \n"
-        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-json_folder> <output_folder>",
+        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-json_folder> <output_folder>\n"
+        "  Serve: {0} serve    (one JSON request per line on stdin, methods: dump, inject)",
         wide2Ascii(programPath.filename()));
 }
 
@@ -1024,6 +1075,9 @@ int wmain(int argc, wchar_t* argv[])
                 }
             }
         }
+        else if (mode == L"serve") {
+            return serveScripts();
+        }
         else {
             printUsage(argv[0]);
             return 1;
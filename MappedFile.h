@@ -0,0 +1,214 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 各封包工具共用的只读文件映射和带边界检查的读取器。
+// 原先解析索引都是 std::ifstream 每个字段 seekg + read 一次，一个条目要几次系统调用和流状态检查，
+// 上万条目的封包光解析索引就要花不少时间；提取时也要先 read 到临时缓冲区再写出。
+// 这里把整个文件映射进来：
+//   MappedFile  只读映射整个文件 (Windows 用 CreateFileMapping，其他平台用 mmap)
+//   ByteSpan    不持有数据的 [data, data + size) 视图，按偏移读取小端/大端整数和定长字符串
+//   SpanReader  在 ByteSpan 上顺序读取的游标
+// 所有读取都检查边界，越界时抛出 std::out_of_range，不会读到映射之外。
+// 映射只读，多个线程可以同时读取同一个 MappedFile/ByteSpan；SpanReader 自身有游标，每个线程各用一个。
+
+class ByteSpan {
+public:
+    ByteSpan() = default;
+    ByteSpan(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // [offset, offset + length) 是否在范围内，不会溢出
+    bool contains(uint64_t offset, uint64_t length) const {
+        return offset <= m_size && length <= m_size - offset;
+    }
+
+    // 返回 [offset, offset + length) 的起始指针，越界时抛出
+    const uint8_t* at(uint64_t offset, uint64_t length) const {
+        if (!contains(offset, length)) {
+            throw std::out_of_range("Read out of range: offset " + std::to_string(offset) +
+                ", length " + std::to_string(length) + ", size " + std::to_string(m_size));
+        }
+        return m_data + offset;
+    }
+
+    ByteSpan sub(uint64_t offset, uint64_t length) const {
+        return ByteSpan(at(offset, length), (size_t)length);
+    }
+
+    ByteSpan sub(uint64_t offset) const {
+        return sub(offset, offset <= m_size ? m_size - offset : 0);
+    }
+
+    uint8_t u8(uint64_t offset) const { return *at(offset, 1); }
+    uint16_t u16le(uint64_t offset) const { return (uint16_t)readLE(at(offset, 2), 2); }
+    uint32_t u32le(uint64_t offset) const { return (uint32_t)readLE(at(offset, 4), 4); }
+    uint64_t u64le(uint64_t offset) const { return readLE(at(offset, 8), 8); }
+    uint16_t u16be(uint64_t offset) const { return (uint16_t)readBE(at(offset, 2), 2); }
+    uint32_t u32be(uint64_t offset) const { return (uint32_t)readBE(at(offset, 4), 4); }
+    uint64_t u64be(uint64_t offset) const { return readBE(at(offset, 8), 8); }
+
+    // 长度为 length 的定长字段，在第一个 '\0' 处截断
+    std::string str(uint64_t offset, uint64_t length) const {
+        const char* p = reinterpret_cast<const char*>(at(offset, length));
+        const void* nul = memchr(p, 0, (size_t)length);
+        return std::string(p, nul ? (const char*)nul - p : (size_t)length);
+    }
+
+    // 按原样复制到 dst
+    void copy(uint64_t offset, void* dst, uint64_t length) const {
+        memcpy(dst, at(offset, length), (size_t)length);
+    }
+
+private:
+    // 逐字节拼装，不依赖对齐和主机字节序，编译器会合并为一次读取
+    static uint64_t readLE(const uint8_t* p, int n) {
+        uint64_t value = 0;
+        for (int i = n - 1; i >= 0; --i) value = (value << 8) | p[i];
+        return value;
+    }
+
+    static uint64_t readBE(const uint8_t* p, int n) {
+        uint64_t value = 0;
+        for (int i = 0; i < n; ++i) value = (value << 8) | p[i];
+        return value;
+    }
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+class SpanReader {
+public:
+    explicit SpanReader(ByteSpan span, size_t pos = 0) : m_span(span), m_pos(pos) {}
+
+    size_t tell() const { return m_pos; }
+    size_t remaining() const { return m_pos <= m_span.size() ? m_span.size() - m_pos : 0; }
+    bool eof() const { return m_pos >= m_span.size(); }
+    const ByteSpan& span() const { return m_span; }
+
+    void seek(size_t pos) { m_pos = pos; }
+    void skip(size_t count) { m_span.at(m_pos, count); m_pos += count; }
+
+    uint8_t u8() { return advance(m_span.u8(m_pos), 1); }
+    uint16_t u16le() { return advance(m_span.u16le(m_pos), 2); }
+    uint32_t u32le() { return advance(m_span.u32le(m_pos), 4); }
+    uint64_t u64le() { return advance(m_span.u64le(m_pos), 8); }
+    uint16_t u16be() { return advance(m_span.u16be(m_pos), 2); }
+    uint32_t u32be() { return advance(m_span.u32be(m_pos), 4); }
+    uint64_t u64be() { return advance(m_span.u64be(m_pos), 8); }
+    std::string str(size_t length) { return advance(m_span.str(m_pos, length), length); }
+
+    // 返回接下来 count 字节的指针并前进
+    const uint8_t* bytes(size_t count) { return advance(m_span.at(m_pos, count), count); }
+
+private:
+    template <class T>
+    T advance(T value, size_t count) {
+        m_pos += count;
+        return value;
+    }
+
+    ByteSpan m_span;
+    size_t m_pos;
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+        hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Could not open file: " + path.string());
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize)) {
+            CloseHandle(hFile);
+            throw std::runtime_error("Could not get file size: " + path.string());
+        }
+        size = (size_t)fileSize.QuadPart;
+        if (size == 0) {
+            return;
+        }
+        hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping != nullptr) {
+            view = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (view == nullptr) {
+            if (hMapping != nullptr) CloseHandle(hMapping);
+            CloseHandle(hFile);
+            throw std::runtime_error("Could not map file: " + path.string());
+        }
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open file: " + path.string());
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not get file size: " + path.string());
+        }
+        size = (size_t)st.st_size;
+        if (size == 0) {
+            return;
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map file: " + path.string());
+        }
+        view = (const uint8_t*)mapped;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (view != nullptr) UnmapViewOfFile(view);
+        if (hMapping != nullptr) CloseHandle(hMapping);
+        if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+#else
+        if (view != nullptr) munmap(const_cast<uint8_t*>(view), size);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return view; }
+    size_t fileSize() const { return size; }
+    ByteSpan span() const { return ByteSpan(view, size); }
+
+private:
+#ifdef _WIN32
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    const uint8_t* view = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,222 @@
+﻿// MappedFile.h 的索引解析/提取基准：与各工具原先 std::ifstream 每个字段 seekg + read 的写法对比
+// 用法: MappedFileBench [entries] [iterations]
+// 在临时目录生成两种典型索引的合成封包 (默认 20000 个条目)：
+//   fixed     NextonLikeC 的 LST 一类定长记录 (偏移/大小/0x40 字节加密文件名/类型)
+//   variable  OtemotoTLZ 一类变长记录 (大小/偏移/名称长度 + 名称)
+// index   从打开文件到得到完整条目表
+// extract 读出每个条目的数据 (只计算校验和，不写磁盘，排除输出端的开销)
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <filesystem>
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+struct BenchEntry {
+    std::string name;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    int32_t type = 0;
+
+    bool operator==(const BenchEntry& other) const {
+        return name == other.name && offset == other.offset && size == other.size && type == other.type;
+    }
+};
+
+const uint8_t NameKey = 0x5A;
+
+// 数据区在前，索引在后；文件头: 条目数、索引偏移
+void writeArchive(const fs::path& path, size_t count, bool fixed, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data;
+    std::vector<BenchEntry> entries(count);
+    data.resize(8);
+    for (size_t i = 0; i < count; ++i) {
+        BenchEntry& entry = entries[i];
+        entry.name = "data/scene" + std::to_string(i) + (i % 3 ? ".ogg" : ".png");
+        entry.offset = (uint32_t)data.size();
+        entry.size = 256 + rng() % 4096;
+        entry.type = (int32_t)(i % 6);
+        for (uint32_t j = 0; j < entry.size; ++j) {
+            data.push_back((uint8_t)rng());
+        }
+    }
+
+    uint32_t indexOffset = (uint32_t)data.size();
+    auto put32 = [&](uint32_t value) {
+        for (int i = 0; i < 4; ++i) data.push_back((uint8_t)(value >> (i * 8)));
+    };
+    for (const BenchEntry& entry : entries) {
+        put32(entry.offset);
+        put32(entry.size);
+        if (fixed) {
+            uint8_t name[0x40] = {};
+            for (size_t i = 0; i < entry.name.size(); ++i) name[i] = (uint8_t)entry.name[i] ^ NameKey;
+            data.insert(data.end(), name, name + sizeof(name));
+            put32((uint32_t)entry.type);
+        }
+        else {
+            put32((uint32_t)entry.name.size());
+            data.insert(data.end(), entry.name.begin(), entry.name.end());
+        }
+    }
+    for (int i = 0; i < 4; ++i) data[i] = (uint8_t)(count >> (i * 8));
+    for (int i = 0; i < 4; ++i) data[4 + i] = (uint8_t)(indexOffset >> (i * 8));
+
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// 原写法，保留作对照
+std::vector<BenchEntry> legacyParse(const fs::path& path, bool fixed) {
+    std::ifstream file(path, std::ios::binary);
+    uint32_t count = 0, indexOffset = 0;
+    file.read(reinterpret_cast<char*>(&count), 4);
+    file.read(reinterpret_cast<char*>(&indexOffset), 4);
+
+    std::vector<BenchEntry> entries;
+    entries.reserve(count);
+    uint32_t pos = indexOffset;
+    for (uint32_t i = 0; i < count; ++i) {
+        BenchEntry entry;
+        file.seekg(pos);
+        file.read(reinterpret_cast<char*>(&entry.offset), 4);
+        file.read(reinterpret_cast<char*>(&entry.size), 4);
+        if (fixed) {
+            file.seekg(pos + 8);
+            std::vector<char> name(0x40);
+            file.read(name.data(), name.size());
+            for (char c : name) {
+                if (c == 0) break;
+                entry.name.push_back((char)(c ^ NameKey));
+            }
+            file.seekg(pos + 0x48);
+            file.read(reinterpret_cast<char*>(&entry.type), 4);
+            pos += 0x4C;
+        }
+        else {
+            uint32_t nameLength = 0;
+            file.read(reinterpret_cast<char*>(&nameLength), 4);
+            std::vector<char> name(nameLength + 1);
+            file.read(name.data(), nameLength);
+            entry.name = name.data();
+            entry.type = (int32_t)(i % 6);
+            pos += 12 + nameLength;
+        }
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+std::vector<BenchEntry> mappedParse(const ByteSpan& file, bool fixed) {
+    uint32_t count = file.u32le(0);
+    SpanReader index(file, file.u32le(4));
+
+    std::vector<BenchEntry> entries;
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        BenchEntry entry;
+        entry.offset = index.u32le();
+        entry.size = index.u32le();
+        if (fixed) {
+            const uint8_t* name = index.bytes(0x40);
+            for (int j = 0; j < 0x40 && name[j] != 0; ++j) {
+                entry.name.push_back((char)(name[j] ^ NameKey));
+            }
+            entry.type = (int32_t)index.u32le();
+        }
+        else {
+            entry.name = index.str(index.u32le());
+            entry.type = (int32_t)(i % 6);
+        }
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+uint64_t checksum(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) sum += data[i];
+    return sum;
+}
+
+template<typename Func>
+double measure(int iterations, Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+void runArchive(const fs::path& path, bool fixed, size_t count, int iterations) {
+    std::vector<BenchEntry> legacyEntries = legacyParse(path, fixed);
+    std::vector<BenchEntry> mappedEntries;
+    {
+        MappedFile file(path);
+        mappedEntries = mappedParse(file.span(), fixed);
+    }
+    if (legacyEntries != mappedEntries || legacyEntries.size() != count) {
+        std::cout << path.filename().string() << ": index mismatch!" << std::endl;
+        return;
+    }
+
+    std::cout << (fixed ? "fixed" : "variable") << " (" << count << " entries, "
+        << fs::file_size(path) / (1024 * 1024) << " MB)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    double legacyIndex = measure(iterations, [&]() { legacyParse(path, fixed); });
+    double mappedIndex = measure(iterations, [&]() {
+        MappedFile file(path);
+        mappedParse(file.span(), fixed);
+    });
+    std::cout << "  index    ifstream " << std::setw(9) << legacyIndex << " ms | mapped " << std::setw(9) << mappedIndex
+        << " ms  (x" << std::setprecision(1) << legacyIndex / mappedIndex << std::setprecision(2) << ")" << std::endl;
+
+    uint64_t legacySum = 0, mappedSum = 0;
+    double legacyExtract = measure(iterations, [&]() {
+        std::ifstream file(path, std::ios::binary);
+        legacySum = 0;
+        for (const BenchEntry& entry : legacyEntries) {
+            std::vector<char> buffer(entry.size);
+            file.seekg(entry.offset);
+            file.read(buffer.data(), entry.size);
+            legacySum += checksum(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+        }
+    });
+    double mappedExtract = measure(iterations, [&]() {
+        MappedFile file(path);
+        ByteSpan view = file.span();
+        mappedSum = 0;
+        for (const BenchEntry& entry : mappedEntries) {
+            mappedSum += checksum(view.at(entry.offset, entry.size), entry.size);
+        }
+    });
+    if (legacySum != mappedSum) {
+        std::cout << "  extract: data mismatch!" << std::endl;
+        return;
+    }
+    std::cout << "  extract  ifstream " << std::setw(9) << legacyExtract << " ms | mapped " << std::setw(9) << mappedExtract
+        << " ms  (x" << std::setprecision(1) << legacyExtract / mappedExtract << std::setprecision(2) << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc >= 2 ? std::stoul(argv[1]) : 20000;
+    int iterations = argc >= 3 ? std::stoi(argv[2]) : 3;
+
+    fs::path dir = fs::temp_directory_path() / "MappedFileBench";
+    fs::create_directories(dir);
+    for (bool fixed : { true, false }) {
+        fs::path path = dir / (fixed ? "fixed.arc" : "variable.arc");
+        writeArchive(path, count, fixed, fixed ? 1 : 2);
+        runArchive(path, fixed, count, iterations);
+    }
+    fs::remove_all(dir);
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <filesystem>
 #include <sstream>
 #include <iomanip>
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -149,12 +150,7 @@ void extractMBL(const std::string& mblPath, const std::string& outputDir, const
 
 template<typename T>
 void createMBL(const std::string& inputDir, const std::string& outputPath, const std::vector<uint8_t>& key) {
-    std::vector<fs::path> files;
-    for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
-        if (fs::is_regular_file(entry)) {
-            files.push_back(entry.path());
-        }
-    }
+    std::vector<fs::path> files = scanPackDirectory(inputDir, true);
 
     std::ofstream mblFile(outputPath, std::ios::binary);
     if (!mblFile) {
@@ -163,38 +159,49 @@ void createMBL(const std::string& inputDir, const std::string& outputPath, const
     }
 
     uint32_t fileCount = files.size();
-    mblFile.write(reinterpret_cast<char*>(&fileCount), sizeof(fileCount));
-
-    uint32_t currentOffset = 4 + fileCount * sizeof(T);
-
-    std::vector<T> entries(fileCount);
+    std::vector<PackItem> items(fileCount);
     for (size_t i = 0; i < fileCount; ++i) {
-        processFileNamePack(files[i].filename().string(), entries[i].name, sizeof(entries[i].name));
-        entries[i].offset = currentOffset;
-        entries[i].size = fs::file_size(files[i]);
-        currentOffset += entries[i].size;
+        items[i].path = files[i];
+        items[i].name = files[i].filename().string();
     }
 
-    mblFile.write(reinterpret_cast<char*>(entries.data()), fileCount * sizeof(T));
-
-    for (const auto& file : files) {
-        std::ifstream inputFile(file, std::ios::binary);
-        std::vector<char> buffer(fs::file_size(file));
-        inputFile.read(buffer.data(), buffer.size());
-
+    PackHooks<PackItem> hooks;
+    hooks.transform = [&](PackItem& item) {
+        std::vector<uint8_t>& buffer = item.data;
         if (!key.empty()) {
             for (size_t i = 0; i < buffer.size(); ++i) {
                 buffer[i] ^= key[i % key.size()];
             }
         }
         else {
-            for (char& byte : buffer) {
+            for (uint8_t& byte : buffer) {
                 byte = ~(byte - 1);
             }
         }
+    };
+    hooks.written = [](const PackItem& item) {
+        std::cout << "Packed: " << item.name << std::endl;
+    };
+    hooks.emitIndex = [](std::ostream& out, std::vector<PackItem>& items, uint64_t) {
+        uint32_t fileCount = items.size();
+        std::vector<T> entries(fileCount);
+        for (size_t i = 0; i < fileCount; ++i) {
+            processFileNamePack(items[i].name, entries[i].name, sizeof(entries[i].name));
+            entries[i].offset = static_cast<uint32_t>(items[i].offset);
+            entries[i].size = static_cast<uint32_t>(items[i].size);
+        }
 
-        mblFile.write(buffer.data(), buffer.size());
-        std::cout << "Packed: " << file.filename().string() << std::endl;
+        out.seekp(0);
+        out.write(reinterpret_cast<char*>(&fileCount), sizeof(fileCount));
+        out.write(reinterpret_cast<char*>(entries.data()), fileCount * sizeof(T));
+    };
+
+    try {
+        runPackPipeline(mblFile, items, 4 + fileCount * sizeof(T), hooks);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Failed to pack MBL file: " << e.what() << std::endl;
+        return;
     }
 
     mblFile.close();
@@ -15,84 +15,120 @@ const int MIN_MATCH_LENGTH = 3;
 const int MAX_MATCH_LENGTH = 34; // (0x1F) + 3
 const int MAX_OFFSET = 2048;     // 11 bits for offset -> 2^11
 
+// 哈希链匹配器常量
+const int HASH_BITS = 15;
+const int HASH_SIZE = 1 << HASH_BITS;
+const int MAX_CHAIN = 256;       // 每个位置最多检查的候选数
+
+/**
+ * @brief 哈希链匹配器状态，按线程复用，避免每个文件重新分配
+ */
+struct LzMatcher {
+    std::vector<int32_t> head;
+    std::vector<int32_t> prev;
+
+    LzMatcher() : head(HASH_SIZE), prev(MAX_OFFSET) {}
+
+    void reset() {
+        std::fill(head.begin(), head.end(), -1);
+    }
+
+    static uint32_t hash3(const uint8_t* p) {
+        return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+    }
+
+    void insert(const uint8_t* data, size_t pos) {
+        uint32_t h = hash3(data + pos);
+        prev[pos & (MAX_OFFSET - 1)] = head[h];
+        head[h] = (int32_t)pos;
+    }
+};
+
 /**
  * @brief 将原始数据压缩为 MMA/MNP 格式的 LZ 压缩流
  * @param raw_data 待压缩的原始数据
- * @param compressed_data 用于存放压缩后数据的字节向量
+ * @param compressed_data 用于存放压缩后数据的字节向量，可在多次调用间复用
  * @return 如果压缩成功返回 true
  */
 bool compress_lz(const std::vector<uint8_t>& raw_data, std::vector<uint8_t>& compressed_data) {
+    thread_local LzMatcher matcher;
+    matcher.reset();
+
+    const uint8_t* src = raw_data.data();
+    const size_t src_size = raw_data.size();
+
+    // 最坏情况：每 8 个字面量多 1 个控制字节
     compressed_data.clear();
+    compressed_data.reserve(1 + src_size + src_size / 8 + 1);
     compressed_data.push_back(0xC0); // 写入魔术字节
 
     size_t input_pos = 0;
+    size_t control_byte_pos = 0;
+    int bit = 8;
+
+    while (input_pos < src_size) {
+        if (bit == 8) {
+            // 记住控制字节在输出流中的位置，数据直接写在其后，稍后回填
+            control_byte_pos = compressed_data.size();
+            compressed_data.push_back(0);
+            bit = 0;
+        }
 
-    while (input_pos < raw_data.size()) {
-        uint8_t control_byte = 0;
-        std::vector<uint8_t> chunk_data;
-
-        // 记住控制字节在输出流中的位置，我们稍后会回来更新它
-        size_t control_byte_pos = compressed_data.size();
-        compressed_data.push_back(0); // 先放一个占位符
-
-        // 处理一个最多包含8个操作的块
-        for (int bit = 0; bit < 8; ++bit) {
-            if (input_pos >= raw_data.size()) break;
-
-            // --- 寻找最佳匹配 ---
-            int best_match_length = 0;
-            int best_match_offset = 0;
-
-            // 定义搜索窗口
-            size_t search_start = (input_pos > MAX_OFFSET) ? (input_pos - MAX_OFFSET) : 0;
-
-            // 限制最大可匹配长度
-            size_t max_possible_length = std::min((size_t)MAX_MATCH_LENGTH, raw_data.size() - input_pos);
-
-            // 从近到远搜索，这样可以优先找到偏移量小的匹配
-            for (size_t p = input_pos - 1; p >= search_start && p != (size_t)-1; --p) {
-                int current_match_length = 0;
-                while (current_match_length < max_possible_length &&
-                    raw_data[p + current_match_length] == raw_data[input_pos + current_match_length]) {
-                    current_match_length++;
+        // --- 寻找最佳匹配 ---
+        int best_match_length = 0;
+        int best_match_offset = 0;
+        size_t max_possible_length = std::min<size_t>((size_t)MAX_MATCH_LENGTH, src_size - input_pos);
+
+        if (max_possible_length >= MIN_MATCH_LENGTH) {
+            // 链表从近到远排列，只有更长的匹配才替换，因此等长时优先偏移量小的
+            int32_t candidate = matcher.head[LzMatcher::hash3(src + input_pos)];
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+                size_t p = (size_t)candidate;
+                if (input_pos - p > MAX_OFFSET) break;
+
+                if (src[p + best_match_length] == src[input_pos + best_match_length]) {
+                    int current_match_length = 0;
+                    while (current_match_length < (int)max_possible_length &&
+                        src[p + current_match_length] == src[input_pos + current_match_length]) {
+                        current_match_length++;
+                    }
+                    if (current_match_length > best_match_length) {
+                        best_match_length = current_match_length;
+                        best_match_offset = (int)(input_pos - p);
+                        if (best_match_length == (int)max_possible_length) break;
+                    }
                 }
 
-                if (current_match_length > best_match_length) {
-                    best_match_length = current_match_length;
-                    best_match_offset = input_pos - p;
-                }
+                int32_t next = matcher.prev[p & (MAX_OFFSET - 1)];
+                if (next >= candidate) break; // 环形缓冲区中的旧链接已被覆盖
+                candidate = next;
             }
+        }
 
-            // --- 决策：使用引用还是字面量 ---
-            if (best_match_length >= MIN_MATCH_LENGTH) {
-                // 使用引用
-                control_byte |= (1 << (7 - bit)); // 设置控制位为 1
-
-                uint16_t encoded_offset = best_match_offset - 1;
-                uint16_t encoded_length = best_match_length - 3;
-
-                uint16_t packed_word = (encoded_offset << 5) | encoded_length;
-
-                chunk_data.push_back(packed_word >> 8);      // 高位字节
-                chunk_data.push_back(packed_word & 0xFF);  // 低位字节
+        // --- 决策：使用引用还是字面量 ---
+        size_t advance = 1;
+        if (best_match_length >= MIN_MATCH_LENGTH) {
+            compressed_data[control_byte_pos] |= (1 << (7 - bit)); // 设置控制位为 1
 
-                input_pos += best_match_length;
-            }
-            else {
-                // 使用字面量
-                // 控制位默认为 0，无需操作 control_byte
+            uint16_t encoded_offset = best_match_offset - 1;
+            uint16_t encoded_length = best_match_length - 3;
+            uint16_t packed_word = (encoded_offset << 5) | encoded_length;
 
-                uint8_t rotated_byte = rotate_right(raw_data[input_pos], 5);
-                chunk_data.push_back(rotated_byte);
+            compressed_data.push_back(packed_word >> 8);      // 高位字节
+            compressed_data.push_back(packed_word & 0xFF);  // 低位字节
+            advance = best_match_length;
+        }
+        else {
+            compressed_data.push_back(rotate_right(src[input_pos], 5));
+        }
 
-                input_pos++;
+        // 被匹配覆盖的位置同样要进入哈希链
+        for (size_t end = input_pos + advance; input_pos < end; ++input_pos) {
+            if (input_pos + MIN_MATCH_LENGTH <= src_size) {
+                matcher.insert(src, input_pos);
             }
         }
-
-        // 回填正确的控制字节
-        compressed_data[control_byte_pos] = control_byte;
-        // 追加这个块的数据
-        compressed_data.insert(compressed_data.end(), chunk_data.begin(), chunk_data.end());
+        ++bit;
     }
 
     return true;
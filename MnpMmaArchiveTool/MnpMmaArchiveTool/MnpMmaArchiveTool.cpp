@@ -7,7 +7,11 @@
 #include <cstdint>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <Windows.h>
+#include "../../ThreadCount.h"
 
 #pragma pack(1)
 
@@ -78,86 +82,120 @@ const int MIN_MATCH_LENGTH = 3;
 const int MAX_MATCH_LENGTH = 34; // (0x1F) + 3
 const int MAX_OFFSET = 2048;     // 11 bits for offset -> 2^11
 
+// 哈希链匹配器常量
+const int HASH_BITS = 15;
+const int HASH_SIZE = 1 << HASH_BITS;
+const int MAX_CHAIN = 256;       // 每个位置最多检查的候选数
+
 /**
- * @brief 将原始数据压缩为 MMA/MNP 格式的 LZ 压缩流
- * @param raw_data 待压缩的原始数据
- * @param compressed_data 用于存放压缩后数据的字节向量
- * @return 如果压缩成功返回 true
+ * @brief 哈希链匹配器状态，按线程复用，避免每个文件重新分配
  */
-void compress_lz(const std::vector<uint8_t>& raw_data, std::vector<uint8_t>& compressed_data, bool encrypt) {
-    compressed_data.clear();
-    compressed_data.push_back(0xC0); // 写入魔术字节
+struct LzMatcher {
+    std::vector<int32_t> head;
+    std::vector<int32_t> prev;
 
-    size_t input_pos = 0;
+    LzMatcher() : head(HASH_SIZE), prev(MAX_OFFSET) {}
 
-    while (input_pos < raw_data.size()) {
-        uint8_t control_byte = 0;
-        std::vector<uint8_t> chunk_data;
+    void reset() {
+        std::fill(head.begin(), head.end(), -1);
+    }
 
-        // 记住控制字节在输出流中的位置，我们稍后会回来更新它
-        size_t control_byte_pos = compressed_data.size();
-        compressed_data.push_back(0); // 先放一个占位符
+    static uint32_t hash3(const uint8_t* p) {
+        return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+    }
 
-        // 处理一个最多包含8个操作的块
-        for (int bit = 0; bit < 8; ++bit) {
-            if (input_pos >= raw_data.size()) break;
+    void insert(const uint8_t* data, size_t pos) {
+        uint32_t h = hash3(data + pos);
+        prev[pos & (MAX_OFFSET - 1)] = head[h];
+        head[h] = (int32_t)pos;
+    }
+};
 
-            // --- 寻找最佳匹配 ---
-            int best_match_length = 0;
-            int best_match_offset = 0;
+/**
+ * @brief 将原始数据压缩为 MMA/MNP 格式的 LZ 压缩流
+ * @param raw_data 待压缩的原始数据
+ * @param compressed_data 用于存放压缩后数据的字节向量，可在多次调用间复用
+ */
+void compress_lz(const std::vector<uint8_t>& raw_data, std::vector<uint8_t>& compressed_data, bool encrypt) {
+    thread_local LzMatcher matcher;
+    matcher.reset();
 
-            // 定义搜索窗口
-            size_t search_start = (input_pos > MAX_OFFSET) ? (input_pos - MAX_OFFSET) : 0;
+    const uint8_t* src = raw_data.data();
+    const size_t src_size = raw_data.size();
 
-            // 限制最大可匹配长度
-            size_t max_possible_length = std::min<size_t>((size_t)MAX_MATCH_LENGTH, raw_data.size() - input_pos);
+    // 最坏情况：每 8 个字面量多 1 个控制字节
+    compressed_data.clear();
+    compressed_data.reserve(1 + src_size + src_size / 8 + 1);
+    compressed_data.push_back(0xC0); // 写入魔术字节
 
-            // 从近到远搜索，这样可以优先找到偏移量小的匹配
-            for (size_t p = input_pos - 1; p >= search_start && p != (size_t)-1; --p) {
-                int current_match_length = 0;
-                while (current_match_length < max_possible_length &&
-                    raw_data[p + current_match_length] == raw_data[input_pos + current_match_length]) {
-                    current_match_length++;
-                }
+    size_t input_pos = 0;
+    size_t control_byte_pos = 0;
+    int bit = 8;
+
+    while (input_pos < src_size) {
+        if (bit == 8) {
+            // 记住控制字节在输出流中的位置，数据直接写在其后，稍后回填
+            control_byte_pos = compressed_data.size();
+            compressed_data.push_back(0);
+            bit = 0;
+        }
 
-                if (current_match_length > best_match_length) {
-                    best_match_length = current_match_length;
-                    best_match_offset = input_pos - p;
+        // --- 寻找最佳匹配 ---
+        int best_match_length = 0;
+        int best_match_offset = 0;
+        size_t max_possible_length = std::min<size_t>((size_t)MAX_MATCH_LENGTH, src_size - input_pos);
+
+        if (max_possible_length >= MIN_MATCH_LENGTH) {
+            // 链表从近到远排列，只有更长的匹配才替换，因此等长时优先偏移量小的
+            int32_t candidate = matcher.head[LzMatcher::hash3(src + input_pos)];
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+                size_t p = (size_t)candidate;
+                if (input_pos - p > MAX_OFFSET) break;
+
+                if (src[p + best_match_length] == src[input_pos + best_match_length]) {
+                    int current_match_length = 0;
+                    while (current_match_length < (int)max_possible_length &&
+                        src[p + current_match_length] == src[input_pos + current_match_length]) {
+                        current_match_length++;
+                    }
+                    if (current_match_length > best_match_length) {
+                        best_match_length = current_match_length;
+                        best_match_offset = (int)(input_pos - p);
+                        if (best_match_length == (int)max_possible_length) break;
+                    }
                 }
-            }
-
-            // --- 决策：使用引用还是字面量 ---
-            if (best_match_length >= MIN_MATCH_LENGTH) {
-                // 使用引用
-                control_byte |= (1 << (7 - bit)); // 设置控制位为 1
 
-                uint16_t encoded_offset = best_match_offset - 1;
-                uint16_t encoded_length = best_match_length - 3;
+                int32_t next = matcher.prev[p & (MAX_OFFSET - 1)];
+                if (next >= candidate) break; // 环形缓冲区中的旧链接已被覆盖
+                candidate = next;
+            }
+        }
 
-                uint16_t packed_word = (encoded_offset << 5) | encoded_length;
+        // --- 决策：使用引用还是字面量 ---
+        size_t advance = 1;
+        if (best_match_length >= MIN_MATCH_LENGTH) {
+            compressed_data[control_byte_pos] |= (1 << (7 - bit)); // 设置控制位为 1
 
-                chunk_data.push_back(packed_word >> 8);      // 高位字节
-                chunk_data.push_back(packed_word & 0xFF);  // 低位字节
+            uint16_t encoded_offset = best_match_offset - 1;
+            uint16_t encoded_length = best_match_length - 3;
+            uint16_t packed_word = (encoded_offset << 5) | encoded_length;
 
-                input_pos += best_match_length;
-            }
-            else {
-                // 使用字面量
-                // 控制位默认为 0，无需操作 control_byte
-
-                uint8_t rotated_byte = rotate_right(raw_data[input_pos], 5, encrypt);
-                chunk_data.push_back(rotated_byte);
+            compressed_data.push_back(packed_word >> 8);      // 高位字节
+            compressed_data.push_back(packed_word & 0xFF);  // 低位字节
+            advance = best_match_length;
+        }
+        else {
+            compressed_data.push_back(rotate_right(src[input_pos], 5, encrypt));
+        }
 
-                input_pos++;
+        // 被匹配覆盖的位置同样要进入哈希链
+        for (size_t end = input_pos + advance; input_pos < end; ++input_pos) {
+            if (input_pos + MIN_MATCH_LENGTH <= src_size) {
+                matcher.insert(src, input_pos);
             }
         }
-
-        // 回填正确的控制字节
-        compressed_data[control_byte_pos] = control_byte;
-        // 追加这个块的数据
-        compressed_data.insert(compressed_data.end(), chunk_data.begin(), chunk_data.end());
+        ++bit;
     }
-
 }
 
 typedef int(__stdcall* InitializeMME_t)(int);
@@ -225,7 +263,72 @@ void extract(const std::string& mma_file, const std::string& output_dir) {
     FreeLibrary(hArc);
 }
 
-void repack(const std::string& org_mma_file, const std::string& input_mod_files_dir, const std::string& output_new_mma_file, bool compress, bool encrypt) {
+/**
+ * @brief 并行读取并压缩/加密所有被修改的文件
+ * @return 与 index_table 等长的数组，未修改的条目为空
+ */
+std::vector<std::vector<uint8_t>> build_mod_payloads(const std::vector<std::string>& fileNames, const std::string& input_mod_files_dir,
+    std::vector<MMAIndexEntry>& index_table, std::vector<uint8_t>& modified, bool compress, bool encrypt) {
+    std::vector<std::vector<uint8_t>> payloads(fileNames.size());
+    modified.assign(fileNames.size(), false);
+
+    std::vector<size_t> jobs;
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        if (fs::exists(fs::path(input_mod_files_dir) / fs::path(fileNames[i]).filename())) {
+            jobs.push_back(i);
+        }
+    }
+
+    unsigned int num_threads = defaultThreadCount();
+    num_threads = (unsigned int)std::min<size_t>(num_threads, std::max<size_t>(jobs.size(), 1));
+
+    std::atomic<size_t> next_job{ 0 };
+    auto worker = [&]() {
+        std::vector<uint8_t> mod_data;
+        for (size_t j = next_job++; j < jobs.size(); j = next_job++) {
+            size_t i = jobs[j];
+            fs::path mod_file_path = fs::path(input_mod_files_dir) / fs::path(fileNames[i]).filename();
+            std::ifstream ifs(mod_file_path, std::ios::binary);
+            mod_data.resize(fs::file_size(mod_file_path));
+            ifs.read((char*)mod_data.data(), mod_data.size());
+
+            std::vector<uint8_t>& out = payloads[i];
+            if (compress) {
+                compress_lz(mod_data, out, encrypt);
+            }
+            else {
+                out.assign(mod_data.begin(), mod_data.end());
+            }
+            if (encrypt) {
+                encrypt_in_place(out, 0, out.size(), compress);
+            }
+            index_table[i].org_size = (uint32_t)mod_data.size();
+            modified[i] = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return payloads;
+}
+
+void copy_range(std::ifstream& ifs, std::ofstream& ofs, uint64_t offset, uint64_t size, std::vector<char>& buffer) {
+    ifs.clear();
+    ifs.seekg(offset);
+    while (size > 0) {
+        size_t chunk = (size_t)std::min<uint64_t>(size, buffer.size());
+        ifs.read(buffer.data(), chunk);
+        ofs.write(buffer.data(), chunk);
+        size -= chunk;
+    }
+}
+
+void repack(const std::string& org_mma_file, const std::string& input_mod_files_dir, const std::string& output_new_mma_file, bool compress, bool encrypt, bool compact) {
     std::ifstream ifs(org_mma_file, std::ios::binary);
 
     MMAHeader header;
@@ -277,70 +380,60 @@ void repack(const std::string& org_mma_file, const std::string& input_mod_files_
         return;
     }
 
+    std::vector<uint8_t> modified;
+    std::vector<std::vector<uint8_t>> payloads = build_mod_payloads(fileNames, input_mod_files_dir, index_table, modified, compress, encrypt);
+
     ofs.open(output_new_mma_file, std::ios::binary);
     if (!ofs.is_open()) {
         std::cout << "Error: failed to open output mma file for appending." << std::endl;
         return;
     }
-    {
-        ifs.open(org_mma_file, std::ios::binary);
-        std::vector<char> buffer(1024 * 1024);
-        while (ifs.good()) {
-            ifs.read(buffer.data(), buffer.size());
-            if (ifs.gcount() > 0) {
-                ofs.write(buffer.data(), ifs.gcount());
+    ifs.open(org_mma_file, std::ios::binary);
+    std::vector<char> buffer(1024 * 1024);
+
+    // 紧凑模式只保留仍被引用的数据；否则沿用旧做法，在原档案后追加
+    uint64_t index_table_size = (uint64_t)header.file_count * sizeof(MMAIndexEntry);
+    uint64_t data_start = fs::file_size(org_mma_file);
+    if (compact) {
+        for (const auto& entry : index_table) {
+            if (entry.size != 0) {
+                data_start = std::min<uint64_t>(data_start, entry.offset);
             }
         }
-        ifs.close();
     }
+    bool index_in_prefix = header.index_table_offset + index_table_size <= data_start;
+    copy_range(ifs, ofs, 0, data_start, buffer);
 
-    for (int i = 0; i < fileNames.size(); i++) {
-        fs::path mod_file_path = fs::path(input_mod_files_dir) / fs::path(fileNames[i]).filename();
-        if (!fs::exists(mod_file_path)) {
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        if (!modified[i] && !compact) {
             continue;
         }
 
-        std::cout << "Repacking file: " << fs::path(fileNames[i]).filename() << std::endl;
-        ifs.open(mod_file_path, std::ios::binary);
-        std::vector<uint8_t> mod_data(fs::file_size(mod_file_path));
-        ifs.read((char*)mod_data.data(), mod_data.size());
-        ifs.close();
-
-        std::vector<uint8_t> compressed_data;
-
-        uint32_t new_offset = ofs.tellp();
+        uint32_t new_offset = (uint32_t)ofs.tellp();
+        if (!modified[i]) {
+            copy_range(ifs, ofs, index_table[i].offset, index_table[i].size, buffer);
+            index_table[i].offset = new_offset;
+            continue;
+        }
 
+        std::cout << "Repacking file: " << fs::path(fileNames[i]).filename() << std::endl;
         if (index_table[i].block_size != 0) {
-            ifs.open(org_mma_file, std::ios::binary);
-            std::vector<char> org_data(index_table[i].block_size);
-            ifs.seekg(index_table[i].offset);
-            ifs.read(org_data.data(), org_data.size());
-            ifs.close();
-            ofs.write(org_data.data(), org_data.size());
+            copy_range(ifs, ofs, index_table[i].offset, index_table[i].block_size, buffer);
         }
+        ofs.write((char*)payloads[i].data(), payloads[i].size());
 
         index_table[i].offset = new_offset;
-        index_table[i].org_size = mod_data.size();
-
-        if (compress) {
-            compress_lz(mod_data, compressed_data, encrypt);
-            if (compressed_data.empty()) {
-                std::cout << "Error: failed to compress data for file " << fs::path(fileNames[i]).filename() << std::endl;
-                continue;
-            }
-        }
-        else {
-            compressed_data = std::move(mod_data);
-        }
-
-        if (encrypt) {
-            encrypt_in_place(compressed_data, 0, compressed_data.size(), compress);
-        }
-
-        index_table[i].size = compressed_data.size() + index_table[i].block_size;
-        ofs.write((char*)compressed_data.data(), compressed_data.size());
+        index_table[i].size = (uint32_t)payloads[i].size() + index_table[i].block_size;
+        std::vector<uint8_t>().swap(payloads[i]);
     }
+    ifs.close();
 
+    if (!index_in_prefix) {
+        // 索引表原本位于数据区之后，已被丢弃，重新写到文件末尾
+        header.index_table_offset = (uint32_t)ofs.tellp();
+        ofs.seekp(0);
+        ofs.write((char*)&header, sizeof(header));
+    }
     ofs.seekp(header.index_table_offset);
     for (int i = 0; i < header.file_count; i++) {
         ofs.write((char*)&index_table[i], sizeof(index_table[i]));
@@ -357,10 +450,11 @@ int main(int argc, char* argv[]) {
         std::cout << "Made by julixian 2025.08.01" << std::endl;
         std::cout << "Usage: \n"
             << "For extract(can not process pictures very well yet): " << argv[0] << " extract <mma_file> <output_dir>\n"
-            << "For repack: " << argv[0] << " repack <org_mma_file> <input_mod_files_dir> <output_new_mma_file> [--compress] [--encrypt]" << std::endl;
+            << "For repack: " << argv[0] << " repack <org_mma_file> <input_mod_files_dir> <output_new_mma_file> [--compress] [--encrypt] [--compact]" << std::endl;
         std::cout << "IMPORTANT: Ensure that ARC.dll is in the same directory as your working directory." << std::endl;
         std::cout << "--compress: " << "Compress the modified files before repacking, usually needed for script archive." << std::endl;
         std::cout << "--encrypt: " << "F**k Mnp.(If the archive can be extracted by GARbro, it's probably needed to be encrypted.)" << std::endl;
+        std::cout << "--compact: " << "Rebuild the archive with live data only instead of appending to a copy of the original." << std::endl;
         return 1;
     }
 
@@ -381,6 +475,7 @@ int main(int argc, char* argv[]) {
         }
         bool compress = false;
         bool encrypt = false;
+        bool compact = false;
         int arg_index = 5;
         while (arg_index < argc) {
             if (std::string(argv[arg_index]) == "--compress") {
@@ -389,13 +484,16 @@ int main(int argc, char* argv[]) {
             else if (std::string(argv[arg_index]) == "--encrypt") {
                 encrypt = true;
             }
+            else if (std::string(argv[arg_index]) == "--compact") {
+                compact = true;
+            }
             else {
                 std::cout << "Invalid argument: " << argv[arg_index] << std::endl;
                 return 1;
             }
             arg_index++;
         }
-        repack(argv[2], argv[3], argv[4], compress, encrypt);
+        repack(argv[2], argv[3], argv[4], compress, encrypt, compact);
         return 0;
     }
 
@@ -11,6 +11,14 @@
 #include <map>
 #include <algorithm>
 #include <cstring>
+#include <charconv>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "ZlibCodec.h"
+#include "MappedFile.h"
+#include "ThreadCount.h"
 
 namespace fs = std::filesystem;
 
@@ -33,17 +41,15 @@ class PacArchive {
 private:
     std::string filename;
     std::vector<Entry> directory;
-    std::ifstream file;
+    std::unique_ptr<MappedFile> mapping;
+    bool verbose;
+    std::mutex outputMutex;
 
     bool checkPlacement(uint32_t offset, uint32_t size, uint64_t maxOffset) {
-        return (offset + size) <= maxOffset;
+        return (uint64_t)offset + size <= maxOffset;
     }
 
-    std::string decodeString(const std::vector<uint8_t>& buffer, size_t length) {
-        return std::string(buffer.begin(), buffer.begin() + length);
-    }
-
-    bool createDirectory(const std::string& path) {
+    bool createDirectory(const fs::path& path) {
         try {
             fs::create_directories(path);
             return true;
@@ -62,8 +68,9 @@ private:
         return "";
     }
 
-    void printCompressionInfo(const std::vector<uint8_t>& buffer, const std::string& itemName) {
-        if (buffer.size() < 2) {
+    // 逐条目的 zlib 头信息，只在 -v 时输出
+    void printCompressionInfo(const uint8_t* buffer, size_t size, const std::string& itemName) {
+        if (size < 2) {
             std::cout << "Buffer too small to contain zlib header for " << itemName << std::endl;
             return;
         }
@@ -105,19 +112,71 @@ private:
         std::cout << "  FLG bits: " << std::bitset<8>(flg) << std::endl;
     }
 
+    // 解出单个条目，buffer 由调用线程复用。可在多个线程中同时调用
+    bool extractEntry(const Entry& entry, const fs::path& fullPath, std::vector<uint8_t>& buffer) {
+        const uint8_t* packed = mapping->data() + entry.offset;
+
+        if (verbose) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << "Extracting: " << entry.name << std::endl;
+            printCompressionInfo(packed, entry.size, entry.name);
+        }
+
+        const uint8_t* output = packed;
+        size_t outputSize = entry.size;
+        if (entry.isPacked) {
+            buffer.resize(entry.unpackedSize);
+            if (!ZlibCodec::threadLocal().inflate(packed, entry.size, buffer.data(), entry.unpackedSize)) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Failed to decompress file data" << std::endl;
+                return false;
+            }
+            output = buffer.data();
+            outputSize = entry.unpackedSize;
+        }
+
+        std::ofstream outFile(fullPath, std::ios::binary);
+        if (!outFile) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << "Failed to create output file: " << fullPath << std::endl;
+            return false;
+        }
+        outFile.write(reinterpret_cast<const char*>(output), outputSize);
+        return true;
+    }
+
 public:
-    PacArchive(const std::string& fname) : filename(fname) {
-        file.open(filename, std::ios::binary);
+    PacArchive(const std::string& fname, bool verboseOutput = false) : filename(fname), verbose(verboseOutput) {
+        try {
+            mapping = std::make_unique<MappedFile>(fs::path(filename));
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
     }
 
+    // 索引直接在映射上解析：文件名解压到栈上的缓冲区，共用同一个 z_stream
     bool tryOpen(int32_t maxExtractFiles = -1) {
-        if (!file.is_open()) {
+        if (!mapping || mapping->data() == nullptr) {
             std::cerr << "Failed to open input file" << std::endl;
             return false;
         }
 
-        int32_t totalCount;
-        file.read(reinterpret_cast<char*>(&totalCount), sizeof(totalCount));
+        const uint8_t* data = mapping->data();
+        const size_t fileSize = mapping->fileSize();
+        size_t pos = 0;
+        auto readInt = [&](auto& value) {
+            if (pos + sizeof(value) > fileSize) return false;
+            std::memcpy(&value, data + pos, sizeof(value));
+            pos += sizeof(value);
+            return true;
+        };
+
+        int32_t totalCount = 0;
+        if (!readInt(totalCount)) {
+            std::cerr << "File is too short to contain a file count" << std::endl;
+            return false;
+        }
         if (totalCount <= 0 || totalCount > 10000) {
             std::cerr << "Invalid file count: " << totalCount << std::endl;
             return false;
@@ -125,68 +184,53 @@ public:
 
         std::cout << "Total files in archive: " << totalCount << std::endl;
 
-        std::vector<uint8_t> nameBuffer(0x100);
-        std::vector<uint8_t> zlibBuffer(0x100);
+        uint8_t nameBuffer[0x100];
+        ZlibCodec& codec = ZlibCodec::threadLocal();
 
         directory.reserve(totalCount);
 
         for (int i = 0; i < totalCount; ++i) {
-            int32_t nameLen, unpackedSize, packedSize;
-            file.read(reinterpret_cast<char*>(&nameLen), sizeof(nameLen));
-            file.read(reinterpret_cast<char*>(&unpackedSize), sizeof(unpackedSize));
-            file.read(reinterpret_cast<char*>(&packedSize), sizeof(packedSize));
-
-            if (nameLen <= 0 || nameLen > nameBuffer.size() ||
-                unpackedSize < nameLen || unpackedSize > nameBuffer.size() ||
-                packedSize <= 0 || packedSize > zlibBuffer.size()) {
-                std::cerr << "Invalid size parameters at entry " << i << std::endl;
+            int32_t nameLen = 0, unpackedSize = 0, packedSize = 0;
+            if (!readInt(nameLen) || !readInt(unpackedSize) || !readInt(packedSize)) {
+                std::cerr << "Unexpected end of index at entry " << i << std::endl;
                 return false;
             }
 
-            file.read(reinterpret_cast<char*>(zlibBuffer.data()), packedSize);
-
-            // 打印文件名压缩信息
-            std::cout << "File name compression info for entry " << i << ":" << std::endl;
-            printCompressionInfo(zlibBuffer, "File name");
-
-            z_stream zs = { 0 };
-            zs.zalloc = Z_NULL;
-            zs.zfree = Z_NULL;
-            zs.opaque = Z_NULL;
-            zs.avail_in = packedSize;
-            zs.next_in = zlibBuffer.data();
-            zs.avail_out = nameBuffer.size();
-            zs.next_out = nameBuffer.data();
-
-            if (inflateInit(&zs) != Z_OK) {
-                std::cerr << "Failed to initialize zlib for name decompression" << std::endl;
+            if (nameLen <= 0 || nameLen > (int32_t)sizeof(nameBuffer) ||
+                unpackedSize < nameLen || unpackedSize > (int32_t)sizeof(nameBuffer) ||
+                packedSize <= 0 || packedSize > 0x100 || pos + packedSize > fileSize) {
+                std::cerr << "Invalid size parameters at entry " << i << std::endl;
                 return false;
             }
 
-            if (inflate(&zs, Z_FINISH) != Z_STREAM_END) {
-                inflateEnd(&zs);
+            if (verbose) {
+                // 打印文件名压缩信息
+                std::cout << "File name compression info for entry " << i << ":" << std::endl;
+                printCompressionInfo(data + pos, packedSize, "File name");
+            }
+
+            if (!codec.inflate(data + pos, packedSize, nameBuffer, sizeof(nameBuffer))) {
                 std::cerr << "Failed to decompress name data" << std::endl;
                 return false;
             }
+            pos += packedSize;
 
-            inflateEnd(&zs);
-
-            std::string name = decodeString(nameBuffer, nameLen);
-            directory.push_back(Entry(name));
+            directory.emplace_back(std::string(reinterpret_cast<const char*>(nameBuffer), nameLen));
         }
 
         for (auto& entry : directory) {
-            uint32_t offset, size, unpackedSize;
-            file.read(reinterpret_cast<char*>(&offset), sizeof(offset));
-            file.read(reinterpret_cast<char*>(&size), sizeof(size));
-            file.read(reinterpret_cast<char*>(&unpackedSize), sizeof(unpackedSize));
+            uint32_t offset = 0, size = 0, unpackedSize = 0;
+            if (!readInt(offset) || !readInt(size) || !readInt(unpackedSize)) {
+                std::cerr << "Unexpected end of index" << std::endl;
+                return false;
+            }
 
             entry.offset = offset;
             entry.size = size;
             entry.unpackedSize = unpackedSize;
             entry.isPacked = true;
 
-            if (!checkPlacement(offset, size, UINT64_MAX)) {
+            if (!checkPlacement(offset, size, fileSize)) {
                 std::cerr << "Invalid file placement for: " << entry.name << std::endl;
                 return false;
             }
@@ -200,72 +244,63 @@ public:
         return true;
     }
 
-    bool extractEntry(const Entry& entry, const std::string& outputPath) {
-        if (!file.is_open()) return false;
-
-        fs::path fullPath = fs::path(outputPath) / entry.name;
-        createDirectory(fullPath.parent_path().string());
-
-        std::vector<uint8_t> buffer(entry.size);
-        file.seekg(entry.offset);
-        file.read(reinterpret_cast<char*>(buffer.data()), entry.size);
-
-        std::ofstream outFile(fullPath, std::ios::binary);
-        if (!outFile) {
-            std::cerr << "Failed to create output file: " << fullPath << std::endl;
-            return false;
-        }
-
-        printCompressionInfo(buffer, entry.name);
+    bool extractAll(const std::string& outputPath, unsigned int numThreads = 0) {
+        auto startTime = std::chrono::steady_clock::now();
+        std::cout << "Extracting files to: " << outputPath << std::endl;
 
-        if (!entry.isPacked) {
-            outFile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
-            outFile.close();
-            return true;
+        // 目录先在主线程中建好，解包线程只负责解压和写文件
+        std::vector<fs::path> outputPaths;
+        outputPaths.reserve(directory.size());
+        for (const auto& entry : directory) {
+            outputPaths.push_back(fs::path(outputPath) / entry.name);
         }
-
-        std::vector<uint8_t> unpackedData(entry.unpackedSize);
-        z_stream zs = { 0 };
-        zs.zalloc = Z_NULL;
-        zs.zfree = Z_NULL;
-        zs.opaque = Z_NULL;
-        zs.avail_in = entry.size;
-        zs.next_in = buffer.data();
-        zs.avail_out = entry.unpackedSize;
-        zs.next_out = unpackedData.data();
-
-        if (inflateInit(&zs) != Z_OK) {
-            std::cerr << "Failed to initialize zlib for data decompression" << std::endl;
-            return false;
+        {
+            std::vector<fs::path> parents;
+            for (const auto& path : outputPaths) {
+                parents.push_back(path.parent_path());
+            }
+            std::sort(parents.begin(), parents.end());
+            parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+            for (const auto& dir : parents) {
+                createDirectory(dir);
+            }
         }
 
-        if (inflate(&zs, Z_FINISH) != Z_STREAM_END) {
-            inflateEnd(&zs);
-            std::cerr << "Failed to decompress file data" << std::endl;
-            return false;
+        if (numThreads == 0) {
+            numThreads = defaultThreadCount();
         }
+        numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(directory.size(), 1));
 
-        inflateEnd(&zs);
+        std::atomic<size_t> nextEntry{ 0 };
+        std::atomic<size_t> failed{ 0 };
+        std::atomic<uint64_t> totalBytes{ 0 };
 
-        outFile.write(reinterpret_cast<const char*>(unpackedData.data()), entry.unpackedSize);
-        outFile.close();
-
-        return true;
-    }
-
-    bool extractAll(const std::string& outputPath) {
-        bool success = true;
-        std::cout << "Extracting files to: " << outputPath << std::endl;
-
-        for (const auto& entry : directory) {
-            std::cout << "Extracting: " << entry.name << std::endl;
-            if (!extractEntry(entry, outputPath)) {
-                std::cerr << "Failed to extract: " << entry.name << std::endl;
-                success = false;
+        auto worker = [&]() {
+            std::vector<uint8_t> buffer;
+            for (size_t i = nextEntry++; i < directory.size(); i = nextEntry++) {
+                const Entry& entry = directory[i];
+                if (!extractEntry(entry, outputPaths[i], buffer)) {
+                    failed++;
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cerr << "Failed to extract: " << entry.name << std::endl;
+                    continue;
+                }
+                totalBytes += entry.isPacked ? entry.unpackedSize : entry.size;
             }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < numThreads; ++t) {
+            threads.emplace_back(worker);
+        }
+        for (auto& t : threads) {
+            t.join();
         }
 
-        return success;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Extracted " << directory.size() - failed << "/" << directory.size() << " files, "
+            << totalBytes / 1048576.0 << " MB in " << seconds << " s" << std::endl;
+        return failed == 0;
     }
 
     const std::vector<Entry>& getDirectory() const {
@@ -293,6 +328,8 @@ private:
     std::string originalFile;
     std::vector<FileEntry> originalEntries;  // 存储原始文件信息
     int32_t numFilesToProcess;               // 要处理的文件数量
+    ZlibLevel level;                         // 压缩级别
+    unsigned int numThreads;                 // 压缩线程数，0 为 CPU 核数
 
     // 从原始文件读取文件信息
     bool readOriginalEntries() {
@@ -300,8 +337,8 @@ private:
         if (!file) return false;
 
         // 读取文件数量
-        int32_t totalCount;
-        file.read(reinterpret_cast<char*>(&totalCount), sizeof(totalCount));
+        int32_t totalCount = 0;
+        if (!file.read(reinterpret_cast<char*>(&totalCount), sizeof(totalCount))) return false;
 
         // 读取所有文件名信息
         for (int i = 0; i < totalCount; ++i) {
@@ -316,18 +353,9 @@ private:
 
             // 解压文件名以获取实际名称
             std::vector<uint8_t> nameBuffer(entry.nameUnpackedSize);
-            z_stream zs = { 0 };
-            zs.next_in = entry.compressedNameData.data();
-            zs.avail_in = entry.compressedNameSize;
-            zs.next_out = nameBuffer.data();
-            zs.avail_out = nameBuffer.size();
-
-            if (inflateInit(&zs) != Z_OK) continue;
-            if (inflate(&zs, Z_FINISH) != Z_STREAM_END) {
-                inflateEnd(&zs);
+            if (!ZlibCodec::threadLocal().inflate(entry.compressedNameData.data(), entry.compressedNameSize, nameBuffer.data(), nameBuffer.size())) {
                 continue;
             }
-            inflateEnd(&zs);
 
             entry.name = std::string(reinterpret_cast<char*>(nameBuffer.data()), entry.nameLength);
             originalEntries.push_back(entry);
@@ -345,36 +373,12 @@ private:
     }
 
     // 压缩文件数据
+    // 默认 Max 与原先的 deflateInit2(Z_BEST_COMPRESSION, 15, 8) 相同
     std::vector<uint8_t> compressData(const std::vector<uint8_t>& input) {
-        z_stream zs = { 0 };
-        zs.zalloc = Z_NULL;
-        zs.zfree = Z_NULL;
-        zs.opaque = Z_NULL;
-
-        if (deflateInit2(&zs,
-            Z_BEST_COMPRESSION,    // 最高压缩级别
-            Z_DEFLATED,
-            15,                    // 包含zlib头部
-            8,                     // 内存级别
-            Z_DEFAULT_STRATEGY) != Z_OK) {
-            throw std::runtime_error("deflateInit failed");
-        }
-
-        size_t maxCompressedSize = compressBound(input.size());
-        std::vector<uint8_t> output(maxCompressedSize);
-
-        zs.next_in = const_cast<uint8_t*>(input.data());
-        zs.avail_in = input.size();
-        zs.next_out = output.data();
-        zs.avail_out = output.size();
-
-        if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
-            deflateEnd(&zs);
+        std::vector<uint8_t> output;
+        if (!ZlibCodec::threadLocal().deflate(input.data(), input.size(), output, level)) {
             throw std::runtime_error("deflate failed");
         }
-
-        output.resize(zs.total_out);
-        deflateEnd(&zs);
         return output;
     }
 
@@ -393,8 +397,9 @@ private:
     }
 
 public:
-    PacPacker(const std::string& inDir, const std::string& outFile, const std::string& origFile, int32_t numFiles)
-        : inputDir(inDir), outputFile(outFile), originalFile(origFile), numFilesToProcess(numFiles) {}
+    PacPacker(const std::string& inDir, const std::string& outFile, const std::string& origFile, int32_t numFiles,
+        ZlibLevel lvl = ZlibLevel::Max, unsigned int threads = 0)
+        : inputDir(inDir), outputFile(outFile), originalFile(origFile), numFilesToProcess(numFiles), level(lvl), numThreads(threads) {}
 
     void createPacFile() {
         if (!readOriginalEntries()) {
@@ -403,19 +408,50 @@ public:
 
         std::cout << "Read " << originalEntries.size() << " entries from original file\n";
 
-        // 打开原始文件和新文件
-        std::ifstream origFile(originalFile, std::ios::binary);
+        // 原始封包只读映射，未替换的文件直接从映射中复制
+        MappedFile origFile{ fs::path(originalFile) };
         std::ofstream outFile(outputFile, std::ios::binary);
-        if (!origFile || !outFile) {
+        if (!outFile) {
             throw std::runtime_error("Cannot open files");
         }
+        const char* originalData = reinterpret_cast<const char*>(origFile.data());
+        const size_t originalSize = origFile.fileSize();
+
+        // 替换文件的读取和压缩在线程池中进行，结果按索引顺序写出，输出与单线程相同
+        struct Replacement {
+            bool ok = false;
+            uint32_t unpackedSize = 0;
+            std::vector<uint8_t> data;
+            std::string error;
+        };
+        size_t replaceCount = std::min<size_t>(std::max<int32_t>(numFilesToProcess, 0), originalEntries.size());
+        std::vector<Replacement> replacements(replaceCount);
+        std::atomic<size_t> nextEntry{ 0 };
+
+        auto worker = [&]() {
+            for (size_t i = nextEntry++; i < replaceCount; i = nextEntry++) {
+                std::string fullPath = (fs::path(inputDir) / originalEntries[i].name).string();
+                try {
+                    // 尝试读取并压缩新文件
+                    auto rawData = readFileData(fullPath);
+                    replacements[i].data = compressData(rawData);
+                    replacements[i].unpackedSize = rawData.size();
+                    replacements[i].ok = true;
+                }
+                catch (const std::exception& e) {
+                    replacements[i].error = e.what();
+                }
+            }
+        };
 
-        // 首先读取原始文件的所有数据
-        origFile.seekg(0, std::ios::end);
-        size_t totalSize = origFile.tellg();
-        origFile.seekg(0);
-        std::vector<char> originalData(totalSize);
-        origFile.read(originalData.data(), totalSize);
+        unsigned int threadCount = (unsigned int)std::min<size_t>(numThreads ? numThreads : defaultThreadCount(), std::max<size_t>(replaceCount, 1));
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < threadCount; ++t) {
+            threads.emplace_back(worker);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
 
         // 写入文件总数量（保持原始数量）
         int32_t totalCount = originalEntries.size();
@@ -429,90 +465,52 @@ public:
             outFile.write(reinterpret_cast<const char*>(entry.compressedNameData.data()), entry.compressedNameSize);
         }
 
-        // 计算新的数据偏移位置
-        uint32_t currentOffset = outFile.tellp();
-        currentOffset += originalEntries.size() * 12;  // 为所有文件的元数据预留空间
-
-        // 更新所有文件的偏移量
+        // 先算出所有文件的新偏移，元数据写完后顺序写出数据
+        uint32_t currentOffset = static_cast<uint32_t>(outFile.tellp()) + originalEntries.size() * 12;
         std::vector<FileEntry> updatedEntries = originalEntries;  // 复制一份用于更新
 
-        // 处理文件数据
-        size_t dataStartPos = static_cast<size_t>(outFile.tellp()) + originalEntries.size() * 12;
-        outFile.seekp(dataStartPos);
-
-        // 处理要替换的文件
         for (size_t i = 0; i < originalEntries.size(); ++i) {
-            if (i < numFilesToProcess) {
-                // 尝试替换这个文件
-                std::string fullPath = (fs::path(inputDir) / originalEntries[i].name).string();
-                std::cout << "Processing: " << originalEntries[i].name << " from " << fullPath << std::endl;
-
-                try {
-                    // 尝试读取并压缩新文件
-                    auto rawData = readFileData(fullPath);
-                    auto compressedData = compressData(rawData);
-
-                    // 更新文件信息
-                    updatedEntries[i].offset = currentOffset;
-                    updatedEntries[i].size = compressedData.size();
-                    updatedEntries[i].unpackedSize = rawData.size();
-
-                    // 写入新的压缩数据
-                    outFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedData.size());
-                    currentOffset += compressedData.size();
-
-                    std::cout << "Successfully replaced: " << originalEntries[i].name << std::endl;
-                }
-                catch (const std::exception& e) {
-                    // 如果读取或压缩失败，作为未替换文件处理
-                    std::cout << "Failed to process " << originalEntries[i].name << ": " << e.what() << std::endl;
-                    std::cout << "Using original data instead." << std::endl;
-
-                    // 复制原始数据
-                    updatedEntries[i].offset = currentOffset;
-                    size_t originalOffset = originalEntries[i].offset;
-                    size_t originalSize = originalEntries[i].size;
-
-                    if (originalOffset + originalSize <= originalData.size()) {
-                        outFile.write(&originalData[originalOffset], originalSize);
-                        currentOffset += originalSize;
-                    }
-                    else {
-                        throw std::runtime_error("Invalid original file offset or size");
-                    }
-                }
+            updatedEntries[i].offset = currentOffset;
+            if (i < replaceCount) {
+                std::cout << "Processing: " << originalEntries[i].name << " from "
+                    << (fs::path(inputDir) / originalEntries[i].name).string() << std::endl;
+            }
+            if (i < replaceCount && replacements[i].ok) {
+                updatedEntries[i].size = replacements[i].data.size();
+                updatedEntries[i].unpackedSize = replacements[i].unpackedSize;
+                std::cout << "Successfully replaced: " << originalEntries[i].name << std::endl;
             }
             else {
-                // 对于未替换的文件，直接复制原始数据
-                updatedEntries[i].offset = currentOffset;
-
-                // 直接从原始数据中复制
-                size_t originalOffset = originalEntries[i].offset;
-                size_t originalSize = originalEntries[i].size;
-
-                if (originalOffset + originalSize <= originalData.size()) {
-                    outFile.write(&originalData[originalOffset], originalSize);
-                    currentOffset += originalSize;
+                if (i < replaceCount) {
+                    // 如果读取或压缩失败，作为未替换文件处理
+                    std::cout << "Failed to process " << originalEntries[i].name << ": " << replacements[i].error << std::endl;
+                    std::cout << "Using original data instead." << std::endl;
                 }
-                else {
+                if ((uint64_t)originalEntries[i].offset + originalEntries[i].size > originalSize) {
                     throw std::runtime_error("Invalid original file offset or size");
                 }
             }
+            currentOffset += updatedEntries[i].size;
         }
 
-        // 回到元数据位置写入更新后的偏移量
-        outFile.seekp(dataStartPos - originalEntries.size() * 12);
-
         // 写入更新后的所有文件元数据
         for (const auto& entry : updatedEntries) {
             outFile.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
             outFile.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
             outFile.write(reinterpret_cast<const char*>(&entry.unpackedSize), sizeof(entry.unpackedSize));
         }
-    }
-
-
 
+        // 写入文件数据：替换成功的用新的压缩数据，其余直接从原始封包复制
+        for (size_t i = 0; i < originalEntries.size(); ++i) {
+            if (i < replaceCount && replacements[i].ok) {
+                outFile.write(reinterpret_cast<const char*>(replacements[i].data.data()), replacements[i].data.size());
+                replacements[i].data = {};
+            }
+            else {
+                outFile.write(originalData + originalEntries[i].offset, originalEntries[i].size);
+            }
+        }
+    }
 
     void verifyFile() {
         std::ifstream origFile(originalFile, std::ios::binary);
@@ -559,8 +557,36 @@ public:
 void printUsage(const char* programName) {
     std::cout << "Made by julixian 2025.01.01" << std::endl;
     std::cout << "Usage:" << std::endl;
-    std::cout << "To unpack: " << programName << " unpack <pac_file> <output_directory> <number_of_files>" << std::endl;
-    std::cout << "To pack: " << programName << " pack <input_directory> <output_pac> <original_pac> <number_of_files>" << std::endl;
+    std::cout << "To unpack: " << programName << " unpack <pac_file> <output_directory> <number_of_files> [-v] [--threads N]" << std::endl;
+    std::cout << "To pack: " << programName << " pack <input_directory> <output_pac> <original_pac> <number_of_files> [--level fast|balanced|max] [--threads N]" << std::endl;
+    std::cout << "  -v: print zlib header info for every entry" << std::endl;
+    std::cout << "  --threads: worker threads, default is the number of CPU cores" << std::endl;
+}
+
+// 解析必选参数之后的可选项
+bool parseOptions(int argc, char* argv[], int first, bool& verbose, ZlibLevel& level, unsigned int& numThreads) {
+    for (int i = first; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "-v") {
+            verbose = true;
+        }
+        else if (option == "--level" && i + 1 < argc && parseZlibLevel(argv[i + 1], level)) {
+            ++i;
+        }
+        else if (option == "--threads" && i + 1 < argc) {
+            // 非数字、超出范围或为 0 时返回 false
+            const char* value = argv[++i];
+            const char* end = value + strlen(value);
+            auto [ptr, ec] = std::from_chars(value, end, numThreads);
+            if (ec != std::errc() || ptr != end || numThreads == 0) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -580,8 +606,15 @@ int main(int argc, char* argv[]) {
         std::string inputFile = argv[2];
         std::string outputDir = argv[3];
         int32_t numFiles = std::stoi(argv[4]);
+        bool verbose = false;
+        ZlibLevel level = ZlibLevel::Max;
+        unsigned int numThreads = 0;
+        if (!parseOptions(argc, argv, 5, verbose, level, numThreads)) {
+            printUsage(argv[0]);
+            return 1;
+        }
 
-        PacArchive archive(inputFile);
+        PacArchive archive(inputFile, verbose);
         if (!archive.tryOpen(numFiles)) {
             std::cerr << "Failed to open archive: " << inputFile << std::endl;
             return 1;
@@ -589,7 +622,7 @@ int main(int argc, char* argv[]) {
 
         std::cout << "Archive opened successfully" << std::endl;
 
-        if (!archive.extractAll(outputDir)) {
+        if (!archive.extractAll(outputDir, numThreads)) {
             std::cerr << "Some files failed to extract" << std::endl;
             return 1;
         }
@@ -604,7 +637,14 @@ int main(int argc, char* argv[]) {
 
         try {
             int32_t numFiles = std::stoi(argv[5]);
-            PacPacker packer(argv[2], argv[3], argv[4], numFiles);
+            bool verbose = false;
+            ZlibLevel level = ZlibLevel::Max;
+            unsigned int numThreads = 0;
+            if (!parseOptions(argc, argv, 6, verbose, level, numThreads)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            PacPacker packer(argv[2], argv[3], argv[4], numFiles, level, numThreads);
 
             std::cout << "Creating PAC file...\n";
             packer.createPacFile();
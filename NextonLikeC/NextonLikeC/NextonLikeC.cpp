@@ -1,5 +1,6 @@
 ﻿#include <Windows.h>
 #include <cstdint>
+#include "../../MappedFile.h"
 
 import std;
 namespace fs = std::filesystem;
@@ -63,17 +64,15 @@ struct PackInfo {
 };
 
 // 读取并解密名称
-std::string readName(std::ifstream& file, uint32_t offset, uint32_t size, uint8_t key) {
-    file.seekg(offset);
-    std::vector<char> buffer(size, 0);
-    file.read(buffer.data(), size);
+std::string readName(const ByteSpan& file, uint32_t offset, uint32_t size, uint8_t key) {
+    const uint8_t* buffer = file.at(offset, size);
 
     std::string result;
     for (uint32_t i = 0; i < size; ++i) {
         if (buffer[i] == 0)
             break;
 
-        uint8_t b = static_cast<uint8_t>(buffer[i]);
+        uint8_t b = buffer[i];
         if (b != key)
             b ^= key;
 
@@ -103,18 +102,19 @@ void writeName(std::ofstream& file, const std::string& name, uint32_t offset, ui
 }
 
 // 尝试以Moon格式打开列表文件
-std::vector<Entry> openMoon(std::ifstream& lst, uint64_t maxOffset) {
+std::vector<Entry> openMoon(const ByteSpan& lst, uint64_t maxOffset) {
     std::vector<Entry> entries;
 
     // 读取文件头
-    lst.seekg(0);
-    uint32_t countEncrypted;
-    lst.read(reinterpret_cast<char*>(&countEncrypted), 4);
+    if (!lst.contains(0, 4)) {
+        return {};
+    }
+    uint32_t countEncrypted = lst.u32le(0);
 
     uint32_t count = countEncrypted ^ 0xcccccccc;
 
-    // 验证条目数量
-    if (count <= 0 || (4 + count * 0x2c) > maxOffset) {
+    // 验证条目数量，整个索引也必须在列表文件内
+    if (count <= 0 || (4 + count * 0x2c) > maxOffset || !lst.contains(4, (uint64_t)count * 0x2c)) {
         return {};
     }
 
@@ -123,11 +123,8 @@ std::vector<Entry> openMoon(std::ifstream& lst, uint64_t maxOffset) {
     uint32_t indexOffset = 4;
 
     for (uint32_t i = 0; i < count; ++i) {
-        lst.seekg(indexOffset);
-
-        uint32_t offsetEncrypted, sizeEncrypted;
-        lst.read(reinterpret_cast<char*>(&offsetEncrypted), 4);
-        lst.read(reinterpret_cast<char*>(&sizeEncrypted), 4);
+        uint32_t offsetEncrypted = lst.u32le(indexOffset);
+        uint32_t sizeEncrypted = lst.u32le(indexOffset + 4);
 
         uint32_t offset = offsetEncrypted ^ 0xcccccccc;
         uint32_t size = sizeEncrypted ^ 0xcccccccc;
@@ -157,13 +154,14 @@ std::vector<Entry> openMoon(std::ifstream& lst, uint64_t maxOffset) {
 }
 
 // 尝试以Nexton格式打开列表文件
-std::vector<Entry> openNexton(std::ifstream& lst, uint64_t maxOffset) {
+std::vector<Entry> openNexton(const ByteSpan& lst, uint64_t maxOffset) {
     std::vector<Entry> entries;
 
     // 猜测XOR密钥
-    lst.seekg(3);
-    uint8_t keyByte;
-    lst.read(reinterpret_cast<char*>(&keyByte), 1);
+    if (!lst.contains(0, 4)) {
+        return {};
+    }
+    uint8_t keyByte = lst.u8(3);
 
     if (keyByte == 0) {
         return {};
@@ -174,14 +172,12 @@ std::vector<Entry> openNexton(std::ifstream& lst, uint64_t maxOffset) {
     key |= key << 16;
 
     // 读取文件头
-    lst.seekg(0);
-    uint32_t countEncrypted;
-    lst.read(reinterpret_cast<char*>(&countEncrypted), 4);
+    uint32_t countEncrypted = lst.u32le(0);
 
     uint32_t count = countEncrypted ^ key;
 
-    // 验证条目数量
-    if (count <= 0 || (4 + count * 0x4c) > maxOffset) {
+    // 验证条目数量，整个索引也必须在列表文件内
+    if (count <= 0 || (4 + count * 0x4c) > maxOffset || !lst.contains(4, (uint64_t)count * 0x4c)) {
         return {};
     }
 
@@ -190,11 +186,8 @@ std::vector<Entry> openNexton(std::ifstream& lst, uint64_t maxOffset) {
     uint32_t indexOffset = 4;
 
     for (uint32_t i = 0; i < count; ++i) {
-        lst.seekg(indexOffset);
-
-        uint32_t offsetEncrypted, sizeEncrypted;
-        lst.read(reinterpret_cast<char*>(&offsetEncrypted), 4);
-        lst.read(reinterpret_cast<char*>(&sizeEncrypted), 4);
+        uint32_t offsetEncrypted = lst.u32le(indexOffset);
+        uint32_t sizeEncrypted = lst.u32le(indexOffset + 4);
 
         uint32_t offset = offsetEncrypted ^ key;
         uint32_t size = sizeEncrypted ^ key;
@@ -217,9 +210,7 @@ std::vector<Entry> openNexton(std::ifstream& lst, uint64_t maxOffset) {
         entry.replaced = false;
 
         // 读取类型
-        lst.seekg(indexOffset + 0x48);
-        int32_t type;
-        lst.read(reinterpret_cast<char*>(&type), 4);
+        int32_t type = static_cast<int32_t>(lst.u32le(indexOffset + 0x48));
 
         if (type >= 0 && type < 6) {
             entry.typeIndex = type;
@@ -263,10 +254,9 @@ std::vector<char> readFileData(const std::string& filename) {
 }
 
 // 读取原始封包中的文件数据
-void readOriginalData(std::ifstream& arc, Entry& entry) {
-    entry.data.resize(entry.size);
-    arc.seekg(entry.offset);
-    arc.read(entry.data.data(), entry.size);
+void readOriginalData(const ByteSpan& arc, Entry& entry) {
+    const uint8_t* data = arc.at(entry.offset, entry.size);
+    entry.data.assign(data, data + entry.size);
     // 如果需要解密
     if (entry.key != 0) {
         for (size_t i = 0; i < entry.data.size(); ++i) {
@@ -297,18 +287,22 @@ PackInfo analyzePackage(const fs::path& arcFilePath, const fs::path& lstFilePath
     PackInfo info;
     info.format = PackFormat::Unknown;
 
-    // 打开文件
-    std::ifstream arc(arcFilePath, std::ios::binary);
-    std::ifstream lst(lstFilePath, std::ios::binary);
+    // 打开文件，列表文件整体映射后直接解析
+    std::unique_ptr<MappedFile> lstFile;
+    std::error_code ec;
+    uint64_t maxOffset = fs::file_size(arcFilePath, ec);
+    try {
+        lstFile = std::make_unique<MappedFile>(lstFilePath);
+    }
+    catch (const std::exception&) {
+        lstFile.reset();
+    }
 
-    if (!arc || !lst) {
+    if (ec || !lstFile) {
         std::println("Cannot open file: {}", wide2Ascii(arcFilePath));
         return info;
     }
-
-    // 获取文件大小
-    uint64_t maxOffset = fs::file_size(arcFilePath);
-    uint64_t lstSize = fs::file_size(lstFilePath);
+    const ByteSpan lst = lstFile->span();
 
     // 先尝试Moon格式
     info.entries = openMoon(lst, maxOffset);
@@ -324,8 +318,7 @@ PackInfo analyzePackage(const fs::path& arcFilePath, const fs::path& lstFilePath
     if (!info.entries.empty()) {
         info.format = PackFormat::Nexton;
         // 获取猜测的密钥
-        lst.seekg(3);
-        lst.read(reinterpret_cast<char*>(&info.key), 1);
+        info.key = lst.u8(3);
         info.entrySize = 0x4c;
         return info;
     }
@@ -334,7 +327,7 @@ PackInfo analyzePackage(const fs::path& arcFilePath, const fs::path& lstFilePath
 }
 
 // 提取文件
-void extractFile(std::ifstream& arc, const Entry& entry, const fs::path& outputDir) {
+void extractFile(const ByteSpan& arc, const Entry& entry, const fs::path& outputDir) {
 
     // 打开输出文件
     const fs::path outputPath = outputDir / ascii2Wide(entry.fileName, CP_UTF8);
@@ -345,20 +338,25 @@ void extractFile(std::ifstream& arc, const Entry& entry, const fs::path& outputD
         return;
     }
 
-    // 读取数据
-    std::vector<char> buffer(entry.size);
-    arc.seekg(entry.offset);
-    arc.read(buffer.data(), entry.size);
+    // 数据直接从映射中读取
+    if (!arc.contains(entry.offset, entry.size)) {
+        std::println("Entry out of range: {}", wide2Ascii(outputPath));
+        return;
+    }
+    const char* data = reinterpret_cast<const char*>(arc.at(entry.offset, entry.size));
 
     // 如果需要解密
     if (entry.key != 0) {
+        std::vector<char> buffer(data, data + entry.size);
         for (size_t i = 0; i < buffer.size(); ++i) {
             buffer[i] ^= entry.key;
         }
+        ofs.write(buffer.data(), buffer.size());
+    }
+    else {
+        // 写入数据
+        ofs.write(data, entry.size);
     }
-
-    // 写入数据
-    ofs.write(buffer.data(), buffer.size());
     ofs.close();
     std::println("Extracted: {} ({} bytes)", wide2Ascii(outputPath), entry.size);
 }
@@ -368,11 +366,15 @@ void createNewPackage(PackInfo& info, const fs::path& arcFilePath,
     const fs::path& lstFilePath,
     const fs::path& newArcFilePath,
     const fs::path& newArcLstPath) {
-    // 打开原始LST文件进行读取
-    std::ifstream oldLst(lstFilePath, std::ios::binary);
-    if (!oldLst) {
+    // 映射原始LST文件进行读取
+    std::unique_ptr<MappedFile> oldLstFile;
+    try {
+        oldLstFile = std::make_unique<MappedFile>(lstFilePath);
+    }
+    catch (const std::exception&) {
         throw std::runtime_error(std::format("Cannot open file: {}", wide2Ascii(lstFilePath)));
     }
+    const ByteSpan oldLst = oldLstFile->span();
 
     // 创建新文件
     std::ofstream newArc(newArcFilePath, std::ios::binary);
@@ -405,11 +407,6 @@ void createNewPackage(PackInfo& info, const fs::path& arcFilePath,
         currentOffset += entry.size;
     }
 
-    // 复制原始LST文件内容并更新偏移和大小
-    std::vector<char> lstBuffer(fs::file_size(lstFilePath));
-    oldLst.seekg(0);
-    oldLst.read(lstBuffer.data(), lstBuffer.size());
-
     // 写入LST文件条目
     uint32_t indexOffset = 4;
     for (const auto& entry : info.entries) {
@@ -425,11 +422,8 @@ void createNewPackage(PackInfo& info, const fs::path& arcFilePath,
             newLst.write(reinterpret_cast<char*>(&sizeEncrypted), 4);
 
             // 复制原始文件名 - 直接从原始LST文件复制
-            oldLst.seekg(indexOffset + 8);
-            std::vector<char> nameBuffer(0x24);
-            oldLst.read(nameBuffer.data(), 0x24);
             newLst.seekp(indexOffset + 8);
-            newLst.write(nameBuffer.data(), 0x24);
+            newLst.write(reinterpret_cast<const char*>(oldLst.at(indexOffset + 8, 0x24)), 0x24);
 
             indexOffset += 0x2c;
         }
@@ -447,18 +441,12 @@ void createNewPackage(PackInfo& info, const fs::path& arcFilePath,
             newLst.write(reinterpret_cast<char*>(&sizeEncrypted), 4);
 
             // 复制原始文件名 - 直接从原始LST文件复制
-            oldLst.seekg(indexOffset + 8);
-            std::vector<char> nameBuffer(0x40);
-            oldLst.read(nameBuffer.data(), 0x40);
             newLst.seekp(indexOffset + 8);
-            newLst.write(nameBuffer.data(), 0x40);
+            newLst.write(reinterpret_cast<const char*>(oldLst.at(indexOffset + 8, 0x40)), 0x40);
 
             // 复制类型信息
-            oldLst.seekg(indexOffset + 0x48);
-            int32_t type;
-            oldLst.read(reinterpret_cast<char*>(&type), 4);
             newLst.seekp(indexOffset + 0x48);
-            newLst.write(reinterpret_cast<char*>(&type), 4);
+            newLst.write(reinterpret_cast<const char*>(oldLst.at(indexOffset + 0x48, 4)), 4);
 
             indexOffset += 0x4c;
         }
@@ -491,12 +479,15 @@ void extractPackage(const fs::path& arcFilePath, const fs::path& lstFilePath, co
         throw std::runtime_error(std::format("Original LST file not found: {}", wide2Ascii(lstFilePath)));
     }
 
-    // 打开文件
-    std::ifstream arc(arcFilePath, std::ios::binary);
-
-    if (!arc) {
+    // 映射封包文件
+    std::unique_ptr<MappedFile> arcFile;
+    try {
+        arcFile = std::make_unique<MappedFile>(arcFilePath);
+    }
+    catch (const std::exception&) {
         throw std::runtime_error(std::format("Cannot open file: {}", wide2Ascii(arcFilePath)));
     }
+    const ByteSpan arc = arcFile->span();
 
     PackInfo packInfo = analyzePackage(arcFilePath, lstFilePath);
 
@@ -550,11 +541,15 @@ void repackPackage(const fs::path& arcFilePath, const fs::path& lstFilePath,
     std::string formatName = (packInfo.format == PackFormat::Moon) ? "Moon" : "Nexton";
     std::println("Detected {} format, key: {:#x}, file count: {}", formatName, packInfo.key, packInfo.entries.size());
 
-    // 打开原始封包文件
-    std::ifstream arc(arcFilePath, std::ios::binary);
-    if (!arc) {
+    // 映射原始封包文件
+    std::unique_ptr<MappedFile> arcFile;
+    try {
+        arcFile = std::make_unique<MappedFile>(arcFilePath);
+    }
+    catch (const std::exception&) {
         throw std::runtime_error(std::format("Cannot open file: {}", wide2Ascii(arcFilePath)));
     }
+    const ByteSpan arc = arcFile->span();
 
     // 读取原始数据并查找替换文件
     int replacedCount = 0;
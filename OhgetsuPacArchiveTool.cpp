@@ -7,6 +7,15 @@
 #include <cstring>
 #include <iomanip>
 #include <algorithm>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <charconv>
+#include <emmintrin.h>
+#include "MappedFile.h"
+#include "ThreadCount.h"
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -26,14 +35,172 @@ struct OldExeEntry {
 };
 #pragma pack()
 
+// 两种格式的索引表都以 offset == 0、resource_id == 1 的条目开头，下一项的 offset 是首项长度按 2048/256 对齐后的值
+struct IndexLocation {
+    size_t offset = 0;
+    bool old_format = false;
+};
+
+static bool isIndexStart(const uint8_t* data, size_t size, size_t pos, bool old_format) {
+    if (size < sizeof(ExeEntry) * 2 || pos >= size - sizeof(ExeEntry) * 2) {
+        return false;
+    }
+    if (old_format) {
+        OldExeEntry entry, next_entry;
+        memcpy(&entry, data + pos, sizeof(entry));
+        memcpy(&next_entry, data + pos + sizeof(entry), sizeof(next_entry));
+        return !entry.offset &&
+            (((entry.length + 255) & ~255) == next_entry.offset) &&
+            (static_cast<int32_t>(entry.length) > 0) &&
+            (!entry.is_compressed || entry.is_compressed == 1) &&
+            (entry.resource_id == 1);
+    }
+    ExeEntry entry, next_entry;
+    memcpy(&entry, data + pos, sizeof(entry));
+    memcpy(&next_entry, data + pos + sizeof(entry), sizeof(next_entry));
+    return !entry.offset &&
+        (((entry.length + 2047) & ~2047) == next_entry.offset) &&
+        (static_cast<int32_t>(entry.length) > 0) &&
+        (!entry.is_compressed || entry.is_compressed == 1) &&
+        (entry.resource_id == 1);
+}
+
+// 按 4 字节步长一次扫描两种格式。以 dword 下标 k 计:
+//   新格式 d[k] 为 is_compressed|resource_id << 16 (0x00010000 或 0x00010001)，d[k + 1] 为 offset == 0
+//   旧格式 d[k] 为 offset == 0，d[k + 2] 为 is_compressed|resource_id << 16
+// SSE2 每次比较 4 个位置，只有通过这两个条件的位置才做完整检查。新格式优先，与先后扫描两遍的结果一致
+static bool scanIndex(const uint8_t* data, size_t size, IndexLocation& location) {
+    if (size < sizeof(ExeEntry) * 2) {
+        return false;
+    }
+    const size_t limit = size - sizeof(ExeEntry) * 2;
+    size_t old_pos = SIZE_MAX;
+
+    auto check = [&](size_t pos) {
+        if (isIndexStart(data, size, pos, false)) {
+            location.offset = pos;
+            location.old_format = false;
+            return true;
+        }
+        if (old_pos == SIZE_MAX && isIndexStart(data, size, pos, true)) {
+            old_pos = pos;
+        }
+        return false;
+    };
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i flag_mask = _mm_set1_epi32(~1);
+    const __m128i first_id = _mm_set1_epi32(0x00010000);
+    size_t pos = 0;
+    for (; pos + 12 < limit; pos += 16) {
+        __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 4));
+        __m128i d2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 8));
+        __m128i new_hit = _mm_and_si128(
+            _mm_cmpeq_epi32(_mm_and_si128(d0, flag_mask), first_id),
+            _mm_cmpeq_epi32(d1, zero));
+        __m128i old_hit = _mm_and_si128(
+            _mm_cmpeq_epi32(d0, zero),
+            _mm_cmpeq_epi32(_mm_and_si128(d2, flag_mask), first_id));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(new_hit, old_hit)));
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            mask &= mask - 1;
+            if (check(pos + lane * 4)) {
+                return true;
+            }
+        }
+    }
+    for (; pos < limit; pos += 4) {
+        if (check(pos)) {
+            return true;
+        }
+    }
+
+    if (old_pos != SIZE_MAX) {
+        location.offset = old_pos;
+        location.old_format = true;
+        return true;
+    }
+    return false;
+}
+
+// FNV-1a 64 的变体: 每次吃 8 字节，4 路独立累加避免乘法依赖链，比逐字节快一个数量级，比扫描本身还便宜
+static uint64_t hashData(const uint8_t* data, size_t size) {
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t lanes[4] = { 0xCBF29CE484222325ull, 0x84222325CBF29CE4ull, 0xE484222325CBF29Cull, 0x2325CBF29CE48422ull };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * prime;
+        }
+    }
+    uint64_t hash = size;
+    for (uint64_t lane : lanes) {
+        hash = (hash ^ lane) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash;
+}
+
+// 索引位置按 EXE 的哈希缓存在临时目录中，同一个 EXE 再次运行时跳过扫描。
+// 命中后仍会在该位置重新检查一次，缓存文件损坏或哈希碰撞时退回完整扫描
+static fs::path indexCachePath() {
+    std::error_code ec;
+    fs::path dir = fs::temp_directory_path(ec);
+    return ec ? fs::path("OhgetsuPacIndex.cache") : dir / "OhgetsuPacIndex.cache";
+}
+
+static bool findIndex(const std::vector<uint8_t>& exe_data, IndexLocation& location, bool* from_cache = nullptr) {
+    const uint64_t hash = hashData(exe_data.data(), exe_data.size());
+    const fs::path cache_path = indexCachePath();
+    if (from_cache) *from_cache = false;
+
+    std::ifstream cache_in(cache_path);
+    std::string line;
+    while (std::getline(cache_in, line)) {
+        std::istringstream fields(line);
+        uint64_t cached_hash = 0, cached_size = 0, cached_offset = 0;
+        int cached_old = 0;
+        if (!(fields >> std::hex >> cached_hash >> cached_size >> cached_offset >> cached_old) ||
+            cached_hash != hash || cached_size != exe_data.size()) {
+            continue;
+        }
+        if (isIndexStart(exe_data.data(), exe_data.size(), cached_offset, cached_old != 0)) {
+            location.offset = cached_offset;
+            location.old_format = cached_old != 0;
+            if (from_cache) *from_cache = true;
+            return true;
+        }
+    }
+    cache_in.close();
+
+    if (!scanIndex(exe_data.data(), exe_data.size(), location)) {
+        return false;
+    }
+
+    std::ofstream cache_out(cache_path, std::ios::app);
+    if (cache_out) {
+        cache_out << std::hex << hash << ' ' << exe_data.size() << ' ' << location.offset << ' '
+            << (location.old_format ? 1 : 0) << std::endl;
+    }
+    return true;
+}
+
 class PacExtractor {
 private:
     std::string exe_path;
     std::string pac_path;
     std::string output_dir;
     std::vector<uint8_t> exe_data;
-    std::unique_ptr<std::ifstream> pac_file;
+    std::unique_ptr<MappedFile> pac_mapping;
     std::ofstream log_file;
+    unsigned int num_threads;
 
     struct ResourceEntry {
         uint32_t resource_id;
@@ -45,8 +212,8 @@ private:
 
 public:
     PacExtractor(const std::string& exe_path, const std::string& pac_path,
-        const std::string& output_dir)
-        : exe_path(exe_path), pac_path(pac_path), output_dir(output_dir) {
+        const std::string& output_dir, unsigned int num_threads = 0)
+        : exe_path(exe_path), pac_path(pac_path), output_dir(output_dir), num_threads(num_threads) {
     }
 
     bool initialize() {
@@ -68,8 +235,10 @@ public:
         exe_file.close();
 
         // 打开PAC文件
-        pac_file = std::make_unique<std::ifstream>(pac_path, std::ios::binary);
-        if (!pac_file->is_open()) {
+        try {
+            pac_mapping = std::make_unique<MappedFile>(fs::path(pac_path));
+        }
+        catch (const std::exception&) {
             std::cerr << "Failed to open PAC file: " << pac_path << std::endl;
             return false;
         }
@@ -96,11 +265,32 @@ public:
             return false;
         }
 
-        // 提取每个资源
-        for (const auto& res : resources) {
-            if (!extractResource(res)) {
-                std::cerr << "Failed to extract resource " << res.resource_id << std::endl;
-                continue;
+        // 提取每个资源。资源之间互不依赖，交给线程池处理；
+        // 每个资源的日志写入各自的槽位，不需要加锁，全部完成后按索引顺序写入日志
+        std::vector<std::string> log_records(resources.size());
+        std::vector<char> succeeded(resources.size(), 0);
+        std::atomic<size_t> next_resource{ 0 };
+
+        auto worker = [&]() {
+            for (size_t i = next_resource++; i < resources.size(); i = next_resource++) {
+                succeeded[i] = extractResource(resources[i], log_records[i]);
+            }
+        };
+
+        unsigned int thread_count = num_threads ? num_threads : defaultThreadCount();
+        thread_count = (unsigned int)std::min<size_t>(thread_count, std::max<size_t>(resources.size(), 1));
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < thread_count; ++t) {
+            threads.emplace_back(worker);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        for (size_t i = 0; i < resources.size(); ++i) {
+            log_file << log_records[i];
+            if (!succeeded[i]) {
+                std::cerr << "Failed to extract resource " << resources[i].resource_id << std::endl;
             }
         }
 
@@ -118,58 +308,23 @@ private:
     }
 
     bool parseIndex() {
-        // 先尝试新格式
-        auto index_pos = searchIndex(false);
-        if (index_pos != nullptr) {
-            log_file << "Using new format index table" << std::endl;
-            return parseNewFormatIndex(index_pos);
+        IndexLocation location;
+        bool from_cache = false;
+        if (!findIndex(exe_data, location, &from_cache)) {
+            log_file << "No valid index table found" << std::endl;
+            return false;
         }
-
-        // 再尝试旧格式
-        index_pos = searchIndex(true);
-        if (index_pos != nullptr) {
-            log_file << "Using old format index table" << std::endl;
-            return parseOldFormatIndex(index_pos);
+        if (from_cache) {
+            log_file << "Index location loaded from cache: 0x" << std::hex << location.offset << std::dec << std::endl;
         }
 
-        log_file << "No valid index table found" << std::endl;
-        return false;
-    }
-
-    uint8_t* searchIndex(bool old_format) {
-        size_t entry_size = old_format ? sizeof(OldExeEntry) : sizeof(ExeEntry);
-        uint8_t* p = exe_data.data();
-        uint8_t* end = p + (exe_data.size() - entry_size * 2);
-
-        while (p < end) {
-            if (old_format) {
-                auto* entry = reinterpret_cast<OldExeEntry*>(p);
-                auto* next_entry = entry + 1;
-
-                if (!entry->offset &&
-                    (((entry->length + 255) & ~255) == next_entry->offset) &&
-                    (static_cast<int32_t>(entry->length) > 0) &&
-                    (!entry->is_compressed || entry->is_compressed == 1) &&
-                    (entry->resource_id == 1)) {
-                    return p;
-                }
-            }
-            else {
-                auto* entry = reinterpret_cast<ExeEntry*>(p);
-                auto* next_entry = entry + 1;
-
-                if (!entry->offset &&
-                    (((entry->length + 2047) & ~2047) == next_entry->offset) &&
-                    (static_cast<int32_t>(entry->length) > 0) &&
-                    (!entry->is_compressed || entry->is_compressed == 1) &&
-                    (entry->resource_id == 1)) {
-                    return p;
-                }
-            }
-            p += 4;
+        if (!location.old_format) {
+            log_file << "Using new format index table" << std::endl;
+            return parseNewFormatIndex(exe_data.data() + location.offset);
         }
 
-        return nullptr;
+        log_file << "Using old format index table" << std::endl;
+        return parseOldFormatIndex(exe_data.data() + location.offset);
     }
 
     bool parseNewFormatIndex(uint8_t* index_start) {
@@ -217,50 +372,47 @@ private:
         return !resources.empty();
     }
 
-    bool extractResource(const ResourceEntry& res) {
+    bool extractResource(const ResourceEntry& res, std::string& log_record) const {
+        std::ostringstream log;
+
         // 构建输出文件名
-        std::string filename = std::to_string(res.resource_id);
-        filename = std::string(5 - filename.length(), '0') + filename;
+        char filename[16];
+        snprintf(filename, sizeof(filename), "%05u", res.resource_id);
         std::string output_path = output_dir + "/script" + filename + ".bin";
 
         // 创建输出文件
         std::ofstream out_file(output_path, std::ios::binary);
         if (!out_file) {
-            log_file << "Failed to create output file: " << output_path << std::endl;
-            return false;
-        }
-
-        // 定位到资源位置
-        pac_file->seekg(res.offset, std::ios::beg);
-        if (pac_file->fail()) {
-            log_file << "Failed to seek to resource offset: " << res.offset << std::endl;
+            log << "Failed to create output file: " << output_path << std::endl;
+            log_record = log.str();
             return false;
         }
 
-        // 分配缓冲区
-        std::vector<uint8_t> buffer(res.length);
-
-        // 读取资源数据
-        pac_file->read(reinterpret_cast<char*>(buffer.data()), res.length);
-        if (pac_file->fail()) {
-            log_file << "Failed to read resource data, id: " << res.resource_id << std::endl;
+        // 资源数据直接从映射中读取
+        const ByteSpan pac = pac_mapping->span();
+        if (!pac.contains(res.offset, res.length)) {
+            log << "Failed to read resource data, id: " << res.resource_id << std::endl;
+            log_record = log.str();
             return false;
         }
+        const uint8_t* data = pac.at(res.offset, res.length);
 
         // 写入输出文件
-        out_file.write(reinterpret_cast<char*>(buffer.data()), res.length);
+        out_file.write(reinterpret_cast<const char*>(data), res.length);
         if (out_file.fail()) {
-            log_file << "Failed to write resource data, id: " << res.resource_id << std::endl;
+            log << "Failed to write resource data, id: " << res.resource_id << std::endl;
+            log_record = log.str();
             return false;
         }
 
         // 记录日志
-        log_file << "Extracted resource " << filename
+        log << "Extracted resource " << filename
             << " (ID: " << res.resource_id
             << ", Offset: 0x" << std::hex << res.offset
-            << ", Length: 0x" << res.length
+            << ", Length: 0x" << res.length << std::dec
             << ", Compressed: " << (res.is_compressed ? "Yes" : "No")
             << ")" << std::endl;
+        log_record = log.str();
 
         return true;
     }
@@ -284,7 +436,7 @@ private:
 
 class PacPacker {
 private:
-    static const uint32_t ALIGNMENT = 0x800;  // 2048字节对齐
+    // 旧格式的条目读入后也以 ExeEntry 保存，写回时再转换
     std::vector<ExeEntry> index_entries;
     fs::path exe_path;
     fs::path input_dir;
@@ -292,10 +444,13 @@ private:
     std::vector<uint8_t> exe_data;
     uint8_t* index_location = nullptr;
     size_t index_entries_count = 0;
+    bool old_format = false;
+    uint32_t alignment = 0x800;  // 新格式 2048 字节对齐，旧格式 256 字节对齐
+    unsigned int num_threads;
 
 public:
-    PacPacker(const fs::path& exe, const fs::path& input, const fs::path& output)
-        : exe_path(exe), input_dir(input), output_dir(output) {}
+    PacPacker(const fs::path& exe, const fs::path& input, const fs::path& output, unsigned int num_threads = 0)
+        : exe_path(exe), input_dir(input), output_dir(output), num_threads(num_threads) {}
 
     bool execute() {
         if (!loadExe()) return false;
@@ -327,38 +482,38 @@ private:
     }
 
     bool findIndex() {
-        uint8_t* p = exe_data.data();
-        uint8_t* end = p + (exe_data.size() - sizeof(ExeEntry) * 2);
-
-        while (p < end) {
-            ExeEntry* entry = reinterpret_cast<ExeEntry*>(p);
-            ExeEntry* next_entry = entry + 1;
-
-            if (!entry->offset &&
-                (((entry->length + 2047) & ~2047) == next_entry->offset) &&
-                (static_cast<int32_t>(entry->length) > 0) &&
-                (!entry->is_compressed || entry->is_compressed == 1) &&
-                (entry->resource_id == 1)) {
-                index_location = p;
-                // 计算索引表条目数
-                uint8_t* index_end = p;
-                while (index_end < end) {
-                    ExeEntry* curr_entry = reinterpret_cast<ExeEntry*>(index_end);
-                    if (curr_entry->offset && !curr_entry->resource_id &&
-                        (curr_entry->offset == curr_entry->length)) {
-                        break;
-                    }
-                    index_entries.push_back(*curr_entry);
-                    index_end += sizeof(ExeEntry);
-                }
-                index_entries_count = index_entries.size();
-                return true;
+        IndexLocation location;
+        if (!::findIndex(exe_data, location)) {
+            std::cerr << "Failed to find index in exe" << std::endl;
+            return false;
+        }
+        old_format = location.old_format;
+        alignment = old_format ? 0x100 : 0x800;
+
+        uint8_t* p = exe_data.data() + location.offset;
+        uint8_t* end = exe_data.data() + (exe_data.size() - sizeof(ExeEntry) * 2);
+        index_location = p;
+        // 计算索引表条目数
+        uint8_t* index_end = p;
+        while (index_end < end) {
+            ExeEntry curr_entry;
+            if (old_format) {
+                OldExeEntry old_entry;
+                memcpy(&old_entry, index_end, sizeof(old_entry));
+                curr_entry = { old_entry.is_compressed, old_entry.resource_id, old_entry.offset, old_entry.length };
             }
-            p += 4;
+            else {
+                memcpy(&curr_entry, index_end, sizeof(curr_entry));
+            }
+            if (curr_entry.offset && !curr_entry.resource_id &&
+                (curr_entry.offset == curr_entry.length)) {
+                break;
+            }
+            index_entries.push_back(curr_entry);
+            index_end += sizeof(ExeEntry);
         }
-
-        std::cerr << "Failed to find index in exe" << std::endl;
-        return false;
+        index_entries_count = index_entries.size();
+        return true;
     }
 
     bool createPac() {
@@ -369,55 +524,45 @@ private:
             return false;
         }
 
-        uint32_t current_offset = 0;
-        std::vector<uint8_t> padding(ALIGNMENT, 0);
-
-        // 处理每个文件
+        // 输入文件由 PackPipeline 的工作线程读入，按索引顺序写出并按格式对齐
+        std::vector<PackItem> items(index_entries_count);
         for (size_t i = 0; i < index_entries_count; ++i) {
             // 构造输入文件名
             std::stringstream ss;
             ss << "script" << std::setfill('0') << std::setw(5) << (i + 1) << ".bin";
-            fs::path input_file = input_dir / ss.str();
-
-            // 读取输入文件
-            std::ifstream input(input_file, std::ios::binary);
-            if (!input) {
-                std::cerr << "Failed to open input file: " << input_file << std::endl;
-                return false;
-            }
-
-            // 获取文件大小
-            input.seekg(0, std::ios::end);
-            uint32_t file_size = static_cast<uint32_t>(input.tellg());
-            input.seekg(0, std::ios::beg);
-
-            // 读取文件数据
-            std::vector<uint8_t> file_data(file_size);
-            input.read(reinterpret_cast<char*>(file_data.data()), file_size);
-
-            // 更新索引信息
-            index_entries[i].offset = current_offset;
-            index_entries[i].length = file_size;
-            index_entries[i].is_compressed = 0;  // 设置为不压缩
-
-            // 写入文件数据
-            pac_file.write(reinterpret_cast<char*>(file_data.data()), file_size);
-
-            // 计算需要的填充大小
-            uint32_t aligned_offset = (current_offset + file_size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
-            uint32_t padding_size = aligned_offset - (current_offset + file_size);
+            items[i].name = ss.str();
+            items[i].path = input_dir / items[i].name;
+        }
 
-            // 写入填充数据
-            if (padding_size > 0) {
-                pac_file.write(reinterpret_cast<char*>(padding.data()), padding_size);
+        PackHooks<PackItem> hooks;
+        const uint64_t align_mask = alignment - 1;
+        hooks.align = [align_mask](const PackItem&, uint64_t offset) {
+            return (offset + align_mask) & ~align_mask;
+        };
+        hooks.written = [](const PackItem& item) {
+            std::cout << "Packed file \"" << item.name << "\""
+                << " at offset 0x" << std::hex << item.offset
+                << " (size: 0x" << item.size << ")" << std::endl;
+        };
+        // 最后一个文件之后同样补齐到对齐边界，再更新索引信息
+        hooks.emitIndex = [&](std::ostream& out, std::vector<PackItem>& items, uint64_t data_end) {
+            uint64_t aligned_end = (data_end + align_mask) & ~align_mask;
+            std::vector<char> padding((size_t)(aligned_end - data_end), 0);
+            out.write(padding.data(), padding.size());
+
+            for (size_t i = 0; i < items.size(); ++i) {
+                index_entries[i].offset = static_cast<uint32_t>(items[i].offset);
+                index_entries[i].length = static_cast<uint32_t>(items[i].size);
+                index_entries[i].is_compressed = 0;  // 设置为不压缩
             }
+        };
 
-            // 更新偏移
-            current_offset = aligned_offset;
-
-            std::cout << "Packed file " << input_file.filename()
-                << " at offset 0x" << std::hex << index_entries[i].offset
-                << " (size: 0x" << file_size << ")" << std::endl;
+        try {
+            runPackPipeline(pac_file, items, 0, hooks, num_threads);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
         }
 
         pac_file.close();
@@ -429,8 +574,16 @@ private:
 
         // 更新exe中的索引数据
         if (index_location) {
-            std::memcpy(index_location, index_entries.data(),
-                index_entries.size() * sizeof(ExeEntry));
+            for (size_t i = 0; i < index_entries.size(); ++i) {
+                const ExeEntry& entry = index_entries[i];
+                if (old_format) {
+                    OldExeEntry old_entry = { entry.offset, entry.length, entry.is_compressed, entry.resource_id };
+                    std::memcpy(index_location + i * sizeof(OldExeEntry), &old_entry, sizeof(old_entry));
+                }
+                else {
+                    std::memcpy(index_location + i * sizeof(ExeEntry), &entry, sizeof(entry));
+                }
+            }
         }
 
         // 写入新的exe文件
@@ -449,26 +602,40 @@ private:
 };
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
+    // 可选的 --threads N 紧跟在模式之后
+    std::vector<std::string> args(argv + 1, argv + argc);
+    unsigned int num_threads = 0;
+    bool bad_threads = false;
+    if (args.size() == 6 && args[1] == "--threads") {
+        // 非数字、超出范围或为 0 时打印用法
+        const std::string& value = args[2];
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), num_threads);
+        bad_threads = ec != std::errc() || ptr != value.data() + value.size() || num_threads == 0;
+        args.erase(args.begin() + 1, args.begin() + 3);
+    }
+
+    if (bad_threads || args.size() != 4) {
         std::cout << "Made by julixian 2025.01.12" << std::endl;
-        std::cout << "Usage: " << argv[0] << " <mode> <exe_path> <pac_path/input_dir> <release_dir>\n"
+        std::cout << "Usage: " << argv[0] << " <mode> [--threads N] <exe_path> <pac_path/input_dir> <release_dir>\n"
             << "Modes:\n"
             << "  -u    Unpack script.pac\n"
             << "  -p    Pack files into script.pac\n"
+            << "Options:\n"
+            << "  --threads N    worker threads, default hardware concurrency\n"
             << "Examples:\n"
             << "  Unpack: " << argv[0] << " -u game.exe script.pac output_dir\n"
             << "  Pack:   " << argv[0] << " -p game.exe input_dir output_dir\n";
         return 1;
     }
 
-    std::string mode = argv[1];
-    fs::path exe_path = argv[2];
-    fs::path input_path = argv[3];
-    fs::path output_dir = argv[4];
+    std::string mode = args[0];
+    fs::path exe_path = args[1];
+    fs::path input_path = args[2];
+    fs::path output_dir = args[3];
 
     if (mode == "-u") {
         // 解包模式
-        PacExtractor extractor(exe_path.string(), input_path.string(), output_dir.string());
+        PacExtractor extractor(exe_path.string(), input_path.string(), output_dir.string(), num_threads);
         if (!extractor.initialize()) {
             std::cerr << "Failed to initialize extractor" << std::endl;
             return 1;
@@ -483,7 +650,7 @@ int main(int argc, char* argv[]) {
     }
     else if (mode == "-p") {
         // 封包模式
-        PacPacker packer(exe_path, input_path, output_dir);
+        PacPacker packer(exe_path, input_path, output_dir, num_threads);
         if (!packer.execute()) {
             std::cerr << "Packing failed" << std::endl;
             return 1;
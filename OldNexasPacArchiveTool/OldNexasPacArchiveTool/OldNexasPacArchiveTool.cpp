@@ -5,8 +5,19 @@
 #include <string>
 #include <filesystem>
 #include <algorithm>
+#include <span>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <charconv>
+#define NOMINMAX
 #include <Windows.h>
 #include <string.h>
+#include "../../MappedFile.h"
+#include "../../ThreadCount.h"
 
 namespace fs = std::filesystem;
 
@@ -36,70 +47,146 @@ struct FileEntry {
     uint32_t fileSize;
 };
 
-bool extractPackage(const std::string& packagePath, const std::string& outputDir) {
+// 索引为连续的 [文件名 ^ 0xFF, '\0'] [offset] [size]，一次扫完，不再为每个条目单独读取
+std::vector<FileEntry> parseIndex(std::span<const uint8_t> index, uint64_t dataSize) {
+    std::vector<FileEntry> entries;
+    std::string fileName;
+    size_t i = 0;
+    while (i < index.size()) {
+        const uint8_t* nameBegin = index.data() + i;
+        const uint8_t* nameEnd = (const uint8_t*)memchr(nameBegin, 0, index.size() - i);
+        if (nameEnd == nullptr || (size_t)(nameEnd - index.data()) + 9 > index.size()) {
+            char message[64];
+            snprintf(message, sizeof(message), "Corrupted index at 0x%llX", (unsigned long long)(i + 7));
+            throw std::runtime_error(message);
+        }
+        fileName.resize(nameEnd - nameBegin);
+        std::transform(nameBegin, nameEnd, fileName.begin(), [](uint8_t ch) { return (char)(ch ^ 0xFF); });
+        i = nameEnd - index.data() + 1;
 
-    std::ifstream packageFile(packagePath, std::ios::binary);
-    if (!packageFile) {
-        std::cerr << "Error: Could not open package file: " << AsciiToAscii(packagePath, CP_ACP, 65001) << std::endl;
-        return false;
+        FileEntry entry;
+        entry.fileName = AsciiToWide(fileName, 932);
+        memcpy(&entry.offset, index.data() + i, 4);
+        memcpy(&entry.fileSize, index.data() + i + 4, 4);
+        i += 8;
+        if ((uint64_t)entry.offset + entry.fileSize > dataSize) {
+            throw std::runtime_error("Entry out of range: " + WideToAscii(entry.fileName, 65001));
+        }
+        entries.push_back(std::move(entry));
     }
-    char header[3];
-    packageFile.read(header, 3);
-    if (std::strncmp(header, "PAC", 3) != 0) {
-        std::cerr << "Error: Invalid package format. Expected 'PAC' header." << std::endl;
+    return entries;
+}
+
+bool extractPackage(const std::string& packagePath, const std::string& outputDir, bool verbose, unsigned int numThreads) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<FileEntry> entries;
+    std::unique_ptr<MappedFile> package;
+    uint32_t dataBase = 0;
+    try {
+        package = std::make_unique<MappedFile>(AsciiToWide(packagePath, CP_ACP));
+        if (package->fileSize() < 7 || std::strncmp((const char*)package->data(), "PAC", 3) != 0) {
+            std::cerr << "Error: Invalid package format. Expected 'PAC' header." << std::endl;
+            return false;
+        }
+        memcpy(&dataBase, package->data() + 3, 4);
+        if (dataBase < 7 || dataBase > package->fileSize()) {
+            std::cerr << "Error: Invalid data offset 0x" << std::hex << dataBase << std::dec << std::endl;
+            return false;
+        }
+        entries = parseIndex({ package->data() + 7, dataBase - 7u }, package->fileSize() - dataBase);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return false;
     }
-    uint32_t dataBase;
-    packageFile.read(reinterpret_cast<char*>(&dataBase), 4);
 
-    std::vector<FileEntry> entries;
-    std::vector<uint8_t> indexData(dataBase - 0x7);
-    packageFile.read((char*)indexData.data(), dataBase - 0x7);
-    for (size_t i = 0; i < indexData.size();) {
-        FileEntry entry;
-        std::string fileName((char*)&indexData[i]);
-        for (auto& ch : fileName) {
-            ch ^= 0xFF;
+    if (verbose) {
+        for (const auto& entry : entries) {
+            std::cout << "Processing: " << WideToAscii(entry.fileName, 65001) << "\n"
+                << "offset: 0x" << std::hex << entry.offset << "\n"
+                << "fileSize: 0x" << entry.fileSize << std::dec << "\n";
         }
-        entry.fileName = AsciiToWide(fileName, 932);
-        i += fileName.length();
-        i++;
-        entry.offset = *(uint32_t*)&indexData[i];
-        i += 4;
-        entry.fileSize = *(uint32_t*)&indexData[i];
-        i += 4;
-        entries.push_back(entry);
-        std::cout << "Processing: " << AsciiToAscii(fileName, 932, 65001) << "\n"
-            << "offset: 0x" << std::hex << entry.offset << "\n"
-            << "fileSize: 0x" << std::hex << entry.fileSize << std::endl;
+        std::cout.flush();
     }
 
+    // 目录先在主线程中建好，写线程只负责写文件
+    fs::path outputRoot(AsciiToWide(outputDir, CP_ACP));
+    std::vector<fs::path> outputPaths;
+    outputPaths.reserve(entries.size());
     for (const auto& entry : entries) {
-
-        std::vector<uint8_t> fileData(entry.fileSize);
-        packageFile.seekg(entry.offset + dataBase);
-        packageFile.read(reinterpret_cast<char*>(fileData.data()), entry.fileSize);
-        for (size_t j = 0; j < 3; j++) {
-            fileData[j] ^= 0xFF;
+        outputPaths.push_back(outputRoot / entry.fileName);
+    }
+    {
+        std::vector<fs::path> parents;
+        for (const auto& path : outputPaths) {
+            parents.push_back(path.parent_path());
         }
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+        for (const auto& dir : parents) {
+            std::error_code ec;
+            fs::create_directories(dir, ec);
+        }
+    }
+
+    if (numThreads == 0) {
+        numThreads = defaultThreadCount();
+    }
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(entries.size(), 1));
+
+    const uint8_t* data = package->data() + dataBase;
+    std::atomic<size_t> nextEntry{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::mutex outputMutex;
+
+    // 只有前 3 个字节需要异或，其余部分直接从映射写出
+    auto worker = [&]() {
+        for (size_t i = nextEntry++; i < entries.size(); i = nextEntry++) {
+            const FileEntry& entry = entries[i];
+            const uint8_t* src = data + entry.offset;
+            uint8_t head[3];
+            size_t headSize = std::min<size_t>(3, entry.fileSize);
+            for (size_t j = 0; j < headSize; j++) {
+                head[j] = src[j] ^ 0xFF;
+            }
 
-        std::wstring fullPath = AsciiToWide(outputDir, CP_ACP) + L"\\" + entry.fileName;
-        std::filesystem::path filePath(fullPath);
-        std::filesystem::create_directories(filePath.parent_path());
-        std::ofstream outFile(fullPath, std::ios::binary);
-        if (!outFile) {
-            std::cerr << "Error: Could not create output file: " << WideToAscii(fullPath, 65001) << std::endl;
-            continue;
+            std::ofstream outFile(outputPaths[i], std::ios::binary);
+            if (outFile) {
+                outFile.write((const char*)head, headSize);
+                outFile.write((const char*)src + headSize, entry.fileSize - headSize);
+            }
+            if (!outFile) {
+                failed++;
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Error: Could not create output file: " << WideToAscii(outputPaths[i].wstring(), 65001) << std::endl;
+                continue;
+            }
+            outFile.close();
+            totalBytes += entry.fileSize;
+            if (verbose) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << "  Successfully extracted to: " << WideToAscii(outputPaths[i].wstring(), 65001) << std::endl;
+            }
         }
-        outFile.write(reinterpret_cast<char*>(fileData.data()), fileData.size());
-        outFile.close();
-        std::cout << "  Successfully extracted to: " << WideToAscii(fullPath, 65001) << std::endl;
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
     }
-    packageFile.close();
-    return true;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Extracted " << entries.size() - failed << "/" << entries.size() << " files, "
+        << totalBytes / 1048576.0 << " MB in " << seconds << " s" << std::endl;
+    return failed == 0;
 }
 
-bool createPackage(const std::string& inputDir, const std::string& packagePath) {
+bool createPackage(const std::string& inputDir, const std::string& packagePath, bool verbose) {
 
     if (!std::filesystem::exists(inputDir) || !std::filesystem::is_directory(inputDir)) {
         std::cerr << "Error: Input directory does not exist: " << AsciiToAscii(inputDir, CP_ACP, 65001) << std::endl;
@@ -123,42 +210,68 @@ bool createPackage(const std::string& inputDir, const std::string& packagePath)
         return false;
     }
 
-    packageFile.write("PAC", 3);
-    packageFile.seekp(0x7);
+    // 先在内存中算好整个索引和每个文件的偏移，文件头和索引一次写出，不再回填
+    std::vector<char> index(0x7);
+    std::vector<uint32_t> fileSizes;
+    fileSizes.reserve(files.size());
     uint32_t currentOffset = 0;
     for (fs::path& file : files) {
         std::string fileName = WideToAscii(fs::relative(file, inputDir).wstring(), 932);
         for (auto& ch : fileName) {
             ch ^= 0xFF;
         }
-        uint32_t fileSize = fs::file_size(file);
-        packageFile.write(fileName.c_str(), fileName.length() + 1);
-        packageFile.write((char*)&currentOffset, 4);
-        packageFile.write((char*)&fileSize, 4);
+        uint32_t fileSize = (uint32_t)fs::file_size(file);
+        index.insert(index.end(), fileName.c_str(), fileName.c_str() + fileName.length() + 1);
+        index.insert(index.end(), (const char*)&currentOffset, (const char*)&currentOffset + 4);
+        index.insert(index.end(), (const char*)&fileSize, (const char*)&fileSize + 4);
+        fileSizes.push_back(fileSize);
         currentOffset += fileSize;
     }
+    uint32_t dataBase = (uint32_t)index.size();
+    memcpy(index.data(), "PAC", 3);
+    memcpy(index.data() + 3, &dataBase, 4);
+    packageFile.write(index.data(), index.size());
 
-    uint32_t dataBase = packageFile.tellp();
-    packageFile.seekp(0x3);
-    packageFile.write((char*)&dataBase, 4);
-    packageFile.seekp(dataBase);
-
-    for (fs::path& file : files) {
-        std::ifstream ifs(file, std::ios::binary);
+    // 小文件攒进同一个缓冲区，大文件分块读入，缓冲区满了才写出
+    const size_t bufferSize = 8 * 1024 * 1024;
+    std::vector<char> buffer(bufferSize);
+    size_t buffered = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::ifstream ifs(files[i], std::ios::binary);
         if (!ifs) {
-            std::cout << "Fail to open: " << (char*)file.u8string().c_str() << std::endl;
+            std::cout << "Fail to open: " << (char*)files[i].u8string().c_str() << std::endl;
             return false;
         }
-        std::vector<uint8_t> fileData(fs::file_size(file));
-        ifs.read((char*)fileData.data(), fileData.size());
-        ifs.close();
-        for (size_t j = 0; j < 3 && j < fileData.size(); j++) {
-            fileData[j] ^= 0xFF;
+        if (verbose) {
+            std::cout << "Adding: " << (char*)files[i].u8string().c_str() << " (" << fileSizes[i] << " bytes)" << std::endl;
+        }
+        size_t remaining = fileSizes[i];
+        size_t xored = 0;  // 文件开头已异或的字节数，前 3 字节可能跨过缓冲区边界
+        while (remaining > 0) {
+            if (buffered == bufferSize) {
+                packageFile.write(buffer.data(), buffered);
+                buffered = 0;
+            }
+            size_t chunk = std::min(remaining, bufferSize - buffered);
+            if (!ifs.read(buffer.data() + buffered, chunk)) {
+                std::cerr << "Error: File changed while packing: " << (char*)files[i].u8string().c_str() << std::endl;
+                return false;
+            }
+            size_t filePos = fileSizes[i] - remaining;
+            for (; xored < 3 && xored < filePos + chunk; xored++) {
+                buffer[buffered + (xored - filePos)] ^= 0xFF;
+            }
+            buffered += chunk;
+            remaining -= chunk;
         }
-        packageFile.write((char*)fileData.data(), fileData.size());
     }
+    packageFile.write(buffer.data(), buffered);
 
     packageFile.close();
+    if (!packageFile) {
+        std::cerr << "Error: Failed to write package file: " << AsciiToAscii(packagePath, CP_ACP, 65001) << std::endl;
+        return false;
+    }
     std::cout << "Package created successfully: " << AsciiToAscii(packagePath, CP_ACP, 65001) << std::endl;
     return true;
 }
@@ -166,21 +279,47 @@ bool createPackage(const std::string& inputDir, const std::string& packagePath)
 void printUsage(const char* programName) {
     std::cout << "Made by julixian 2025.05.22" << std::endl;
     std::cout << "Usage:" << std::endl;
-    std::cout << "For extract: " << AsciiToAscii(programName, CP_ACP, 65001) << " -e <package_file> <output_directory>" << std::endl;
-    std::cout << "For pack:  " << AsciiToAscii(programName, CP_ACP, 65001) << " -p <input_directory> <package_file>" << std::endl;
+    std::cout << "For extract: " << AsciiToAscii(programName, CP_ACP, 65001) << " [-v] [--threads N] -e <package_file> <output_directory>" << std::endl;
+    std::cout << "For pack:  " << AsciiToAscii(programName, CP_ACP, 65001) << " [-v] -p <input_directory> <package_file>" << std::endl;
+    std::cout << "  -v           Print every entry (default: summary only)" << std::endl;
+    std::cout << "  --threads N  Number of writer threads for extraction (default: CPU count)" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     system("chcp 65001");
-    if (argc != 4) {
+    bool verbose = false;
+    unsigned int numThreads = 0;
+    int argi = 1;
+    while (argi < argc) {
+        std::string opt = argv[argi];
+        if (opt == "-v") {
+            verbose = true;
+            argi++;
+        }
+        else if (opt == "--threads" && argi + 1 < argc) {
+            // 非数字、超出范围或为 0 时打印用法
+            const char* value = argv[argi + 1];
+            const char* end = value + strlen(value);
+            auto [ptr, ec] = std::from_chars(value, end, numThreads);
+            if (ec != std::errc() || ptr != end || numThreads == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            argi += 2;
+        }
+        else {
+            break;
+        }
+    }
+    if (argc - argi != 3) {
         printUsage(argv[0]);
         return 1;
     }
-    std::string mode = argv[1];
-    std::string path1 = argv[2];
-    std::string path2 = argv[3];
+    std::string mode = argv[argi];
+    std::string path1 = argv[argi + 1];
+    std::string path2 = argv[argi + 2];
     if (mode == "-e") {
-        if (extractPackage(path1, path2)) {
+        if (extractPackage(path1, path2, verbose, numThreads)) {
             std::cout << "Extraction completed successfully!" << std::endl;
             return 0;
         }
@@ -190,7 +329,7 @@ int main(int argc, char* argv[]) {
         }
     }
     else if (mode == "-p") {
-        if (createPackage(path1, path2)) {
+        if (createPackage(path1, path2, verbose)) {
             std::cout << "Package created successfully!" << std::endl;
             return 0;
         }
@@ -5,7 +5,15 @@
 #include <string>
 #include <cstring>
 #include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <emmintrin.h>
 #include <png.h>
+#include "../../ThreadCount.h"
+
+namespace fs = std::filesystem;
 
 // 常量定义
 constexpr int GR2_VERSION = 2;
@@ -15,6 +23,40 @@ constexpr int COUNT_MASK = 0x1F;
 constexpr int WINDOW_SIZE = 2048;
 constexpr int MAX_MATCH = 32;
 constexpr int MIN_MATCH = 3;
+constexpr int HASH_BITS = 14;
+constexpr int HASH_SIZE = 1 << HASH_BITS;
+constexpr int MAX_CHAIN = 256;
+
+// 将 RGBX 像素 (每像素 4 字节) 转换为小端序 RGB565，SSE2 一次处理 8 个像素
+void pack_rgb565(const uint8_t* rgbx, uint8_t* out, size_t pixel_count) {
+    const __m128i mask_r = _mm_set1_epi32(0x000000F8);
+    const __m128i mask_g = _mm_set1_epi32(0x0000FC00);
+    const __m128i mask_b = _mm_set1_epi32(0x00F80000);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+
+    auto to565 = [&](__m128i v) {
+        __m128i r = _mm_slli_epi32(_mm_and_si128(v, mask_r), 8);
+        __m128i g = _mm_srli_epi32(_mm_and_si128(v, mask_g), 5);
+        __m128i b = _mm_srli_epi32(_mm_and_si128(v, mask_b), 19);
+        // packs_epi32 是有符号饱和，先减去 0x8000 再打包，打包后再加回
+        return _mm_sub_epi32(_mm_or_si128(r, _mm_or_si128(g, b)), bias32);
+    };
+
+    size_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        __m128i lo = to565(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbx + i * 4)));
+        __m128i hi = to565(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbx + i * 4 + 16)));
+        __m128i packed = _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), packed);
+    }
+    for (; i < pixel_count; i++) {
+        const uint8_t* p = rgbx + i * 4;
+        uint16_t rgb565 = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+        out[i * 2] = rgb565 & 0xFF;
+        out[i * 2 + 1] = (rgb565 >> 8) & 0xFF;
+    }
+}
 
 // 写入小端序16位值
 void write_uint16_le(std::ofstream& file, uint16_t value) {
@@ -41,7 +83,9 @@ private:
     int height = 0;
     std::vector<uint8_t> raw_data;
     std::vector<uint8_t> compressed_data;
-    std::vector<bool> control_bits;
+    std::vector<uint8_t> control_bytes;
+    uint32_t control_bit_count = 0;
+    bool verbose = true;
 
     // 读取PNG图像
     bool load_png() {
@@ -110,130 +154,116 @@ private:
             png_set_gray_to_rgb(png_ptr);
         if (color_type & PNG_COLOR_MASK_ALPHA)
             png_set_strip_alpha(png_ptr);
+        png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
 
         // 更新信息
         png_read_update_info(png_ptr, info_ptr);
 
-        // 获取更新后的行字节数
-        png_size_t rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-
-        // 分配内存存储图像数据
-        png_bytep* row_pointers = new png_bytep[height];
+        // 读入一整块连续的 RGBX 缓冲区，每像素 4 字节便于 SIMD 转换
+        std::vector<uint8_t> rgbx((size_t)width * height * 4);
+        std::vector<png_bytep> row_pointers(height);
         for (int y = 0; y < height; y++) {
-            row_pointers[y] = new png_byte[rowbytes];
+            row_pointers[y] = rgbx.data() + (size_t)y * width * 4;
         }
 
         // 读取图像数据
-        png_read_image(png_ptr, row_pointers);
-
-        // 转换为RGB565格式
-        raw_data.resize(width * height * 2); // 16位 = 2字节/像素
-
-        for (int y = 0; y < height; y++) {
-            png_bytep row = row_pointers[y];
-            for (int x = 0; x < width; x++) {
-                // 确保我们处理的是RGB格式
-                uint8_t r = row[x * 3];     // 红色分量
-                uint8_t g = row[x * 3 + 1]; // 绿色分量
-                uint8_t b = row[x * 3 + 2]; // 蓝色分量
-
-                // 转换为RGB565格式 (5位R, 6位G, 5位B)
-                uint8_t r5 = (r >> 3) & 0x1F;
-                uint8_t g6 = (g >> 2) & 0x3F;
-                uint8_t b5 = (b >> 3) & 0x1F;
-
-                // 组合为16位值 (RGB565)
-                uint16_t rgb565 = (r5 << 11) | (g6 << 5) | b5;
-
-                // 存储为小端序
-                int idx = (y * width + x) * 2;
-                raw_data[idx] = rgb565 & 0xFF;
-                raw_data[idx + 1] = (rgb565 >> 8) & 0xFF;
-            }
-        }
+        png_read_image(png_ptr, row_pointers.data());
 
-        // 清理
-        for (int y = 0; y < height; y++) {
-            delete[] row_pointers[y];
-        }
-        delete[] row_pointers;
+        // 转换为RGB565格式 (5位R, 6位G, 5位B)，小端序
+        raw_data.resize((size_t)width * height * 2); // 16位 = 2字节/像素
+        pack_rgb565(rgbx.data(), raw_data.data(), (size_t)width * height);
 
         png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
         fclose(fp);
 
-        std::cout << "图像信息: " << width << "x" << height << ", 将转换为16位RGB565" << std::endl;
+        if (verbose) {
+            std::cout << "图像信息: " << width << "x" << height << ", 将转换为16位RGB565" << std::endl;
+        }
         return true;
     }
 
     // 压缩数据
+    // 哈希链查找 2048 字节窗口内的最长匹配，控制位在生成时直接写入控制字节 (LSB 优先，1 = 引用)
     bool compress_lz77() {
         if (raw_data.empty()) {
             std::cerr << "没有原始数据可压缩" << std::endl;
             return false;
         }
 
+        const uint8_t* src = raw_data.data();
+        size_t data_len = raw_data.size();
+
         compressed_data.clear();
-        control_bits.clear();
+        compressed_data.reserve(data_len);
+        control_bytes.clear();
+        control_bytes.reserve(data_len / 8 + 1);
+        control_bit_count = 0;
 
-        size_t pos = 0;
-        size_t data_len = raw_data.size();
+        std::vector<int32_t> head(HASH_SIZE, -1);
+        std::vector<int32_t> prev(WINDOW_SIZE, -1);
+        auto hash3 = [](const uint8_t* p) {
+            return (uint32_t)((p[0] << 9) ^ (p[1] << 4) ^ p[2]) & (HASH_SIZE - 1);
+        };
 
+        size_t pos = 0;
         while (pos < data_len) {
-            // 查找最佳匹配
+            // 查找最佳匹配，链表从近到远，等长时保留偏移小的
             int best_length = 0;
             int best_offset = 0;
-
-            // 限制回溯窗口大小为2048
-            size_t search_start = (pos > WINDOW_SIZE) ? pos - WINDOW_SIZE : 0;
-
-            // 尝试找到最长匹配
-            if (pos < data_len - MIN_MATCH + 1) {
-                for (size_t offset = 1; offset <= pos - search_start; offset++) {
-                    // 计算可能的匹配长度
-                    size_t match_pos = pos - offset;
-                    int match_len = 0;
-
-                    while (pos + match_len < data_len &&
-                        match_len < MAX_MATCH &&
-                        raw_data[match_pos + match_len] == raw_data[pos + match_len]) {
-                        match_len++;
+            int max_length = (int)std::min<size_t>(MAX_MATCH, data_len - pos);
+
+            if (max_length >= MIN_MATCH) {
+                int32_t candidate = head[hash3(src + pos)];
+                for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; chain++) {
+                    size_t match_pos = (size_t)candidate;
+                    if (pos - match_pos > WINDOW_SIZE) break;
+
+                    if (src[match_pos + best_length] == src[pos + best_length]) {
+                        int match_len = 0;
+                        while (match_len < max_length && src[match_pos + match_len] == src[pos + match_len]) {
+                            match_len++;
+                        }
+                        if (match_len > best_length) {
+                            best_length = match_len;
+                            best_offset = (int)(pos - match_pos);
+                            if (best_length == max_length) break;
+                        }
                     }
 
-                    // 如果找到更好的匹配
-                    if (match_len >= MIN_MATCH && match_len > best_length) {
-                        best_length = match_len;
-                        best_offset = offset;
-                    }
+                    int32_t next = prev[match_pos & (WINDOW_SIZE - 1)];
+                    if (next >= candidate) break; // 环形缓冲区中的旧链接已被覆盖
+                    candidate = next;
                 }
             }
 
-            // 输出匹配或字面量
-            if (best_length >= MIN_MATCH) {
-                // 确保长度不超过可表示的最大值
-                if (best_length > COUNT_MASK + 1) {
-                    best_length = COUNT_MASK + 1;
-                }
+            if ((control_bit_count & 7) == 0) {
+                control_bytes.push_back(0);
+            }
 
-                // 编码为引用 (5位长度，11位偏移)
+            size_t advance = 1;
+            if (best_length >= MIN_MATCH) {
+                // 编码为引用 (5位长度，11位偏移)，小端序
                 uint16_t offset_length = ((best_offset - 1) << COUNT_BITS) | ((best_length - 1) & COUNT_MASK);
-
-                // 存储为小端序
                 compressed_data.push_back(offset_length & 0xFF);
                 compressed_data.push_back((offset_length >> 8) & 0xFF);
 
-                // 添加控制位 1 (引用)
-                control_bits.push_back(true);
-
-                pos += best_length;
+                // 控制位 1 (引用)
+                control_bytes.back() |= (uint8_t)(1 << (control_bit_count & 7));
+                advance = best_length;
             }
             else {
-                // 直接输出字节
-                compressed_data.push_back(raw_data[pos]);
-
-                // 添加控制位 0 (字面量)
-                control_bits.push_back(false);
-
-                pos++;
+                // 直接输出字节，控制位 0 (字面量)
+                compressed_data.push_back(src[pos]);
+            }
+            control_bit_count++;
+
+            // 被匹配覆盖的位置同样要进入哈希链
+            for (size_t end = pos + advance; pos < end; pos++) {
+                if (pos + MIN_MATCH <= data_len) {
+                    uint32_t h = hash3(src + pos);
+                    prev[pos & (WINDOW_SIZE - 1)] = head[h];
+                    head[h] = (int32_t)pos;
+                }
             }
         }
 
@@ -242,7 +272,7 @@ private:
 
     // 创建GR2文件
     bool create_gr2_file(const std::string& output_file) {
-        if (compressed_data.empty() || control_bits.empty()) {
+        if (compressed_data.empty() || control_bytes.empty()) {
             std::cerr << "没有压缩数据" << std::endl;
             return false;
         }
@@ -263,17 +293,9 @@ private:
         write_uint32_le(file, raw_data.size());// 解压后大小
 
         // 写入控制位流长度 (位数)
-        write_uint32_le(file, control_bits.size());
+        write_uint32_le(file, control_bit_count);
 
         // 写入控制位流数据
-        std::vector<uint8_t> control_bytes((control_bits.size() + 7) / 8, 0);
-        for (size_t i = 0; i < control_bits.size(); i++) {
-            if (control_bits[i]) {
-                size_t byte_idx = i / 8;
-                size_t bit_idx = i % 8;
-                control_bytes[byte_idx] |= (1 << bit_idx);
-            }
-        }
         file.write(reinterpret_cast<char*>(control_bytes.data()), control_bytes.size());
 
         // 写入压缩流大小
@@ -284,6 +306,10 @@ private:
 
         file.close();
 
+        if (!verbose) {
+            return true;
+        }
+
         std::cout << "GR2文件已创建: " << output_file << std::endl;
         std::cout << "原始大小: " << raw_data.size() << " 字节" << std::endl;
         size_t total_compressed_size = compressed_data.size() + control_bytes.size() + 4;
@@ -295,7 +321,12 @@ private:
     }
 
 public:
-    PNG2GR2Converter(const std::string& input) : input_file(input) {}
+    PNG2GR2Converter(const std::string& input, bool verbose = true) : input_file(input), verbose(verbose) {}
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    size_t get_raw_size() const { return raw_data.size(); }
+    size_t get_compressed_size() const { return compressed_data.size() + control_bytes.size() + 4; }
 
     bool convert(const std::string& output_file) {
         try {
@@ -343,7 +374,70 @@ std::string get_file_basename(const std::string& filename) {
 
 void print_usage(const char* program_name) {
     std::cout << "用法: " << program_name << " <输入PNG文件> [输出GR2文件]" << std::endl;
+    std::cout << "      " << program_name << " <输入PNG目录> [输出目录]" << std::endl;
     std::cout << "如果未指定输出文件，将使用输入文件名并添加.grp扩展名" << std::endl;
+    std::cout << "如果未指定输出目录，GRP文件将写在PNG文件旁边" << std::endl;
+}
+
+// 批量转换目录下的所有PNG，每个文件互不相关，用多个线程并行处理
+int convert_directory(const fs::path& input_dir, const fs::path& output_dir) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(input_dir)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".png") {
+            files.push_back(entry.path());
+        }
+    }
+
+    unsigned int num_threads = defaultThreadCount();
+    num_threads = (unsigned int)std::min<size_t>(num_threads, std::max<size_t>(files.size(), 1));
+
+    std::atomic<size_t> next_file{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::atomic<size_t> total_raw{ 0 };
+    std::atomic<size_t> total_compressed{ 0 };
+    std::mutex output_mutex;
+
+    auto worker = [&]() {
+        for (size_t i = next_file++; i < files.size(); i = next_file++) {
+            fs::path relative = fs::relative(files[i], input_dir);
+            fs::path output_path = output_dir / relative;
+            output_path.replace_extension(".grp");
+
+            std::error_code ec;
+            fs::create_directories(output_path.parent_path(), ec);
+            PNG2GR2Converter converter(files[i].string(), false);
+            bool ok = converter.convert(output_path.string());
+
+            std::lock_guard<std::mutex> lock(output_mutex);
+            if (ok) {
+                total_raw += converter.get_raw_size();
+                total_compressed += converter.get_compressed_size();
+                std::cout << relative.string() << ": " << converter.get_width() << "x" << converter.get_height()
+                    << ", " << converter.get_raw_size() << " -> " << converter.get_compressed_size() << " 字节" << std::endl;
+            }
+            else {
+                failed++;
+                std::cerr << "转换失败: " << relative.string() << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::cout << "已转换 " << files.size() - failed << "/" << files.size() << " 个文件 (" << num_threads << " 线程), "
+        << total_raw << " -> " << total_compressed << " 字节" << std::endl;
+    return failed == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
@@ -356,6 +450,10 @@ int main(int argc, char* argv[]) {
     std::string input_file = argv[1];
     std::string output_file;
 
+    if (fs::is_directory(input_file)) {
+        return convert_directory(input_file, argc == 3 ? fs::path(argv[2]) : fs::path(input_file));
+    }
+
     // 确定输出文件名
     if (argc == 3) {
         output_file = argv[2];
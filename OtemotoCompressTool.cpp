@@ -4,6 +4,7 @@
 #include <cstring>
 #include <filesystem>
 #include <algorithm>
+#include "LzssDecoder.h"
 
 namespace fs = std::filesystem;
 
@@ -23,51 +24,6 @@ public:
     }
 };
 
-class LzssDecompressor {
-public:
-    LzssDecompressor(int frameSize = 0x1000, uint8_t frameFill = 0, int frameInitPos = 0xFEE)
-        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos) {}
-
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
-        int framePos = m_frameInitPos;
-        int frameMask = m_frameSize - 1;
-
-        size_t inputPos = 0;
-        while (inputPos < input.size()) {
-            uint8_t ctrl = input[inputPos++];
-            for (int bit = 1; bit != 0x100 && inputPos < input.size(); bit <<= 1) {
-                if (ctrl & bit) {
-                    uint8_t b = input[inputPos++];
-                    frame[framePos++ & frameMask] = b;
-                    output.push_back(b);
-                }
-                else {
-                    if (inputPos + 1 >= input.size()) break;
-                    uint8_t lo = input[inputPos++];
-                    uint8_t hi = input[inputPos++];
-                    int offset = ((hi & 0xf0) << 4) | lo;
-                    int count = 3 + (hi & 0xF);
-
-                    for (int i = 0; i < count; ++i) {
-                        uint8_t v = frame[offset++ & frameMask];
-                        frame[framePos++ & frameMask] = v;
-                        output.push_back(v);
-                    }
-                }
-            }
-        }
-
-        return output;
-    }
-
-private:
-    int m_frameSize;
-    uint8_t m_frameFill;
-    int m_frameInitPos;
-};
-
 bool isTargetFile(const fs::path& path) {
     std::string extension = path.extension().string();
     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
@@ -98,8 +54,7 @@ bool processFile(const fs::path& inputPath, const fs::path& outputPath, bool com
         outputData = compressor.compress(inputData);
     }
     else {
-        LzssDecompressor decompressor;
-        outputData = decompressor.decompress(inputData);
+        outputData = StandardLzssDecoder::decode(inputData);
     }
 
     std::ofstream output(outputPath, std::ios::binary);
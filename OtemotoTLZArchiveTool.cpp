@@ -5,6 +5,8 @@
 #include <cstdint>
 #include <filesystem>
 #include <algorithm>
+#include <memory>
+#include "MappedFile.h"
 
 namespace fs = std::filesystem;
 
@@ -16,60 +18,67 @@ struct Entry {
     uint32_t nameOffset;
 };
 
-class TlzExtractor {
-public:
-    bool openArchive(const std::string& filename) {
-        file.open(filename, std::ios::binary);
-        return file.is_open();
+// Parses the index straight from the mapped archive; nameOffset records where each entry sits
+bool readTlzIndex(const ByteSpan& archive, std::vector<Entry>& entries) {
+    if (!archive.contains(0, 0x10) || archive.u32le(0) != 0x315A4C54) { // 'TLZ1'
+        std::cerr << "Invalid TLZ file signature" << std::endl;
+        return false;
     }
 
-    bool extractFiles(const std::string& outputDir) {
-        if (!file.is_open()) return false;
-
-        uint32_t signature;
-        file.read(reinterpret_cast<char*>(&signature), sizeof(signature));
-        if (signature != 0x315A4C54) { // 'TLZ1'
-            std::cerr << "Invalid TLZ file signature" << std::endl;
-            return false;
-        }
-
-        uint32_t indexOffset;
-        file.seekg(4, std::ios::beg);
-        file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
-
-        int32_t count;
-        file.seekg(0xC, std::ios::beg);
-        file.read(reinterpret_cast<char*>(&count), sizeof(count));
-
-        if (count <= 0 || count > 10000) { // Sanity check
-            std::cerr << "Invalid file count" << std::endl;
-            return false;
-        }
+    uint32_t indexOffset = archive.u32le(4);
+    int32_t count = static_cast<int32_t>(archive.u32le(0xC));
 
-        std::vector<Entry> entries;
-        file.seekg(indexOffset, std::ios::beg);
+    if (count <= 0 || count > 10000) { // Sanity check
+        std::cerr << "Invalid file count" << std::endl;
+        return false;
+    }
 
+    try {
+        SpanReader index(archive, indexOffset);
         for (int i = 0; i < count; ++i) {
             Entry entry;
-            file.read(reinterpret_cast<char*>(&entry.unpackedSize), sizeof(entry.unpackedSize));
-            file.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
-            file.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
+            entry.nameOffset = static_cast<uint32_t>(index.tell());
+            entry.unpackedSize = index.u32le();
+            entry.size = index.u32le();
+            entry.offset = index.u32le();
 
-            uint32_t nameLength;
-            file.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
+            uint32_t nameLength = index.u32le();
             if (nameLength == 0 || nameLength > 0x100) {
                 std::cerr << "Invalid name length for entry " << i << std::endl;
                 return false;
             }
-
-            char* nameBuf = new char[nameLength + 1];
-            file.read(nameBuf, nameLength);
-            nameBuf[nameLength] = '\0';
-            entry.name = std::string(nameBuf);
-            delete[] nameBuf;
+            entry.name = index.str(nameLength);
 
             entries.push_back(entry);
         }
+    }
+    catch (const std::out_of_range&) {
+        std::cerr << "Truncated TLZ index" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+class TlzExtractor {
+public:
+    bool openArchive(const std::string& filename) {
+        try {
+            file = std::make_unique<MappedFile>(filename);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    bool extractFiles(const std::string& outputDir) {
+        if (!file) return false;
+
+        const ByteSpan archive = file->span();
+        std::vector<Entry> entries;
+        if (!readTlzIndex(archive, entries)) {
+            return false;
+        }
 
         fs::create_directories(outputDir);
 
@@ -81,10 +90,11 @@ public:
                 continue;
             }
 
-            file.seekg(entry.offset, std::ios::beg);
-            std::vector<char> buffer(entry.size);
-            file.read(buffer.data(), entry.size);
-            outFile.write(buffer.data(), entry.size);
+            if (!archive.contains(entry.offset, entry.size)) {
+                std::cerr << "Entry out of range: " << entry.name << std::endl;
+                continue;
+            }
+            outFile.write(reinterpret_cast<const char*>(archive.at(entry.offset, entry.size)), entry.size);
             outFile.close();
 
             std::cout << "Extracted: " << entry.name << std::endl;
@@ -93,71 +103,28 @@ public:
         return true;
     }
 
-    ~TlzExtractor() {
-        if (file.is_open()) file.close();
-    }
-
 private:
-    std::ifstream file;
+    std::unique_ptr<MappedFile> file;
 };
 
 class TlzUpdater {
 public:
     bool openArchive(const std::string& filename) {
         archiveName = filename;
+        // The index is parsed from a mapping that is closed again before the archive is opened for writing
+        try {
+            MappedFile mapping(filename);
+            indexLoaded = readTlzIndex(mapping.span(), entries);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
         file.open(filename, std::ios::binary | std::ios::in | std::ios::out);
         return file.is_open();
     }
 
     bool updateArchive(const std::string& updateDir) {
-        if (!file.is_open()) return false;
-
-        uint32_t signature;
-        file.read(reinterpret_cast<char*>(&signature), sizeof(signature));
-        if (signature != 0x315A4C54) { // 'TLZ1'
-            std::cerr << "Invalid TLZ file signature" << std::endl;
-            return false;
-        }
-
-        uint32_t indexOffset;
-        file.seekg(4, std::ios::beg);
-        file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
-
-        int32_t count;
-        file.seekg(0xC, std::ios::beg);
-        file.read(reinterpret_cast<char*>(&count), sizeof(count));
-
-        if (count <= 0 || count > 10000) { // Sanity check
-            std::cerr << "Invalid file count" << std::endl;
-            return false;
-        }
-
-        std::vector<Entry> entries;
-        file.seekg(indexOffset, std::ios::beg);
-
-        // Read original entries
-        for (int i = 0; i < count; ++i) {
-            Entry entry;
-            entry.nameOffset = file.tellg();
-            file.read(reinterpret_cast<char*>(&entry.unpackedSize), sizeof(entry.unpackedSize));
-            file.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
-            file.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
-
-            uint32_t nameLength;
-            file.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
-            if (nameLength == 0 || nameLength > 0x100) {
-                std::cerr << "Invalid name length for entry " << i << std::endl;
-                return false;
-            }
-
-            char* nameBuf = new char[nameLength + 1];
-            file.read(nameBuf, nameLength);
-            nameBuf[nameLength] = '\0';
-            entry.name = std::string(nameBuf);
-            delete[] nameBuf;
-
-            entries.push_back(entry);
-        }
+        if (!file.is_open() || !indexLoaded) return false;
 
         // Find the end of the last file
         uint32_t endOfLastFile = 0;
@@ -228,6 +195,8 @@ public:
 private:
     std::fstream file;
     std::string archiveName;
+    std::vector<Entry> entries;
+    bool indexLoaded = false;
 };
 
 void printUsage(const char* programName) {
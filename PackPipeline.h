@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ThreadCount.h"
+
+// 各“遍历目录 -> 读文件 -> 压缩/加密 -> 追加 -> 写索引”封包工具共用的流水线。
+// 原先这些工具都是单线程逐个文件 read/write，读盘和变换完全串行。这里拆成三段：
+//   scanPackDirectory  收集源文件，递归时每个顶层子目录由一个线程遍历，结果按原遍历顺序拼接
+//   工作线程           读入源文件 (item.path 非空时) 并执行格式自己的 transform，可以乱序完成
+//   写入线程           (调用者线程) 按条目顺序等待、对齐、分配偏移并写出，最后由 emitIndex 写索引
+// 写出顺序和偏移只由条目顺序决定，输出与单线程完全相同。
+// 在途条目数有上限，已写出的数据立即释放，大封包不会整个留在内存里。
+
+// 流水线条目，各格式继承后加上自己的索引字段
+struct PackItem {
+    std::filesystem::path path; // 源文件，为空时不读取，由 transform 填写 data
+    std::string name;           // 封包内名称
+    std::vector<uint8_t> data;  // 写入封包的数据，写出后释放
+    uint64_t offset = 0;        // 写入线程分配的偏移
+    uint64_t size = 0;          // 写出的字节数 (data 释放后仍可用)
+};
+
+template<typename Item>
+struct PackHooks {
+    // 工作线程中执行，可并行，只能修改传入的条目
+    std::function<void(Item&)> transform;
+    // 返回条目的起始偏移 (不小于 offset)，中间补 0；为空时紧接上一个条目
+    std::function<uint64_t(const Item&, uint64_t offset)> align;
+    // 条目写出后在写入线程中按顺序调用，用于输出日志
+    std::function<void(const Item&)> written;
+    // 全部数据写出后调用，dataEnd 为数据区末尾；索引在数据之前的格式自行 seekp 回去写
+    std::function<void(std::ostream&, std::vector<Item>&, uint64_t dataEnd)> emitIndex;
+};
+
+// 读入整个文件
+inline std::vector<uint8_t> readPackFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Can not read file: " + path.string());
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    std::vector<uint8_t> data((size_t)size);
+    if (size > 0 && !file.read(reinterpret_cast<char*>(data.data()), size)) {
+        throw std::runtime_error("Can not read file: " + path.string());
+    }
+    return data;
+}
+
+// 收集目录下的普通文件。
+// 非递归时与 directory_iterator 顺序相同；递归时与 recursive_directory_iterator 顺序相同
+// (先序遍历，不跟随目录符号链接)，只是各顶层子目录的遍历分给多个线程并行进行。
+inline std::vector<std::filesystem::path> scanPackDirectory(const std::filesystem::path& dir, bool recursive, unsigned int numThreads = 0) {
+    std::vector<std::filesystem::path> files;
+    if (!recursive) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.is_regular_file()) {
+                files.push_back(entry.path());
+            }
+        }
+        return files;
+    }
+
+    // 顶层条目：文件直接放入对应槽位，子目录留给线程遍历
+    struct Slot {
+        std::filesystem::path path;
+        bool isDirectory = false;
+        std::vector<std::filesystem::path> files;
+        std::exception_ptr error;
+    };
+    std::vector<Slot> slots;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        Slot slot;
+        slot.path = entry.path();
+        if (entry.is_regular_file()) {
+            slot.files.push_back(entry.path());
+        }
+        else if (entry.is_directory() && !entry.is_symlink()) {
+            slot.isDirectory = true;
+        }
+        else {
+            continue;
+        }
+        slots.push_back(std::move(slot));
+    }
+
+    std::atomic<size_t> nextSlot{ 0 };
+    auto worker = [&]() {
+        for (size_t i = nextSlot++; i < slots.size(); i = nextSlot++) {
+            Slot& slot = slots[i];
+            if (!slot.isDirectory) {
+                continue;
+            }
+            try {
+                for (const auto& entry : std::filesystem::recursive_directory_iterator(slot.path)) {
+                    if (entry.is_regular_file()) {
+                        slot.files.push_back(entry.path());
+                    }
+                }
+            }
+            catch (...) {
+                slot.error = std::current_exception();
+            }
+        }
+    };
+
+    if (numThreads == 0) {
+        numThreads = defaultThreadCount();
+    }
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(slots.size(), 1));
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (auto& slot : slots) {
+        if (slot.error) {
+            std::rethrow_exception(slot.error);
+        }
+        files.insert(files.end(), std::make_move_iterator(slot.files.begin()), std::make_move_iterator(slot.files.end()));
+    }
+    return files;
+}
+
+// 从 dataStart 开始按顺序写出所有条目，返回数据区末尾的偏移。
+// 任一条目读取或变换失败时停止所有线程并把异常抛给调用者。
+template<typename Item>
+uint64_t runPackPipeline(std::ostream& out, std::vector<Item>& items, uint64_t dataStart,
+    const PackHooks<Item>& hooks, unsigned int numThreads = 0) {
+    if (numThreads == 0) {
+        numThreads = defaultThreadCount();
+    }
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(items.size(), 1));
+    // 在途 (已领取但未写出) 的条目上限
+    const size_t window = std::max<size_t>((size_t)numThreads * 4, 16);
+
+    std::vector<char> ready(items.size(), 0);
+    std::vector<std::exception_ptr> errors(items.size());
+    std::atomic<size_t> nextItem{ 0 };
+    size_t writtenCount = 0;
+    bool abort = false;
+    std::mutex mutex;
+    std::condition_variable readyCond;
+    std::condition_variable writtenCond;
+
+    auto worker = [&]() {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                i = nextItem++;
+                if (i >= items.size()) {
+                    return;
+                }
+                writtenCond.wait(lock, [&]() { return abort || i < writtenCount + window; });
+                if (abort) {
+                    return;
+                }
+            }
+
+            std::exception_ptr error;
+            try {
+                Item& item = items[i];
+                if (!item.path.empty()) {
+                    item.data = readPackFile(item.path);
+                }
+                if (hooks.transform) {
+                    hooks.transform(item);
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            errors[i] = error;
+            ready[i] = 1;
+            readyCond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+
+    auto stop = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+        }
+        writtenCond.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    };
+
+    uint64_t offset = dataStart;
+    try {
+        out.seekp(dataStart);
+        for (size_t i = 0; i < items.size(); ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                readyCond.wait(lock, [&]() { return ready[i] != 0; });
+                if (errors[i]) {
+                    std::rethrow_exception(errors[i]);
+                }
+            }
+
+            Item& item = items[i];
+            if (hooks.align) {
+                uint64_t aligned = hooks.align(item, offset);
+                if (aligned > offset) {
+                    std::vector<char> padding((size_t)(aligned - offset), 0);
+                    out.write(padding.data(), padding.size());
+                    offset = aligned;
+                }
+            }
+            item.offset = offset;
+            item.size = item.data.size();
+            out.write(reinterpret_cast<const char*>(item.data.data()), item.data.size());
+            if (!out) {
+                throw std::runtime_error("Failed to write archive data: " + item.name);
+            }
+            offset += item.size;
+            std::vector<uint8_t>().swap(item.data);
+
+            if (hooks.written) {
+                hooks.written(item);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++writtenCount;
+            }
+            writtenCond.notify_all();
+        }
+    }
+    catch (...) {
+        stop();
+        throw;
+    }
+    stop();
+
+    if (hooks.emitIndex) {
+        hooks.emitIndex(out, items, offset);
+    }
+    return offset;
+}
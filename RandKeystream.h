@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <emmintrin.h>
+
+// MSVC rand() 的密钥流：srand(seed) 后第 i 个字节为 key[rand() % key.length()]。
+// rand() 只有 15 位，取模预先做成 32768 项的表；LCG 用跳跃公式 x(n+8) = A8 * x(n) + C8
+// 同时推进 8 路状态，打破逐字节的乘法依赖链
+class RandKeystream {
+public:
+    explicit RandKeystream(const std::string& key) : m_table(0x8000) {
+        for (uint32_t r = 0; r < 0x8000; ++r) {
+            m_table[r] = static_cast<uint8_t>(key[r % key.length()]);
+        }
+    }
+
+    void generate(int seed, uint8_t* out, size_t count) const {
+        constexpr uint32_t A = 214013u;
+        constexpr uint32_t C = 2531011u;
+        constexpr int Lanes = 8;
+
+        alignas(16) uint32_t state[Lanes];
+        uint32_t x = static_cast<uint32_t>(seed);
+        uint32_t a8 = 1, c8 = 0;
+        for (int l = 0; l < Lanes; ++l) {
+            x = x * A + C;
+            state[l] = x;
+            a8 *= A;
+            c8 = c8 * A + C;
+        }
+
+        __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(state));
+        __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(state + 4));
+        const __m128i mulA = _mm_set1_epi32(static_cast<int>(a8));
+        const __m128i addC = _mm_set1_epi32(static_cast<int>(c8));
+        const __m128i mask = _mm_set1_epi32(0x7FFF);
+        alignas(16) uint32_t r[Lanes];
+
+        for (size_t i = 0; i < count; i += Lanes) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(r), _mm_and_si128(_mm_srli_epi32(lo, 16), mask));
+            _mm_store_si128(reinterpret_cast<__m128i*>(r + 4), _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+            size_t n = std::min<size_t>(Lanes, count - i);
+            for (size_t l = 0; l < n; ++l) {
+                out[i + l] = m_table[r[l]];
+            }
+            lo = _mm_add_epi32(mullo32(lo, mulA), addC);
+            hi = _mm_add_epi32(mullo32(hi, mulA), addC);
+        }
+    }
+
+private:
+    // SSE2 没有 32 位低位乘法，用两次 _mm_mul_epu32 拼出来
+    static __m128i mullo32(__m128i a, __m128i b) {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    std::vector<uint8_t> m_table;
+};
@@ -13,6 +13,7 @@
 #include <string>
 #include <unordered_set>
 #include <vector>
+#include "../../ScriptServer.h"
 
 namespace fs = std::filesystem;
 
@@ -591,11 +592,8 @@ private:
 // Dump
 // =========================
 
-static void dumpText(const fs::path& inputPath, const fs::path& outputPath, UINT codePage)
+static void dumpText(const ScanResult& scan, const fs::path& outputPath, UINT codePage)
 {
-    std::vector<uint8_t> buf = readAllBytes(inputPath);
-    ScanResult scan = scanScript(buf);
-
     std::ofstream out(outputPath, std::ios::binary);
     if (!out) {
         throw std::runtime_error("Cannot open output: " + outputPath.string());
@@ -620,16 +618,19 @@ static void dumpText(const fs::path& inputPath, const fs::path& outputPath, UINT
     std::cout << "     TXT encoding: UTF-8\n";
 }
 
+static void dumpText(const fs::path& inputPath, const fs::path& outputPath, UINT codePage)
+{
+    std::vector<uint8_t> buf = readAllBytes(inputPath);
+    dumpText(scanScript(buf), outputPath, codePage);
+}
+
 // =========================
 // Inject
 // =========================
 
-static void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath, UINT codePage)
+static void injectText(const std::vector<uint8_t>& buf, const ScanResult& scan, std::string txtRaw, const fs::path& outputBinPath, UINT codePage)
 {
-    std::vector<uint8_t> buf = readAllBytes(inputBinPath);
-    ScanResult scan = scanScript(buf);
-
-    std::vector<std::string> lines = splitLinesUtf8(readAllTextBinary(inputTxtPath));
+    std::vector<std::string> lines = splitLinesUtf8(std::move(txtRaw));
     if (lines.size() != scan.slots.size()) {
         std::ostringstream oss;
         oss << "Text count mismatch. Script needs " << scan.slots.size()
@@ -898,6 +899,54 @@ static void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPat
     }
 }
 
+static void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath, UINT codePage)
+{
+    std::vector<uint8_t> buf = readAllBytes(inputBinPath);
+    ScanResult scan = scanScript(buf);
+    injectText(buf, scan, readAllTextBinary(inputTxtPath), outputBinPath, codePage);
+}
+
+// =========================
+// Serve
+// =========================
+
+// Resident mode: scan results are cached by script content hash, requests whose inputs did not change are skipped
+static int serveScripts()
+{
+    ScriptServer server("SAS5OldScriptFixed");
+    ScriptParseCache<ScanResult> scans;
+
+    // {"input": script.bin, "output": out.txt, "code_page": 932}
+    server.on("dump", [&](ScriptCall& call) {
+        auto input = call.input(call.path("input"));
+        fs::path outputPath = call.output(call.path("output"));
+        UINT codePage = static_cast<UINT>(call.integer("code_page", 932));
+        if (call.upToDate()) {
+            return;
+        }
+        auto scan = scans.get(input->hash, [&]() { return scanScript(input->bytes); });
+        dumpText(*scan, outputPath, codePage);
+        call.result("texts", static_cast<long long>(scan->slots.size()));
+    });
+
+    // {"input": script.bin, "text": in.txt, "output": new.bin, "code_page": 932}
+    server.on("inject", [&](ScriptCall& call) {
+        auto inputBin = call.input(call.path("input"));
+        auto inputTxt = call.input(call.path("text"));
+        fs::path outputBinPath = call.output(call.path("output"));
+        UINT codePage = static_cast<UINT>(call.integer("code_page", 932));
+        if (call.upToDate()) {
+            return;
+        }
+        auto scan = scans.get(inputBin->hash, [&]() { return scanScript(inputBin->bytes); });
+        std::string txtRaw(inputTxt->bytes.begin(), inputTxt->bytes.end());
+        injectText(inputBin->bytes, *scan, std::move(txtRaw), outputBinPath, codePage);
+        call.result("texts", static_cast<long long>(scan->slots.size()));
+    });
+
+    return server.serve();
+}
+
 // =========================
 // CLI
 // =========================
@@ -929,6 +978,7 @@ static void printUsage(const fs::path& programPath)
     std::cout << "Usage:\n";
     std::cout << "  Dump:   " << programPath.filename().string() << " dump <script.bin> <out.txt> [codePage]\n";
     std::cout << "  Inject: " << programPath.filename().string() << " inject <script.bin> <in.txt> <new.bin> [codePage]\n";
+    std::cout << "  Serve:  " << programPath.filename().string() << " serve   (one JSON request per line on stdin, methods: dump, inject)\n";
     std::cout << "\n";
     std::cout << "Examples:\n";
     std::cout << "  " << programPath.filename().string() << " dump script.bin out.txt\n";
@@ -964,6 +1014,9 @@ int main(int argc, char* argv[])
             UINT codePage = parseCodePageOrDefault(argc, argv, 5, 932);
             injectText(argv[2], argv[3], argv[4], codePage);
         }
+        else if (mode == "serve") {
+            return serveScripts();
+        }
         else {
             printUsage(argv[0]);
             return 1;
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <zlib.h>
 #include <cstring>
+#include "ZlibCodec.h"
 
 namespace fs = std::filesystem;
 
@@ -58,29 +59,12 @@ std::string ReadString(std::ifstream& file, uint32_t offset) {
 }
 
 // 解压缩zlib数据
+// 共用同一个 z_stream，不再每个条目 inflateInit
 bool DecompressZlib(const std::vector<uint8_t>& input, std::vector<uint8_t>& output, uint32_t unpackedSize) {
     output.resize(unpackedSize);
 
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = static_cast<uInt>(input.size());
-    strm.next_in = const_cast<Bytef*>(input.data());
-    strm.avail_out = static_cast<uInt>(output.size());
-    strm.next_out = output.data();
-
-    int ret = inflateInit(&strm);
-    if (ret != Z_OK) {
-        std::cerr << "zlib初始化失败: " << ret << std::endl;
-        return false;
-    }
-
-    ret = inflate(&strm, Z_FINISH);
-    inflateEnd(&strm);
-
-    if (ret != Z_STREAM_END) {
-        std::cerr << "zlib解压失败: " << ret << std::endl;
+    if (!ZlibCodec::threadLocal().inflate(input.data(), input.size(), output.data(), output.size())) {
+        std::cerr << "zlib解压失败" << std::endl;
         return false;
     }
 
@@ -88,22 +72,12 @@ bool DecompressZlib(const std::vector<uint8_t>& input, std::vector<uint8_t>& out
 }
 
 // 压缩数据使用zlib
-bool CompressData(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
-    // 预估压缩后的最大大小
-    uLong compressedBufferSize = compressBound(input.size());
-    output.resize(compressedBufferSize);
-
-    // 压缩数据
-    uLongf destLen = compressedBufferSize;
-    int result = compress2(output.data(), &destLen, input.data(), input.size(), Z_BEST_COMPRESSION);
-
-    if (result != Z_OK) {
-        std::cerr << "压缩失败: " << result << std::endl;
+bool CompressData(const std::vector<uint8_t>& input, std::vector<uint8_t>& output, ZlibLevel level) {
+    if (!ZlibCodec::threadLocal().deflate(input.data(), input.size(), output, level)) {
+        std::cerr << "压缩失败" << std::endl;
         return false;
     }
 
-    // 调整输出大小为实际压缩后的大小
-    output.resize(destLen);
     return true;
 }
 
@@ -200,7 +174,7 @@ bool ExtractFxArchive(const std::string& archivePath, const std::string& outputD
 }
 
 // 收集要打包的文件
-std::vector<PackFileEntry> CollectFiles(const fs::path& inputDir, bool useCompression) {
+std::vector<PackFileEntry> CollectFiles(const fs::path& inputDir, bool useCompression, ZlibLevel level) {
     std::vector<PackFileEntry> entries;
 
     // 递归遍历目录
@@ -238,7 +212,7 @@ std::vector<PackFileEntry> CollectFiles(const fs::path& inputDir, bool useCompre
         // 根据设置决定是否压缩
         if (useCompression && fileSize > 0) {
             fileEntry.compression = 2; // zlib压缩
-            if (!CompressData(fileContent, fileEntry.data)) {
+            if (!CompressData(fileContent, fileEntry.data, level)) {
                 std::cerr << "压缩文件失败: " << fileEntry.name << std::endl;
                 fileEntry.compression = 0;
                 fileEntry.data = fileContent;
@@ -348,11 +322,12 @@ void ShowHelp(const char* programName) {
     std::cout << "Scoop FX 封包工具" << std::endl;
     std::cout << "用法:" << std::endl;
     std::cout << "  解包: " << programName << " -e <FX文件路径> <输出目录>" << std::endl;
-    std::cout << "  封包: " << programName << " -c <输入目录> <输出FX文件> [--no-compress]" << std::endl;
+    std::cout << "  封包: " << programName << " -c <输入目录> <输出FX文件> [--no-compress] [--level fast|balanced|max]" << std::endl;
     std::cout << "选项:" << std::endl;
     std::cout << "  -e, --extract    解包模式" << std::endl;
     std::cout << "  -c, --create     封包模式" << std::endl;
     std::cout << "  --no-compress    封包时不压缩文件" << std::endl;
+    std::cout << "  --level          压缩级别，默认 max (与原版相同)" << std::endl;
     std::cout << "示例:" << std::endl;
     std::cout << "  " << programName << " -e game.fx extracted" << std::endl;
     std::cout << "  " << programName << " -c input_folder output.fx" << std::endl;
@@ -383,9 +358,21 @@ int main(int argc, char* argv[]) {
 
         // 检查是否使用压缩
         bool useCompression = true;
-        if (argc > 4 && std::string(argv[4]) == "--no-compress") {
-            useCompression = false;
-            std::cout << "已禁用压缩" << std::endl;
+        ZlibLevel level = ZlibLevel::Max;
+        for (int i = 4; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--no-compress") {
+                useCompression = false;
+                std::cout << "已禁用压缩" << std::endl;
+            }
+            else if (option == "--level" && i + 1 < argc && parseZlibLevel(argv[i + 1], level)) {
+                ++i;
+            }
+            else {
+                std::cerr << "未知选项: " << option << std::endl;
+                ShowHelp(argv[0]);
+                return 1;
+            }
         }
 
         // 检查输入目录是否存在
@@ -395,7 +382,7 @@ int main(int argc, char* argv[]) {
         }
 
         // 收集要打包的文件
-        std::vector<PackFileEntry> entries = CollectFiles(inputDir, useCompression);
+        std::vector<PackFileEntry> entries = CollectFiles(inputDir, useCompression, level);
 
         if (entries.empty()) {
             std::cerr << "没有找到要打包的文件" << std::endl;
@@ -0,0 +1,639 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// 脚本工具共用的常驻服务模式 (<tool> serve)。
+// CI 按文件逐个调用脚本工具时，每次都要重新启动进程、加载代码页表、读入并解析脚本，
+// 真正的 dump/inject 往往只占很小一部分。serve 模式下进程常驻，从 stdin 逐行读取 JSON 请求，
+// 每个请求在 stdout 上回复一行 JSON：
+//   -> {"id":1,"method":"dump","params":{"input":"a.bin","output":"a.txt"}}
+//   <- {"id":1,"result":{"status":"ok","ms":0.412}}
+//   <- {"id":2,"error":{"message":"..."}}
+// 工具原有的控制台输出在 serve 模式下被转到 stderr，stdout 只用于回复。
+// 内置方法：ping、stats (缓存命中情况)、shutdown。请求按顺序逐个处理。
+//
+// 保持常驻的缓存：
+//   ScriptFileCache      输入文件内容和哈希，大小与修改时间不变时不再读盘
+//   ScriptParseCache<T>  按内容哈希缓存工具自己的解析结果 (指令列表、文本槽位等)
+//   增量记录             同一请求 (方法 + 参数) 的输入哈希和输出文件状态都未变化时直接回复 "unchanged"，
+//                        参数中带 "force": true 时总是重新处理
+// 代码页转换表由系统在进程内首次使用时加载，常驻后也不再重复加载。
+
+// 输入文件及其内容哈希
+struct ScriptFile {
+    std::filesystem::path path;
+    std::vector<uint8_t> bytes;
+    uint64_t hash = 0;
+    uintmax_t size = 0;
+    std::filesystem::file_time_type mtime;
+};
+
+// 64 位内容哈希，每次处理 8 字节
+inline uint64_t scriptContentHash(const uint8_t* data, size_t size) {
+    uint64_t h = 0xCBF29CE484222325ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    for (; i < size; ++i) {
+        h = (h ^ data[i]) * 0x100000001B3ull;
+    }
+    h ^= h >> 32;
+    return h;
+}
+
+class ScriptFileCache {
+public:
+    explicit ScriptFileCache(uint64_t capacityBytes = 512ull << 20) : m_capacity(capacityBytes) {}
+
+    // 大小和修改时间与缓存一致时直接返回缓存内容，否则重新读入
+    std::shared_ptr<const ScriptFile> load(const std::filesystem::path& path) {
+        uintmax_t size = std::filesystem::file_size(path);
+        std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path);
+        auto key = path.native();
+        auto it = m_files.find(key);
+        if (it != m_files.end() && it->second->size == size && it->second->mtime == mtime) {
+            ++m_hits;
+            return it->second;
+        }
+
+        auto file = std::make_shared<ScriptFile>();
+        file->path = path;
+        file->size = size;
+        file->mtime = mtime;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Cannot open file: " + path.string());
+        }
+        file->bytes.resize((size_t)size);
+        if (size != 0 && !in.read(reinterpret_cast<char*>(file->bytes.data()), (std::streamsize)size)) {
+            throw std::runtime_error("Cannot read file: " + path.string());
+        }
+        file->hash = scriptContentHash(file->bytes.data(), file->bytes.size());
+        ++m_misses;
+
+        if (it != m_files.end()) {
+            m_bytes -= it->second->bytes.size();
+            it->second = file;
+        }
+        else {
+            m_files.emplace(key, file);
+            m_order.push_back(key);
+        }
+        m_bytes += file->bytes.size();
+        evict();
+        return file;
+    }
+
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+    uint64_t bytes() const { return m_bytes; }
+    size_t count() const { return m_files.size(); }
+
+private:
+    // 超出容量时按加入顺序淘汰，正在使用的内容由 shared_ptr 保持
+    void evict() {
+        while (m_bytes > m_capacity && m_order.size() > 1) {
+            auto it = m_files.find(m_order.front());
+            m_order.pop_front();
+            if (it != m_files.end()) {
+                m_bytes -= it->second->bytes.size();
+                m_files.erase(it);
+            }
+        }
+    }
+
+    uint64_t m_capacity;
+    uint64_t m_bytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    std::unordered_map<std::filesystem::path::string_type, std::shared_ptr<const ScriptFile>> m_files;
+    std::deque<std::filesystem::path::string_type> m_order;
+};
+
+// 按内容哈希缓存解析结果，解析函数只在未命中时调用
+template<typename T>
+class ScriptParseCache {
+public:
+    explicit ScriptParseCache(size_t capacity = 4096) : m_capacity(capacity) {}
+
+    template<typename Parse>
+    std::shared_ptr<const T> get(uint64_t hash, Parse&& parse) {
+        auto it = m_entries.find(hash);
+        if (it != m_entries.end()) {
+            return it->second;
+        }
+        auto value = std::make_shared<const T>(parse());
+        m_entries.emplace(hash, value);
+        m_order.push_back(hash);
+        while (m_order.size() > m_capacity) {
+            m_entries.erase(m_order.front());
+            m_order.pop_front();
+        }
+        return value;
+    }
+
+private:
+    size_t m_capacity;
+    std::unordered_map<uint64_t, std::shared_ptr<const T>> m_entries;
+    std::deque<uint64_t> m_order;
+};
+
+// 请求中的一个值：字符串为解码后的内容，数字/true/false/null 为原文，嵌套的对象和数组为原始 JSON 文本
+struct ScriptJsonValue {
+    std::string text;
+    bool isString = false;
+
+    // 原样写回 JSON
+    std::string json() const;
+};
+
+// 请求解析，只支持请求用到的 JSON 子集
+class ScriptJsonReader {
+public:
+    explicit ScriptJsonReader(std::string_view text) : m_text(text) {}
+
+    std::map<std::string, ScriptJsonValue> object() {
+        std::map<std::string, ScriptJsonValue> members;
+        skipSpace();
+        expect('{');
+        skipSpace();
+        if (peek() == '}') {
+            ++m_pos;
+            return members;
+        }
+        while (true) {
+            skipSpace();
+            std::string key = string();
+            skipSpace();
+            expect(':');
+            skipSpace();
+            members[key] = value();
+            skipSpace();
+            if (peek() == ',') {
+                ++m_pos;
+                continue;
+            }
+            expect('}');
+            return members;
+        }
+    }
+
+    void finish() {
+        skipSpace();
+        if (m_pos != m_text.size()) {
+            fail("trailing characters");
+        }
+    }
+
+private:
+    ScriptJsonValue value() {
+        char c = peek();
+        if (c == '"') {
+            return { string(), true };
+        }
+        if (c == '{' || c == '[') {
+            size_t start = m_pos;
+            skipNested();
+            return { std::string(m_text.substr(start, m_pos - start)), false };
+        }
+        size_t start = m_pos;
+        while (m_pos < m_text.size() && std::strchr(",}] \t\r\n", m_text[m_pos]) == nullptr) {
+            ++m_pos;
+        }
+        if (start == m_pos) {
+            fail("value expected");
+        }
+        return { std::string(m_text.substr(start, m_pos - start)), false };
+    }
+
+    void skipNested() {
+        int depth = 0;
+        do {
+            char c = peek();
+            if (c == '"') {
+                string();
+                continue;
+            }
+            if (c == '{' || c == '[') ++depth;
+            else if (c == '}' || c == ']') --depth;
+            ++m_pos;
+        } while (depth > 0);
+    }
+
+    std::string string() {
+        expect('"');
+        std::string out;
+        while (true) {
+            char c = peek();
+            ++m_pos;
+            if (c == '"') {
+                return out;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            char e = peek();
+            ++m_pos;
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = hex4();
+                if (cp >= 0xD800 && cp < 0xDC00 && m_text.substr(m_pos, 2) == "\\u") {
+                    m_pos += 2;
+                    uint32_t low = hex4();
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default:
+                fail("invalid escape");
+            }
+        }
+    }
+
+    uint32_t hex4() {
+        if (m_pos + 4 > m_text.size()) {
+            fail("truncated \\u escape");
+        }
+        uint32_t v = (uint32_t)std::stoul(std::string(m_text.substr(m_pos, 4)), nullptr, 16);
+        m_pos += 4;
+        return v;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        }
+        else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+        else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    char peek() {
+        if (m_pos >= m_text.size()) {
+            fail("unexpected end of input");
+        }
+        return m_text[m_pos];
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            fail(std::string("'") + c + "' expected");
+        }
+        ++m_pos;
+    }
+
+    void skipSpace() {
+        while (m_pos < m_text.size() && std::strchr(" \t\r\n", m_text[m_pos]) != nullptr && m_text[m_pos] != '\0') {
+            ++m_pos;
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& what) {
+        throw std::runtime_error("Invalid request JSON at " + std::to_string(m_pos) + ": " + what);
+    }
+
+    std::string_view m_text;
+    size_t m_pos = 0;
+};
+
+inline std::string scriptJsonString(std::string_view s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                out += buf;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+inline std::string ScriptJsonValue::json() const {
+    return isString ? scriptJsonString(text) : text;
+}
+
+class ScriptServer;
+
+// 一次请求的处理上下文
+class ScriptCall {
+public:
+    const std::string& method() const { return m_method; }
+    bool has(const std::string& name) const { return m_params.count(name) != 0; }
+
+    std::string str(const std::string& name) const {
+        auto it = m_params.find(name);
+        if (it == m_params.end()) {
+            throw std::runtime_error("Missing parameter: " + name);
+        }
+        return it->second;
+    }
+
+    std::string str(const std::string& name, const std::string& defaultValue) const {
+        return has(name) ? str(name) : defaultValue;
+    }
+
+    // 参数中的路径为 UTF-8
+    std::filesystem::path path(const std::string& name) const {
+        std::string value = str(name);
+        return std::filesystem::path(std::u8string(value.begin(), value.end()));
+    }
+
+    bool flag(const std::string& name, bool defaultValue = false) const {
+        return has(name) ? str(name) == "true" : defaultValue;
+    }
+
+    long long integer(const std::string& name, long long defaultValue) const {
+        return has(name) ? std::stoll(str(name)) : defaultValue;
+    }
+
+    // 通过文件缓存读入输入文件，并登记其内容哈希
+    std::shared_ptr<const ScriptFile> input(const std::filesystem::path& path);
+
+    // 登记输出文件，返回其路径
+    std::filesystem::path output(const std::filesystem::path& path) {
+        m_outputs.push_back(path);
+        return path;
+    }
+
+    // 已登记的输入内容和输出文件都与上一次完成同一请求时相同，无需重新处理
+    bool upToDate();
+
+    // 附加到回复 result 中的字段
+    void result(const std::string& key, const std::string& value) { m_result += "," + scriptJsonString(key) + ":" + scriptJsonString(value); }
+    void result(const std::string& key, long long value) { m_result += "," + scriptJsonString(key) + ":" + std::to_string(value); }
+
+private:
+    friend class ScriptServer;
+
+    ScriptServer* m_server = nullptr;
+    std::string m_method;
+    std::map<std::string, std::string> m_params;
+    std::vector<std::pair<std::filesystem::path, uint64_t>> m_inputs;
+    std::vector<std::filesystem::path> m_outputs;
+    std::string m_result;
+    bool m_skipped = false;
+};
+
+class ScriptServer {
+public:
+    using Handler = std::function<void(ScriptCall&)>;
+
+    explicit ScriptServer(std::string toolName) : m_toolName(std::move(toolName)) {}
+
+    void on(const std::string& method, Handler handler) { m_handlers[method] = std::move(handler); }
+
+    ScriptFileCache& files() { return m_files; }
+
+    // 处理 stdin 上的请求直到 EOF 或 shutdown
+    int serve() {
+        FILE* responses = redirectStdout();
+        std::string line;
+        while (!m_stopped && std::getline(std::cin, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.find_first_not_of(" \t") == std::string::npos) {
+                continue;
+            }
+            std::string response = handle(line);
+            std::fflush(stdout);
+            std::fputs(response.c_str(), responses);
+            std::fputc('\n', responses);
+            std::fflush(responses);
+        }
+        return 0;
+    }
+
+private:
+    friend class ScriptCall;
+
+    struct OutputState {
+        std::filesystem::path path;
+        uintmax_t size = 0;
+        std::filesystem::file_time_type mtime;
+    };
+    struct Record {
+        std::vector<std::pair<std::filesystem::path, uint64_t>> inputs;
+        std::vector<OutputState> outputs;
+    };
+
+    // 回复写到原来的 stdout，工具自身的输出改写到 stderr
+    static FILE* redirectStdout() {
+        std::fflush(stdout);
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        int responseFd = _dup(_fileno(stdout));
+        _dup2(_fileno(stderr), _fileno(stdout));
+        FILE* responses = _fdopen(responseFd, "wb");
+#else
+        int responseFd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        FILE* responses = fdopen(responseFd, "w");
+#endif
+        if (responses == nullptr) {
+            throw std::runtime_error("Cannot open response stream");
+        }
+        return responses;
+    }
+
+    static std::string recordKey(const ScriptCall& call) {
+        std::string key = call.m_method;
+        for (const auto& [name, value] : call.m_params) {
+            if (name == "force") {
+                continue;
+            }
+            key += '\0' + name + '=' + value;
+        }
+        return key;
+    }
+
+    std::string handle(const std::string& line) {
+        auto start = std::chrono::steady_clock::now();
+        std::string id = "null";
+        try {
+            ScriptJsonReader reader(line);
+            auto request = reader.object();
+            reader.finish();
+            if (request.count("id")) {
+                id = request["id"].json();
+            }
+            if (!request.count("method") || !request["method"].isString) {
+                throw std::runtime_error("Missing method");
+            }
+
+            ScriptCall call;
+            call.m_server = this;
+            call.m_method = request["method"].text;
+            if (request.count("params")) {
+                ScriptJsonReader paramsReader(request["params"].text);
+                for (auto& [name, value] : paramsReader.object()) {
+                    call.m_params[name] = std::move(value.text);
+                }
+                paramsReader.finish();
+            }
+
+            ++m_requests;
+            std::string status = "ok";
+            if (call.m_method == "ping") {
+                call.result("tool", m_toolName);
+            }
+            else if (call.m_method == "stats") {
+                call.result("requests", (long long)m_requests);
+                call.result("unchanged", (long long)m_unchanged);
+                call.result("file_cache_hits", (long long)m_files.hits());
+                call.result("file_cache_misses", (long long)m_files.misses());
+                call.result("file_cache_files", (long long)m_files.count());
+                call.result("file_cache_bytes", (long long)m_files.bytes());
+            }
+            else if (call.m_method == "shutdown") {
+                m_stopped = true;
+            }
+            else {
+                auto it = m_handlers.find(call.m_method);
+                if (it == m_handlers.end()) {
+                    throw std::runtime_error("Unknown method: " + call.m_method);
+                }
+                it->second(call);
+                if (call.m_skipped) {
+                    status = "unchanged";
+                    ++m_unchanged;
+                }
+                else {
+                    remember(call);
+                }
+            }
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            char ms[32];
+            snprintf(ms, sizeof(ms), "%.3f", elapsed.count());
+            return "{\"id\":" + id + ",\"result\":{\"status\":" + scriptJsonString(status) + ",\"ms\":" + ms + call.m_result + "}}";
+        }
+        catch (const std::exception& e) {
+            return "{\"id\":" + id + ",\"error\":{\"message\":" + scriptJsonString(e.what()) + "}}";
+        }
+    }
+
+    // 记录本次请求的输入哈希和输出文件状态，供之后的同一请求判断是否需要重新处理
+    void remember(const ScriptCall& call) {
+        Record record;
+        record.inputs = call.m_inputs;
+        for (const auto& path : call.m_outputs) {
+            std::error_code ec;
+            OutputState state;
+            state.path = path;
+            state.size = std::filesystem::file_size(path, ec);
+            if (!ec) {
+                state.mtime = std::filesystem::last_write_time(path, ec);
+            }
+            if (ec) {
+                m_records.erase(recordKey(call));
+                return;
+            }
+            record.outputs.push_back(std::move(state));
+        }
+        m_records[recordKey(call)] = std::move(record);
+    }
+
+    bool upToDate(const ScriptCall& call) {
+        if (call.flag("force")) {
+            return false;
+        }
+        auto it = m_records.find(recordKey(call));
+        if (it == m_records.end()) {
+            return false;
+        }
+        const Record& record = it->second;
+        if (record.inputs != call.m_inputs || record.outputs.size() != call.m_outputs.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < record.outputs.size(); ++i) {
+            const OutputState& state = record.outputs[i];
+            std::error_code ec;
+            if (state.path != call.m_outputs[i]
+                || std::filesystem::file_size(state.path, ec) != state.size || ec
+                || std::filesystem::last_write_time(state.path, ec) != state.mtime || ec) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string m_toolName;
+    std::map<std::string, Handler> m_handlers;
+    ScriptFileCache m_files;
+    std::unordered_map<std::string, Record> m_records;
+    uint64_t m_requests = 0;
+    uint64_t m_unchanged = 0;
+    bool m_stopped = false;
+};
+
+inline std::shared_ptr<const ScriptFile> ScriptCall::input(const std::filesystem::path& path) {
+    auto file = m_server->m_files.load(path);
+    m_inputs.emplace_back(path, file->hash);
+    return file;
+}
+
+inline bool ScriptCall::upToDate() {
+    m_skipped = m_server->upToDate(*this);
+    return m_skipped;
+}
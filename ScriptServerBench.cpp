@@ -0,0 +1,418 @@
+﻿// 脚本工具 serve 模式的请求延迟基准：对比每个请求单独启动进程 (冷启动) 与常驻进程 (serve) 的耗时
+// 用法: ScriptServerBench <tool_exe> <requests.jsonl> [rounds] [--cold <commands.txt>]
+// requests.jsonl 每行一个请求，格式同 ScriptServer.h，例如
+//   {"id":1,"method":"dump","params":{"input":"scr/a.bin","output":"txt/a.txt"}}
+// commands.txt 与 requests.jsonl 逐行对应，每行是同一请求用普通命令行调用工具时 <tool_exe> 之后的参数，例如
+//   -d scr txt
+// 冷启动：每行启动一次 "<tool> <参数>" 走工具原本的一次性命令行，计时到进程退出，非 0 退出码记为错误；
+// 未给出 --cold 时跳过冷启动
+// 常驻：启动一次 "<tool> serve"，所有请求逐个发送；第一轮做实际处理，之后各轮输入未变，走增量跳过
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// 以 "<tool> serve" 启动的子进程，stdin/stdout 接管道，stderr 丢弃
+class ServeProcess {
+public:
+    explicit ServeProcess(const std::string& tool) {
+#ifdef _WIN32
+        SECURITY_ATTRIBUTES sa = { sizeof(sa), nullptr, TRUE };
+        HANDLE childIn = nullptr;
+        HANDLE childOut = nullptr;
+        if (!CreatePipe(&childIn, &m_in, &sa, 0) || !CreatePipe(&m_out, &childOut, &sa, 0)) {
+            throw std::runtime_error("CreatePipe failed");
+        }
+        SetHandleInformation(m_in, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(m_out, HANDLE_FLAG_INHERIT, 0);
+        HANDLE nul = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, nullptr);
+
+        STARTUPINFOA si = { sizeof(si) };
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = childIn;
+        si.hStdOutput = childOut;
+        si.hStdError = nul;
+        std::string commandLine = "\"" + tool + "\" serve";
+        BOOL ok = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &m_process);
+        CloseHandle(childIn);
+        CloseHandle(childOut);
+        CloseHandle(nul);
+        if (!ok) {
+            throw std::runtime_error("Can not start: " + tool);
+        }
+        CloseHandle(m_process.hThread);
+#else
+        int inPipe[2];
+        int outPipe[2];
+        if (pipe(inPipe) != 0 || pipe(outPipe) != 0) {
+            throw std::runtime_error("pipe failed");
+        }
+        m_pid = fork();
+        if (m_pid < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        if (m_pid == 0) {
+            dup2(inPipe[0], 0);
+            dup2(outPipe[1], 1);
+            if (FILE* nul = freopen("/dev/null", "w", stderr); nul == nullptr) {
+                _exit(127);
+            }
+            close(inPipe[0]);
+            close(inPipe[1]);
+            close(outPipe[0]);
+            close(outPipe[1]);
+            execl(tool.c_str(), tool.c_str(), "serve", (char*)nullptr);
+            _exit(127);
+        }
+        close(inPipe[0]);
+        close(outPipe[1]);
+        m_in = inPipe[1];
+        m_out = outPipe[0];
+#endif
+    }
+
+    ~ServeProcess() {
+        closeInput();
+        wait();
+#ifdef _WIN32
+        if (m_out != nullptr) CloseHandle(m_out);
+#else
+        if (m_out >= 0) close(m_out);
+#endif
+    }
+
+    ServeProcess(const ServeProcess&) = delete;
+    ServeProcess& operator=(const ServeProcess&) = delete;
+
+    void writeLine(std::string line) {
+        line += '\n';
+        size_t written = 0;
+        while (written < line.size()) {
+#ifdef _WIN32
+            DWORD n = 0;
+            if (!WriteFile(m_in, line.data() + written, (DWORD)(line.size() - written), &n, nullptr)) {
+                throw std::runtime_error("Write to tool failed");
+            }
+#else
+            ssize_t n = ::write(m_in, line.data() + written, line.size() - written);
+            if (n <= 0) {
+                throw std::runtime_error("Write to tool failed");
+            }
+#endif
+            written += (size_t)n;
+        }
+    }
+
+    std::string readLine() {
+        while (true) {
+            size_t pos = m_buffer.find('\n');
+            if (pos != std::string::npos) {
+                std::string line = m_buffer.substr(0, pos);
+                m_buffer.erase(0, pos + 1);
+                return line;
+            }
+            char chunk[4096];
+#ifdef _WIN32
+            DWORD n = 0;
+            if (!ReadFile(m_out, chunk, sizeof(chunk), &n, nullptr) || n == 0) {
+                throw std::runtime_error("Tool exited without reply");
+            }
+#else
+            ssize_t n = ::read(m_out, chunk, sizeof(chunk));
+            if (n <= 0) {
+                throw std::runtime_error("Tool exited without reply");
+            }
+#endif
+            m_buffer.append(chunk, (size_t)n);
+        }
+    }
+
+    void closeInput() {
+#ifdef _WIN32
+        if (m_in != nullptr) {
+            CloseHandle(m_in);
+            m_in = nullptr;
+        }
+#else
+        if (m_in >= 0) {
+            close(m_in);
+            m_in = -1;
+        }
+#endif
+    }
+
+    void wait() {
+#ifdef _WIN32
+        if (m_process.hProcess != nullptr) {
+            WaitForSingleObject(m_process.hProcess, INFINITE);
+            CloseHandle(m_process.hProcess);
+            m_process.hProcess = nullptr;
+        }
+#else
+        if (m_pid > 0) {
+            int status = 0;
+            waitpid(m_pid, &status, 0);
+            m_pid = -1;
+        }
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    PROCESS_INFORMATION m_process = {};
+    HANDLE m_in = nullptr;
+    HANDLE m_out = nullptr;
+#else
+    pid_t m_pid = -1;
+    int m_in = -1;
+    int m_out = -1;
+#endif
+    std::string m_buffer;
+};
+
+// 以普通命令行运行一次工具并等待退出，返回退出码。stdin/stdout/stderr 都接空设备
+static int runOnce(const std::string& tool, const std::string& arguments) {
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), nullptr, TRUE };
+    HANDLE nul = CreateFileA("NUL", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, nullptr);
+
+    STARTUPINFOA si = { sizeof(si) };
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = nul;
+    si.hStdOutput = nul;
+    si.hStdError = nul;
+    PROCESS_INFORMATION process = {};
+    std::string commandLine = "\"" + tool + "\" " + arguments;
+    BOOL ok = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &process);
+    CloseHandle(nul);
+    if (!ok) {
+        throw std::runtime_error("Can not start: " + tool);
+    }
+    CloseHandle(process.hThread);
+    WaitForSingleObject(process.hProcess, INFINITE);
+    DWORD exitCode = 1;
+    GetExitCodeProcess(process.hProcess, &exitCode);
+    CloseHandle(process.hProcess);
+    return (int)exitCode;
+#else
+    // 按空白切分参数，双引号内的空白保留
+    std::vector<std::string> args = { tool };
+    std::string current;
+    bool quoted = false;
+    bool hasArg = false;
+    for (char ch : arguments) {
+        if (ch == '"') {
+            quoted = !quoted;
+            hasArg = true;
+        }
+        else if (!quoted && (ch == ' ' || ch == '\t')) {
+            if (hasArg) {
+                args.push_back(current);
+                current.clear();
+                hasArg = false;
+            }
+        }
+        else {
+            current += ch;
+            hasArg = true;
+        }
+    }
+    if (hasArg) {
+        args.push_back(current);
+    }
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0) {
+        int nul = open("/dev/null", O_RDWR);
+        if (nul < 0) {
+            _exit(127);
+        }
+        dup2(nul, 0);
+        dup2(nul, 1);
+        dup2(nul, 2);
+        close(nul);
+        execv(tool.c_str(), argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+#endif
+}
+
+struct RoundResult {
+    std::vector<double> ms;
+    size_t errors = 0;
+    size_t unchanged = 0;
+    std::string firstError;
+};
+
+static void countReply(RoundResult& result, const std::string& reply) {
+    if (reply.find("\"error\":") != std::string::npos) {
+        if (result.errors++ == 0) {
+            result.firstError = reply;
+        }
+    }
+    else if (reply.find("\"status\":\"unchanged\"") != std::string::npos) {
+        ++result.unchanged;
+    }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 每条命令都从启动进程开始计时，到进程退出为止
+static RoundResult runCold(const std::string& tool, const std::vector<std::string>& commands) {
+    RoundResult result;
+    for (const auto& command : commands) {
+        auto start = std::chrono::steady_clock::now();
+        int exitCode = runOnce(tool, command);
+        result.ms.push_back(elapsedMs(start));
+        if (exitCode != 0 && result.errors++ == 0) {
+            result.firstError = "exit code " + std::to_string(exitCode) + ": " + command;
+        }
+    }
+    return result;
+}
+
+static RoundResult runWarm(ServeProcess& process, const std::vector<std::string>& requests) {
+    RoundResult result;
+    for (const auto& request : requests) {
+        auto start = std::chrono::steady_clock::now();
+        process.writeLine(request);
+        std::string reply = process.readLine();
+        result.ms.push_back(elapsedMs(start));
+        countReply(result, reply);
+    }
+    return result;
+}
+
+static void report(const std::string& name, RoundResult result) {
+    std::vector<double>& ms = result.ms;
+    std::sort(ms.begin(), ms.end());
+    double total = std::accumulate(ms.begin(), ms.end(), 0.0);
+    double avg = ms.empty() ? 0.0 : total / ms.size();
+    double median = ms.empty() ? 0.0 : ms[ms.size() / 2];
+    double p95 = ms.empty() ? 0.0 : ms[std::min(ms.size() - 1, ms.size() * 95 / 100)];
+
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+        << " total " << std::setw(10) << total << " ms"
+        << " | avg " << std::setw(8) << avg << " ms"
+        << " | median " << std::setw(8) << median << " ms"
+        << " | p95 " << std::setw(8) << p95 << " ms"
+        << " | unchanged " << result.unchanged
+        << " | errors " << result.errors << std::endl;
+    if (result.errors != 0) {
+        std::cout << "  first error: " << result.firstError << std::endl;
+    }
+}
+
+// 读取非空行，去掉行尾的 \r
+static bool readLines(const std::string& path, std::vector<std::string>& lines) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        std::cerr << "Can not open file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> positional;
+    std::string coldPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cold" && i + 1 < argc) {
+            coldPath = argv[++i];
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+    int rounds = 3;
+    bool valid = positional.size() == 2 || positional.size() == 3;
+    if (valid && positional.size() == 3) {
+        const std::string& value = positional[2];
+        valid = !value.empty() && value.size() <= 6 && value.find_first_not_of("0123456789") == std::string::npos;
+        rounds = valid ? std::max(std::stoi(value), 1) : rounds;
+    }
+    if (!valid) {
+        std::cerr << "Usage: " << argv[0] << " <tool_exe> <requests.jsonl> [rounds] [--cold <commands.txt>]" << std::endl;
+        return 1;
+    }
+    std::string tool = positional[0];
+    std::vector<std::string> requests;
+    if (!readLines(positional[1], requests)) {
+        return 1;
+    }
+    std::vector<std::string> commands;
+    if (!coldPath.empty()) {
+        if (!readLines(coldPath, commands)) {
+            return 1;
+        }
+        if (commands.size() != requests.size()) {
+            std::cerr << coldPath << " has " << commands.size() << " commands, expected one per request (" << requests.size() << ")" << std::endl;
+            return 1;
+        }
+    }
+#ifndef _WIN32
+    // 工具异常退出时写管道报错而不是被 SIGPIPE 结束
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    try {
+        std::cout << "Tool: " << tool << ", " << requests.size() << " requests, " << rounds << " warm rounds" << std::endl;
+        if (!commands.empty()) {
+            report("cold (process/request)", runCold(tool, commands));
+        }
+
+        // 先等进程启动完成，常驻各轮只统计请求本身
+        ServeProcess process(tool);
+        process.writeLine("{\"id\":0,\"method\":\"ping\"}");
+        process.readLine();
+        report("warm round 1", runWarm(process, requests));
+        for (int round = 2; round <= rounds; ++round) {
+            report("warm round " + std::to_string(round), runWarm(process, requests));
+        }
+        process.writeLine("{\"id\":0,\"method\":\"stats\"}");
+        std::cout << "stats: " << process.readLine() << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -6,6 +6,12 @@
 #include <zlib.h>
 #include <memory>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include "ZlibCodec.h"
+#include "ThreadCount.h"
 
 // LZ解压函数
 std::vector<uint8_t> lz_decompress(const std::vector<uint8_t>& input) {
@@ -49,51 +55,22 @@ std::vector<uint8_t> lz_decompress(const std::vector<uint8_t>& input) {
     return output;
 }
 
-// Zlib解压函数
-std::vector<uint8_t> decompress_zlib(const std::vector<uint8_t>& input) {
+// Zlib解压函数，原始大小未知，输出缓冲区按需扩容
+std::vector<uint8_t> decompress_zlib(const uint8_t* input, size_t size) {
     std::vector<uint8_t> output;
-    z_stream strm = { nullptr };
-
-    // 初始化zlib
-    if (inflateInit(&strm) != Z_OK) {
-        throw std::runtime_error("Failed to initialize zlib");
+    if (!ZlibCodec::threadLocal().inflateUnknown(input, size, output)) {
+        throw std::runtime_error("Decompression failed");
     }
-
-    // 设置输入
-    strm.next_in = const_cast<Bytef*>(input.data());
-    strm.avail_in = static_cast<uInt>(input.size());
-
-    // 分配缓冲区进行解压
-    const size_t CHUNK = 16384;
-    std::vector<uint8_t> buffer(CHUNK);
-
-    // 解压循环
-    do {
-        strm.next_out = buffer.data();
-        strm.avail_out = static_cast<uInt>(buffer.size());
-
-        int ret = inflate(&strm, Z_NO_FLUSH);
-        if (ret != Z_OK && ret != Z_STREAM_END) {
-            inflateEnd(&strm);
-            throw std::runtime_error("Decompression failed");
-        }
-
-        size_t have = CHUNK - strm.avail_out;
-        output.insert(output.end(), buffer.begin(), buffer.begin() + have);
-    } while (strm.avail_out == 0);
-
-    inflateEnd(&strm);
     return output;
 }
 
-// LZSS伪压缩
-std::vector<uint8_t> lz_compress(const std::vector<uint8_t>& input) {
+// 只用字面量块的编码 (原先的伪压缩)，输出总比输入大
+std::vector<uint8_t> lz_store(const std::vector<uint8_t>& input) {
     std::vector<uint8_t> output;
     // 写入原始大小
     uint32_t size = static_cast<uint32_t>(input.size());
     output.insert(output.end(), (uint8_t*)&size, (uint8_t*)&size + 4);
 
-    // 每8字节一组进行伪压缩
     for (size_t i = 0; i < input.size(); i += 0x7F) {
         size_t remain = std::min(size_t(0x7F), input.size() - i);
         output.push_back(static_cast<uint8_t>(remain - 1));  // 控制字节
@@ -102,22 +79,118 @@ std::vector<uint8_t> lz_compress(const std::vector<uint8_t>& input) {
     return output;
 }
 
-// Zlib压缩
-std::vector<uint8_t> compress_zlib(const std::vector<uint8_t>& input) {
-    uLongf compress_buf_size = compressBound(input.size());
-    std::vector<uint8_t> output(compress_buf_size);
+// LZ压缩，与 lz_decompress 对应：
+//   控制字节最高位为 1: 回溯复制，距离 1~1024 (10 位)，长度 1~32 (5 位)，共 2 字节
+//   否则: 后跟 ctl + 1 (1~128) 个字面量
+// 哈希链查找 + 一步惰性匹配。窗口只有 1 KB，prev 用环形数组即可
+std::vector<uint8_t> lz_compress(const std::vector<uint8_t>& input) {
+    constexpr size_t kWindow = 1024;
+    constexpr size_t kMinMatch = 3;
+    constexpr size_t kMaxMatch = 32;
+    constexpr size_t kMaxLiteral = 0x80;
+    constexpr int kMaxChain = 128;
+    constexpr int kHashBits = 14;
+
+    const size_t n = input.size();
+    const uint8_t* src = input.data();
+    std::vector<uint8_t> output;
+    output.reserve(n + n / kMaxLiteral + 8);
+    uint32_t size = static_cast<uint32_t>(n);
+    output.insert(output.end(), (uint8_t*)&size, (uint8_t*)&size + 4);
 
-    if (compress2(output.data(), &compress_buf_size, input.data(), input.size(),
-        Z_BEST_COMPRESSION) != Z_OK) {
-        throw std::runtime_error("Zlib compression failed");
+    std::vector<int32_t> head(1 << kHashBits, -1);
+    std::vector<int32_t> prev(kWindow, -1);
+    auto hash = [&](size_t p) {
+        uint32_t v = src[p] | (src[p + 1] << 8) | (src[p + 2] << 16);
+        return (v * 2654435761u) >> (32 - kHashBits);
+    };
+
+    // 查找前须把 p 之前的位置都加入哈希链，且 p 本身尚未加入，这样环形 prev 中链上的槽位不会被覆盖
+    size_t inserted = 0;
+    auto insertUpTo = [&](size_t end) {
+        for (; inserted < end && inserted + kMinMatch <= n; ++inserted) {
+            uint32_t h = hash(inserted);
+            prev[inserted % kWindow] = head[h];
+            head[h] = static_cast<int32_t>(inserted);
+        }
+        inserted = std::max(inserted, end);
+    };
+    auto findMatch = [&](size_t p, size_t& bestDist) -> size_t {
+        if (p + kMinMatch > n) return 0;
+        size_t maxLen = std::min(kMaxMatch, n - p);
+        size_t best = 0;
+        int32_t cand = head[hash(p)];
+        for (int chain = kMaxChain; cand >= 0 && p - cand <= kWindow && chain > 0; --chain) {
+            if (src[cand + best] == src[p + best]) {
+                size_t len = 0;
+                while (len < maxLen && src[cand + len] == src[p + len]) ++len;
+                if (len > best) {
+                    best = len;
+                    bestDist = p - cand;
+                    if (len == maxLen) break;
+                }
+            }
+            cand = prev[cand % kWindow];
+        }
+        return best >= kMinMatch ? best : 0;
+    };
+
+    size_t literalStart = 0;
+    auto flushLiterals = [&](size_t end) {
+        while (literalStart < end) {
+            size_t count = std::min(kMaxLiteral, end - literalStart);
+            output.push_back(static_cast<uint8_t>(count - 1));
+            output.insert(output.end(), src + literalStart, src + literalStart + count);
+            literalStart += count;
+        }
+    };
+
+    size_t pos = 0;
+    while (pos < n) {
+        insertUpTo(pos);
+        size_t dist = 0;
+        size_t len = findMatch(pos, dist);
+        if (len && len < kMaxMatch) {
+            // 下一个位置能匹配得更长时，当前字节作为字面量输出
+            insertUpTo(pos + 1);
+            size_t nextDist = 0;
+            if (findMatch(pos + 1, nextDist) > len) {
+                ++pos;
+                continue;
+            }
+        }
+        if (!len) {
+            ++pos;
+            continue;
+        }
+
+        flushLiterals(pos);
+        size_t code = dist - 1;
+        output.push_back(static_cast<uint8_t>(0x80 | (code >> 3)));
+        output.push_back(static_cast<uint8_t>(((code & 7) << 5) | (len - 1)));
+        pos += len;
+        literalStart = pos;
+    }
+    flushLiterals(n);
+
+    // 解包时只对大于 1024 字节的数据做 LZ 解压，压得太小的 (原文件 > 1024) 改用字面量编码以免被当成未压缩数据
+    if (output.size() <= 1024) {
+        return lz_store(input);
     }
+    return output;
+}
 
-    output.resize(compress_buf_size);
+// Zlib压缩
+std::vector<uint8_t> compress_zlib(const std::vector<uint8_t>& input, ZlibLevel level) {
+    std::vector<uint8_t> output;
+    if (!ZlibCodec::threadLocal().deflate(input.data(), input.size(), output, level)) {
+        throw std::runtime_error("Zlib compression failed");
+    }
     return output;
 }
 
-// 封包函数
-void pack_files(const std::string& input_dir, const std::string& output_file, int version, bool lz) {
+// 封包函数。各文件的 LZ/zlib 压缩在线程池中进行，结果按文件名顺序写出，输出与单线程相同
+void pack_files(const std::string& input_dir, const std::string& output_file, int version, bool lz, ZlibLevel level, unsigned int num_threads) {
     std::vector<std::filesystem::path> files;
 
     // 收集所有文件并排序
@@ -134,63 +207,80 @@ void pack_files(const std::string& input_dir, const std::string& output_file, in
         throw std::runtime_error("Failed to create output file");
     }
 
+    struct PackedFile {
+        size_t raw_size = 0;
+        std::vector<uint8_t> data;
+    };
+    std::vector<PackedFile> packed(files.size());
+    std::atomic<size_t> next_index{ 0 };
+    std::exception_ptr error;
+    std::atomic<bool> failed{ false };
+
+    auto worker = [&]() {
+        size_t i;
+        while (!failed && (i = next_index++) < files.size()) {
+            try {
+                // 读取输入文件
+                std::ifstream in(files[i], std::ios::binary);
+                std::vector<uint8_t> data(
+                    (std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+                packed[i].raw_size = data.size();
+
+                // 压缩数据
+                if (lz && data.size() > 1024) {
+                    data = lz_compress(data);
+                }
+                if (version != 3) {
+                    data = compress_zlib(data, level);
+                }
+                packed[i].data = std::move(data);
+            }
+            catch (...) {
+                if (!failed.exchange(true)) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, std::max<size_t>(files.size(), 1)));
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
     // 写入文件数量
     uint32_t count = static_cast<uint32_t>(files.size());
     out.write(reinterpret_cast<char*>(&count), sizeof(count));
 
-    // 预留偏移表空间
+    // 计算偏移表后与数据一起写出
     std::vector<uint32_t> offsets(count);
-    out.seekp(sizeof(uint32_t) * (count + 1));
-
-    // 处理每个文件
     uint32_t current_offset = sizeof(uint32_t) * (count + 1);
-
     for (size_t i = 0; i < files.size(); ++i) {
-        // 读取输入文件
-        std::ifstream in(files[i], std::ios::binary);
-        std::vector<uint8_t> data(
-            (std::istreambuf_iterator<char>(in)),
-            std::istreambuf_iterator<char>());
-
-        // 记录偏移
         offsets[i] = current_offset;
+        current_offset += static_cast<uint32_t>(packed[i].data.size()) + (version == 2 ? 4 : 0);
+    }
+    out.write(reinterpret_cast<char*>(offsets.data()), sizeof(uint32_t) * count);
 
-        // 压缩数据
-        std::vector<uint8_t> lz_compressed;
-        if (lz && data.size() > 1024) {
-            lz_compressed = lz_compress(data);
-        }
-        else {
-            lz_compressed = data;
-        }
-
-        std::vector<uint8_t> zlib_compressed;
-        if (version != 3) {
-            zlib_compressed = compress_zlib(lz_compressed);
-        }
-        else {
-            zlib_compressed = lz_compressed;
-        }
-
+    for (size_t i = 0; i < files.size(); ++i) {
         // 写入标记和压缩数据
         if (version == 2) {
             uint32_t mark = 1;
             out.write(reinterpret_cast<char*>(&mark), sizeof(mark));
-            current_offset += 4;
         }
-        out.write(reinterpret_cast<char*>(zlib_compressed.data()), zlib_compressed.size());
-
-        // 更新偏移
-        current_offset +=  zlib_compressed.size();
+        out.write(reinterpret_cast<char*>(packed[i].data.data()), packed[i].data.size());
 
-        std::cout << "Packed file " << files[i] << " (Size: " << data.size()
-            << " -> " << zlib_compressed.size() << " bytes)" << std::endl;
+        std::cout << "Packed file " << files[i] << " (Size: " << packed[i].raw_size
+            << " -> " << packed[i].data.size() << " bytes)" << std::endl;
     }
 
-    // 写回偏移表
-    out.seekp(sizeof(uint32_t));
-    out.write(reinterpret_cast<char*>(offsets.data()), sizeof(uint32_t) * count);
-
     std::cout << "Packing complete!" << std::endl;
 }
 
@@ -199,8 +289,10 @@ int main(int argc, char* argv[]) {
         std::cout << "Made by julixian 2025.03.08" << std::endl;
         std::cout << "Usage: " << std::endl;
         std::cout << "For extract: " << argv[0] << " -e [--lz] <input_file> <output_dir>" << std::endl;
-        std::cout << "For pack: " << argv[0] << " -p <version> [--lz] <input_dir> <output_file>" << std::endl;
+        std::cout << "For pack: " << argv[0] << " -p <version> [--lz] [--level fast|balanced|max] [--threads N] <input_dir> <output_file>" << std::endl;
         std::cout << "--lz: " << "decompress/compress file using lzss method when extracting/packing" << std::endl;
+        std::cout << "--level: " << "zlib compression level when packing, default max" << std::endl;
+        std::cout << "--threads: " << "number of compression threads when packing, default is the number of CPU cores" << std::endl;
         std::cout << "version: 1/2/3, will show when extracting" << std::endl;
         return 1;
     }
@@ -256,12 +348,11 @@ int main(int argc, char* argv[]) {
                     if (size >= 4 && *reinterpret_cast<uint32_t*>(data.data()) == 1 &&
                         size >= 5 && data[4] == 0x78) {
                         version2++;
-                        std::vector<uint8_t> zlib_data(data.begin() + 4, data.end());
-                        zlib_decompressed = decompress_zlib(zlib_data);
+                        zlib_decompressed = decompress_zlib(data.data() + 4, size - 4);
                     }
                     else if (data[0] == 0x78) {
                         version1++;
-                        zlib_decompressed = decompress_zlib(data);
+                        zlib_decompressed = decompress_zlib(data.data(), size);
                     }
                     else {
                         version3++;
@@ -310,12 +401,28 @@ int main(int argc, char* argv[]) {
         }
         else if (mode == "-p") {
             int version;
-            bool lz;
+            bool lz = false;
+            ZlibLevel level = ZlibLevel::Max;
+            unsigned int num_threads = defaultThreadCount();
             int argOffset = 2;
 
             version = std::stol(std::string(argv[argOffset++]));
-            lz = std::string(argv[argOffset++]) == "--lz";
-            pack_files(input_path, output_path, version, lz);
+            for (; argOffset < argc - 2; ++argOffset) {
+                std::string option = argv[argOffset];
+                if (option == "--lz") {
+                    lz = true;
+                }
+                else if (option == "--level" && argOffset + 1 < argc - 2 && parseZlibLevel(argv[argOffset + 1], level)) {
+                    ++argOffset;
+                }
+                else if (option == "--threads" && argOffset + 1 < argc - 2 && std::stoul(argv[argOffset + 1]) > 0) {
+                    num_threads = std::stoul(argv[++argOffset]);
+                }
+                else {
+                    throw std::runtime_error("Unknown option: " + option);
+                }
+            }
+            pack_files(input_path, output_path, version, lz, level, num_threads);
         }
         else {
             std::cout << "Invalid mode. Use -e for extract or -p for create." << std::endl;
@@ -6,6 +6,9 @@
 #include <filesystem>
 #include <algorithm>
 #include <map>
+#include <memory>
+#include "MappedFile.h"
+#include "PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -26,6 +29,14 @@ std::string readCString(std::ifstream& file, uint32_t offset) {
     return result;
 }
 
+std::string readCString(ByteSpan data, uint64_t offset) {
+    std::string result;
+    while (offset < data.size() && data.u8(offset) != 0) {
+        result += static_cast<char>(data.u8(offset++));
+    }
+    return result;
+}
+
 bool extractCAF(const std::string& filename, const std::string& outputDir) {
     std::ifstream file(filename, std::ios::binary);
     if (!file) {
@@ -95,11 +106,15 @@ bool extractCAF(const std::string& filename, const std::string& outputDir) {
 }
 
 bool updateCAF(const std::string& originalFile, const std::string& updateDir, const std::string& outputFile) {
-    std::ifstream inFile(originalFile, std::ios::binary);
-    if (!inFile) {
+    std::unique_ptr<MappedFile> inFile;
+    try {
+        inFile = std::make_unique<MappedFile>(originalFile);
+    }
+    catch (const std::exception&) {
         std::cerr << "Failed to open original file: " << originalFile << std::endl;
         return false;
     }
+    ByteSpan archive = inFile->span();
 
     std::ofstream outFile(outputFile, std::ios::binary);
     if (!outFile) {
@@ -107,92 +122,75 @@ bool updateCAF(const std::string& originalFile, const std::string& updateDir, co
         return false;
     }
 
-    // Read and write header
-    uint32_t signature, count, indexOffset, indexSize, namesOffset, namesSize;
-    inFile.read(reinterpret_cast<char*>(&signature), 4);
-    inFile.seekg(8);
-    inFile.read(reinterpret_cast<char*>(&count), 4);
-    inFile.read(reinterpret_cast<char*>(&indexOffset), 4);
-    inFile.read(reinterpret_cast<char*>(&indexSize), 4);
-    inFile.read(reinterpret_cast<char*>(&namesOffset), 4);
-    inFile.read(reinterpret_cast<char*>(&namesSize), 4);
-
-    outFile.write(reinterpret_cast<char*>(&signature), 4);
-    outFile.seekp(8);
-    outFile.write(reinterpret_cast<char*>(&count), 4);
-    outFile.write(reinterpret_cast<char*>(&indexOffset), 4);
-    outFile.write(reinterpret_cast<char*>(&indexSize), 4);
-    outFile.write(reinterpret_cast<char*>(&namesOffset), 4);
-    outFile.write(reinterpret_cast<char*>(&namesSize), 4);
-
-    // Copy the rest of the header
-    inFile.seekg(0);
-    outFile.seekp(0);
-    std::vector<char> buffer(namesOffset + namesSize);
-    inFile.read(buffer.data(), buffer.size());
-    outFile.write(buffer.data(), buffer.size());
-
-    // Read entries
-    std::vector<Entry> entries;
-    inFile.seekg(indexOffset);
-    for (uint32_t i = 0; i < count; ++i) {
-        Entry entry;
-        uint32_t dirNameOffset, nameOffset;
-        entry.indexOffset = indexOffset + i * 0x14;
-        inFile.seekg(entry.indexOffset + 4);
-        inFile.read(reinterpret_cast<char*>(&dirNameOffset), 4);
-        inFile.read(reinterpret_cast<char*>(&nameOffset), 4);
-        inFile.read(reinterpret_cast<char*>(&entry.offset), 4);
-        inFile.read(reinterpret_cast<char*>(&entry.size), 4);
-
-        std::string dirName = (dirNameOffset >= 0) ? readCString(inFile, namesOffset + dirNameOffset) : "";
-        std::string fileName = readCString(inFile, namesOffset + nameOffset);
-        entry.name = dirName.empty() ? fileName : dirName + "/" + fileName;
-        entry.offset += namesOffset + namesSize;
-
-        entries.push_back(entry);
-    }
-
-    // Update entries and write new data
-    uint32_t currentOffset = namesOffset + namesSize;
-    for (auto& entry : entries) {
-        fs::path updatePath = fs::path(updateDir) / entry.name;
-        if (fs::exists(updatePath) && fs::is_regular_file(updatePath)) {
-            // Update with new file
-            std::ifstream newFile(updatePath, std::ios::binary | std::ios::ate);
-            std::streamsize newSize = newFile.tellg();
-            newFile.seekg(0, std::ios::beg);
-
-            entry.offset = currentOffset;
-            entry.size = static_cast<uint32_t>(newSize);
-
-            std::vector<char> newData(newSize);
-            newFile.read(newData.data(), newSize);
-            outFile.seekp(currentOffset);
-            outFile.write(newData.data(), newSize);
-
-            currentOffset += entry.size;
-            std::cout << "Updated: " << entry.name << std::endl;
+    struct CafPackItem : PackItem {
+        uint32_t indexOffset = 0;
+        uint64_t originalOffset = 0;
+        uint32_t originalSize = 0;
+        bool updated = false;
+    };
+
+    try {
+        // Read header
+        uint32_t count = archive.u32le(8);
+        uint32_t indexOffset = archive.u32le(12);
+        uint32_t namesOffset = archive.u32le(20);
+        uint32_t namesSize = archive.u32le(24);
+        uint64_t dataStart = (uint64_t)namesOffset + namesSize;
+
+        // Read entries
+        std::vector<CafPackItem> entries(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            CafPackItem& entry = entries[i];
+            entry.indexOffset = indexOffset + i * 0x14;
+            uint32_t dirNameOffset = archive.u32le(entry.indexOffset + 4);
+            uint32_t nameOffset = archive.u32le(entry.indexOffset + 8);
+            entry.originalOffset = archive.u32le(entry.indexOffset + 12) + dataStart;
+            entry.originalSize = archive.u32le(entry.indexOffset + 16);
+
+            std::string dirName = readCString(archive, namesOffset + (uint64_t)dirNameOffset);
+            std::string fileName = readCString(archive, namesOffset + (uint64_t)nameOffset);
+            entry.name = dirName.empty() ? fileName : dirName + "/" + fileName;
+
+            fs::path updatePath = fs::path(updateDir) / entry.name;
+            if (fs::exists(updatePath) && fs::is_regular_file(updatePath)) {
+                entry.path = updatePath;
+                entry.updated = true;
+            }
         }
-        else {
-            // Copy original data
-            inFile.seekg(entry.offset);
-            buffer.resize(entry.size);
-            inFile.read(buffer.data(), entry.size);
-            outFile.seekp(currentOffset);
-            outFile.write(buffer.data(), entry.size);
-
-            entry.offset = currentOffset;
-            currentOffset += entry.size;
-        }
-    }
 
-    // Update index
-    for (const auto& entry : entries) {
-        outFile.seekp(entry.indexOffset + 12);
-        uint32_t relativeOffset = entry.offset - (namesOffset + namesSize);
-        outFile.write(reinterpret_cast<const char*>(&relativeOffset), 4);
-        outFile.write(reinterpret_cast<const char*>(&entry.size), 4);
+        PackHooks<CafPackItem> hooks;
+        // 未替换的条目从映射的原文件复制原始数据
+        hooks.transform = [&](CafPackItem& entry) {
+            if (!entry.updated) {
+                ByteSpan data = archive.sub(entry.originalOffset, entry.originalSize);
+                entry.data.assign(data.data(), data.data() + data.size());
+            }
+        };
+        hooks.written = [](const CafPackItem& entry) {
+            if (entry.updated) {
+                std::cout << "Updated: " << entry.name << std::endl;
+            }
+        };
+        // 复制头部、索引和文件名区，再更新索引中的偏移和大小
+        hooks.emitIndex = [&](std::ostream& out, std::vector<CafPackItem>& entries, uint64_t) {
+            ByteSpan header = archive.sub(0, dataStart);
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+            for (const auto& entry : entries) {
+                out.seekp(entry.indexOffset + 12);
+                uint32_t relativeOffset = static_cast<uint32_t>(entry.offset - dataStart);
+                uint32_t size = static_cast<uint32_t>(entry.size);
+                out.write(reinterpret_cast<const char*>(&relativeOffset), 4);
+                out.write(reinterpret_cast<const char*>(&size), 4);
+            }
+        };
+
+        runPackPipeline(outFile, entries, dataStart, hooks);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
     }
 
     std::cout << "CAF file updated successfully: " << outputFile << std::endl;
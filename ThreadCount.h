@@ -0,0 +1,9 @@
+﻿#pragma once
+
+#include <thread>
+
+// 各工具默认的工作线程数：硬件线程数，取不到 (hardware_concurrency 返回 0) 时用 4
+inline unsigned int defaultThreadCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 4 : n;
+}
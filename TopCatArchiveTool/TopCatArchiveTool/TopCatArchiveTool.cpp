@@ -1,5 +1,8 @@
-﻿#include <Windows.h>
+﻿#define NOMINMAX
+#include <Windows.h>
+#include <emmintrin.h>
 #include <cstdint>
+#include "../../MappedFile.h"
 
 import std;
 namespace fs = std::filesystem;
@@ -64,8 +67,14 @@ const std::vector<std::string> SECTION_EXTENSIONS = { ".TCT", ".TSF", ".SPD", ".
 // -----------------------------------------------------------------------------
 
 void decryptNames(std::vector<char>& buffer, char key) {
-    for (char& c : buffer) {
-        c -= key;
+    size_t i = 0;
+    const __m128i keyVec = _mm_set1_epi8(key);
+    for (; i + 16 <= buffer.size(); i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer.data() + i), _mm_sub_epi8(v, keyVec));
+    }
+    for (; i < buffer.size(); ++i) {
+        buffer[i] -= key;
     }
 }
 
@@ -83,110 +92,195 @@ std::string getNameFromBuffer(const std::vector<char>& names, uint32_t nameLengt
     return std::string(buffer);
 }
 
-// -----------------------------------------------------------------------------
-// Core Logic
-// -----------------------------------------------------------------------------
-
-void extractArchive(const fs::path& archivePath, const fs::path& outputDir) {
-    std::ifstream ifs(archivePath, std::ios::binary);
-    std::ofstream ofs;
-    if (!ifs) {
-        throw std::runtime_error("Failed to open TCD file: " + wide2Ascii(archivePath.wstring()));
+template<typename T>
+std::vector<T> copyArray(const ByteSpan& file, uint64_t& pos, size_t count) {
+    ByteSpan bytes = file.sub(pos, (uint64_t)count * sizeof(T));
+    std::vector<T> result(count);
+    if (count != 0) {
+        memcpy(result.data(), bytes.data(), bytes.size());
     }
+    pos += bytes.size();
+    return result;
+}
+
+struct TcdSection {
+    uint32_t headerOffset = 0;
+    TcdSectionHeader header = { 0 };
+    std::vector<char> dirNames;   // 已解密
+    std::vector<TcdDirEntry> dirs;
+    std::vector<char> fileNames;  // 已解密
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> tctAbsOffsetsTable;
+    std::vector<uint8_t> unknownData; // 未解密
+    // 原始索引区在文件中的范围，以及其中偏移表和 TCT 跳转表的相对位置
+    uint64_t indexSize = 0;
+    uint64_t offsetsPos = 0;
+    uint64_t tctAbsOffsetsPos = 0;
+};
 
-    // Enable exceptions for read errors
-    ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+struct TcdArchive {
+    uint32_t signature = 0;
+    uint32_t totalFiles = 0;
+    uint32_t totalSections = 0;
+    std::vector<TcdSection> sections;
+};
 
-    uint32_t signature;
-    uint32_t totalFiles;
-    ifs.read(reinterpret_cast<char*>(&signature), sizeof(signature));
-    ifs.read(reinterpret_cast<char*>(&totalFiles), sizeof(totalFiles));
+// 一次性解析所有分区头与索引
+TcdArchive parseArchive(const ByteSpan& file) {
+    TcdArchive archive;
+    uint64_t pos = 0;
+    archive.signature = copyArray<uint32_t>(file, pos, 1)[0];
+    archive.totalFiles = copyArray<uint32_t>(file, pos, 1)[0];
 
-    uint32_t totalSections;
-    if (signature == 0x32444354) { // TCD2{
-        totalSections = 4;
+    if (archive.signature == 0x32444354) { // TCD2
+        archive.totalSections = 4;
     }
-    else if (signature == 0x33444354) { // TCD3
-        totalSections = 5;
+    else if (archive.signature == 0x33444354) { // TCD3
+        archive.totalSections = 5;
     }
     else {
         throw std::runtime_error("Invalid TCD signature.");
     }
+    bool isTcd2 = archive.totalSections == 4;
+
+    std::vector<uint32_t> rawHeaders = copyArray<uint32_t>(file, pos, archive.totalSections * 8);
+    archive.sections.resize(archive.totalSections);
+
+    for (uint32_t i = 0; i < archive.totalSections; ++i) {
+        TcdSection& section = archive.sections[i];
+        section.headerOffset = 8 + i * 0x20;
+        const uint32_t* h = &rawHeaders[i * 8];
+        TcdSectionHeader& header = section.header;
+        header.dataSize = h[0];
+        if (header.dataSize == 0) {
+            continue;
+        }
+
+        if (isTcd2) {
+            header.fileCount = h[1];
+            header.dirCount = h[2];
+            header.indexOffset = h[3];
+            header.dirNameLength = h[4];
+            header.fileNameLength = h[5];
+            header.tctAbsOffsetCount = h[6];
+            header.unknownDataSize = h[7];
+        }
+        else {
+            header.indexOffset = h[1];
+            header.dirCount = h[2];
+            header.dirNameLength = h[3];
+            header.fileCount = h[4];
+            header.fileNameLength = h[5];
+            header.tctAbsOffsetCount = h[6];
+            header.unknownDataSize = h[7];
+        }
 
-    uint32_t currentSectionOffset = 8;
+        uint64_t indexPos = header.indexOffset;
+        section.dirNames = copyArray<char>(file, indexPos, header.dirNameLength * (isTcd2 ? 1 : header.dirCount));
+        if (section.dirNames.empty()) {
+            throw std::runtime_error("Empty directory name table.");
+        }
+        char sectionKey = section.dirNames.back();
+        decryptNames(section.dirNames, sectionKey);
 
-    for (uint32_t i = 0; i < totalSections; ++i) {
-        ifs.seekg(currentSectionOffset);
+        section.dirs = copyArray<TcdDirEntry>(file, indexPos, header.dirCount);
 
-        TcdSectionHeader section;
-        ifs.read(reinterpret_cast<char*>(&section.dataSize), sizeof(uint32_t));
+        section.fileNames = copyArray<char>(file, indexPos, header.fileNameLength * (isTcd2 ? 1 : header.fileCount));
+        decryptNames(section.fileNames, sectionKey);
 
-        // Store current position to advance to next section later
-        uint32_t nextSectionPos = currentSectionOffset + 0x20;
+        section.offsetsPos = indexPos - header.indexOffset;
+        section.offsets = copyArray<uint32_t>(file, indexPos, header.fileCount + 1);
 
-        if (section.dataSize == 0) {
-            currentSectionOffset = nextSectionPos;
-            continue;
+        if (i == 0 && header.tctAbsOffsetCount > 0) {
+            indexPos += (uint64_t)(header.fileCount + 1) * sizeof(uint32_t); // tctAbsOffsetsIndex
+            section.tctAbsOffsetsPos = indexPos - header.indexOffset;
+            section.tctAbsOffsetsTable = copyArray<uint32_t>(file, indexPos, header.tctAbsOffsetCount);
+            section.unknownData = copyArray<uint8_t>(file, indexPos, header.unknownDataSize * (isTcd2 ? 1 : header.tctAbsOffsetCount));
+            indexPos += (uint64_t)(header.fileCount + 1) * sizeof(uint32_t); // unknownTable
         }
+        section.indexSize = indexPos - header.indexOffset;
+        file.at(header.indexOffset, section.indexSize);
+    }
+    return archive;
+}
 
-        if (totalSections == 4) {
-            ifs.read(reinterpret_cast<char*>(&section.fileCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.indexOffset), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.tctAbsOffsetCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.unknownDataSize), sizeof(uint32_t));
+// 按目录顺序遍历分区内的文件，回调参数为相对路径与文件序号
+template<typename Func>
+void forEachFile(const TcdSection& section, uint32_t sectionIndex, bool isTcd2, Func&& func) {
+    uint32_t dirNameOffset = 0;
+    for (const auto& dir : section.dirs) {
+        std::string dirName;
+        if (isTcd2) {
+            dirName = getNameFromBuffer(section.dirNames, dirNameOffset);
+            dirNameOffset += static_cast<uint32_t>(dirName.length() + 1);
         }
-        else if (totalSections == 5) {
-            ifs.read(reinterpret_cast<char*>(&section.indexOffset), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.tctAbsOffsetCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.unknownDataSize), sizeof(uint32_t));
+        else {
+            dirName = getNameFromBuffer(section.dirNames, section.header.dirNameLength, dirNameOffset);
         }
 
-        // Read Directory Names
-        ifs.seekg(section.indexOffset);
-        std::vector<char> dirNames(section.dirNameLength * (totalSections == 4 ? 1 : section.dirCount));
-        ifs.read(dirNames.data(), dirNames.size());
+        uint32_t fileIndex = dir.firstIndex;
+        uint32_t fileNameOffset = dir.namesOffset;
+
+        for (uint32_t k = 0; k < dir.fileCount; ++k) {
+            std::string fileName;
+            if (isTcd2) {
+                fileName = getNameFromBuffer(section.fileNames, fileNameOffset);
+                fileNameOffset += static_cast<uint32_t>(fileName.length() + 1);
+            }
+            else {
+                fileName = getNameFromBuffer(section.fileNames, section.header.fileNameLength, fileNameOffset);
+            }
 
-        char sectionKey = dirNames.back();
-        decryptNames(dirNames, sectionKey);
+            // Construct path and enforce extension
+            fs::path relPath = fs::path(ascii2Wide(dirName, 932)) / ascii2Wide(fileName, 932);
+            relPath.replace_extension(SECTION_EXTENSIONS[sectionIndex]);
 
-        // Read Directory Entries
-        std::vector<TcdDirEntry> dirs(section.dirCount);
-        for (auto& dir : dirs) {
-            ifs.read(reinterpret_cast<char*>(&dir), sizeof(TcdDirEntry));
+            if (fileIndex >= section.header.fileCount) {
+                throw std::runtime_error(std::format("File index {} out of range in section {}.", fileIndex, sectionIndex));
+            }
+            func(relPath, fileIndex);
+            fileIndex++;
         }
+    }
+}
+
+// 大块写出，避免 ofstream 对超大 span 的单次 write 受 streamsize 限制
+void writeSpan(std::ofstream& ofs, ByteSpan data) {
+    const size_t blockSize = 64 * 1024 * 1024;
+    for (size_t pos = 0; pos < data.size(); pos += blockSize) {
+        size_t length = std::min(blockSize, data.size() - pos);
+        ofs.write(reinterpret_cast<const char*>(data.data() + pos), length);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Core Logic
+// -----------------------------------------------------------------------------
 
-        // Read File Names
-        std::vector<char> fileNames(section.fileNameLength * (totalSections == 4 ? 1 : section.fileCount));
-        ifs.read(fileNames.data(), fileNames.size());
-        decryptNames(fileNames, sectionKey);
+void extractArchive(const fs::path& archivePath, const fs::path& outputDir) {
+    MappedFile mapping(archivePath);
+    const ByteSpan file = mapping.span();
+    TcdArchive archive = parseArchive(file);
+    bool isTcd2 = archive.totalSections == 4;
+    std::ofstream ofs;
 
-        // Read Offsets
-        std::vector<uint32_t> offsets(section.fileCount + 1);
-        ifs.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    for (uint32_t i = 0; i < archive.totalSections; ++i) {
+        const TcdSection& section = archive.sections[i];
+        if (section.header.dataSize == 0) {
+            continue;
+        }
 
-        if (i == 0 && section.tctAbsOffsetCount > 0) {
-            std::vector<uint32_t> tctAbsOffsetsIndex(section.fileCount + 1);
-            ifs.read(reinterpret_cast<char*>(tctAbsOffsetsIndex.data()), tctAbsOffsetsIndex.size() * sizeof(uint32_t));
-            std::vector<uint32_t> tctAbsOffsetsTable(section.tctAbsOffsetCount);
-            ifs.read(reinterpret_cast<char*>(tctAbsOffsetsTable.data()), tctAbsOffsetsTable.size() * sizeof(uint32_t));
+        if (i == 0 && section.header.tctAbsOffsetCount > 0) {
             ofs.open(L"tct_abs_offsets.txt");
             if (!ofs) {
                 throw std::runtime_error("Failed to open TCT absolute offset file.");
             }
-            for (uint32_t absOffset : tctAbsOffsetsTable) {
+            for (uint32_t absOffset : section.tctAbsOffsetsTable) {
                 ofs << std::format("{:08X}\n", absOffset);
             }
             ofs.close();
-            std::vector<uint8_t> unknownData(section.unknownDataSize * (totalSections == 4 ? 1 : section.tctAbsOffsetCount));
-            ifs.read(reinterpret_cast<char*>(unknownData.data()), unknownData.size());
-            uint8_t unkownDataKey = unknownData.back();
+            std::vector<uint8_t> unknownData = section.unknownData;
+            uint8_t unkownDataKey = unknownData.empty() ? 0 : unknownData.back();
             for (uint8_t& c : unknownData) {
                 c -= unkownDataKey;
             }
@@ -198,297 +292,163 @@ void extractArchive(const fs::path& archivePath, const fs::path& outputDir) {
             ofs.close();
         }
 
-        // Process Directories and Files
-        uint32_t dirNameOffset = 0;
-        for (const auto& dir : dirs) {
-            std::string dirName;
-            if (totalSections == 4) {
-                dirName = getNameFromBuffer(dirNames, dirNameOffset);
-                dirNameOffset += static_cast<uint32_t>(dirName.length() + 1);
-            }
-            else if (totalSections == 5) {
-                dirName = getNameFromBuffer(dirNames, section.dirNameLength, dirNameOffset);
-            }
+        forEachFile(section, i, isTcd2, [&](const fs::path& relPath, uint32_t fileIndex) {
+            fs::path fullPath = outputDir / relPath;
 
-            uint32_t fileIndex = dir.firstIndex;
-            uint32_t fileNameOffset = dir.namesOffset;
-
-            for (uint32_t k = 0; k < dir.fileCount; ++k) {
-                std::string fileName;
-                if (totalSections == 4) {
-                    fileName = getNameFromBuffer(fileNames, fileNameOffset);
-                    fileNameOffset += static_cast<uint32_t>(fileName.length() + 1);
-                }
-                else if (totalSections == 5) {
-                    fileName = getNameFromBuffer(fileNames, section.fileNameLength, fileNameOffset);
-                }
-
-                // Construct path and enforce extension
-                fs::path relPath = fs::path(ascii2Wide(dirName, 932)) / ascii2Wide(fileName, 932);
-                relPath.replace_extension(SECTION_EXTENSIONS[i]);
-
-                fs::path fullPath = outputDir / relPath;
-
-                // Create directory if needed
-                if (!fs::exists(fullPath.parent_path())) {
-                    fs::create_directories(fullPath.parent_path());
-                }
-
-                uint32_t fileOffset = offsets[fileIndex];
-                uint32_t fileSize = offsets[fileIndex + 1] - offsets[fileIndex];
-
-                // Extract data
-                std::vector<char> dataBuffer(fileSize);
-
-                ifs.seekg(fileOffset);
-                ifs.read(dataBuffer.data(), fileSize);
-
-                ofs.open(fullPath, std::ios::binary);
-                if (!ofs) {
-                    throw std::runtime_error(std::format("Failed to open output file: {}", wide2Ascii(fullPath.wstring())));
-                }
-                else {
-                    ofs.write(dataBuffer.data(), fileSize);
-                    std::println("Extracted: {}", wide2Ascii(relPath.wstring()));
-                }
-                ofs.close();
-
-                fileIndex++;
+            // Create directory if needed
+            if (!fs::exists(fullPath.parent_path())) {
+                fs::create_directories(fullPath.parent_path());
             }
-        }
 
-        currentSectionOffset = nextSectionPos;
+            uint32_t fileOffset = section.offsets[fileIndex];
+            uint32_t fileSize = section.offsets[fileIndex + 1] - section.offsets[fileIndex];
+
+            // 直接从映射视图写出，不经过中间缓冲
+            ByteSpan data = file.sub(fileOffset, fileSize);
+            ofs.open(fullPath, std::ios::binary);
+            if (!ofs) {
+                throw std::runtime_error(std::format("Failed to open output file: {}", wide2Ascii(fullPath.wstring())));
+            }
+            writeSpan(ofs, data);
+            ofs.close();
+            std::println("Extracted: {}", wide2Ascii(relPath.wstring()));
+        });
     }
 }
 
 void repackArchive(const fs::path& origArchivePath, const fs::path& modifiedDir, const fs::path& outputArchivePath, std::optional<fs::path> tctAbsOffsetFile) {
+    MappedFile mapping(origArchivePath);
+    const ByteSpan file = mapping.span();
+    TcdArchive archive = parseArchive(file);
+    bool isTcd2 = archive.totalSections == 4;
 
-    std::ifstream ifs(origArchivePath, std::ios::binary);
     std::ofstream ofs(outputArchivePath, std::ios::binary);
-    if (!ifs) {
-        throw std::runtime_error("Failed to open TCD file: " + wide2Ascii(origArchivePath.wstring()));
-    }
     if (!ofs) {
         throw std::runtime_error("Failed to open output TCD file: " + wide2Ascii(outputArchivePath.wstring()));
     }
 
-    // Enable exceptions for read errors
-    ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    uint32_t signature;
-    uint32_t totalFiles;
-    ifs.read(reinterpret_cast<char*>(&signature), sizeof(signature));
-    ifs.read(reinterpret_cast<char*>(&totalFiles), sizeof(totalFiles));
-    ofs.write(reinterpret_cast<char*>(&signature), sizeof(signature));
-    ofs.write(reinterpret_cast<char*>(&totalFiles), sizeof(totalFiles));
-
-    uint32_t totalSections;
-    if (signature == 0x32444354) { // TCD2{
-        totalSections = 4;
-    }
-    else if (signature == 0x33444354) { // TCD3
-        totalSections = 5;
-    }
-    else {
-        throw std::runtime_error("Invalid TCD signature.");
-    }
-
-    uint32_t currentSectionOffset = 8;
-    for (uint32_t i = 0; i < totalSections; ++i) {
-        TcdSectionHeader section = { 0 };
-        ofs.write(reinterpret_cast<char*>(&section), sizeof(TcdSectionHeader));
-    }
-
-    for (uint32_t i = 0; i < totalSections; ++i) {
-        ifs.seekg(currentSectionOffset);
-
-        TcdSectionHeader section;
-        ifs.read(reinterpret_cast<char*>(&section.dataSize), sizeof(uint32_t));
+    ofs.write(reinterpret_cast<char*>(&archive.signature), sizeof(archive.signature));
+    ofs.write(reinterpret_cast<char*>(&archive.totalFiles), sizeof(archive.totalFiles));
+    // 分区头最后回填，原档案中 dataSize 为 0 的分区保持全零
+    std::vector<uint32_t> newHeaders(archive.totalSections * 8, 0);
+    ofs.write(reinterpret_cast<char*>(newHeaders.data()), newHeaders.size() * sizeof(uint32_t));
 
-        // Store current position to advance to next section later
-        uint32_t nextSectionPos = currentSectionOffset + 0x20;
+    std::vector<char> readBuffer;
 
-        if (section.dataSize == 0) {
-            currentSectionOffset = nextSectionPos;
+    for (uint32_t i = 0; i < archive.totalSections; ++i) {
+        const TcdSection& section = archive.sections[i];
+        if (section.header.dataSize == 0) {
             continue;
         }
+        const TcdSectionHeader& header = section.header;
 
-        if (totalSections == 4) {
-            ifs.read(reinterpret_cast<char*>(&section.fileCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.indexOffset), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.tctAbsOffsetCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.unknownDataSize), sizeof(uint32_t));
-        }
-        else if (totalSections == 5) {
-            ifs.read(reinterpret_cast<char*>(&section.indexOffset), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.dirNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.fileNameLength), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.tctAbsOffsetCount), sizeof(uint32_t));
-            ifs.read(reinterpret_cast<char*>(&section.unknownDataSize), sizeof(uint32_t));
-        }
+        ByteSpan origIndex = file.sub(header.indexOffset, section.indexSize);
+        std::vector<uint8_t> newIndexData(origIndex.data(), origIndex.data() + origIndex.size());
 
-        TcdSectionHeader newSectionHeader = section;
-        std::vector<uint8_t> newIndexData;
-        std::vector<std::vector<uint8_t>> newFileData(section.fileCount);
-
-        // Read Directory Names
-        ifs.seekg(section.indexOffset);
-        std::vector<char> dirNames(section.dirNameLength * (totalSections == 4 ? 1 : section.dirCount));
-        ifs.read(dirNames.data(), dirNames.size());
-        newIndexData.insert(newIndexData.end(), dirNames.begin(), dirNames.end());
-
-        char sectionKey = dirNames.back();
-        decryptNames(dirNames, sectionKey);
-
-        // Read Directory Entries
-        std::vector<TcdDirEntry> dirs(section.dirCount);
-        for (auto& dir : dirs) {
-            ifs.read(reinterpret_cast<char*>(&dir), sizeof(TcdDirEntry));
-            newIndexData.insert(newIndexData.end(), reinterpret_cast<uint8_t*>(&dir), reinterpret_cast<uint8_t*>(&dir) + sizeof(TcdDirEntry));
+        if (i == 0 && header.tctAbsOffsetCount > 0 && tctAbsOffsetFile.has_value()) {
+            std::ifstream tctAbsOffsetInStream(tctAbsOffsetFile.value());
+            if (!tctAbsOffsetInStream) {
+                throw std::runtime_error("Failed to open TCT absolute offset file.");
+            }
+            std::string line;
+            std::vector<uint32_t> newTctAbsOffsetsTable;
+            while (std::getline(tctAbsOffsetInStream, line)) {
+                uint32_t absOffset = std::stoul(line, nullptr, 16);
+                newTctAbsOffsetsTable.push_back(absOffset);
+            }
+            if (newTctAbsOffsetsTable.size() != header.tctAbsOffsetCount) {
+                throw std::runtime_error(std::format("TCT absolute offset file has incorrect size (expected {}, got {}).", header.tctAbsOffsetCount, newTctAbsOffsetsTable.size()));
+            }
+            memcpy(newIndexData.data() + section.tctAbsOffsetsPos, newTctAbsOffsetsTable.data(), newTctAbsOffsetsTable.size() * sizeof(uint32_t));
         }
 
-        // Read File Names
-        std::vector<char> fileNames(section.fileNameLength * (totalSections == 4 ? 1 : section.fileCount));
-        ifs.read(fileNames.data(), fileNames.size());
-        newIndexData.insert(newIndexData.end(), fileNames.begin(), fileNames.end());
-        decryptNames(fileNames, sectionKey);
-
-        // Read Offsets
-        std::vector<uint32_t> offsets(section.fileCount + 1);
-        ifs.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
-        uint32_t fileOffsetIndex = (uint32_t)newIndexData.size();
-        newIndexData.insert(newIndexData.end(), reinterpret_cast<uint8_t*>(offsets.data()), reinterpret_cast<uint8_t*>(offsets.data()) + offsets.size() * sizeof(uint32_t));
-
-        bool hasTctAbsOffsets = (i == 0 && section.tctAbsOffsetCount > 0);
-        if (hasTctAbsOffsets) {
-            std::vector<uint32_t> tctAbsOffsetsIndex(section.fileCount + 1);
-            ifs.read(reinterpret_cast<char*>(tctAbsOffsetsIndex.data()), tctAbsOffsetsIndex.size() * sizeof(uint32_t));
-            newIndexData.insert(newIndexData.end(), reinterpret_cast<uint8_t*>(tctAbsOffsetsIndex.data()), reinterpret_cast<uint8_t*>(tctAbsOffsetsIndex.data()) + tctAbsOffsetsIndex.size() * sizeof(uint32_t));
-            std::vector<uint32_t> tctAbsOffsetsTable(section.tctAbsOffsetCount);
-            ifs.read(reinterpret_cast<char*>(tctAbsOffsetsTable.data()), tctAbsOffsetsTable.size() * sizeof(uint32_t));
-            if (tctAbsOffsetFile.has_value()) {
-                std::ifstream tctAbsOffsetInStream(tctAbsOffsetFile.value());
-                if (!tctAbsOffsetInStream) {
-                    throw std::runtime_error("Failed to open TCT absolute offset file.");
-                }
-                std::string line;
-                std::vector<uint32_t> newTctAbsOffsetsTable;
-                while (std::getline(tctAbsOffsetInStream, line)) {
-                    uint32_t absOffset = std::stoul(line, nullptr, 16);
-                    newTctAbsOffsetsTable.push_back(absOffset);
-                }
-                if (newTctAbsOffsetsTable.size() != section.tctAbsOffsetCount) {
-                    throw std::runtime_error(std::format("TCT absolute offset file has incorrect size (expected {}, got {}).", section.tctAbsOffsetCount, newTctAbsOffsetsTable.size()));
-                }
-                tctAbsOffsetsTable = std::move(newTctAbsOffsetsTable);
-            }
-            newIndexData.insert(newIndexData.end(), reinterpret_cast<uint8_t*>(tctAbsOffsetsTable.data()), reinterpret_cast<uint8_t*>(tctAbsOffsetsTable.data()) + tctAbsOffsetsTable.size() * sizeof(uint32_t));
-            std::vector<uint8_t> unknownData(section.unknownDataSize * (totalSections == 4 ? 1 : section.tctAbsOffsetCount));
-            ifs.read(reinterpret_cast<char*>(unknownData.data()), unknownData.size());
-            newIndexData.insert(newIndexData.end(), unknownData.begin(), unknownData.end());
-            std::vector<uint32_t> unknownTable(section.fileCount + 1);
-            ifs.read(reinterpret_cast<char*>(unknownTable.data()), unknownTable.size() * sizeof(uint32_t));
-            newIndexData.insert(newIndexData.end(), reinterpret_cast<uint8_t*>(unknownTable.data()), reinterpret_cast<uint8_t*>(unknownTable.data()) + unknownTable.size() * sizeof(uint32_t));
+        // 先确定每个文件的来源与大小，再按序号顺序流式写出
+        std::vector<fs::path> replacements(header.fileCount);
+        std::vector<uint64_t> newSizes(header.fileCount);
+        for (uint32_t j = 0; j < header.fileCount; ++j) {
+            newSizes[j] = section.offsets[j + 1] - section.offsets[j];
         }
+        forEachFile(section, i, isTcd2, [&](const fs::path& relPath, uint32_t fileIndex) {
+            fs::path fullPath = modifiedDir / relPath;
+            if (fs::exists(fullPath)) {
+                std::println("Replacing: {}", wide2Ascii(relPath.wstring()));
+                replacements[fileIndex] = fullPath;
+                newSizes[fileIndex] = fs::file_size(fullPath);
+            }
+            else {
+                std::println("Using original: {}", wide2Ascii(relPath.wstring()));
+            }
+        });
 
-        // Process Directories and Files
-        uint32_t dirNameOffset = 0;
-        for (const auto& dir : dirs) {
-            std::string dirName;
-            if (totalSections == 4) {
-                dirName = getNameFromBuffer(dirNames, dirNameOffset);
-                dirNameOffset += static_cast<uint32_t>(dirName.length() + 1);
+        ofs.seekp(0, std::ios::end);
+        uint64_t dataStart = (uint64_t)ofs.tellp();
+        std::vector<uint32_t> newOffsets(header.fileCount + 1);
+        uint64_t cursor = dataStart;
+        for (uint32_t j = 0; j < header.fileCount; ++j) {
+            newOffsets[j] = (uint32_t)cursor;
+            cursor += newSizes[j];
+        }
+        newOffsets[header.fileCount] = (uint32_t)cursor;
+        if (cursor > 0xFFFFFFFFull) {
+            throw std::runtime_error("Repacked archive exceeds 4 GB.");
+        }
+        memcpy(newIndexData.data() + section.offsetsPos, newOffsets.data(), newOffsets.size() * sizeof(uint32_t));
+
+        // 连续未修改的文件在原档案中也是连续的，合并为一次大块拷贝
+        uint32_t runStart = 0;
+        auto flushRun = [&](uint32_t runEnd) {
+            if (runEnd > runStart) {
+                uint32_t begin = section.offsets[runStart];
+                uint32_t end = section.offsets[runEnd];
+                writeSpan(ofs, file.sub(begin, end - begin));
             }
-            else if (totalSections == 5) {
-                dirName = getNameFromBuffer(dirNames, section.dirNameLength, dirNameOffset);
+        };
+        for (uint32_t j = 0; j < header.fileCount; ++j) {
+            if (replacements[j].empty()) {
+                continue;
             }
+            flushRun(j);
+            runStart = j + 1;
 
-            uint32_t fileIndex = dir.firstIndex;
-            uint32_t fileNameOffset = dir.namesOffset;
-
-            for (uint32_t k = 0; k < dir.fileCount; ++k) {
-                std::string fileName;
-                if (totalSections == 4) {
-                    fileName = getNameFromBuffer(fileNames, fileNameOffset);
-                    fileNameOffset += static_cast<uint32_t>(fileName.length() + 1);
-                }
-                else if (totalSections == 5) {
-                    fileName = getNameFromBuffer(fileNames, section.fileNameLength, fileNameOffset);
-                }
-
-                // Construct path and enforce extension
-                fs::path relPath = fs::path(ascii2Wide(dirName, 932)) / ascii2Wide(fileName, 932);
-                relPath.replace_extension(SECTION_EXTENSIONS[i]);
-
-                fs::path fullPath = modifiedDir / relPath;
-
-                if (fs::exists(fullPath)) {
-                    std::println("Replacing: {}", wide2Ascii(relPath.wstring()));
-                    std::ifstream newFile(fullPath, std::ios::binary);
-                    if (!newFile) {
-                        throw std::runtime_error(std::format("Failed to open input file: {}", wide2Ascii(fullPath.wstring())));
-                    }
-                    newFileData[fileIndex].resize(fs::file_size(fullPath));
-                    newFile.read((char*)newFileData[fileIndex].data(), newFileData[fileIndex].size());
-                    newFile.close();
-                }
-                else {
-                    std::println("Using original: {}", wide2Ascii(relPath.wstring()));
-                    uint32_t fileOffset = offsets[fileIndex];
-                    uint32_t fileSize = offsets[fileIndex + 1] - offsets[fileIndex];
-                    newFileData[fileIndex].resize(fileSize);
-                    ifs.seekg(fileOffset);
-                    ifs.read((char*)newFileData[fileIndex].data(), newFileData[fileIndex].size());
-                }
-
-                fileIndex++;
+            std::ifstream newFile(replacements[j], std::ios::binary);
+            if (!newFile) {
+                throw std::runtime_error(std::format("Failed to open input file: {}", wide2Ascii(replacements[j].wstring())));
             }
+            readBuffer.resize(newSizes[j]);
+            newFile.read(readBuffer.data(), readBuffer.size());
+            ofs.write(readBuffer.data(), readBuffer.size());
         }
+        flushRun(header.fileCount);
 
-        ofs.seekp(0, std::ios::end);
-        offsets[0] = (uint32_t)ofs.tellp();
-        for (uint32_t j = 1; j < offsets.size(); ++j) {
-            offsets[j] = offsets[j - 1] + (uint32_t)newFileData[j - 1].size();
-        }
-        memcpy(newIndexData.data() + fileOffsetIndex, offsets.data(), offsets.size() * sizeof(uint32_t));
-        uint32_t newDataSize = (uint32_t)std::ranges::fold_left(newFileData | stdv::transform(&std::vector<uint8_t>::size), 0uz, std::plus<>{});
-        newSectionHeader.dataSize = newDataSize;
-        newSectionHeader.indexOffset = (uint32_t)ofs.tellp() + newDataSize;
-        for (const auto& fileData : newFileData) {
-            ofs.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
-        }
+        TcdSectionHeader newSectionHeader = header;
+        newSectionHeader.dataSize = (uint32_t)(cursor - dataStart);
+        newSectionHeader.indexOffset = (uint32_t)cursor;
         ofs.write(reinterpret_cast<const char*>(newIndexData.data()), newIndexData.size());
-        ofs.seekp(currentSectionOffset);
-        if (totalSections == 4) {
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dataSize), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.fileCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dirCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.indexOffset), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dirNameLength), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.fileNameLength), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.tctAbsOffsetCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.unknownDataSize), sizeof(uint32_t));
+
+        uint32_t* h = &newHeaders[i * 8];
+        h[0] = newSectionHeader.dataSize;
+        if (isTcd2) {
+            h[1] = newSectionHeader.fileCount;
+            h[2] = newSectionHeader.dirCount;
+            h[3] = newSectionHeader.indexOffset;
+            h[4] = newSectionHeader.dirNameLength;
+            h[5] = newSectionHeader.fileNameLength;
+            h[6] = newSectionHeader.tctAbsOffsetCount;
+            h[7] = newSectionHeader.unknownDataSize;
         }
-        else if (totalSections == 5) {
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dataSize), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.indexOffset), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dirCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.dirNameLength), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.fileCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.fileNameLength), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.tctAbsOffsetCount), sizeof(uint32_t));
-            ofs.write(reinterpret_cast<const char*>(&newSectionHeader.unknownDataSize), sizeof(uint32_t));
+        else {
+            h[1] = newSectionHeader.indexOffset;
+            h[2] = newSectionHeader.dirCount;
+            h[3] = newSectionHeader.dirNameLength;
+            h[4] = newSectionHeader.fileCount;
+            h[5] = newSectionHeader.fileNameLength;
+            h[6] = newSectionHeader.tctAbsOffsetCount;
+            h[7] = newSectionHeader.unknownDataSize;
         }
-
-        currentSectionOffset = nextSectionPos;
     }
 
-    ifs.close();
+    ofs.seekp(8);
+    ofs.write(reinterpret_cast<char*>(newHeaders.data()), newHeaders.size() * sizeof(uint32_t));
     ofs.close();
 
     std::println("Repacked: {}", wide2Ascii(outputArchivePath.wstring()));
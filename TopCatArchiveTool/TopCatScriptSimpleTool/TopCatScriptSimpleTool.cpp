@@ -1,5 +1,8 @@
-﻿#include <Windows.h>
+﻿#define NOMINMAX
+#include <Windows.h>
 #include <cstdint>
+#include "../../ScriptServer.h"
+#include "../../MappedFile.h"
 
 import std;
 namespace fs = std::filesystem;
@@ -204,68 +207,109 @@ void dumpText(const fs::path& inputPath, const fs::path& outputPath) {
     std::println("Extraction complete. Output saved to {}", wide2Ascii(outputPath));
 }
 
-//IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII
-void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath, std::vector<uint32_t>& tctAbsOffset) {
-    std::ifstream inputBin(inputBinPath, std::ios::binary);
-    std::ifstream inputTxt(inputTxtPath);
-    std::ofstream outputBin(outputBinPath, std::ios::binary);
-
-    if (!inputBin || !inputTxt || !outputBin) {
-        throw std::runtime_error("Error opening files: " + wide2Ascii(inputBinPath) + " or " + wide2Ascii(inputTxtPath) + " or " + wide2Ascii(outputBinPath));
-    }
-    auto fileSize = fs::file_size(inputBinPath);
-    std::vector<uint8_t> newBuffer;
-    newBuffer.reserve(fileSize);
-
+std::vector<std::string> parseSentences(std::string_view text) {
     std::vector<std::string> sentences;
-    uint32_t translationIndex = 0;
-
-    // 读取翻译文本
-    std::string line;
-    while (std::getline(inputTxt, line)) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view line = text.substr(pos, end - pos);
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
         if (line.starts_with("Select: ")) {
-            line = line.substr(8);
+            line.remove_prefix(8);
         }
-        sentences.push_back(std::move(line));
+        sentences.emplace_back(line);
+        pos = end + 1;
     }
+    return sentences;
+}
 
-    std::map<uint32_t, uint32_t> commandHeaderOffsetMap;
+std::vector<std::string> readSentences(const fs::path& inputTxtPath) {
+    std::ifstream inputTxt(inputTxtPath, std::ios::binary);
+    if (!inputTxt) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(inputTxtPath));
+    }
+    std::string text(std::istreambuf_iterator<char>(inputTxt), {});
+    return parseSentences(text);
+}
 
-    while (inputBin.tellg() < fileSize) {
-        commandHeaderOffsetMap[inputBin.tellg()] = newBuffer.size();
-        uint32_t commandHeader;
-        inputBin.read(reinterpret_cast<char*>(&commandHeader), 4);
-        uint16_t commandLength;
-        inputBin.read(reinterpret_cast<char*>(&commandLength), 2);
-        inputBin.seekg(-6, std::ios::cur);
-        std::vector<uint8_t> commandBytes(commandLength);
-        inputBin.read(reinterpret_cast<char*>(commandBytes.data()), commandLength);
-        std::vector<uint8_t> newCommandBytes = commandBytes;
+// 原偏移 -> 新偏移，按原偏移升序追加，查找时二分
+struct Relocation {
+    uint32_t orgOffset;
+    uint32_t newOffset;
+};
+
+//IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII
+// 单次遍历输入，直接把新命令写入 output，返回用掉的译文条数
+uint32_t rewriteTct(std::span<const uint8_t> input, const std::vector<std::string>& sentences, std::vector<uint8_t>& output, std::vector<uint32_t>& tctAbsOffset) {
+    size_t totalTextSize = 0;
+    for (const auto& sentence : sentences) {
+        totalTextSize += sentence.size();
+    }
+    output.clear();
+    output.reserve(input.size() + totalTextSize);
+
+    uint32_t translationIndex = 0;
+    auto nextSentence = [&]() -> const std::string& {
+        if (translationIndex >= sentences.size()) {
+            throw std::runtime_error("Error: not enough translations provided.");
+        }
+        return sentences[translationIndex++];
+    };
+    auto append = [&](const void* ptr, size_t length) {
+        const uint8_t* p = (const uint8_t*)ptr;
+        output.insert(output.end(), p, p + length);
+    };
+    auto appendU16 = [&](uint16_t value) {
+        append(&value, 2);
+    };
+
+    std::vector<Relocation> relocations;
+    std::vector<uint32_t> absOffsetOrders;
+
+    size_t pos = 0;
+    while (pos < input.size()) {
+        if (input.size() - pos < 6) {
+            throw std::runtime_error(std::format("Error: truncated command at offset 0x{:X}.", pos));
+        }
+        const uint8_t* commandBytes = input.data() + pos;
+        uint32_t commandHeader = read<uint32_t>((void*)commandBytes);
+        uint16_t commandLength = read<uint16_t>((void*)(commandBytes + 4));
+        if (commandLength < 6 || pos + commandLength > input.size()) {
+            throw std::runtime_error(std::format("Error: invalid command length 0x{:X} at offset 0x{:X}.", commandLength, pos));
+        }
+
+        const size_t commandStart = output.size();
+        relocations.push_back({ (uint32_t)pos, (uint32_t)commandStart });
+        // 已拷贝到 output 的原命令字节数
+        uint32_t copiedUpTo = 0;
+        auto copyUpTo = [&](uint32_t end) {
+            append(commandBytes + copiedUpTo, end - copiedUpTo);
+            copiedUpTo = end;
+        };
 
         switch (commandHeader)
         {
         case 0x00010004:
         case 0x0000003A:
         {
-            std::string text((char*)&commandBytes[9]);
-            if (translationIndex >= sentences.size()) {
-                throw std::runtime_error("Error: not enough translations provided.");
-            }
-            std::string newText = sentences[translationIndex++];
-            std::vector<uint8_t> newTextBytes = string2Bytes(newText);
-            auto it = newCommandBytes.begin() + 9;
-            it = newCommandBytes.erase(it, it + text.length());
-            newCommandBytes.insert(it, newTextBytes.begin(), newTextBytes.end());
-            write<uint16_t>(&newCommandBytes[4], newCommandBytes.size());
+            size_t textLength = strlen((const char*)&commandBytes[9]);
+            const std::string& newText = nextSentence();
+            copyUpTo(9);
+            append(newText.data(), newText.size());
+            copiedUpTo = 9 + (uint32_t)textLength;
         }
         break;
 
         case 0x00000000:
         {
-            std::vector<std::function<void()>> commandHandlers;
             uint32_t currentCommandOffset = 0x8;
             while (currentCommandOffset < commandLength) {
-                uint8_t op = read<uint8_t>(&commandBytes[currentCommandOffset]);
+                uint8_t op = commandBytes[currentCommandOffset];
                 currentCommandOffset += 1;
                 switch (op)
                 {
@@ -273,32 +317,20 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
                 case 0x66:
                 case 0x68:
                 {
-                    uint16_t textLength = read<uint16_t>(&commandBytes[currentCommandOffset]);
+                    uint16_t textLength = read<uint16_t>((void*)&commandBytes[currentCommandOffset]);
                     currentCommandOffset += 2;
                     if (commandBytes[currentCommandOffset] != 0x00) {
-                        if (translationIndex >= sentences.size()) {
-                            throw std::runtime_error("Error: not enough translations provided.");
-                        }
-                        std::string newText = sentences[translationIndex++];
-                        std::vector<uint8_t> newTextBytes = string2Bytes(newText);
-                        if (newTextBytes.empty()) {
-                            std::function<void()> handler = [&, currentCommandOffset, textLength]()
-                                {
-                                    auto it = newCommandBytes.begin() + currentCommandOffset - 3;
-                                    newCommandBytes.erase(it, it + textLength + 3);
-                                };
-                            commandHandlers.push_back(handler);
+                        const std::string& newText = nextSentence();
+                        if (newText.empty()) {
+                            // 连同操作码和长度一起删除
+                            copyUpTo(currentCommandOffset - 3);
                         }
                         else {
-                            std::function<void()> handler = [&, currentCommandOffset, textLength, newTextBytes]()
-                                {
-                                    auto it = newCommandBytes.begin() + currentCommandOffset;
-                                    it = newCommandBytes.erase(it, it + textLength);
-                                    newCommandBytes.insert(it, newTextBytes.begin(), newTextBytes.end());
-                                    write<uint16_t>(&newCommandBytes[currentCommandOffset - 2], newTextBytes.size());
-                                };
-                            commandHandlers.push_back(handler);
+                            copyUpTo(currentCommandOffset - 2);
+                            appendU16((uint16_t)newText.size());
+                            append(newText.data(), newText.size());
                         }
+                        copiedUpTo = currentCommandOffset + textLength;
                     }
                     currentCommandOffset += textLength;
                 }
@@ -306,71 +338,54 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
 
                 case 0x0F:
                 {
-                    if (translationIndex >= sentences.size()) {
-                        throw std::runtime_error("Error: not enough translations provided.");
-                    }
-                    std::string newText = sentences[translationIndex++];
-                    std::vector<uint8_t> newBaseTextBytes;
-                    std::vector<uint8_t> newFuriganaBytes;
+                    const std::string& newText = nextSentence();
+                    std::string_view newBaseText;
+                    std::string_view newFurigana;
                     if (newText.starts_with('[') && newText.ends_with(']') && newText.contains('/')) {
-                        size_t pos = newText.find('/');
-                        newBaseTextBytes = string2Bytes(newText.substr(pos + 1));
-                        newBaseTextBytes.pop_back();
-                        newFuriganaBytes = string2Bytes(newText.substr(1, pos - 1));
+                        size_t slashPos = newText.find('/');
+                        newBaseText = std::string_view(newText).substr(slashPos + 1, newText.size() - slashPos - 2);
+                        newFurigana = std::string_view(newText).substr(1, slashPos - 1);
                     }
                     else {
-                        newBaseTextBytes = string2Bytes(newText);
-                        newFuriganaBytes.push_back(0x20); newFuriganaBytes.push_back(0x20);
+                        newBaseText = newText;
+                        newFurigana = "  ";
                     }
 
                     uint32_t subCommandOffset = currentCommandOffset - 1;
-                    uint16_t subCommandLength = read<uint16_t>(&commandBytes[currentCommandOffset]);
-
-                    std::vector<uint8_t> newSubCommandBytes{ commandBytes[subCommandOffset], 0x00, 0x00 };
+                    uint16_t subCommandLength = read<uint16_t>((void*)&commandBytes[currentCommandOffset]);
                     uint32_t nextCommandOffset = subCommandOffset + subCommandLength;
 
                     currentCommandOffset += 2;
-                    newSubCommandBytes.push_back(commandBytes[currentCommandOffset]);
+                    uint8_t baseTextPrefix = commandBytes[currentCommandOffset];
                     currentCommandOffset += 1;
-                    std::string baseText((char*)&commandBytes[currentCommandOffset]);
-                    currentCommandOffset += baseText.length() + 1;
-                    newSubCommandBytes.insert(newSubCommandBytes.end(), newBaseTextBytes.begin(), newBaseTextBytes.end());
-                    newSubCommandBytes.push_back(0x00);
-                    newSubCommandBytes.push_back(commandBytes[currentCommandOffset]);
+                    currentCommandOffset += (uint32_t)strlen((const char*)&commandBytes[currentCommandOffset]) + 1;
+                    uint8_t furiganaPrefix = commandBytes[currentCommandOffset];
                     currentCommandOffset += 1;
-                    std::string furigana((char*)&commandBytes[currentCommandOffset]);
-                    currentCommandOffset += furigana.length() + 1;
-                    newSubCommandBytes.insert(newSubCommandBytes.end(), newFuriganaBytes.begin(), newFuriganaBytes.end());
-                    newSubCommandBytes.push_back(0x00);
+                    currentCommandOffset += (uint32_t)strlen((const char*)&commandBytes[currentCommandOffset]) + 1;
                     if (currentCommandOffset != nextCommandOffset) {
                         throw std::runtime_error("Error: unexpected command format.");
                     }
 
-                    write<uint16_t>(&newSubCommandBytes[1], newSubCommandBytes.size());
-
-                    if (newBaseTextBytes.empty()) {
-                        std::function<void()> handler = [&, subCommandOffset, subCommandLength]()
-                            {
-                                auto it = newCommandBytes.begin() + subCommandOffset;
-                                newCommandBytes.erase(it, it + subCommandLength);
-                            };
-                        commandHandlers.push_back(handler);
-                    }
-                    else {
-                        std::function<void()> handler = [&, subCommandOffset, subCommandLength, newSubCommandBytes]()
-                            {
-                                auto it = newCommandBytes.begin() + subCommandOffset;
-                                it = newCommandBytes.erase(it, it + subCommandLength);
-                                newCommandBytes.insert(it, newSubCommandBytes.begin(), newSubCommandBytes.end());
-                            };
-                        commandHandlers.push_back(handler);
+                    copyUpTo(subCommandOffset);
+                    if (!newBaseText.empty()) {
+                        size_t subCommandStart = output.size();
+                        output.push_back(commandBytes[subCommandOffset]);
+                        appendU16(0);
+                        output.push_back(baseTextPrefix);
+                        append(newBaseText.data(), newBaseText.size());
+                        output.push_back(0x00);
+                        output.push_back(furiganaPrefix);
+                        append(newFurigana.data(), newFurigana.size());
+                        output.push_back(0x00);
+                        write<uint16_t>(&output[subCommandStart + 1], (uint16_t)(output.size() - subCommandStart));
                     }
+                    copiedUpTo = nextCommandOffset;
                 }
                 break;
 
                 case 0x04:
                 {
-                    uint16_t subCommandLength = read<uint16_t>(&commandBytes[currentCommandOffset]);
+                    uint16_t subCommandLength = read<uint16_t>((void*)&commandBytes[currentCommandOffset]);
                     currentCommandOffset = currentCommandOffset + subCommandLength - 1;
                 }
                 break;
@@ -379,47 +394,22 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
                 case 0x11:
                 case 0x12:
                 {
-                    if (translationIndex >= sentences.size()) {
-                        throw std::runtime_error("Error: not enough translations provided.");
-                    }
-                    std::string newText = sentences[translationIndex++];
-                    std::vector<uint8_t> newTextBytes = string2Bytes(newText);
+                    const std::string& newText = nextSentence();
 
                     uint32_t subCommandOffset = currentCommandOffset - 1;
-                    uint16_t subCommandLength = read<uint16_t>(&commandBytes[currentCommandOffset]);
+                    uint16_t subCommandLength = read<uint16_t>((void*)&commandBytes[currentCommandOffset]);
                     uint32_t nextCommandOffset = subCommandOffset + subCommandLength;
-                    std::vector<uint8_t> newSubCommandBytes{ commandBytes[subCommandOffset], 0x00, 0x00 };
 
                     currentCommandOffset += 2;
-                    newSubCommandBytes.push_back(commandBytes[currentCommandOffset]);
                     currentCommandOffset += 1;
-                    std::string text((char*)&commandBytes[currentCommandOffset]);
-                    currentCommandOffset += text.length() + 1;
-                    newSubCommandBytes.insert(newSubCommandBytes.end(), text.begin(), text.end());
-                    newSubCommandBytes.push_back(0x00);
+                    currentCommandOffset += (uint32_t)strlen((const char*)&commandBytes[currentCommandOffset]) + 1;
                     if (currentCommandOffset != nextCommandOffset) {
                         throw std::runtime_error("Error: unexpected command format.");
                     }
-                    
-                    write<uint16_t>(&newSubCommandBytes[1], newSubCommandBytes.size());
-
-                    if(newTextBytes.empty()){
-                        std::function<void()> handler = [&, subCommandOffset, subCommandLength]()
-                            {
-                                auto it = newCommandBytes.begin() + subCommandOffset;
-                                newCommandBytes.erase(it, it + subCommandLength);
-                            };
-                        commandHandlers.push_back(handler);
-                    }
-                    else {
-                        std::function<void()> handler = [&, subCommandOffset, subCommandLength, newSubCommandBytes]()
-                            {
-                                auto it = newCommandBytes.begin() + subCommandOffset;
-                                it = newCommandBytes.erase(it, it + subCommandLength);
-                                newCommandBytes.insert(it, newSubCommandBytes.begin(), newSubCommandBytes.end());
-                            };
-                        commandHandlers.push_back(handler);
-                    }
+
+                    // 与原实现一致：非空时保留原文，只有空译文才删除整个子命令
+                    copyUpTo(newText.empty() ? subCommandOffset : nextCommandOffset);
+                    copiedUpTo = nextCommandOffset;
                 }
                 break;
 
@@ -434,12 +424,6 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
                     throw std::runtime_error(std::format("Error: unknown command op code 0x{:02X}.", op));
                 }
             }
-
-            for (const auto& handler : commandHandlers | stdv::reverse) {
-                handler();
-            }
-
-            write<uint16_t>(&newCommandBytes[4], newCommandBytes.size());
         }
         break;
 
@@ -448,82 +432,214 @@ void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, cons
             if (translationIndex + 1 >= sentences.size()) {
                 throw std::runtime_error("Error: not enough translations provided.");
             }
-            std::string newText1 = sentences[translationIndex++];
-            std::string newText2 = sentences[translationIndex++];
-            std::vector<uint8_t> newText1Bytes = string2Bytes(newText1);
-            std::vector<uint8_t> newText2Bytes = string2Bytes(newText2);
-
-            uint32_t currentCommandOffset = 0x8;
-            currentCommandOffset += 1;
-            uint32_t text1Offset = currentCommandOffset;
-            std::string text1((char*)&commandBytes[currentCommandOffset]);
-            currentCommandOffset += text1.length() + 1;
-            currentCommandOffset += 1;
-            uint32_t text2Offset = currentCommandOffset;
-            std::string text2((char*)&commandBytes[currentCommandOffset]);
-            currentCommandOffset += text2.length() + 1;
-
-            auto it = newCommandBytes.begin() + text2Offset;
-            it = newCommandBytes.erase(it, it + text2.length());
-            newCommandBytes.insert(it, newText2Bytes.begin(), newText2Bytes.end());
-            it = newCommandBytes.begin() + text1Offset;
-            it = newCommandBytes.erase(it, it + text1.length());
-            newCommandBytes.insert(it, newText1Bytes.begin(), newText1Bytes.end());
-
-            write<uint16_t>(&newCommandBytes[4], newCommandBytes.size());
+            const std::string& newText1 = sentences[translationIndex++];
+            const std::string& newText2 = sentences[translationIndex++];
+
+            uint32_t text1Offset = 0x8 + 1;
+            uint32_t text1Length = (uint32_t)strlen((const char*)&commandBytes[text1Offset]);
+            uint32_t text2Offset = text1Offset + text1Length + 1 + 1;
+            uint32_t text2Length = (uint32_t)strlen((const char*)&commandBytes[text2Offset]);
+
+            copyUpTo(text1Offset);
+            append(newText1.data(), newText1.size());
+            copiedUpTo = text1Offset + text1Length;
+            copyUpTo(text2Offset);
+            append(newText2.data(), newText2.size());
+            copiedUpTo = text2Offset + text2Length;
         }
         break;
 
+        case 0x0000000A:
+        case 0x0000000B:
+            absOffsetOrders.push_back(read<uint32_t>((void*)&commandBytes[0x9]));
+            break;
+
         default:
             break;
         }
 
-        newBuffer.insert(newBuffer.end(), newCommandBytes.begin(), newCommandBytes.end());
+        copyUpTo(commandLength);
+        if (output.size() - commandStart != commandLength) {
+            write<uint16_t>(&output[commandStart + 4], (uint16_t)(output.size() - commandStart));
+        }
+        pos += commandLength;
     }
 
-    inputBin.seekg(0);
-    while (inputBin.tellg() < fileSize) {
-        uint32_t commandHeader;
-        inputBin.read(reinterpret_cast<char*>(&commandHeader), 4);
-        uint16_t commandLength;
-        inputBin.read(reinterpret_cast<char*>(&commandLength), 2);
-        inputBin.seekg(-6, std::ios::cur);
-        std::vector<uint8_t> commandBytes(commandLength);
-        inputBin.read(reinterpret_cast<char*>(commandBytes.data()), commandLength);
-
-        if (commandHeader == 0x0000000A || commandHeader == 0x0000000B) {
-            uint32_t absOffsetOrder = read<uint32_t>(&commandBytes[0x9]);
-            if (absOffsetOrder >= tctAbsOffset.size()) {
-                throw std::runtime_error("Error: not enough TCT absolute offsets provided.");
-            }
-            uint32_t orgAbsOffset = tctAbsOffset[absOffsetOrder];
-            auto it = commandHeaderOffsetMap.find(orgAbsOffset);
-            if (it == commandHeaderOffsetMap.end()) {
-                throw std::runtime_error(std::format("Error: TCT absolute offset 0x{:08X} not found in command header offset map.", orgAbsOffset));
-            }
-            uint32_t newAbsOffset = it->second;
-            tctAbsOffset[absOffsetOrder] = newAbsOffset;
+    // 最后统一修正跳转表
+    for (uint32_t absOffsetOrder : absOffsetOrders) {
+        if (absOffsetOrder >= tctAbsOffset.size()) {
+            throw std::runtime_error("Error: not enough TCT absolute offsets provided.");
+        }
+        uint32_t orgAbsOffset = tctAbsOffset[absOffsetOrder];
+        auto it = std::ranges::lower_bound(relocations, orgAbsOffset, {}, &Relocation::orgOffset);
+        if (it == relocations.end() || it->orgOffset != orgAbsOffset) {
+            throw std::runtime_error(std::format("Error: TCT absolute offset 0x{:08X} not found in command header offset map.", orgAbsOffset));
         }
+        tctAbsOffset[absOffsetOrder] = it->newOffset;
     }
 
+    return translationIndex;
+}
+
+uint32_t injectText(std::span<const uint8_t> input, const std::vector<std::string>& sentences, const fs::path& outputBinPath, std::vector<uint32_t>& tctAbsOffset) {
+    std::vector<uint8_t> newBuffer;
+    uint32_t translationIndex = rewriteTct(input, sentences, newBuffer, tctAbsOffset);
+
     if (translationIndex < sentences.size()) {
         std::println("Warning: {0} translations provided, expected {1}.", sentences.size(), translationIndex);
     }
 
+    std::ofstream outputBin(outputBinPath, std::ios::binary);
+    if (!outputBin) {
+        throw std::runtime_error("Error opening file: " + wide2Ascii(outputBinPath));
+    }
     outputBin.write(reinterpret_cast<const char*>(newBuffer.data()), newBuffer.size());
-
-    inputBin.close();
-    inputTxt.close();
     outputBin.close();
 
     std::println("Injection complete. Output saved to {}", wide2Ascii(outputBinPath));
+    return translationIndex;
+}
+
+void injectText(const fs::path& inputBinPath, const fs::path& inputTxtPath, const fs::path& outputBinPath, std::vector<uint32_t>& tctAbsOffset) {
+    MappedFile inputBin(inputBinPath);
+    injectText(std::span<const uint8_t>(inputBin.data(), inputBin.fileSize()), readSentences(inputTxtPath), outputBinPath, tctAbsOffset);
+}
+
+// 对单个 TCT（一般取 TCD3 中最大的那个）反复注入，测量重写吞吐
+void benchInject(const fs::path& inputBinPath, const fs::path& inputTxtPath, std::vector<uint32_t>& tctAbsOffset, int iterations) {
+    MappedFile inputBin(inputBinPath);
+    std::span<const uint8_t> bytes(inputBin.data(), inputBin.fileSize());
+    std::vector<std::string> sentences = readSentences(inputTxtPath);
+    std::vector<uint8_t> newBuffer;
+    std::vector<uint32_t> offsets;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        offsets = tctAbsOffset;
+        rewriteTct(bytes, sentences, newBuffer, offsets);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double perIteration = elapsed.count() / iterations;
+    double megabytes = bytes.size() / (1024.0 * 1024.0);
+    std::println("{0}: {1} bytes -> {2} bytes, {3:.3f} ms per inject, {4:.1f} MB/s",
+        wide2Ascii(inputBinPath.filename()), bytes.size(), newBuffer.size(), perIteration * 1000.0, megabytes / perIteration);
+}
+
+std::vector<uint32_t> readTctAbsOffset(const fs::path& tctAbsOffsetFile) {
+    std::ifstream ifs(tctAbsOffsetFile);
+    if (!ifs) {
+        throw std::runtime_error("Error opening TCT absolute offset file: " + wide2Ascii(tctAbsOffsetFile));
+    }
+    std::vector<uint32_t> tctAbsOffset;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        tctAbsOffset.push_back(std::stoul(line, nullptr, 16));
+    }
+    return tctAbsOffset;
+}
+
+fs::path newTctAbsOffsetPath(const fs::path& tctAbsOffsetFile) {
+    fs::path newTctAbsOffsetFile = tctAbsOffsetFile;
+    newTctAbsOffsetFile.replace_filename(newTctAbsOffsetFile.stem().wstring() + L"_new" + newTctAbsOffsetFile.extension().wstring());
+    return newTctAbsOffsetFile;
+}
+
+void writeTctAbsOffset(const fs::path& newTctAbsOffsetFile, const std::vector<uint32_t>& tctAbsOffset) {
+    std::ofstream ofs(newTctAbsOffsetFile);
+    if (!ofs) {
+        throw std::runtime_error("Error opening new TCT absolute offset file: " + wide2Ascii(newTctAbsOffsetFile));
+    }
+    for (uint32_t offset : tctAbsOffset) {
+        ofs << std::format("{:08X}\n", offset);
+    }
+    ofs.close();
+}
+
+// 常驻服务用：保留原始跳转表，每个脚本注入时只记录自己改动的项，
+// 同一脚本重复注入时覆盖旧记录，合并后写出 _new 文件
+struct TctAbsOffsetTable {
+    uint64_t hash = 0;
+    std::vector<uint32_t> original;
+    std::map<fs::path, std::vector<std::pair<uint32_t, uint32_t>>> patches;
+
+    std::vector<uint32_t> merged() const {
+        std::vector<uint32_t> result = original;
+        for (const auto& [path, entries] : patches) {
+            for (auto [index, offset] : entries) {
+                result[index] = offset;
+            }
+        }
+        return result;
+    }
+};
+
+int serveScripts() {
+    ScriptServer server("TopCatScriptSimpleTool");
+    std::map<fs::path, TctAbsOffsetTable> tables;
+
+    // {"input": tct, "output": txt}
+    server.on("dump", [&](ScriptCall& call) {
+        fs::path inputPath = call.path("input");
+        call.input(inputPath);
+        fs::path outputPath = call.output(call.path("output"));
+        if (call.upToDate()) {
+            return;
+        }
+        dumpText(inputPath, outputPath);
+    });
+
+    // {"input": 原tct, "text": 译文, "output": 新tct, "tct_abs_offset": 可选的跳转表文件}
+    server.on("inject", [&](ScriptCall& call) {
+        fs::path inputBinPath = call.path("input");
+        auto inputBin = call.input(inputBinPath);
+        auto inputTxt = call.input(call.path("text"));
+        fs::path outputBinPath = call.output(call.path("output"));
+        std::shared_ptr<const ScriptFile> offsetFile;
+        if (call.has("tct_abs_offset")) {
+            offsetFile = call.input(call.path("tct_abs_offset"));
+        }
+        if (call.upToDate()) {
+            return;
+        }
+
+        std::string_view text((const char*)inputTxt->bytes.data(), inputTxt->bytes.size());
+        std::vector<std::string> sentences = parseSentences(text);
+        if (!offsetFile) {
+            std::vector<uint32_t> tctAbsOffset;
+            call.result("texts", (long long)injectText(inputBin->bytes, sentences, outputBinPath, tctAbsOffset));
+            return;
+        }
+
+        TctAbsOffsetTable& table = tables[offsetFile->path];
+        if (table.original.empty() || table.hash != offsetFile->hash) {
+            table.hash = offsetFile->hash;
+            table.original = readTctAbsOffset(offsetFile->path);
+            table.patches.clear();
+        }
+        std::vector<uint32_t> tctAbsOffset = table.original;
+        uint32_t texts = injectText(inputBin->bytes, sentences, outputBinPath, tctAbsOffset);
+        auto& entries = table.patches[inputBinPath];
+        entries.clear();
+        for (uint32_t i = 0; i < tctAbsOffset.size(); i++) {
+            if (tctAbsOffset[i] != table.original[i]) {
+                entries.emplace_back(i, tctAbsOffset[i]);
+            }
+        }
+        writeTctAbsOffset(newTctAbsOffsetPath(offsetFile->path), table.merged());
+        call.result("texts", (long long)texts);
+    });
+
+    return server.serve();
 }
 
 void printUsage(const fs::path& programPath) {
     std::print("Made by julixian 2025.11.22\n"
         "Usage: \n"
         "  Dump: {0} dump <input_folder> <output_folder>\n"
-        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-txt_folder> <output_folder> [tct_abs_offset_file]",
+        "  Inject: {0} inject <input_orig-bin_folder> <input_translated-txt_folder> <output_folder> [tct_abs_offset_file]\n"
+        "  Bench: {0} bench <input_orig-bin_file> <input_translated-txt_file> [iterations] [tct_abs_offset_file]\n"
+        "  Serve: {0} serve    (one JSON request per line on stdin, methods: dump, inject)",
         wide2Ascii(programPath.filename()));
 }
 
@@ -566,17 +682,8 @@ int wmain(int argc, wchar_t* argv[])
             fs::path newTctAbsOffsetFile;
             if (argc >= 6) {
                 const fs::path tctAbsOffsetFile = argv[5];
-                std::ifstream ifs(tctAbsOffsetFile);
-                if (!ifs) {
-                    throw std::runtime_error("Error opening TCT absolute offset file: " + wide2Ascii(tctAbsOffsetFile));
-                }
-                std::string line;
-                while (std::getline(ifs, line)) {
-                    tctAbsOffset.push_back(std::stoul(line, nullptr, 16));
-                }
-                ifs.close();
-                newTctAbsOffsetFile = tctAbsOffsetFile;
-                newTctAbsOffsetFile.replace_filename(newTctAbsOffsetFile.stem().wstring() + L"_new" + newTctAbsOffsetFile.extension().wstring());
+                tctAbsOffset = readTctAbsOffset(tctAbsOffsetFile);
+                newTctAbsOffsetFile = newTctAbsOffsetPath(tctAbsOffsetFile);
             }
             const fs::path inputBinFolder = argv[2];
             const fs::path inputTxtFolder = argv[3];
@@ -598,15 +705,23 @@ int wmain(int argc, wchar_t* argv[])
                 }
             }
             if (!newTctAbsOffsetFile.empty()) {
-                std::ofstream ofs(newTctAbsOffsetFile);
-                if (!ofs) {
-                    throw std::runtime_error("Error opening new TCT absolute offset file: " + wide2Ascii(newTctAbsOffsetFile));
-                }
-                for (uint32_t offset : tctAbsOffset) {
-                    ofs << std::format("{:08X}\n", offset);
-                }
-                ofs.close();
+                writeTctAbsOffset(newTctAbsOffsetFile, tctAbsOffset);
+            }
+        }
+        else if (mode == L"bench") {
+            if (argc < 4) {
+                printUsage(argv[0]);
+                return 1;
             }
+            int iterations = argc >= 5 ? std::stoi(argv[4]) : 100;
+            std::vector<uint32_t> tctAbsOffset;
+            if (argc >= 6) {
+                tctAbsOffset = readTctAbsOffset(argv[5]);
+            }
+            benchInject(argv[2], argv[3], tctAbsOffset, std::max(iterations, 1));
+        }
+        else if (mode == L"serve") {
+            return serveScripts();
         }
         else {
             printUsage(argv[0]);
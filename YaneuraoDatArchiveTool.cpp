@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <map>
 #include <iomanip>
+#include <cstring>
+#include "MappedFile.h"
 
 namespace fs = std::filesystem;
 
@@ -17,63 +19,78 @@ struct FileEntry {
     uint32_t packed_size;
 };
 
-class DatExtractor {
-public:
-    DatExtractor(const std::string& datPath) : m_datPath(datPath) {}
+// 打开封包并直接在映射上解析文件头和索引
+bool ReadDatIndex(const ByteSpan& dat, bool& isYanepkDx, std::vector<FileEntry>& entries) {
+    // 检查文件头
+    if (!dat.contains(0, 12)) {
+        std::cerr << "不支持的文件格式" << std::endl;
+        return false;
+    }
+    const uint8_t* signature = dat.data();
 
-    bool Extract(const std::string& outputDir) {
-        std::ifstream file(m_datPath, std::ios::binary);
-        if (!file) {
-            std::cerr << "无法打开文件: " << m_datPath << std::endl;
-            return false;
-        }
+    isYanepkDx = (memcmp(signature, "yanepkDx", 8) == 0);
+    bool isYanepkEx = (memcmp(signature, "yanepkEx", 8) == 0);
 
-        // 检查文件头
-        char signature[8];
-        file.read(signature, 8);
+    if (!isYanepkDx && !isYanepkEx) {
+        std::cerr << "不支持的文件格式" << std::endl;
+        return false;
+    }
 
-        bool isYanepkDx = (memcmp(signature, "yanepkDx", 8) == 0);
-        bool isYanepkEx = (memcmp(signature, "yanepkEx", 8) == 0);
+    // 读取文件数量
+    uint32_t count = dat.u32le(8);
 
-        if (!isYanepkDx && !isYanepkEx) {
-            std::cerr << "不支持的文件格式" << std::endl;
-            return false;
-        }
+    if (count > 10000) { // 安全检查
+        std::cerr << "文件数量异常" << std::endl;
+        return false;
+    }
+
+    // 读取文件条目
+    uint32_t nameLength = isYanepkDx ? 0x100 : 0x20;
+    if (!dat.contains(0xC, (uint64_t)count * (nameLength + 0xC))) {
+        std::cerr << "索引不完整" << std::endl;
+        return false;
+    }
+
+    entries.clear();
+    entries.reserve(count);
+    SpanReader index(dat, 0xC);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        FileEntry entry;
+
+        // 读取文件名
+        entry.filename = index.str(nameLength);
 
-        // 读取文件数量
-        uint32_t count;
-        file.seekg(8);
-        file.read(reinterpret_cast<char*>(&count), 4);
+        // 读取文件信息
+        entry.offset = index.u32le();
+        entry.unpacked_size = index.u32le();
+        entry.packed_size = index.u32le();
 
-        if (count > 10000) { // 安全检查
-            std::cerr << "文件数量异常" << std::endl;
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+class DatExtractor {
+public:
+    DatExtractor(const std::string& datPath) : m_datPath(datPath) {}
+
+    bool Extract(const std::string& outputDir) {
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(m_datPath);
+        }
+        catch (const std::exception&) {
+            std::cerr << "无法打开文件: " << m_datPath << std::endl;
             return false;
         }
+        const ByteSpan dat = file->span();
 
-        // 读取文件条目
+        bool isYanepkDx = false;
         std::vector<FileEntry> entries;
-        entries.reserve(count);
-
-        uint32_t nameLength = isYanepkDx ? 0x100 : 0x20;
-        uint32_t indexOffset = 0xC;
-
-        for (uint32_t i = 0; i < count; ++i) {
-            FileEntry entry;
-
-            // 读取文件名
-            std::vector<char> nameBuffer(nameLength);
-            file.seekg(indexOffset);
-            file.read(nameBuffer.data(), nameLength);
-            entry.filename = std::string(nameBuffer.data());
-
-            // 读取文件信息
-            file.seekg(indexOffset + nameLength);
-            file.read(reinterpret_cast<char*>(&entry.offset), 4);
-            file.read(reinterpret_cast<char*>(&entry.unpacked_size), 4);
-            file.read(reinterpret_cast<char*>(&entry.packed_size), 4);
-
-            entries.push_back(entry);
-            indexOffset += nameLength + 0xC;
+        if (!ReadDatIndex(dat, isYanepkDx, entries)) {
+            return false;
         }
 
         // 创建输出目录
@@ -88,17 +105,18 @@ public:
             fs::path dirPath = fs::path(outPath).parent_path();
             fs::create_directories(dirPath);
 
-            // 读取并写入文件数据
-            std::vector<char> buffer(entry.packed_size);
-            file.seekg(entry.offset);
-            file.read(buffer.data(), entry.packed_size);
+            // 文件数据直接从映射写出
+            if (!dat.contains(entry.offset, entry.packed_size)) {
+                std::cerr << "数据越界: " << entry.filename << std::endl;
+                continue;
+            }
 
             std::ofstream outFile(outPath, std::ios::binary);
             if (!outFile) {
                 std::cerr << "无法创建文件: " << outPath << std::endl;
                 continue;
             }
-            outFile.write(buffer.data(), entry.packed_size);
+            outFile.write(reinterpret_cast<const char*>(dat.at(entry.offset, entry.packed_size)), entry.packed_size);
 
             std::cout << "已提取: " << entry.filename << std::endl;
         }
@@ -115,38 +133,23 @@ public:
     DatUpdater(const std::string& datPath) : m_datPath(datPath) {}
 
     bool Update(const std::string& updateDir, const std::string& outputPath) {
-        std::ifstream file(m_datPath, std::ios::binary);
-        if (!file) {
-            std::cerr << "无法打开文件: " << m_datPath << std::endl;
-            return false;
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(m_datPath);
         }
-
-        // 检查文件头
-        char signature[8];
-        file.read(signature, 8);
-
-        bool isYanepkDx = (memcmp(signature, "yanepkDx", 8) == 0);
-        bool isYanepkEx = (memcmp(signature, "yanepkEx", 8) == 0);
-
-        if (!isYanepkDx && !isYanepkEx) {
-            std::cerr << "不支持的文件格式" << std::endl;
+        catch (const std::exception&) {
+            std::cerr << "无法打开文件: " << m_datPath << std::endl;
             return false;
         }
+        const ByteSpan dat = file->span();
 
-        // 读取文件数量
-        uint32_t count;
-        file.seekg(8);
-        file.read(reinterpret_cast<char*>(&count), 4);
-
-        if (count > 10000) { // 安全检查
-            std::cerr << "文件数量异常" << std::endl;
+        bool isYanepkDx = false;
+        std::vector<FileEntry> entries;
+        if (!ReadDatIndex(dat, isYanepkDx, entries)) {
             return false;
         }
 
-        // 读取文件条目
-        std::vector<FileEntry> entries;
-        entries.reserve(count);
-
+        uint32_t count = static_cast<uint32_t>(entries.size());
         uint32_t nameLength = isYanepkDx ? 0x100 : 0x20;
         uint32_t indexOffset = 0xC;
         uint32_t dataOffset = indexOffset + count * (nameLength + 0xC);
@@ -156,28 +159,11 @@ public:
         std::cout << std::string(70, '-') << std::endl;
 
         for (uint32_t i = 0; i < count; ++i) {
-            FileEntry entry;
-
-            // 读取文件名
-            std::vector<char> nameBuffer(nameLength);
-            file.seekg(indexOffset);
-            file.read(nameBuffer.data(), nameLength);
-            entry.filename = std::string(nameBuffer.data());
-
-            // 读取文件信息
-            file.seekg(indexOffset + nameLength);
-            file.read(reinterpret_cast<char*>(&entry.offset), 4);
-            file.read(reinterpret_cast<char*>(&entry.unpacked_size), 4);
-            file.read(reinterpret_cast<char*>(&entry.packed_size), 4);
-
-            entries.push_back(entry);
-            indexOffset += nameLength + 0xC;
+            const FileEntry& entry = entries[i];
 
             // 打印文件信息
-            std::string cleanFilename = entry.filename;
-            cleanFilename.erase(std::find(cleanFilename.begin(), cleanFilename.end(), '\0'), cleanFilename.end());
             std::cout << std::setw(5) << i + 1
-                << std::setw(50) << cleanFilename
+                << std::setw(50) << entry.filename
                 << std::setw(15) << entry.packed_size << std::endl;
         }
 
@@ -200,7 +186,7 @@ public:
         }
 
         // 写入文件头和文件数量
-        outFile.write(signature, 8);
+        outFile.write(reinterpret_cast<const char*>(dat.data()), 8);
         outFile.write(reinterpret_cast<char*>(&count), 4);
 
         // 写入文件条目信息（先占位）
@@ -251,10 +237,11 @@ public:
             }
             else {
                 // 使用原始文件
-                file.seekg(entry.offset);
-                std::vector<char> buffer(entry.packed_size);
-                file.read(buffer.data(), entry.packed_size);
-                outFile.write(buffer.data(), entry.packed_size);
+                if (!dat.contains(entry.offset, entry.packed_size)) {
+                    std::cerr << "数据越界: " << cleanFilename << std::endl;
+                    return false;
+                }
+                outFile.write(reinterpret_cast<const char*>(dat.at(entry.offset, entry.packed_size)), entry.packed_size);
 
                 entry.offset = currentDataOffset;
                 currentDataOffset += entry.packed_size;
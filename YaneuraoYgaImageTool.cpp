@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
+#include "LzssDecoder.h"
 
 namespace fs = std::filesystem;
 
@@ -38,51 +39,6 @@ struct YgaHeader {
     uint32_t unknown;
 };
 
-class LzssDecompressor {
-public:
-    LzssDecompressor(int frameSize = 0x1000, uint8_t frameFill = 0, int frameInitPos = 0xFEE)
-        : m_frameSize(frameSize), m_frameFill(frameFill), m_frameInitPos(frameInitPos) {}
-
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& input) {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> frame(m_frameSize, m_frameFill);
-        int framePos = m_frameInitPos;
-        int frameMask = m_frameSize - 1;
-
-        size_t inputPos = 0;
-        while (inputPos < input.size()) {
-            uint8_t ctrl = input[inputPos++];
-            for (int bit = 1; bit != 0x100 && inputPos < input.size(); bit <<= 1) {
-                if (ctrl & bit) {
-                    uint8_t b = input[inputPos++];
-                    frame[framePos++ & frameMask] = b;
-                    output.push_back(b);
-                }
-                else {
-                    if (inputPos + 1 >= input.size()) break;
-                    uint8_t lo = input[inputPos++];
-                    uint8_t hi = input[inputPos++];
-                    int offset = ((hi & 0xf0) << 4) | lo;
-                    int count = 3 + (hi & 0xF);
-
-                    for (int i = 0; i < count; ++i) {
-                        uint8_t v = frame[offset++ & frameMask];
-                        frame[framePos++ & frameMask] = v;
-                        output.push_back(v);
-                    }
-                }
-            }
-        }
-
-        return output;
-    }
-
-private:
-    int m_frameSize;
-    uint8_t m_frameFill;
-    int m_frameInitPos;
-};
-
 bool processYgaFile(std::istream& input, const fs::path& outputPath) {
     YgaHeader header;
     input.read(reinterpret_cast<char*>(&header), sizeof(YgaHeader));
@@ -98,8 +54,7 @@ bool processYgaFile(std::istream& input, const fs::path& outputPath) {
 
     std::vector<uint8_t> outputData;
     if (header.compression == 1) {
-        LzssDecompressor decompressor;
-        outputData = decompressor.decompress(inputData);
+        outputData = StandardLzssDecoder::decode(inputData, (size_t)header.width * header.height * 4);
     }
     else {
         outputData = inputData;
@@ -160,8 +115,7 @@ bool processYgaFile(std::istream& input, const fs::path& outputPath) {
 }
 
 bool decompressAndProcessYga(const std::vector<uint8_t>& compressedData, const fs::path& outputPath) {
-    LzssDecompressor decompressor;
-    std::vector<uint8_t> decompressedData = decompressor.decompress(compressedData);
+    std::vector<uint8_t> decompressedData = StandardLzssDecoder::decode(compressedData);
 
     // 创建一个内存流来模拟文件输入
     std::istringstream memoryStream(std::string(decompressedData.begin(), decompressedData.end()));
@@ -6,6 +6,17 @@
 #include <zlib.h>
 #include <memory>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include "../../ZlibCodec.h"
+#include "../../MappedFile.h"
+#include "../../ThreadCount.h"
+#include "../../PackPipeline.h"
 
 namespace fs = std::filesystem;
 
@@ -21,190 +32,191 @@ struct Entry {
 };
 
 // 通用函数
-uint32_t ReadUInt32(std::ifstream& file) {
-    uint32_t value = 0;
-    file.read(reinterpret_cast<char*>(&value), 4);
-    return value;
-}
-
-void WriteUInt32(std::ofstream& file, uint32_t value) {
+void WriteUInt32(std::ostream& file, uint32_t value) {
     file.write(reinterpret_cast<const char*>(&value), 4);
 }
 
-// 解压函数
-std::vector<uint8_t> DecompressZLib(const std::vector<uint8_t>& input, uint32_t unpackedSize) {
-    std::vector<uint8_t> output(unpackedSize);
-    z_stream strm = {};
-
-    if (inflateInit(&strm) != Z_OK) {
-        throw std::runtime_error("Failed to initialize zlib");
-    }
-
-    strm.next_in = const_cast<uint8_t*>(input.data());
-    strm.avail_in = input.size();
-    strm.next_out = output.data();
-    strm.avail_out = unpackedSize;
-
-    int ret = inflate(&strm, Z_FINISH);
-    inflateEnd(&strm);
-
-    if (ret != Z_STREAM_END) {
-        throw std::runtime_error("Failed to decompress data");
+// 压缩函数
+std::vector<uint8_t> CompressZLib(const std::vector<uint8_t>& input, ZlibLevel level) {
+    std::vector<uint8_t> output;
+    if (!ZlibCodec::threadLocal().deflate(input.data(), input.size(), output, level)) {
+        throw std::runtime_error("Failed to compress data");
     }
-
     return output;
 }
 
-// 压缩函数
-std::vector<uint8_t> CompressZLib(const std::vector<uint8_t>& input) {
-    uLong compressedSize = compressBound(input.size());
-    std::vector<uint8_t> output(compressedSize);
+void ExtractYoxDat(const std::string& inputPath, const std::string& outputPath, int version, unsigned int numThreads) {
+    auto startTime = std::chrono::steady_clock::now();
 
-    z_stream strm = {};
-    if (deflateInit(&strm, Z_BEST_COMPRESSION) != Z_OK) {
-        throw std::runtime_error("Failed to initialize zlib");
+    std::unique_ptr<MappedFile> mapping;
+    try {
+        mapping = std::make_unique<MappedFile>(fs::path(inputPath));
     }
-
-    strm.next_in = const_cast<uint8_t*>(input.data());
-    strm.avail_in = input.size();
-    strm.next_out = output.data();
-    strm.avail_out = compressedSize;
-
-    deflate(&strm, Z_FINISH);
-    deflateEnd(&strm);
-
-    output.resize(strm.total_out);
-    return output;
-}
-
-void ExtractYoxDat(const std::string& inputPath, const std::string& outputPath, int version) {
-    std::ifstream file(inputPath, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open input file" << std::endl;
+    catch (const std::exception& e) {
+        std::cerr << "Failed to open input file: " << e.what() << std::endl;
         return;
     }
+    const ByteSpan view = mapping->span();
+    const size_t fileSize = view.size();
 
     // 读取文件头
-    uint32_t signature = ReadUInt32(file);
-    if (signature != 0x584F59) { // "YOX"
+    if (fileSize < 16 || view.u32le(0) != 0x584F59) { // "YOX"
         std::cerr << "Invalid YOX signature" << std::endl;
         return;
     }
 
-    file.seekg(8);
-    uint32_t indexOffset = ReadUInt32(file);
-    uint32_t count = ReadUInt32(file);
+    uint32_t indexOffset = view.u32le(8);
+    uint32_t count = view.u32le(12);
 
     std::cout << "File count: " << count << std::endl;
 
-    // 创建输出目录
-    fs::create_directories(outputPath);
-
-    // 读取索引
-    std::vector<Entry> entries;
-    file.seekg(indexOffset);
+    // 索引和每个条目开头的 YOX 子头都直接在映射上读取，一次扫完
     bool newVersion = version >= 2;
+    size_t stride = newVersion ? 16 : 8;
+    if (!view.contains(indexOffset, (uint64_t)count * stride)) {
+        std::cerr << "Invalid index offset or file count" << std::endl;
+        return;
+    }
 
-    // 尝试8字节条目格式
+    std::vector<Entry> entries(count);
+    SpanReader index(view, indexOffset);
     for (uint32_t i = 0; i < count; ++i) {
-        Entry entry;
-        entry.offset = ReadUInt32(file);
-        entry.size = ReadUInt32(file);
-        entry.isPacked = false;
-        entry.name = std::to_string(i);
-        while (entry.name.length() < 5) entry.name = "0" + entry.name;
-        entries.push_back(entry);
+        Entry& entry = entries[i];
+        entry.offset = index.u32le();
+        entry.size = index.u32le();
         if (newVersion) {
-            file.seekg(8, std::ios::cur);
+            index.skip(8);
         }
-    }
-
-    // 处理每个文件
-    for (auto& entry : entries) {
-        file.seekg(entry.offset);
+        entry.isPacked = false;
+        entry.unpackedSize = 0;
+        char name[16];
+        snprintf(name, sizeof(name), "%05u", i);
+        entry.name = name;
 
         // 检查是否为压缩文件
-        uint32_t entrySignature = ReadUInt32(file);
-        if (entrySignature == 0x584F59) {
-            uint32_t flags = ReadUInt32(file);
+        if (entry.size >= 0x10 && view.contains(entry.offset, 0x10) && view.u32le(entry.offset) == 0x584F59) {
+            uint32_t flags = view.u32le(entry.offset + 4);
             if (flags & 2) {
                 entry.isPacked = true;
-                entry.unpackedSize = ReadUInt32(file);
+                entry.unpackedSize = view.u32le(entry.offset + 8);
                 entry.offset += 0x10;
                 entry.size -= 0x10;
             }
         }
+    }
+
+    // 创建输出目录
+    fs::create_directories(outputPath);
 
-        // 读取文件数据
-        file.seekg(entry.offset);
-        std::vector<uint8_t> data(entry.size);
-        file.read(reinterpret_cast<char*>(data.data()), entry.size);
+    if (numThreads == 0) {
+        numThreads = defaultThreadCount();
+    }
+    numThreads = (unsigned int)std::min<size_t>(numThreads, std::max<size_t>(entries.size(), 1));
+
+    std::atomic<size_t> nextEntry{ 0 };
+    std::atomic<size_t> extracted{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::mutex outputMutex;
+
+    // 压缩条目解压到按 unpackedSize 预分配的缓冲区 (每个线程复用)，未压缩条目直接从映射写出
+    auto worker = [&]() {
+        std::vector<uint8_t> buffer;
+        for (size_t i = nextEntry++; i < entries.size(); i = nextEntry++) {
+            const Entry& entry = entries[i];
+            if (!view.contains(entry.offset, entry.size)) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Entry out of range: " << entry.name << std::endl;
+                continue;
+            }
 
-        // 如果是压缩文件，进行解压
-        if (entry.isPacked) {
-            try {
-                data = DecompressZLib(data, entry.unpackedSize);
+            const uint8_t* data = view.at(entry.offset, entry.size);
+            size_t dataSize = entry.size;
+            if (entry.isPacked) {
+                buffer.resize(entry.unpackedSize);
+                if (!ZlibCodec::threadLocal().inflate(data, entry.size, buffer.data(), buffer.size())) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cerr << "Failed to decompress file " << entry.name << ": Failed to decompress data" << std::endl;
+                    continue;
+                }
+                data = buffer.data();
+                dataSize = buffer.size();
             }
-            catch (const std::exception& e) {
-                std::cerr << "Failed to decompress file " << entry.name << ": " << e.what() << std::endl;
+
+            // 写入文件
+            std::string outPath = outputPath + "/" + entry.name;
+            std::ofstream outFile(outPath, std::ios::binary);
+            if (!outFile) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "Failed to create output file: " << entry.name << std::endl;
                 continue;
             }
-        }
 
-        // 写入文件
-        std::string outPath = outputPath + "/" + entry.name;
-        std::ofstream outFile(outPath, std::ios::binary);
-        if (!outFile) {
-            std::cerr << "Failed to create output file: " << entry.name << std::endl;
-            continue;
+            outFile.write(reinterpret_cast<const char*>(data), dataSize);
+            extracted++;
+            totalBytes += dataSize;
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << "Extracted: " << entry.name << (entry.isPacked ? " (Decompressed)" : "") << std::endl;
         }
+    };
 
-        outFile.write(reinterpret_cast<char*>(data.data()), data.size());
-        std::cout << "Extracted: " << entry.name << (entry.isPacked ? " (Decompressed)" : "") << std::endl;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
     }
 
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Extracted " << extracted << "/" << entries.size() << " files, "
+        << totalBytes / 1048576.0 << " MB in " << seconds << " s" << std::endl;
     std::cout << "Extraction completed!" << std::endl;
 }
 
-void PackYoxDat(const std::string& originalDat, const std::string& inputDir, const std::string& outputDat, int version, bool zlib) {
+void PackYoxDat(const std::string& originalDat, const std::string& inputDir, const std::string& outputDat, int version, bool zlib, ZlibLevel level, unsigned int numThreads) {
     // 读取原始DAT文件的头部和索引
-    std::ifstream origFile(originalDat, std::ios::binary);
-    if (!origFile) {
+    std::unique_ptr<MappedFile> origFile;
+    try {
+        origFile = std::make_unique<MappedFile>(fs::path(originalDat));
+    }
+    catch (const std::exception&) {
         throw std::runtime_error("Failed to open original DAT file");
     }
+    const ByteSpan orig = origFile->span();
 
     // 读取头部16字节
-    std::vector<uint8_t> header(16);
-    origFile.read(reinterpret_cast<char*>(header.data()), 16);
+    const ByteSpan header = orig.sub(0, 16);
 
     // 获取文件数量和原始索引偏移
-    origFile.seekg(0xC);
-    uint32_t fileCount = ReadUInt32(origFile);
-    origFile.seekg(0x8);
-    uint32_t origIndexOffset = ReadUInt32(origFile);
+    uint32_t fileCount = orig.u32le(0xC);
+    uint32_t origIndexOffset = orig.u32le(0x8);
 
     // 读取原始索引
-    std::vector<Entry> entries;
-    origFile.seekg(origIndexOffset);
+    struct YoxPackItem : PackItem {
+        uint32_t extra1 = 0;    // 新版本索引中额外的8字节数据
+        uint32_t extra2 = 0;
+    };
+    std::vector<YoxPackItem> entries(fileCount);
+    SpanReader index(orig, origIndexOffset);
     bool newVersion = version >= 2;
 
     for (uint32_t i = 0; i < fileCount; ++i) {
-        Entry entry;
-        entry.offset = ReadUInt32(origFile);
-        entry.size = ReadUInt32(origFile);
+        YoxPackItem& entry = entries[i];
+        index.u32le();  // 原偏移
+        index.u32le();  // 原大小
         if (newVersion) {
-            entry.extra1 = ReadUInt32(origFile);
-            entry.extra2 = ReadUInt32(origFile);
+            entry.extra1 = index.u32le();
+            entry.extra2 = index.u32le();
         }
-        entry.name = std::to_string(i);
-        while (entry.name.length() < 5) entry.name = "0" + entry.name;
-        entries.push_back(entry);
+        char name[16];
+        snprintf(name, sizeof(name), "%05u", i);
+        entry.name = name;
+        entry.path = fs::path(inputDir) / entry.name;
     }
 
-    size_t sundrySize = fs::file_size(originalDat) - origFile.tellg();
-    //std::cout << "sundrySize: " << std::hex << sundrySize << std::endl;
-    std::vector<uint8_t> sundryIndex(sundrySize);
-    origFile.read((char*)sundryIndex.data(), sundrySize);
+    // 原索引之后的其余数据原样保留
+    const ByteSpan sundryIndex = orig.sub(index.tell());
 
     // 创建输出文件
     std::ofstream outFile(outputDat, std::ios::binary);
@@ -215,77 +227,44 @@ void PackYoxDat(const std::string& originalDat, const std::string& inputDir, con
     // 写入头部
     outFile.write(reinterpret_cast<const char*>(header.data()), 16);
 
-    // 当前写入位置（从0x800开始）
-    uint32_t currentOffset = 0x800;
-    outFile.seekp(currentOffset);
-
-    // 处理每个文件
-    for (auto& entry : entries) {
-        std::string inPath = inputDir + "/" + entry.name;
-        std::ifstream inFile(inPath, std::ios::binary);
-        if (!inFile) {
-            throw std::runtime_error("Failed to open input file: " + inPath);
-        }
-
-        // 读取文件内容
-        inFile.seekg(0, std::ios::end);
-        size_t fileSize = inFile.tellg();
-        inFile.seekg(0);
-        std::vector<uint8_t> fileData(fileSize);
-        inFile.read(reinterpret_cast<char*>(fileData.data()), fileSize);
-
-        // 压缩数据
-        std::vector<uint8_t> finalData;
-        if (zlib) {
-            finalData = CompressZLib(fileData);
-            WriteUInt32(outFile, 0x584F59);  // "YOX"
-            WriteUInt32(outFile, 2);         // 压缩标志
-            WriteUInt32(outFile, fileSize);  // 解压后大小
-            WriteUInt32(outFile, 0);         // 保留
-        }
-        else {
-            finalData = fileData;
-            //WriteUInt32(outFile, 0x584F59);  // "YOX"
-            //WriteUInt32(outFile, 0);         // 压缩标志
-            //WriteUInt32(outFile, fileSize);  // 解压后大小
-            //WriteUInt32(outFile, 0);         // 保留
-        }
-
-        // 写入压缩数据
-        outFile.write(reinterpret_cast<const char*>(finalData.data()), finalData.size());
-
-        // 更新索引信息
-        entry.offset = currentOffset;
-        entry.size = finalData.size();
-        if (zlib) {
-            entry.size += 16;
-        }
-        entry.unpackedSize = fileSize;
-
-        // 计算下一个0x800对齐的位置
-        currentOffset += entry.size;
-        if (currentOffset % 0x800 != 0) {
-            currentOffset = (currentOffset + 0x800) & ~0x7FF;
-        }
-        outFile.seekp(currentOffset);
-        //std::cout << "C" << std::endl;
+    // 读取和压缩由 PackPipeline 的工作线程完成，数据从 0x800 开始按索引顺序写出，每个文件 0x800 对齐
+    PackHooks<YoxPackItem> hooks;
+    if (zlib) {
+        hooks.transform = [&](YoxPackItem& entry) {
+            std::vector<uint8_t> compressed = CompressZLib(entry.data, level);
+            const uint32_t yoxHeader[4] = {
+                0x584F59,                     // "YOX"
+                2,                            // 压缩标志
+                (uint32_t)entry.data.size(),  // 解压后大小
+                0                             // 保留
+            };
+            entry.data.resize(sizeof(yoxHeader) + compressed.size());
+            memcpy(entry.data.data(), yoxHeader, sizeof(yoxHeader));
+            memcpy(entry.data.data() + sizeof(yoxHeader), compressed.data(), compressed.size());
+        };
     }
-
-    // 写入索引表
-    uint32_t indexOffset = currentOffset;
-    for (const auto& entry : entries) {
-        WriteUInt32(outFile, entry.offset);
-        WriteUInt32(outFile, entry.size);
-        if (newVersion) {
-            WriteUInt32(outFile, entry.extra1);
-            WriteUInt32(outFile, entry.extra2);
+    hooks.align = [](const YoxPackItem&, uint64_t offset) {
+        return (offset + 0x7FF) & ~(uint64_t)0x7FF;
+    };
+    // 索引表写在数据之后的下一个0x800对齐位置，再更新头部中的索引偏移
+    hooks.emitIndex = [&](std::ostream& out, std::vector<YoxPackItem>& entries, uint64_t dataEnd) {
+        uint32_t indexOffset = (uint32_t)((dataEnd + 0x7FF) & ~(uint64_t)0x7FF);
+        out.seekp(indexOffset);
+        for (const auto& entry : entries) {
+            WriteUInt32(out, (uint32_t)entry.offset);
+            WriteUInt32(out, (uint32_t)entry.size);
+            if (newVersion) {
+                WriteUInt32(out, entry.extra1);
+                WriteUInt32(out, entry.extra2);
+            }
         }
-    }
-    outFile.write((char*)sundryIndex.data(), sundryIndex.size());
+        out.write(reinterpret_cast<const char*>(sundryIndex.data()), sundryIndex.size());
 
-    // 更新头部中的索引偏移
-    outFile.seekp(0x8);
-    WriteUInt32(outFile, indexOffset);
+        out.seekp(0x8);
+        WriteUInt32(out, indexOffset);
+    };
+
+    runPackPipeline(outFile, entries, 0x800, hooks, numThreads);
 
     std::cout << "Packing completed successfully!" << std::endl;
 }
@@ -293,10 +272,12 @@ void PackYoxDat(const std::string& originalDat, const std::string& inputDir, con
 void PrintUsage(const char* programName) {
     std::cout << "Made by julixian 2025.03.17" << std::endl;
     std::cout << "Usage:\n"
-        << "Extract: " << programName << " -e <version> <input.dat> <output_directory>\n"
-        << "Pack:    " << programName << " -p <version> [--zlib] <original.dat> <input_directory> <output.dat>\n"
+        << "Extract: " << programName << " -e <version> [--threads N] <input.dat> <output_directory>\n"
+        << "Pack:    " << programName << " -p <version> [--zlib] [--level fast|balanced|max] [--threads N] <original.dat> <input_directory> <output.dat>\n"
         << "version: 1 or 2" << "\n"
-        << "--zlib: use zlib compress when repacking, usually used for script.dat" << std::endl;
+        << "--zlib: use zlib compress when repacking, usually used for script.dat" << "\n"
+        << "--level: zlib compression level, default max" << "\n"
+        << "--threads: worker threads, default hardware concurrency" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -307,15 +288,43 @@ int main(int argc, char* argv[]) {
 
     std::string mode = argv[1];
     int version = std::stoi(std::string(argv[2]));
-    bool zlib = mode == "-p" && std::string(argv[3]) == "--zlib";
+    bool zlib = false;
+    ZlibLevel level = ZlibLevel::Max;
+    unsigned int numThreads = 0;
+    if (mode == "-e" || mode == "-p") {
+        int optionsEnd = argc - (mode == "-e" ? 2 : 3);
+        for (int i = 3; i < optionsEnd; ++i) {
+            std::string option = argv[i];
+            if (option == "--zlib" && mode == "-p") {
+                zlib = true;
+            }
+            else if (option == "--level" && mode == "-p" && i + 1 < optionsEnd && parseZlibLevel(argv[i + 1], level)) {
+                ++i;
+            }
+            else if (option == "--threads" && i + 1 < optionsEnd) {
+                // 非数字、超出范围或为 0 时打印用法
+                const char* value = argv[++i];
+                const char* end = value + strlen(value);
+                auto [ptr, ec] = std::from_chars(value, end, numThreads);
+                if (ec != std::errc() || ptr != end || numThreads == 0) {
+                    PrintUsage(argv[0]);
+                    return 1;
+                }
+            }
+            else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+    }
 
     if (mode == "-e") {
         // 解包模式
-        ExtractYoxDat(argv[argc - 2], argv[argc - 1], version);
+        ExtractYoxDat(argv[argc - 2], argv[argc - 1], version, numThreads);
     }
     else if (mode == "-p") {
         // 封包模式
-        PackYoxDat(argv[argc - 3], argv[argc - 2], argv[argc - 1], version, zlib);
+        PackYoxDat(argv[argc - 3], argv[argc - 2], argv[argc - 1], version, zlib, level, numThreads);
     }
     else {
         PrintUsage(argv[0]);
@@ -0,0 +1,368 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#include "ThreadCount.h"
+
+// 各 zlib 封包工具共用的编解码层。
+// 原先每个条目都要 inflateInit/inflateEnd (约 7 KB 状态 + 32 KB 窗口) 或 deflateInit (约 256 KB)，
+// 小文件多的封包里初始化的开销比解压本身还大。这里每个线程保留一对 z_stream，
+// 之后的条目只做 inflateReset/deflateReset。
+//
+// 后端：
+//   默认使用 zlib。链接 zlib-ng 的兼容模式 (ZLIB_COMPAT) 库即可直接替换，无需改代码。
+//   定义 ZLIB_CODEC_USE_LIBDEFLATE 并链接 libdeflate 后，已知大小的解压和压缩改走 libdeflate，
+//   输出仍是标准 zlib 流 (CMF/FLG 头 + deflate + Adler-32)，游戏端照常读取。
+//
+// 压缩级别：Max 与原先的 Z_BEST_COMPRESSION (windowBits 15, memLevel 8) 完全相同，
+// 默认使用 Max 时 zlib 后端的输出与旧版工具逐字节一致。
+// 同一个 ZlibCodec 对象不能被多个线程同时使用，多线程时用 threadLocal()。
+
+enum class ZlibLevel {
+    Fast,       // zlib 1 / libdeflate 1
+    Balanced,   // zlib 6 / libdeflate 6
+    Max         // zlib 9 / libdeflate 12
+};
+
+inline bool parseZlibLevel(const std::string& name, ZlibLevel& level) {
+    if (name == "fast") level = ZlibLevel::Fast;
+    else if (name == "balanced") level = ZlibLevel::Balanced;
+    else if (name == "max") level = ZlibLevel::Max;
+    else return false;
+    return true;
+}
+
+inline const char* zlibLevelName(ZlibLevel level) {
+    switch (level) {
+    case ZlibLevel::Fast: return "fast";
+    case ZlibLevel::Balanced: return "balanced";
+    default: return "max";
+    }
+}
+
+class ZlibCodec {
+public:
+    ZlibCodec() = default;
+    ZlibCodec(const ZlibCodec&) = delete;
+    ZlibCodec& operator=(const ZlibCodec&) = delete;
+
+    ~ZlibCodec() {
+        if (m_inflateReady) inflateEnd(&m_inflate);
+        if (m_deflateReady) deflateEnd(&m_deflate);
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        if (m_decompressor) libdeflate_free_decompressor(m_decompressor);
+        for (auto* compressor : m_compressors) {
+            if (compressor) libdeflate_free_compressor(compressor);
+        }
+#endif
+    }
+
+    static ZlibCodec& threadLocal() {
+        thread_local ZlibCodec codec;
+        return codec;
+    }
+
+    static const char* backendName() {
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        return "libdeflate";
+#else
+        return "zlib " ZLIB_VERSION;
+#endif
+    }
+
+    // 一次性解压到已知大小的缓冲区。流必须完整结束 (与原先 inflate(Z_FINISH) == Z_STREAM_END 的判断相同)，
+    // 解出的数据比 dstSize 少时同样视为成功，实际大小写入 produced
+    bool inflate(const void* src, size_t srcSize, void* dst, size_t dstSize, size_t* produced = nullptr) {
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        if (!m_decompressor && !(m_decompressor = libdeflate_alloc_decompressor())) {
+            return false;
+        }
+        size_t inUsed = 0, outUsed = 0;
+        if (libdeflate_zlib_decompress_ex(m_decompressor, src, srcSize, dst, dstSize, &inUsed, &outUsed) != LIBDEFLATE_SUCCESS) {
+            return false;
+        }
+        if (produced) *produced = outUsed;
+        return true;
+#else
+        if (!resetInflate()) {
+            return false;
+        }
+        // 空 vector 的 data() 可能是 nullptr，zlib 遇到 next_out 为空会直接返回 Z_STREAM_ERROR
+        Bytef empty = 0;
+        m_inflate.next_in = const_cast<Bytef*>(static_cast<const Bytef*>(src));
+        m_inflate.avail_in = static_cast<uInt>(srcSize);
+        m_inflate.next_out = dst ? static_cast<Bytef*>(dst) : &empty;
+        m_inflate.avail_out = static_cast<uInt>(dstSize);
+        if (::inflate(&m_inflate, Z_FINISH) != Z_STREAM_END) {
+            return false;
+        }
+        if (produced) *produced = m_inflate.total_out;
+        return true;
+#endif
+    }
+
+    bool inflate(const std::vector<uint8_t>& src, std::vector<uint8_t>& dst) {
+        size_t produced = 0;
+        if (!inflate(src.data(), src.size(), dst.data(), dst.size(), &produced)) {
+            return false;
+        }
+        dst.resize(produced);
+        return true;
+    }
+
+    // 解压大小未知的流，输出缓冲区按需倍增。sizeHint 为 0 时从输入的 4 倍开始猜
+    bool inflateUnknown(const void* src, size_t srcSize, std::vector<uint8_t>& dst, size_t sizeHint = 0) {
+        size_t capacity = sizeHint ? sizeHint : std::max<size_t>(srcSize * 4, 16384);
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        if (!m_decompressor && !(m_decompressor = libdeflate_alloc_decompressor())) {
+            return false;
+        }
+        for (;;) {
+            dst.resize(capacity);
+            size_t inUsed = 0, outUsed = 0;
+            auto result = libdeflate_zlib_decompress_ex(m_decompressor, src, srcSize, dst.data(), dst.size(), &inUsed, &outUsed);
+            if (result == LIBDEFLATE_SUCCESS) {
+                dst.resize(outUsed);
+                return true;
+            }
+            if (result != LIBDEFLATE_INSUFFICIENT_SPACE) {
+                return false;
+            }
+            capacity *= 2;
+        }
+#else
+        if (!resetInflate()) {
+            return false;
+        }
+        dst.resize(capacity);
+        m_inflate.next_in = const_cast<Bytef*>(static_cast<const Bytef*>(src));
+        m_inflate.avail_in = static_cast<uInt>(srcSize);
+        for (;;) {
+            m_inflate.next_out = dst.data() + m_inflate.total_out;
+            m_inflate.avail_out = static_cast<uInt>(dst.size() - m_inflate.total_out);
+            int ret = ::inflate(&m_inflate, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                dst.resize(m_inflate.total_out);
+                return true;
+            }
+            // 输出满了就扩容继续；输入耗尽仍未结束说明流被截断
+            if ((ret != Z_OK && ret != Z_BUF_ERROR) || m_inflate.avail_out != 0) {
+                return false;
+            }
+            dst.resize(dst.size() * 2);
+        }
+#endif
+    }
+
+    // 压缩结果的上限，用于调用方自行准备缓冲区
+    size_t deflateBound(size_t srcSize, ZlibLevel level = ZlibLevel::Max) {
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        if (auto* compressor = compressorFor(level)) {
+            return libdeflate_zlib_compress_bound(compressor, srcSize);
+        }
+#endif
+        (void)level;
+        return compressBound(static_cast<uLong>(srcSize));
+    }
+
+    // 压缩到调用方提供的缓冲区，dstSize 传入容量、返回实际大小
+    bool deflate(const void* src, size_t srcSize, void* dst, size_t& dstSize, ZlibLevel level = ZlibLevel::Max) {
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+        auto* compressor = compressorFor(level);
+        if (!compressor) {
+            return false;
+        }
+        size_t written = libdeflate_zlib_compress(compressor, src, srcSize, dst, dstSize);
+        if (written == 0) {
+            return false;
+        }
+        dstSize = written;
+        return true;
+#else
+        if (!resetDeflate(level)) {
+            return false;
+        }
+        m_deflate.next_in = const_cast<Bytef*>(static_cast<const Bytef*>(src));
+        m_deflate.avail_in = static_cast<uInt>(srcSize);
+        m_deflate.next_out = static_cast<Bytef*>(dst);
+        m_deflate.avail_out = static_cast<uInt>(dstSize);
+        if (::deflate(&m_deflate, Z_FINISH) != Z_STREAM_END) {
+            return false;
+        }
+        dstSize = m_deflate.total_out;
+        return true;
+#endif
+    }
+
+    bool deflate(const void* src, size_t srcSize, std::vector<uint8_t>& out, ZlibLevel level = ZlibLevel::Max) {
+        out.resize(deflateBound(srcSize, level));
+        size_t written = out.size();
+        if (!deflate(src, srcSize, out.data(), written, level)) {
+            return false;
+        }
+        out.resize(written);
+        return true;
+    }
+
+private:
+    static int zlibLevel(ZlibLevel level) {
+        switch (level) {
+        case ZlibLevel::Fast: return 1;
+        case ZlibLevel::Balanced: return 6;
+        default: return Z_BEST_COMPRESSION;
+        }
+    }
+
+    bool resetInflate() {
+        if (m_inflateReady) {
+            return ::inflateReset(&m_inflate) == Z_OK;
+        }
+        std::memset(&m_inflate, 0, sizeof(m_inflate));
+        m_inflateReady = inflateInit(&m_inflate) == Z_OK;
+        return m_inflateReady;
+    }
+
+    bool resetDeflate(ZlibLevel level) {
+        int wanted = zlibLevel(level);
+        if (!m_deflateReady) {
+            std::memset(&m_deflate, 0, sizeof(m_deflate));
+            m_deflateReady = deflateInit2(&m_deflate, wanted, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            m_deflateLevel = wanted;
+            return m_deflateReady;
+        }
+        if (::deflateReset(&m_deflate) != Z_OK) {
+            return false;
+        }
+        // 刚 reset 过的流没有待输出的数据，deflateParams 只切换参数
+        if (wanted != m_deflateLevel) {
+            if (::deflateParams(&m_deflate, wanted, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            m_deflateLevel = wanted;
+        }
+        return true;
+    }
+
+#ifdef ZLIB_CODEC_USE_LIBDEFLATE
+    libdeflate_compressor* compressorFor(ZlibLevel level) {
+        static const int levels[] = { 1, 6, 12 };
+        auto index = static_cast<size_t>(level);
+        if (!m_compressors[index]) {
+            m_compressors[index] = libdeflate_alloc_compressor(levels[index]);
+        }
+        return m_compressors[index];
+    }
+
+    libdeflate_decompressor* m_decompressor = nullptr;
+    libdeflate_compressor* m_compressors[3] = {};
+#endif
+
+    z_stream m_inflate{};
+    z_stream m_deflate{};
+    bool m_inflateReady = false;
+    bool m_deflateReady = false;
+    int m_deflateLevel = 0;
+};
+
+// 分块并行压缩 (与 pigz 相同的做法)，输出仍是一个标准 zlib 流：
+// 每块用 raw deflate 压缩，以前一块末尾 32 KB 作为预设字典，非末块以 Z_SYNC_FLUSH 结束以便字节对齐拼接，
+// 各块的 Adler-32 用 adler32_combine 合成尾部校验。由于需要预设字典，这里始终使用 zlib 而不是 libdeflate。
+// 压缩率与整体压缩相差很小 (每块约多 5 字节)，但结果不再与单线程 compress2 逐字节相同；
+// 只有一块或 threads 为 1 时退回 ZlibCodec::deflate，输出与原来一致。
+inline bool zlibDeflateParallel(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& out,
+    ZlibLevel level = ZlibLevel::Max, unsigned int threads = 0, size_t blockSize = 1 << 20) {
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    size_t blockCount = srcSize ? (srcSize + blockSize - 1) / blockSize : 1;
+    if (threads == 1 || blockCount == 1) {
+        return ZlibCodec::threadLocal().deflate(src, srcSize, out, level);
+    }
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, blockCount));
+
+    int zlevel = level == ZlibLevel::Fast ? 1 : level == ZlibLevel::Balanced ? 6 : Z_BEST_COMPRESSION;
+    std::vector<std::vector<uint8_t>> blocks(blockCount);
+    std::vector<uLong> checksums(blockCount);
+    std::atomic<size_t> nextBlock{ 0 };
+    std::atomic<bool> failed{ false };
+
+    auto worker = [&]() {
+        z_stream strm{};
+        if (deflateInit2(&strm, zlevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            failed = true;
+            return;
+        }
+        size_t index;
+        while (!failed && (index = nextBlock++) < blockCount) {
+            size_t start = index * blockSize;
+            size_t length = std::min(blockSize, srcSize - start);
+            bool last = index + 1 == blockCount;
+            deflateReset(&strm);
+            if (start > 0) {
+                size_t dictSize = std::min<size_t>(start, 32768);
+                deflateSetDictionary(&strm, src + start - dictSize, static_cast<uInt>(dictSize));
+            }
+            // 加上同步刷新的空存储块和余量
+            std::vector<uint8_t>& block = blocks[index];
+            block.resize(::deflateBound(&strm, static_cast<uLong>(length)) + 16);
+            strm.next_in = const_cast<Bytef*>(src + start);
+            strm.avail_in = static_cast<uInt>(length);
+            strm.next_out = block.data();
+            strm.avail_out = static_cast<uInt>(block.size());
+            int ret = ::deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+            if (last ? ret != Z_STREAM_END : (ret != Z_OK || strm.avail_in != 0 || strm.avail_out == 0)) {
+                failed = true;
+                break;
+            }
+            block.resize(block.size() - strm.avail_out);
+            checksums[index] = adler32(adler32(0, Z_NULL, 0), src + start, static_cast<uInt>(length));
+        }
+        deflateEnd(&strm);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    if (failed) {
+        return false;
+    }
+
+    // zlib 头：CMF 0x78 (32 KB 窗口)，FLEVEL 与 zlib 自身的取值规则一致
+    unsigned int flevel = zlevel < 2 ? 0 : zlevel < 6 ? 1 : zlevel == 6 ? 2 : 3;
+    unsigned int header = (0x78 << 8) | (flevel << 6);
+    header += 31 - header % 31;
+
+    size_t total = 6;
+    for (const auto& block : blocks) {
+        total += block.size();
+    }
+    out.clear();
+    out.reserve(total);
+    out.push_back(static_cast<uint8_t>(header >> 8));
+    out.push_back(static_cast<uint8_t>(header));
+    uLong checksum = checksums[0];
+    for (size_t i = 0; i < blockCount; ++i) {
+        out.insert(out.end(), blocks[i].begin(), blocks[i].end());
+        if (i > 0) {
+            checksum = adler32_combine(checksum, checksums[i], static_cast<z_off_t>(std::min(blockSize, srcSize - i * blockSize)));
+        }
+    }
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(checksum >> shift));
+    }
+    return true;
+}
@@ -0,0 +1,267 @@
+﻿// ZlibCodec.h 的解包/封包吞吐基准：与各工具原先每个条目 inflateInit/compress2 的写法对比，
+// 并按各工具实际调用 ZlibCodec 的方式 (已知大小解压、未知大小解压、压缩到 vector/定长缓冲区、
+// 多线程逐条目解压、分块并行压缩整个封包) 分别测量
+// 用法: ZlibCodecBench [input_dir] [iterations]
+// 指定目录时把目录下所有文件作为条目；否则按几个工具的典型条目构成生成合成数据：
+//   names   MyAdv 的文件名块 (几十字节)
+//   scripts Seraph/AZsys/ScoopFx 的脚本 (4~64 KB)
+//   images  FrontWing/YoxDat/MTSPakZ 的图像 (256 KB~1 MB)
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include "ZlibCodec.h"
+
+struct BenchSet {
+    std::string name;
+    std::vector<std::vector<uint8_t>> entries;
+    size_t totalBytes = 0;
+};
+
+// 原写法，保留作对照
+bool legacyInflate(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+    z_stream strm = {};
+    if (inflateInit(&strm) != Z_OK) {
+        return false;
+    }
+    strm.next_in = const_cast<Bytef*>(input.data());
+    strm.avail_in = static_cast<uInt>(input.size());
+    strm.next_out = output.data();
+    strm.avail_out = static_cast<uInt>(output.size());
+    int ret = inflate(&strm, Z_FINISH);
+    inflateEnd(&strm);
+    return ret == Z_STREAM_END;
+}
+
+std::vector<uint8_t> legacyCompress(const std::vector<uint8_t>& input) {
+    uLongf size = compressBound(static_cast<uLong>(input.size()));
+    std::vector<uint8_t> output(size);
+    compress2(output.data(), &size, input.data(), static_cast<uLong>(input.size()), Z_BEST_COMPRESSION);
+    output.resize(size);
+    return output;
+}
+
+std::vector<uint8_t> makeEntry(std::mt19937& rng, size_t size) {
+    static const char text[] = "\xE3\x80\x8C\xE3\x81\x8A\xE3\x81\xAF\xE3\x82\x88\xE3\x81\x86\xE3\x80\x8D scenario text line, @voice 0012; ";
+    std::vector<uint8_t> data(size);
+    uint8_t pixel = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (rng() % 6 == 0) {
+            pixel = static_cast<uint8_t>(rng());
+        }
+        data[i] = (rng() % 3 == 0) ? pixel : static_cast<uint8_t>(text[i % (sizeof(text) - 1)]);
+    }
+    return data;
+}
+
+BenchSet makeSet(const std::string& name, size_t count, size_t minSize, size_t maxSize, uint32_t seed) {
+    BenchSet set;
+    set.name = name;
+    std::mt19937 rng(seed);
+    for (size_t i = 0; i < count; ++i) {
+        size_t size = minSize + rng() % (maxSize - minSize + 1);
+        set.entries.push_back(makeEntry(rng, size));
+        set.totalBytes += size;
+    }
+    return set;
+}
+
+template<typename Func>
+double measure(int iterations, size_t bytes, Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return bytes * (double)iterations / elapsed.count() / (1024.0 * 1024.0);
+}
+
+// MyAdv/YoxDat 的提取方式：工作线程按原子下标领取条目，各用自己线程的 ZlibCodec 解压
+bool parallelInflate(const std::vector<std::vector<uint8_t>>& packed, std::vector<std::vector<uint8_t>>& buffers, unsigned int numThreads) {
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> ok{ true };
+    auto worker = [&]() {
+        ZlibCodec& codec = ZlibCodec::threadLocal();
+        for (size_t i = next++; i < packed.size(); i = next++) {
+            if (!codec.inflate(packed[i].data(), packed[i].size(), buffers[i].data(), buffers[i].size())) {
+                ok = false;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return ok;
+}
+
+// 各工具调用 ZlibCodec 的路径，默认级别 (Max)；每条路径先校验结果能还原再计时
+void runToolPaths(const BenchSet& set, const std::vector<std::vector<uint8_t>>& packed, int iterations) {
+    ZlibCodec& codec = ZlibCodec::threadLocal();
+    unsigned int numThreads = defaultThreadCount();
+
+    std::vector<std::vector<uint8_t>> buffers;
+    for (const auto& entry : set.entries) {
+        buffers.emplace_back(entry.size());
+    }
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> unknown;
+    std::vector<uint8_t> fixed;
+
+    // MTSPakZ 把整个 PAK 作为一个 zlib 流，这里把全部条目拼起来模拟
+    std::vector<uint8_t> image;
+    image.reserve(set.totalBytes);
+    for (const auto& entry : set.entries) {
+        image.insert(image.end(), entry.begin(), entry.end());
+    }
+    std::vector<uint8_t> imagePacked;
+
+    for (size_t i = 0; i < set.entries.size(); ++i) {
+        const auto& entry = set.entries[i];
+        size_t fixedSize = codec.deflateBound(entry.size());
+        fixed.resize(fixedSize);
+        if (!codec.inflateUnknown(packed[i].data(), packed[i].size(), unknown) || unknown != entry ||
+            !codec.deflate(entry.data(), entry.size(), fixed.data(), fixedSize) ||
+            !codec.inflate(fixed.data(), fixedSize, buffers[i].data(), buffers[i].size()) || buffers[i] != entry) {
+            std::cout << "  tool paths: output mismatch!" << std::endl;
+            return;
+        }
+    }
+    if (!parallelInflate(packed, buffers, numThreads) || buffers != set.entries ||
+        !zlibDeflateParallel(image.data(), image.size(), imagePacked, ZlibLevel::Max, numThreads) ||
+        !codec.inflateUnknown(imagePacked.data(), imagePacked.size(), unknown, imagePacked.size() * 4) || unknown != image) {
+        std::cout << "  tool paths: output mismatch!" << std::endl;
+        return;
+    }
+
+    auto print = [&](const char* path, const char* tools, double speed) {
+        std::cout << "  " << std::left << std::setw(22) << path << std::setw(36) << tools << std::right
+            << std::setw(8) << speed << " MB/s" << std::endl;
+    };
+
+    print("inflate", "FrontWing/MyAdv/ScoopFx/AZsys", measure(iterations, set.totalBytes, [&]() {
+        for (size_t i = 0; i < packed.size(); ++i) codec.inflate(packed[i].data(), packed[i].size(), buffers[i].data(), buffers[i].size());
+    }));
+    print("inflateUnknown", "Seraph", measure(iterations, set.totalBytes, [&]() {
+        for (size_t i = 0; i < packed.size(); ++i) codec.inflateUnknown(packed[i].data(), packed[i].size(), unknown);
+    }));
+    std::string workers = "MyAdv/YoxDat, " + std::to_string(numThreads) + " threads";
+    print("inflate (workers)", workers.c_str(), measure(iterations, set.totalBytes, [&]() {
+        parallelInflate(packed, buffers, numThreads);
+    }));
+    print("deflate -> vector", "FrontWing/MyAdv/Seraph/ScoopFx/YoxDat", measure(iterations, set.totalBytes, [&]() {
+        for (const auto& entry : set.entries) codec.deflate(entry.data(), entry.size(), out);
+    }));
+    print("deflate -> buffer", "AZsys", measure(iterations, set.totalBytes, [&]() {
+        for (const auto& entry : set.entries) {
+            size_t fixedSize = codec.deflateBound(entry.size());
+            fixed.resize(fixedSize);
+            codec.deflate(entry.data(), entry.size(), fixed.data(), fixedSize);
+        }
+    }));
+    print("inflateUnknown (pak)", "MTSPakZ", measure(iterations, set.totalBytes, [&]() {
+        codec.inflateUnknown(imagePacked.data(), imagePacked.size(), unknown, imagePacked.size() * 4);
+    }));
+    std::string parallel = "MTSPakZ, " + std::to_string(numThreads) + " threads";
+    print("zlibDeflateParallel", parallel.c_str(), measure(iterations, set.totalBytes, [&]() {
+        zlibDeflateParallel(image.data(), image.size(), imagePacked, ZlibLevel::Max, numThreads);
+    }));
+}
+
+void runSet(const BenchSet& set, int iterations) {
+    ZlibCodec& codec = ZlibCodec::threadLocal();
+    std::vector<std::vector<uint8_t>> packed;
+    for (const auto& entry : set.entries) {
+        packed.push_back(legacyCompress(entry));
+    }
+
+    // 默认级别必须与原 compress2(Z_BEST_COMPRESSION) 一致 (zlib 后端)，解压结果必须还原
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < set.entries.size(); ++i) {
+        std::vector<uint8_t> unpacked(set.entries[i].size());
+        if (!codec.inflate(packed[i], unpacked) || unpacked != set.entries[i] ||
+            !codec.deflate(set.entries[i].data(), set.entries[i].size(), out) ||
+            (std::string(ZlibCodec::backendName()).rfind("zlib", 0) == 0 && out != packed[i])) {
+            std::cout << set.name << ": output mismatch!" << std::endl;
+            return;
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> buffers;
+    for (const auto& entry : set.entries) {
+        buffers.emplace_back(entry.size());
+    }
+
+    std::cout << set.name << " (" << set.entries.size() << " entries, " << set.totalBytes / 1024 << " KB)" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    double legacyExtract = measure(iterations, set.totalBytes, [&]() {
+        for (size_t i = 0; i < packed.size(); ++i) legacyInflate(packed[i], buffers[i]);
+    });
+    double codecExtract = measure(iterations, set.totalBytes, [&]() {
+        for (size_t i = 0; i < packed.size(); ++i) codec.inflate(packed[i].data(), packed[i].size(), buffers[i].data(), buffers[i].size());
+    });
+    std::cout << "  extract  legacy " << std::setw(8) << legacyExtract << " MB/s | codec " << std::setw(8) << codecExtract << " MB/s" << std::endl;
+
+    size_t legacySize = 0;
+    double legacyPack = measure(iterations, set.totalBytes, [&]() {
+        legacySize = 0;
+        for (const auto& entry : set.entries) legacySize += legacyCompress(entry).size();
+    });
+    std::cout << "  pack     legacy " << std::setw(8) << legacyPack << " MB/s  ratio " << std::setprecision(3) << (double)legacySize / set.totalBytes << std::setprecision(1) << std::endl;
+
+    for (ZlibLevel level : { ZlibLevel::Fast, ZlibLevel::Balanced, ZlibLevel::Max }) {
+        size_t packedSize = 0;
+        double speed = measure(iterations, set.totalBytes, [&]() {
+            packedSize = 0;
+            for (const auto& entry : set.entries) {
+                codec.deflate(entry.data(), entry.size(), out, level);
+                packedSize += out.size();
+            }
+        });
+        std::cout << "  pack     " << std::left << std::setw(8) << zlibLevelName(level) << std::right << "   " << std::setw(8) << speed
+            << " MB/s  ratio " << std::setprecision(3) << (double)packedSize / set.totalBytes << std::setprecision(1) << std::endl;
+    }
+
+    runToolPaths(set, packed, iterations);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<BenchSet> sets;
+    if (argc >= 2) {
+        BenchSet set;
+        set.name = argv[1];
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[1])) {
+            if (!entry.is_regular_file()) continue;
+            std::ifstream ifs(entry.path(), std::ios::binary);
+            set.entries.emplace_back(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            set.totalBytes += set.entries.back().size();
+        }
+        if (set.entries.empty()) {
+            std::cerr << "No files in: " << argv[1] << std::endl;
+            return 1;
+        }
+        sets.push_back(std::move(set));
+    }
+    else {
+        sets.push_back(makeSet("names", 4000, 16, 96, 1));
+        sets.push_back(makeSet("scripts", 400, 4 * 1024, 64 * 1024, 2));
+        sets.push_back(makeSet("images", 24, 256 * 1024, 1024 * 1024, 3));
+    }
+    int iterations = argc >= 3 ? std::stoi(argv[2]) : 3;
+
+    std::cout << "Backend: " << ZlibCodec::backendName() << std::endl;
+    for (const auto& set : sets) {
+        runSet(set, iterations);
+    }
+    return 0;
+}